@@ -0,0 +1,206 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#include "arena.h"
+#include "util.h"
+#include "wincompat.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_MIN_CHUNK_SIZE 4096
+#define ARENA_MAX_CHUNK_SIZE (1024 * 1024)
+
+/* Each chunk is a header followed by its data; the header is padded so that
+ * the data starts on an ARENA_ALIGNMENT boundary.
+ */
+typedef struct arena_chunk_t
+{
+  struct arena_chunk_t *next;
+  size_t size;
+  size_t used;
+} arena_chunk_t;
+
+#define ARENA_HEADER_SIZE                                               \
+  ((sizeof(arena_chunk_t) + (ARENA_ALIGNMENT - 1))                      \
+   & ~((size_t)ARENA_ALIGNMENT - 1))
+
+/* ------------------------------------------------------------------------- */
+
+config_arena_t *libconfig_arena_create(void)
+{
+  config_arena_t *arena = __new(config_arena_t);
+  arena->next_chunk_size = ARENA_MIN_CHUNK_SIZE;
+  return(arena);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_arena_destroy(config_arena_t *arena)
+{
+  arena_chunk_t *chunk, *next;
+
+  if(! arena)
+    return;
+
+  for(chunk = arena->chunks; chunk; chunk = next)
+  {
+    next = chunk->next;
+    __delete(chunk);
+  }
+
+  for(chunk = arena->adopted; chunk; chunk = next)
+  {
+    next = chunk->next;
+    __delete(chunk);
+  }
+
+  __delete(arena);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void *__arena_alloc(config_arena_t *arena, size_t size,
+                           size_t alignment)
+{
+  arena_chunk_t *chunk = arena->chunks;
+  size_t offset = 0;
+  void *p;
+
+  if(chunk)
+    offset = (chunk->used + (alignment - 1)) & ~(alignment - 1);
+
+  if(! chunk || (offset > chunk->size) || ((chunk->size - offset) < size))
+  {
+    size_t chunk_size = arena->next_chunk_size;
+
+    if(size > (chunk_size / 2))
+    {
+      /* Large requests get a chunk of their own, which is linked in behind
+       * the current chunk so that its free space is not abandoned.
+       */
+      chunk = (arena_chunk_t *)libconfig_calloc(1, ARENA_HEADER_SIZE + size);
+      chunk->size = chunk->used = size;
+
+      if(arena->chunks)
+      {
+        chunk->next = arena->chunks->next;
+        arena->chunks->next = chunk;
+      }
+      else
+        arena->chunks = chunk;
+
+      return((char *)chunk + ARENA_HEADER_SIZE);
+    }
+
+    /* Chunks grow geometrically, so that a large tree needs few of them. */
+    chunk = (arena_chunk_t *)libconfig_calloc(1, ARENA_HEADER_SIZE
+                                              + chunk_size);
+    chunk->size = chunk_size;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    offset = 0;
+
+    if(chunk_size < ARENA_MAX_CHUNK_SIZE)
+      arena->next_chunk_size = chunk_size * 2;
+  }
+
+  /* Chunk memory comes from calloc() and is never reused, so it is already
+   * zeroed.
+   */
+  p = (char *)chunk + ARENA_HEADER_SIZE + offset;
+  chunk->used = offset + size;
+
+  return(p);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void *libconfig_arena_alloc(config_arena_t *arena, size_t size)
+{
+  return(__arena_alloc(arena, size ? size : 1, ARENA_ALIGNMENT));
+}
+
+/* ------------------------------------------------------------------------- */
+
+char *libconfig_arena_strdup(config_arena_t *arena, const char *s)
+{
+  return(libconfig_arena_strndup(arena, s, strlen(s)));
+}
+
+/* ------------------------------------------------------------------------- */
+
+char *libconfig_arena_strndup(config_arena_t *arena, const char *s,
+                              size_t len)
+{
+  char *r = (char *)__arena_alloc(arena, len + 1, 1);
+  memcpy(r, s, len);
+  r[len] = '\0';
+  return(r);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* A detached allocation is a chunk of its own, so that the arena can take it
+ * over as it is.
+ */
+void *libconfig_arena_alloc_detached(size_t size)
+{
+  arena_chunk_t *chunk = (arena_chunk_t *)libconfig_calloc(
+    1, ARENA_HEADER_SIZE + size);
+
+  chunk->size = chunk->used = size;
+  return((char *)chunk + ARENA_HEADER_SIZE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_arena_adopt(config_arena_t *arena, void *ptr)
+{
+  arena_chunk_t *chunk = (arena_chunk_t *)((char *)ptr - ARENA_HEADER_SIZE);
+
+#if defined(_MSC_VER)
+  do
+    chunk->next = arena->adopted;
+  while(InterlockedCompareExchangePointer((PVOID *)&(arena->adopted), chunk,
+                                          chunk->next) != chunk->next);
+#elif defined(__GNUC__)
+  chunk->next = __atomic_load_n(&(arena->adopted), __ATOMIC_RELAXED);
+  while(! __atomic_compare_exchange_n(&(arena->adopted), &(chunk->next),
+                                      chunk, 1, __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED));
+#else
+  chunk->next = arena->adopted;
+  arena->adopted = chunk;
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_arena_free_detached(void *ptr)
+{
+  if(ptr)
+    __delete((char *)ptr - ARENA_HEADER_SIZE);
+}
+
+/* ------------------------------------------------------------------------- */
@@ -0,0 +1,59 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __libconfig_arena_h
+#define __libconfig_arena_h
+
+#include <string.h>
+#include <sys/types.h>
+
+struct arena_chunk_t;
+
+typedef struct config_arena_t
+{
+  struct arena_chunk_t *chunks;
+  size_t next_chunk_size;
+  struct arena_chunk_t *adopted;
+} config_arena_t;
+
+extern config_arena_t *libconfig_arena_create(void);
+
+extern void libconfig_arena_destroy(config_arena_t *arena);
+
+extern void *libconfig_arena_alloc(config_arena_t *arena, size_t size);
+
+extern char *libconfig_arena_strdup(config_arena_t *arena, const char *s);
+
+extern char *libconfig_arena_strndup(config_arena_t *arena, const char *s,
+                                     size_t len);
+
+/* Memory that is allocated apart from the arena, so that threads may
+ * allocate it concurrently, and then either adopted by the arena, to be
+ * released with it, or freed. Adoption is atomic.
+ */
+extern void *libconfig_arena_alloc_detached(size_t size);
+
+extern void libconfig_arena_adopt(config_arena_t *arena, void *ptr);
+
+extern void libconfig_arena_free_detached(void *ptr);
+
+#endif /* __libconfig_arena_h */
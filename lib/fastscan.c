@@ -0,0 +1,342 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#include "fastscan.h"
+
+#include <stddef.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+  && defined(__SSE2__)
+#define FASTSCAN_SSE2
+#define FASTSCAN_AVX2
+#include <emmintrin.h>
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) \
+  && (_M_IX86_FP >= 2)))
+#define FASTSCAN_SSE2
+#include <emmintrin.h>
+#include <intrin.h>
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+/* The bytes that the scanner ignores between tokens: ' ' and '\a' through
+ * '\r'.
+ */
+#define FASTSCAN_IS_BLANK(C) (((C) == ' ') \
+  || ((unsigned char)((C) - '\a') <= (unsigned char)('\r' - '\a')))
+
+/* ------------------------------------------------------------------------- */
+
+/* The scalar loops also scan the bytes left over after the vector loops. */
+
+static const char *__fastscan_find_scalar(const char *p, const char *end,
+                                          char a, char b, int *lines)
+{
+  int n = 0;
+
+  for(; (p < end) && (*p != a) && (*p != b) && (*p != '\0'); ++p)
+  {
+    if(*p == '\n')
+      ++n;
+  }
+
+  *lines += n;
+  return(p);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const char *__fastscan_blank_scalar(const char *p, const char *end,
+                                           int *lines)
+{
+  int n = 0;
+
+  for(; (p < end) && FASTSCAN_IS_BLANK(*p); ++p)
+  {
+    if(*p == '\n')
+      ++n;
+  }
+
+  *lines += n;
+  return(p);
+}
+
+/* ------------------------------------------------------------------------- */
+
+#if defined(FASTSCAN_SSE2)
+
+#if defined(_MSC_VER)
+
+static unsigned int __fastscan_ctz(unsigned int x)
+{
+  unsigned long i;
+
+  _BitScanForward(&i, x);
+  return((unsigned int)i);
+}
+
+static int __fastscan_popcount(unsigned int x)
+{
+  x = x - ((x >> 1) & 0x55555555U);
+  x = (x & 0x33333333U) + ((x >> 2) & 0x33333333U);
+  x = (x + (x >> 4)) & 0x0F0F0F0FU;
+  return((int)((x * 0x01010101U) >> 24));
+}
+
+#else
+
+#define __fastscan_ctz(X) ((unsigned int)__builtin_ctz(X))
+#define __fastscan_popcount(X) __builtin_popcount(X)
+
+#endif
+
+/* Each vector loop makes unaligned loads of the blocks that lie wholly before
+ * end, and leaves the rest to the scalar loop.
+ */
+
+static const char *__fastscan_find_sse2(const char *p, const char *end,
+                                        char a, char b, int *lines)
+{
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+  const __m128i vz = _mm_setzero_si128();
+  const __m128i vn = _mm_set1_epi8('\n');
+  int n = 0;
+
+  for(; (end - p) >= 16; p += 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    unsigned int stop = (unsigned int)_mm_movemask_epi8(
+      _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+                   _mm_cmpeq_epi8(v, vz)));
+    unsigned int nl = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vn));
+
+    if(stop)
+    {
+      unsigned int i = __fastscan_ctz(stop);
+
+      *lines += n + __fastscan_popcount(nl & ((1U << i) - 1));
+      return(p + i);
+    }
+
+    n += __fastscan_popcount(nl);
+  }
+
+  *lines += n;
+  return(__fastscan_find_scalar(p, end, a, b, lines));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const char *__fastscan_blank_sse2(const char *p, const char *end,
+                                         int *lines)
+{
+  const __m128i vsp = _mm_set1_epi8(' ');
+  const __m128i vlo = _mm_set1_epi8('\a');
+  const __m128i vspan = _mm_set1_epi8('\r' - '\a');
+  const __m128i vn = _mm_set1_epi8('\n');
+  int n = 0;
+
+  for(; (end - p) >= 16; p += 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i t = _mm_sub_epi8(v, vlo);
+    __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(v, vsp),
+                                 _mm_cmpeq_epi8(_mm_min_epu8(t, vspan), t));
+    unsigned int stop = ~(unsigned int)_mm_movemask_epi8(blank) & 0xFFFFU;
+    unsigned int nl = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vn));
+
+    if(stop)
+    {
+      unsigned int i = __fastscan_ctz(stop);
+
+      *lines += n + __fastscan_popcount(nl & ((1U << i) - 1));
+      return(p + i);
+    }
+
+    n += __fastscan_popcount(nl);
+  }
+
+  *lines += n;
+  return(__fastscan_blank_scalar(p, end, lines));
+}
+
+#endif /* FASTSCAN_SSE2 */
+
+/* ------------------------------------------------------------------------- */
+
+#if defined(FASTSCAN_AVX2)
+
+#define FASTSCAN_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+
+#define __fastscan_have_avx2() \
+  (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+
+FASTSCAN_TARGET_AVX2
+static const char *__fastscan_find_avx2(const char *p, const char *end,
+                                        char a, char b, int *lines)
+{
+  const __m256i va = _mm256_set1_epi8(a);
+  const __m256i vb = _mm256_set1_epi8(b);
+  const __m256i vz = _mm256_setzero_si256();
+  const __m256i vn = _mm256_set1_epi8('\n');
+  int n = 0;
+
+  for(; (end - p) >= 32; p += 32)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    unsigned int stop = (unsigned int)_mm256_movemask_epi8(
+      _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, va),
+                                      _mm256_cmpeq_epi8(v, vb)),
+                      _mm256_cmpeq_epi8(v, vz)));
+    unsigned int nl = (unsigned int)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(v, vn));
+
+    if(stop)
+    {
+      unsigned int i = __fastscan_ctz(stop);
+
+      *lines += n + __fastscan_popcount(nl & ((1U << i) - 1));
+      return(p + i);
+    }
+
+    n += __fastscan_popcount(nl);
+  }
+
+  *lines += n;
+  return(__fastscan_find_sse2(p, end, a, b, lines));
+}
+
+/* ------------------------------------------------------------------------- */
+
+FASTSCAN_TARGET_AVX2
+static const char *__fastscan_blank_avx2(const char *p, const char *end,
+                                         int *lines)
+{
+  const __m256i vsp = _mm256_set1_epi8(' ');
+  const __m256i vlo = _mm256_set1_epi8('\a');
+  const __m256i vspan = _mm256_set1_epi8('\r' - '\a');
+  const __m256i vn = _mm256_set1_epi8('\n');
+  int n = 0;
+
+  for(; (end - p) >= 32; p += 32)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i t = _mm256_sub_epi8(v, vlo);
+    __m256i blank = _mm256_or_si256(
+      _mm256_cmpeq_epi8(v, vsp),
+      _mm256_cmpeq_epi8(_mm256_min_epu8(t, vspan), t));
+    unsigned int stop = ~(unsigned int)_mm256_movemask_epi8(blank);
+    unsigned int nl = (unsigned int)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(v, vn));
+
+    if(stop)
+    {
+      unsigned int i = __fastscan_ctz(stop);
+
+      *lines += n + __fastscan_popcount(nl & ((1U << i) - 1));
+      return(p + i);
+    }
+
+    n += __fastscan_popcount(nl);
+  }
+
+  *lines += n;
+  return(__fastscan_blank_sse2(p, end, lines));
+}
+
+#endif /* FASTSCAN_AVX2 */
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns a pointer to the first a, b or NUL byte at or after p, or end. */
+
+static const char *__fastscan_find(const char *p, const char *end, char a,
+                                   char b, int *lines)
+{
+  /* Short runs are not worth setting up the vector loop for. */
+  if((p == end) || (*p == a) || (*p == b) || (*p == '\0'))
+    return(p);
+
+#if defined(FASTSCAN_AVX2)
+  if(__fastscan_have_avx2())
+    return(__fastscan_find_avx2(p, end, a, b, lines));
+#endif
+
+#if defined(FASTSCAN_SSE2)
+  return(__fastscan_find_sse2(p, end, a, b, lines));
+#else
+  return(__fastscan_find_scalar(p, end, a, b, lines));
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+const char *libconfig_fastscan_eol(const char *p, const char *end, int *lines)
+{
+  return(__fastscan_find(p, end, '\n', '\n', lines));
+}
+
+/* ------------------------------------------------------------------------- */
+
+const char *libconfig_fastscan_string(const char *p, const char *end,
+                                      int *lines)
+{
+  return(__fastscan_find(p, end, '"', '\\', lines));
+}
+
+/* ------------------------------------------------------------------------- */
+
+const char *libconfig_fastscan_comment(const char *p, const char *end,
+                                       int *lines)
+{
+  for(;;)
+  {
+    p = __fastscan_find(p, end, '*', '*', lines);
+    if((p == end) || (*p == '\0') || ((p + 1) == end) || (p[1] == '/')
+       || (p[1] == '\0'))
+      return(p);
+
+    ++p;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+const char *libconfig_fastscan_blank(const char *p, const char *end,
+                                     int *lines)
+{
+  if((p == end) || ! FASTSCAN_IS_BLANK(*p))
+    return(p);
+
+#if defined(FASTSCAN_AVX2)
+  if(__fastscan_have_avx2())
+    return(__fastscan_blank_avx2(p, end, lines));
+#endif
+
+#if defined(FASTSCAN_SSE2)
+  return(__fastscan_blank_sse2(p, end, lines));
+#else
+  return(__fastscan_blank_scalar(p, end, lines));
+#endif
+}
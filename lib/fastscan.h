@@ -0,0 +1,58 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __libconfig_fastscan_h
+#define __libconfig_fastscan_h
+
+/* Fast paths for the scanner, which skip over comment bodies, string runs and
+ * whitespace 16 or 32 bytes at a time with SSE2 or AVX2 where available. The
+ * instruction set is chosen at run time; other platforms use plain loops.
+ *
+ * Each function scans forward from p, but no further than end, and returns a
+ * pointer to the byte it stopped at, or end if it got there first, adding the
+ * number of newlines it passed to *lines. A NUL byte also stops the scan.
+ * Only the bytes from p up to, but not including, end are read: the vector
+ * loops load blocks that lie wholly before end, and scan the bytes left over
+ * one at a time.
+ */
+
+/* Stops at the next '\n'. */
+extern const char *libconfig_fastscan_eol(const char *p, const char *end,
+                                          int *lines);
+
+/* Stops at the next '"' or '\\'. */
+extern const char *libconfig_fastscan_string(const char *p, const char *end,
+                                             int *lines);
+
+/* Stops at the '*' that starts the next comment terminator, or at a '*'
+ * that is the last byte before end or before a NUL.
+ */
+extern const char *libconfig_fastscan_comment(const char *p, const char *end,
+                                              int *lines);
+
+/* Stops at the next byte that is not a space or one of '\a', '\b', '\t',
+ * '\n', '\v', '\f' or '\r'.
+ */
+extern const char *libconfig_fastscan_blank(const char *p, const char *end,
+                                            int *lines);
+
+#endif /* __libconfig_fastscan_h */
@@ -0,0 +1,730 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#include "format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ------------------------------------------------------------------------- */
+
+/* Doubles are converted to decimal with Loitsch's Grisu3 algorithm ("Printing
+ * Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010),
+ * which finds the shortest digit string that reads back as the same double,
+ * using only 64-bit integer arithmetic. For about 0.5% of all doubles it
+ * cannot prove its result optimal, and we fall back on printf().
+ *
+ * Output with a fixed precision is derived from the shortest digits by
+ * rounding them. That is exact unless the digits to be dropped are exactly
+ * "5", or more than 15 digits would be kept; in those cases, and for
+ * subnormal and non-finite values, printf() does the formatting instead.
+ */
+
+typedef struct
+{
+  uint64_t f;
+  int e;
+} diyfp_t; /* f * 2^e */
+
+typedef struct
+{
+  uint64_t f;
+  short e;
+  short k;
+} cached_power_t; /* f * 2^e ~= 10^k */
+
+static const cached_power_t __cached_powers[] =
+{
+  { UINT64_C(0xFA8FD5A0081C0288), -1220, -348 },
+  { UINT64_C(0xBAAEE17FA23EBF76), -1193, -340 },
+  { UINT64_C(0x8B16FB203055AC76), -1166, -332 },
+  { UINT64_C(0xCF42894A5DCE35EA), -1140, -324 },
+  { UINT64_C(0x9A6BB0AA55653B2D), -1113, -316 },
+  { UINT64_C(0xE61ACF033D1A45DF), -1087, -308 },
+  { UINT64_C(0xAB70FE17C79AC6CA), -1060, -300 },
+  { UINT64_C(0xFF77B1FCBEBCDC4F), -1034, -292 },
+  { UINT64_C(0xBE5691EF416BD60C), -1007, -284 },
+  { UINT64_C(0x8DD01FAD907FFC3C),  -980, -276 },
+  { UINT64_C(0xD3515C2831559A83),  -954, -268 },
+  { UINT64_C(0x9D71AC8FADA6C9B5),  -927, -260 },
+  { UINT64_C(0xEA9C227723EE8BCB),  -901, -252 },
+  { UINT64_C(0xAECC49914078536D),  -874, -244 },
+  { UINT64_C(0x823C12795DB6CE57),  -847, -236 },
+  { UINT64_C(0xC21094364DFB5637),  -821, -228 },
+  { UINT64_C(0x9096EA6F3848984F),  -794, -220 },
+  { UINT64_C(0xD77485CB25823AC7),  -768, -212 },
+  { UINT64_C(0xA086CFCD97BF97F4),  -741, -204 },
+  { UINT64_C(0xEF340A98172AACE5),  -715, -196 },
+  { UINT64_C(0xB23867FB2A35B28E),  -688, -188 },
+  { UINT64_C(0x84C8D4DFD2C63F3B),  -661, -180 },
+  { UINT64_C(0xC5DD44271AD3CDBA),  -635, -172 },
+  { UINT64_C(0x936B9FCEBB25C996),  -608, -164 },
+  { UINT64_C(0xDBAC6C247D62A584),  -582, -156 },
+  { UINT64_C(0xA3AB66580D5FDAF6),  -555, -148 },
+  { UINT64_C(0xF3E2F893DEC3F126),  -529, -140 },
+  { UINT64_C(0xB5B5ADA8AAFF80B8),  -502, -132 },
+  { UINT64_C(0x87625F056C7C4A8B),  -475, -124 },
+  { UINT64_C(0xC9BCFF6034C13053),  -449, -116 },
+  { UINT64_C(0x964E858C91BA2655),  -422, -108 },
+  { UINT64_C(0xDFF9772470297EBD),  -396, -100 },
+  { UINT64_C(0xA6DFBD9FB8E5B88F),  -369,  -92 },
+  { UINT64_C(0xF8A95FCF88747D94),  -343,  -84 },
+  { UINT64_C(0xB94470938FA89BCF),  -316,  -76 },
+  { UINT64_C(0x8A08F0F8BF0F156B),  -289,  -68 },
+  { UINT64_C(0xCDB02555653131B6),  -263,  -60 },
+  { UINT64_C(0x993FE2C6D07B7FAC),  -236,  -52 },
+  { UINT64_C(0xE45C10C42A2B3B06),  -210,  -44 },
+  { UINT64_C(0xAA242499697392D3),  -183,  -36 },
+  { UINT64_C(0xFD87B5F28300CA0E),  -157,  -28 },
+  { UINT64_C(0xBCE5086492111AEB),  -130,  -20 },
+  { UINT64_C(0x8CBCCC096F5088CC),  -103,  -12 },
+  { UINT64_C(0xD1B71758E219652C),   -77,   -4 },
+  { UINT64_C(0x9C40000000000000),   -50,    4 },
+  { UINT64_C(0xE8D4A51000000000),   -24,   12 },
+  { UINT64_C(0xAD78EBC5AC620000),     3,   20 },
+  { UINT64_C(0x813F3978F8940984),    30,   28 },
+  { UINT64_C(0xC097CE7BC90715B3),    56,   36 },
+  { UINT64_C(0x8F7E32CE7BEA5C70),    83,   44 },
+  { UINT64_C(0xD5D238A4ABE98068),   109,   52 },
+  { UINT64_C(0x9F4F2726179A2245),   136,   60 },
+  { UINT64_C(0xED63A231D4C4FB27),   162,   68 },
+  { UINT64_C(0xB0DE65388CC8ADA8),   189,   76 },
+  { UINT64_C(0x83C7088E1AAB65DB),   216,   84 },
+  { UINT64_C(0xC45D1DF942711D9A),   242,   92 },
+  { UINT64_C(0x924D692CA61BE758),   269,  100 },
+  { UINT64_C(0xDA01EE641A708DEA),   295,  108 },
+  { UINT64_C(0xA26DA3999AEF774A),   322,  116 },
+  { UINT64_C(0xF209787BB47D6B85),   348,  124 },
+  { UINT64_C(0xB454E4A179DD1877),   375,  132 },
+  { UINT64_C(0x865B86925B9BC5C2),   402,  140 },
+  { UINT64_C(0xC83553C5C8965D3D),   428,  148 },
+  { UINT64_C(0x952AB45CFA97A0B3),   455,  156 },
+  { UINT64_C(0xDE469FBD99A05FE3),   481,  164 },
+  { UINT64_C(0xA59BC234DB398C25),   508,  172 },
+  { UINT64_C(0xF6C69A72A3989F5C),   534,  180 },
+  { UINT64_C(0xB7DCBF5354E9BECE),   561,  188 },
+  { UINT64_C(0x88FCF317F22241E2),   588,  196 },
+  { UINT64_C(0xCC20CE9BD35C78A5),   614,  204 },
+  { UINT64_C(0x98165AF37B2153DF),   641,  212 },
+  { UINT64_C(0xE2A0B5DC971F303A),   667,  220 },
+  { UINT64_C(0xA8D9D1535CE3B396),   694,  228 },
+  { UINT64_C(0xFB9B7CD9A4A7443C),   720,  236 },
+  { UINT64_C(0xBB764C4CA7A44410),   747,  244 },
+  { UINT64_C(0x8BAB8EEFB6409C1A),   774,  252 },
+  { UINT64_C(0xD01FEF10A657842C),   800,  260 },
+  { UINT64_C(0x9B10A4E5E9913129),   827,  268 },
+  { UINT64_C(0xE7109BFBA19C0C9D),   853,  276 },
+  { UINT64_C(0xAC2820D9623BF429),   880,  284 },
+  { UINT64_C(0x80444B5E7AA7CF85),   907,  292 },
+  { UINT64_C(0xBF21E44003ACDD2D),   933,  300 },
+  { UINT64_C(0x8E679C2F5E44FF8F),   960,  308 },
+  { UINT64_C(0xD433179D9C8CB841),   986,  316 },
+  { UINT64_C(0x9E19DB92B4E31BA9),  1013,  324 },
+  { UINT64_C(0xEB96BF6EBADF77D9),  1039,  332 },
+  { UINT64_C(0xAF87023B9BF0EE6B),  1066,  340 }
+};
+
+#define CACHED_POWERS_MIN_K (-348)
+#define CACHED_POWERS_K_STEP 8
+
+#define MIN_TARGET_EXPONENT (-60)
+
+#define DOUBLE_SIGNIFICAND_MASK UINT64_C(0x000FFFFFFFFFFFFF)
+#define DOUBLE_HIDDEN_BIT UINT64_C(0x0010000000000000)
+#define DOUBLE_EXPONENT_BIAS 1075 /* Includes the 52 fraction bits. */
+
+#define MAX_DIGITS 18
+
+static const uint32_t __powers_of_ten[] =
+{
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+  1000000000
+};
+
+/* ------------------------------------------------------------------------- */
+
+static diyfp_t __diyfp_normalize(uint64_t f, int e)
+{
+  diyfp_t r;
+
+  while(! (f & UINT64_C(0xFFC0000000000000)))
+  {
+    f <<= 10;
+    e -= 10;
+  }
+
+  while(! (f & UINT64_C(0x8000000000000000)))
+  {
+    f <<= 1;
+    --e;
+  }
+
+  r.f = f;
+  r.e = e;
+  return(r);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the upper 64 bits of the product, rounded. */
+
+static diyfp_t __diyfp_multiply(diyfp_t a, diyfp_t b)
+{
+  const uint64_t mask = UINT64_C(0xFFFFFFFF);
+  uint64_t ah = a.f >> 32, al = a.f & mask;
+  uint64_t bh = b.f >> 32, bl = b.f & mask;
+  uint64_t hh = ah * bh, hl = ah * bl, lh = al * bh, ll = al * bl;
+  uint64_t mid = (ll >> 32) + (hl & mask) + (lh & mask) + (UINT64_C(1) << 31);
+  diyfp_t r;
+
+  r.f = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+  r.e = a.e + b.e + 64;
+  return(r);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Moves the last digit towards w as long as that stays inside the safe
+ * interval, and then checks that the result is the closest to w that can be
+ * proven correct. All quantities are in units of the scaled exponent.
+ */
+
+static int __grisu_round_weed(char *digits, int length, uint64_t too_high_w,
+                              uint64_t unsafe_interval, uint64_t rest,
+                              uint64_t ten_kappa, uint64_t unit)
+{
+  uint64_t small_distance = too_high_w - unit;
+  uint64_t big_distance = too_high_w + unit;
+
+  while((rest < small_distance)
+        && (unsafe_interval - rest >= ten_kappa)
+        && ((rest + ten_kappa < small_distance)
+            || (small_distance - rest >= rest + ten_kappa - small_distance)))
+  {
+    --digits[length - 1];
+    rest += ten_kappa;
+  }
+
+  if((rest < big_distance)
+     && (unsafe_interval - rest >= ten_kappa)
+     && ((rest + ten_kappa < big_distance)
+         || (big_distance - rest > rest + ten_kappa - big_distance)))
+    return(0);
+
+  return((2 * unit <= rest) && (rest <= unsafe_interval - 4 * unit));
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Generates the shortest digits for the positive, finite value v. On success,
+ * v reads back from 0.DIGITS * 10^point.
+ */
+
+static int __grisu3(double v, char *digits, int *length, int *point)
+{
+  uint64_t bits, f;
+  int e, min_exponent, k, kappa, len = 0;
+  double k_real;
+  diyfp_t w, plus, minus, c, too_low, too_high, one;
+  const cached_power_t *cached;
+  uint64_t unsafe_interval, unit = 1, fractionals, rest;
+  uint32_t integrals, divisor;
+
+  memcpy(&bits, &v, sizeof(bits));
+  f = bits & DOUBLE_SIGNIFICAND_MASK;
+  e = (int)((bits >> 52) & 0x7FF);
+
+  /* The boundaries are the midpoints between v and its neighbours. The lower
+   * one is closer when v is a power of two (except for the smallest normal
+   * exponent).
+   */
+  if(e == 0)
+  {
+    e = 1 - DOUBLE_EXPONENT_BIAS;
+    minus.f = (f << 1) - 1;
+    minus.e = e - 1;
+  }
+  else
+  {
+    int lower_closer = ((f == 0) && (e > 1));
+    f |= DOUBLE_HIDDEN_BIT;
+    e -= DOUBLE_EXPONENT_BIAS;
+    minus.f = lower_closer ? (f << 2) - 1 : (f << 1) - 1;
+    minus.e = lower_closer ? e - 2 : e - 1;
+  }
+
+  w = __diyfp_normalize(f, e);
+  plus = __diyfp_normalize((f << 1) + 1, e - 1);
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+
+  /* Pick the cached power of ten c that brings the exponent of w * c into
+   * [-60, -32].
+   */
+  min_exponent = MIN_TARGET_EXPONENT - (w.e + 64);
+  k_real = (min_exponent + 63) * 0.30102999566398114; /* log10(2) */
+  k = (int)k_real;
+  if(k < k_real)
+    ++k;
+  cached = &__cached_powers[(-CACHED_POWERS_MIN_K + k - 1)
+                            / CACHED_POWERS_K_STEP + 1];
+  c.f = cached->f;
+  c.e = cached->e;
+
+  w = __diyfp_multiply(w, c);
+  minus = __diyfp_multiply(minus, c);
+  plus = __diyfp_multiply(plus, c);
+
+  /* The scaled boundaries are off by up to one unit each; the digits are
+   * generated for the widened ("unsafe") interval and then weeded.
+   */
+  too_low.f = minus.f - unit;
+  too_high.f = plus.f + unit;
+  too_low.e = too_high.e = w.e;
+  unsafe_interval = too_high.f - too_low.f;
+
+  one.e = w.e;
+  one.f = UINT64_C(1) << -one.e;
+  integrals = (uint32_t)(too_high.f >> -one.e);
+  fractionals = too_high.f & (one.f - 1);
+
+  for(kappa = 10; (kappa > 0) && (integrals < __powers_of_ten[kappa - 1]);
+      --kappa);
+  divisor = kappa ? __powers_of_ten[kappa - 1] : 0;
+
+  while(kappa > 0)
+  {
+    digits[len++] = (char)('0' + integrals / divisor);
+    integrals %= divisor;
+    --kappa;
+    rest = ((uint64_t)integrals << -one.e) + fractionals;
+    if(rest < unsafe_interval)
+    {
+      if(! __grisu_round_weed(digits, len, too_high.f - w.f, unsafe_interval,
+                              rest, (uint64_t)divisor << -one.e, unit))
+        return(0);
+      goto done;
+    }
+    divisor /= 10;
+  }
+
+  for(;;)
+  {
+    fractionals *= 10;
+    unit *= 10;
+    unsafe_interval *= 10;
+    digits[len++] = (char)('0' + (fractionals >> -one.e));
+    fractionals &= one.f - 1;
+    --kappa;
+    if(fractionals < unsafe_interval)
+    {
+      if(! __grisu_round_weed(digits, len, (too_high.f - w.f) * unit,
+                              unsafe_interval, fractionals, one.f, unit))
+        return(0);
+      break;
+    }
+  }
+
+done:
+
+  while(digits[len - 1] == '0')
+    --len;
+
+  *length = len;
+  *point = len + kappa - cached->k;
+  return(1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Like __grisu3(), but never fails. */
+
+static void __shortest_digits(double v, char *digits, int *length, int *point)
+{
+  char temp[32];
+  const char *p;
+  int precision, len = 0;
+
+  if(__grisu3(v, digits, length, point))
+    return;
+
+  for(precision = 15; precision < 17; ++precision)
+  {
+    snprintf(temp, sizeof(temp), "%.*e", precision - 1, v);
+    if(strtod(temp, NULL) == v)
+      break;
+  }
+
+  if(precision == 17)
+    snprintf(temp, sizeof(temp), "%.*e", precision - 1, v);
+
+  for(p = temp; *p != 'e'; ++p)
+  {
+    if(*p != '.')
+      digits[len++] = *p;
+  }
+
+  while(digits[len - 1] == '0')
+    --len;
+
+  *length = len;
+  *point = atoi(p + 1) + 1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Rounds the digits to the first n (0 <= n < *length) of them. Fails if the
+ * dropped digits are exactly "5", since the digits themselves may be rounded
+ * and would not tell which way to go.
+ */
+
+static int __round_digits(char *digits, int *length, int *point, int n)
+{
+  if(digits[n] >= '5')
+  {
+    int i;
+
+    if((digits[n] == '5') && (n + 1 == *length))
+      return(0);
+
+    for(i = n - 1; (i >= 0) && (digits[i] == '9'); --i);
+
+    if(i < 0)
+    {
+      digits[0] = '1';
+      n = 1;
+      ++*point;
+    }
+    else
+    {
+      ++digits[i];
+      n = i + 1;
+    }
+  }
+
+  while((n > 0) && (digits[n - 1] == '0'))
+    --n;
+
+  *length = n;
+  return(1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static size_t __format_fixed(char *buf, int negative, const char *digits,
+                             int length, int point)
+{
+  char *p = buf;
+
+  if(negative)
+    *(p++) = '-';
+
+  if(point <= 0)
+  {
+    *(p++) = '0';
+    *(p++) = '.';
+    memset(p, '0', -point);
+    p += -point;
+    memcpy(p, digits, length);
+    p += length;
+  }
+  else if(point >= length)
+  {
+    memcpy(p, digits, length);
+    p += length;
+    memset(p, '0', point - length);
+    p += point - length;
+    *(p++) = '.';
+    *(p++) = '0';
+  }
+  else
+  {
+    memcpy(p, digits, point);
+    p += point;
+    *(p++) = '.';
+    memcpy(p, digits + point, length - point);
+    p += length - point;
+  }
+
+  *p = '\0';
+  return(p - buf);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static size_t __format_scientific(char *buf, int negative, const char *digits,
+                                  int length, int point)
+{
+  char *p = buf;
+  int exponent = point - 1;
+
+  if(negative)
+    *(p++) = '-';
+
+  *(p++) = digits[0];
+  if(length > 1)
+  {
+    *(p++) = '.';
+    memcpy(p, digits + 1, length - 1);
+    p += length - 1;
+  }
+
+  *(p++) = 'e';
+  if(exponent < 0)
+  {
+    *(p++) = '-';
+    exponent = -exponent;
+  }
+  else
+    *(p++) = '+';
+
+  if(exponent >= 100)
+  {
+    *(p++) = (char)('0' + exponent / 100);
+    exponent %= 100;
+  }
+  *(p++) = (char)('0' + exponent / 10);
+  *(p++) = (char)('0' + exponent % 10);
+
+  *p = '\0';
+  return(p - buf);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static size_t __format_double_printf(double val, int precision, int sci_ok,
+                                     char *buf, size_t buflen)
+{
+  const char *fmt = sci_ok ? "%.*g" : "%.*f";
+  char *p, *q;
+
+  snprintf(buf, buflen - 3, fmt, precision, val);
+
+  /* Check for exponent. */
+  p = strchr(buf, 'e');
+  if(p) return(strlen(buf));
+
+  /* Check for decimal point. */
+  p = strchr(buf, '.');
+  if(!p)
+  {
+    /* No decimal point. Add trailing ".0". */
+    strcat(buf, ".0");
+  }
+  else
+  {
+    /* Remove any excess trailing 0's after decimal point. */
+    for(q = buf + strlen(buf) - 1; q > p + 1; --q)
+    {
+      if(*q == '0')
+        *q = '\0';
+      else
+        break;
+    }
+  }
+
+  return(strlen(buf));
+}
+
+/* ------------------------------------------------------------------------- */
+
+size_t libconfig_format_double(double val, int precision, int sci_ok,
+                               char *buf, size_t buflen)
+{
+  char digits[MAX_DIGITS];
+  int length, point, negative, exponent, n;
+  uint64_t bits;
+
+  memcpy(&bits, &val, sizeof(bits));
+  negative = (int)(bits >> 63);
+  exponent = (int)((bits >> 52) & 0x7FF);
+
+  if(exponent == 0x7FF)
+    return(__format_double_printf(val, precision, sci_ok, buf, buflen));
+
+  if(val == 0.0)
+    return(__format_fixed(buf, negative, "", 0, 1));
+
+  if(negative)
+    val = -val;
+
+  if(precision < 0)
+  {
+    /* Shortest round trip, choosing the notation like "%.17g". */
+    __shortest_digits(val, digits, &length, &point);
+
+    if(sci_ok && ((point <= -4) || (point > 17)))
+      return(__format_scientific(buf, negative, digits, length, point));
+
+    return(__format_fixed(buf, negative, digits, length, point));
+  }
+
+  if((exponent == 0) || (precision > 15)
+     || ! __grisu3(val, digits, &length, &point))
+    goto fallback;
+
+  if(sci_ok)
+  {
+    if(precision == 0)
+      precision = 1;
+
+    if((precision < length)
+       && ! __round_digits(digits, &length, &point, precision))
+      goto fallback;
+
+    if((point <= -4) || (point > precision))
+      return(__format_scientific(buf, negative, digits, length, point));
+
+    return(__format_fixed(buf, negative, digits, length, point));
+  }
+
+  /* Keep the digits up to the precision'th after the decimal point. */
+  n = point + precision;
+  if(n > 15)
+    goto fallback;
+
+  if(n < 0)
+    length = 0;
+  else if((n < length) && ! __round_digits(digits, &length, &point, n))
+    goto fallback;
+
+  if(length == 0)
+    return(__format_fixed(buf, negative, "", 0, 1));
+
+  return(__format_fixed(buf, negative, digits, length, point));
+
+fallback:
+
+  return(__format_double_printf(negative ? -val : val, precision, sci_ok,
+                                buf, buflen));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const char __digit_pairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static const char __hex_digits[] = "0123456789ABCDEF";
+
+static const char __nibble_bits[16][4] =
+{
+  {'0','0','0','0'}, {'0','0','0','1'}, {'0','0','1','0'}, {'0','0','1','1'},
+  {'0','1','0','0'}, {'0','1','0','1'}, {'0','1','1','0'}, {'0','1','1','1'},
+  {'1','0','0','0'}, {'1','0','0','1'}, {'1','0','1','0'}, {'1','0','1','1'},
+  {'1','1','0','0'}, {'1','1','0','1'}, {'1','1','1','0'}, {'1','1','1','1'}
+};
+
+/* ------------------------------------------------------------------------- */
+
+size_t libconfig_format_dec(int64_t val, char *buf)
+{
+  char temp[20];
+  char *p = temp + sizeof(temp);
+  uint64_t u = (val < 0) ? (0 - (uint64_t)val) : (uint64_t)val;
+  size_t len = 0, ndigits;
+
+  while(u >= 100)
+  {
+    const char *pair = __digit_pairs + (u % 100) * 2;
+    u /= 100;
+    *(--p) = pair[1];
+    *(--p) = pair[0];
+  }
+
+  if(u >= 10)
+  {
+    *(--p) = __digit_pairs[u * 2 + 1];
+    *(--p) = __digit_pairs[u * 2];
+  }
+  else
+    *(--p) = (char)('0' + u);
+
+  if(val < 0)
+    buf[len++] = '-';
+
+  ndigits = temp + sizeof(temp) - p;
+  memcpy(buf + len, p, ndigits);
+  len += ndigits;
+  buf[len] = '\0';
+
+  return(len);
+}
+
+/* ------------------------------------------------------------------------- */
+
+size_t libconfig_format_hex(uint64_t val, char *buf)
+{
+  size_t len = 1, i;
+  uint64_t top;
+
+  for(top = val >> 4; top; top >>= 4)
+    ++len;
+
+  for(i = len; i > 0; --i)
+  {
+    buf[i - 1] = __hex_digits[val & 0xF];
+    val >>= 4;
+  }
+
+  buf[len] = '\0';
+  return(len);
+}
+
+/* ------------------------------------------------------------------------- */
+
+size_t libconfig_format_bin(uint64_t val, char *buf)
+{
+  size_t len = 4, i;
+  uint64_t top = val;
+
+  while(top > 0xF)
+  {
+    top >>= 4;
+    len += 4;
+  }
+
+  len -= (top < 2) ? 3 : (top < 4) ? 2 : (top < 8) ? 1 : 0;
+
+  for(i = len; i >= 4; i -= 4)
+  {
+    memcpy(buf + i - 4, __nibble_bits[val & 0xF], 4);
+    val >>= 4;
+  }
+
+  if(i > 0)
+    memcpy(buf, __nibble_bits[val & 0xF] + 4 - i, i);
+
+  buf[len] = '\0';
+  return(len);
+}
+
+/* ------------------------------------------------------------------------- */
@@ -0,0 +1,53 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __libconfig_format_h
+#define __libconfig_format_h
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Locale-independent number formatting for the writer. Each function writes
+ * a NUL-terminated string into buf and returns its length.
+ */
+
+/* Large enough for any double in any notation with up to 17 significant
+ * digits, and for any integer in any base.
+ */
+#define LIBCONFIG_FORMAT_BUFSIZE 352
+
+/* Formats val the way printf()'s "%.*g" (if sci_ok) or "%.*f" format would
+ * with the given precision, drops excess trailing zeros after the decimal
+ * point and appends ".0" if there is no decimal point. A negative precision
+ * selects the shortest representation that reads back as exactly val. buflen
+ * should be at least LIBCONFIG_FORMAT_BUFSIZE; with very large precisions
+ * the output is truncated.
+ */
+extern size_t libconfig_format_double(double val, int precision, int sci_ok,
+                                      char *buf, size_t buflen);
+
+/* These need a buffer of at least 21, 17 and 65 bytes respectively. */
+extern size_t libconfig_format_dec(int64_t val, char *buf);
+extern size_t libconfig_format_hex(uint64_t val, char *buf);
+extern size_t libconfig_format_bin(uint64_t val, char *buf);
+
+#endif /* __libconfig_format_h */
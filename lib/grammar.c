@@ -116,8 +116,29 @@ void libconfig_yyerror(void *scanner, struct parse_context *ctx,
   ctx->config->error_text = s;
 }
 
+/* Array elements are packed, and so have no source position of their own;
+ * list elements do.
+ */
+static int append_element(void *scanner, struct parse_context *ctx,
+                          struct scan_context *scan_ctx, int type,
+                          config_value_t value, unsigned short format)
+{
+  config_setting_t *e;
 
-#line 121 "grammar.c"
+  if(! libconfig_setting_append(ctx->parent, type, value, format, &e))
+  {
+    libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+    return(0);
+  }
+
+  if(e)
+    CAPTURE_PARSE_POS(e);
+
+  return(1);
+}
+
+
+#line 142 "grammar.c"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -218,14 +239,14 @@ extern int libconfig_yydebug;
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 union YYSTYPE
 {
-#line 78 "grammar.y"
+#line 99 "grammar.y"
 
   int ival;
   long long llval;
   double fval;
   char *sval;
 
-#line 229 "grammar.c"
+#line 250 "grammar.c"
 
 };
 typedef union YYSTYPE YYSTYPE;
@@ -676,11 +697,11 @@ static const yytype_int8 yytranslate[] =
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_int16 yyrline[] =
 {
-       0,    94,    94,    96,   100,   101,   104,   106,   109,   111,
-     112,   117,   116,   136,   135,   159,   158,   181,   182,   183,
-     184,   188,   189,   193,   213,   235,   257,   279,   301,   323,
-     345,   363,   391,   392,   393,   396,   398,   402,   403,   404,
-     407,   409,   414,   413
+       0,   115,   115,   117,   121,   122,   125,   127,   130,   132,
+     133,   138,   137,   161,   160,   184,   183,   206,   207,   208,
+     209,   213,   214,   218,   232,   249,   266,   283,   300,   317,
+     334,   348,   372,   373,   374,   377,   379,   383,   384,   385,
+     388,   390,   395,   394
 };
 #endif
 
@@ -1019,9 +1040,9 @@ yydestruct (const char *yymsg,
   switch (yykind)
     {
     case YYSYMBOL_TOK_STRING: /* TOK_STRING  */
-#line 90 "grammar.y"
+#line 111 "grammar.y"
             { free(((*yyvaluep).sval)); }
-#line 1025 "grammar.c"
+#line 1046 "grammar.c"
         break;
 
       default:
@@ -1295,7 +1316,7 @@ yyreduce:
   switch (yyn)
     {
   case 11: /* $@1: %empty  */
-#line 117 "grammar.y"
+#line 138 "grammar.y"
   {
     ctx->setting = config_setting_add(ctx->parent, (yyvsp[0].sval), CONFIG_TYPE_NONE);
 
@@ -1307,13 +1328,22 @@ yyreduce:
     else
     {
       CAPTURE_PARSE_POS(ctx->setting);
+      scan_ctx->include_parent = NULL;
     }
   }
-#line 1313 "grammar.c"
+#line 1335 "grammar.c"
+    break;
+
+  case 12: /* setting: TOK_NAME $@1 TOK_EQUALS value setting_terminator  */
+#line 154 "grammar.y"
+  {
+    scan_ctx->include_parent = ctx->parent;
+  }
+#line 1343 "grammar.c"
     break;
 
   case 13: /* $@2: %empty  */
-#line 136 "grammar.y"
+#line 161 "grammar.y"
   {
     if(IN_LIST())
     {
@@ -1327,20 +1357,20 @@ yyreduce:
       ctx->setting = NULL;
     }
   }
-#line 1331 "grammar.c"
+#line 1361 "grammar.c"
     break;
 
   case 14: /* array: TOK_ARRAY_START $@2 simple_value_list_optional TOK_ARRAY_END  */
-#line 151 "grammar.y"
+#line 176 "grammar.y"
   {
     if(ctx->parent)
       ctx->parent = ctx->parent->parent;
   }
-#line 1340 "grammar.c"
+#line 1370 "grammar.c"
     break;
 
   case 15: /* $@3: %empty  */
-#line 159 "grammar.y"
+#line 184 "grammar.y"
   {
     if(IN_LIST())
     {
@@ -1354,70 +1384,59 @@ yyreduce:
       ctx->setting = NULL;
     }
   }
-#line 1358 "grammar.c"
+#line 1388 "grammar.c"
     break;
 
   case 16: /* list: TOK_LIST_START $@3 value_list_optional TOK_LIST_END  */
-#line 174 "grammar.y"
+#line 199 "grammar.y"
   {
     if(ctx->parent)
       ctx->parent = ctx->parent->parent;
   }
-#line 1367 "grammar.c"
+#line 1397 "grammar.c"
     break;
 
   case 21: /* string: TOK_STRING  */
-#line 188 "grammar.y"
-             { libconfig_parsectx_append_string(ctx, (yyvsp[0].sval)); free((yyvsp[0].sval)); }
-#line 1373 "grammar.c"
+#line 213 "grammar.y"
+             { libconfig_parsectx_adopt_string(ctx, (yyvsp[0].sval)); }
+#line 1403 "grammar.c"
     break;
 
   case 22: /* string: string TOK_STRING  */
-#line 189 "grammar.y"
-                      { libconfig_parsectx_append_string(ctx, (yyvsp[0].sval)); free((yyvsp[0].sval)); }
-#line 1379 "grammar.c"
+#line 214 "grammar.y"
+                      { libconfig_parsectx_adopt_string(ctx, (yyvsp[0].sval)); }
+#line 1409 "grammar.c"
     break;
 
   case 23: /* simple_value: TOK_BOOLEAN  */
-#line 194 "grammar.y"
+#line 219 "grammar.y"
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_bool_elem(ctx->parent, -1,
-                                                         (int)(yyvsp[0].ival));
+      config_value_t value;
 
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      value.ival = (int)(yyvsp[0].ival);
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_BOOL, value,
+                          CONFIG_FORMAT_DEFAULT))
         YYABORT;
-      }
-      else
-      {
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
       config_setting_set_bool(ctx->setting, (int)(yyvsp[0].ival));
   }
-#line 1403 "grammar.c"
+#line 1427 "grammar.c"
     break;
 
   case 24: /* simple_value: TOK_INTEGER  */
-#line 214 "grammar.y"
+#line 233 "grammar.y"
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int_elem(ctx->parent, -1, (yyvsp[0].ival));
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.ival = (yyvsp[0].ival);
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT, value,
+                          CONFIG_FORMAT_DEFAULT))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_DEFAULT);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -1425,25 +1444,20 @@ yyreduce:
       config_setting_set_format(ctx->setting, CONFIG_FORMAT_DEFAULT);
     }
   }
-#line 1429 "grammar.c"
+#line 1448 "grammar.c"
     break;
 
   case 25: /* simple_value: TOK_INTEGER64  */
-#line 236 "grammar.y"
+#line 250 "grammar.y"
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int64_elem(ctx->parent, -1, (yyvsp[0].llval));
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.llval = (yyvsp[0].llval);
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT64, value,
+                          CONFIG_FORMAT_DEFAULT))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_DEFAULT);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -1451,25 +1465,20 @@ yyreduce:
       config_setting_set_format(ctx->setting, CONFIG_FORMAT_DEFAULT);
     }
   }
-#line 1455 "grammar.c"
+#line 1469 "grammar.c"
     break;
 
   case 26: /* simple_value: TOK_HEX  */
-#line 258 "grammar.y"
+#line 267 "grammar.y"
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int_elem(ctx->parent, -1, (yyvsp[0].ival));
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.ival = (yyvsp[0].ival);
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT, value,
+                          CONFIG_FORMAT_HEX))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_HEX);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -1477,25 +1486,20 @@ yyreduce:
       config_setting_set_format(ctx->setting, CONFIG_FORMAT_HEX);
     }
   }
-#line 1481 "grammar.c"
+#line 1490 "grammar.c"
     break;
 
   case 27: /* simple_value: TOK_HEX64  */
-#line 280 "grammar.y"
+#line 284 "grammar.y"
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int64_elem(ctx->parent, -1, (yyvsp[0].llval));
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.llval = (yyvsp[0].llval);
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT64, value,
+                          CONFIG_FORMAT_HEX))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_HEX);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -1503,25 +1507,20 @@ yyreduce:
       config_setting_set_format(ctx->setting, CONFIG_FORMAT_HEX);
     }
   }
-#line 1507 "grammar.c"
+#line 1511 "grammar.c"
     break;
 
   case 28: /* simple_value: TOK_BIN  */
-#line 302 "grammar.y"
+#line 301 "grammar.y"
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int_elem(ctx->parent, -1, (yyvsp[0].ival));
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.ival = (yyvsp[0].ival);
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT, value,
+                          CONFIG_FORMAT_BIN))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_BIN);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -1529,25 +1528,20 @@ yyreduce:
       config_setting_set_format(ctx->setting, CONFIG_FORMAT_BIN);
     }
   }
-#line 1533 "grammar.c"
+#line 1532 "grammar.c"
     break;
 
   case 29: /* simple_value: TOK_BIN64  */
-#line 324 "grammar.y"
+#line 318 "grammar.y"
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int64_elem(ctx->parent, -1, (yyvsp[0].llval));
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.llval = (yyvsp[0].llval);
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT64, value,
+                          CONFIG_FORMAT_BIN))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_BIN);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -1555,62 +1549,54 @@ yyreduce:
       config_setting_set_format(ctx->setting, CONFIG_FORMAT_BIN);
     }
   }
-#line 1559 "grammar.c"
+#line 1553 "grammar.c"
     break;
 
   case 30: /* simple_value: TOK_FLOAT  */
-#line 346 "grammar.y"
+#line 335 "grammar.y"
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_float_elem(ctx->parent, -1, (yyvsp[0].fval));
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.fval = (yyvsp[0].fval);
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_FLOAT, value,
+                          CONFIG_FORMAT_DEFAULT))
         YYABORT;
-      }
-      else
-      {
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
       config_setting_set_float(ctx->setting, (yyvsp[0].fval));
   }
-#line 1581 "grammar.c"
+#line 1571 "grammar.c"
     break;
 
   case 31: /* simple_value: string  */
-#line 364 "grammar.y"
+#line 349 "grammar.y"
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      const char *s = libconfig_parsectx_take_string(ctx);
-      config_setting_t *e = config_setting_set_string_elem(ctx->parent, -1, s);
-      __delete(s);
+      config_value_t value;
 
-      if(! e)
+      value.sval = libconfig_parsectx_take_string(ctx);
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_STRING, value,
+                          CONFIG_FORMAT_DEFAULT))
       {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+        __delete(value.sval);
         YYABORT;
       }
-      else
-      {
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
-      const char *s = libconfig_parsectx_take_string(ctx);
-      config_setting_set_string(ctx->setting, s);
-      __delete(s);
+      char *s = libconfig_parsectx_take_string(ctx);
+      if(! libconfig_setting_take_string(ctx->setting, s))
+        __delete(s);
     }
   }
-#line 1610 "grammar.c"
+#line 1596 "grammar.c"
     break;
 
   case 42: /* $@4: %empty  */
-#line 414 "grammar.y"
+#line 395 "grammar.y"
   {
     if(IN_LIST())
     {
@@ -1623,21 +1609,25 @@ yyreduce:
       ctx->parent = ctx->setting;
       ctx->setting = NULL;
     }
+
+    scan_ctx->include_parent = ctx->parent;
   }
-#line 1628 "grammar.c"
+#line 1616 "grammar.c"
     break;
 
   case 43: /* group: TOK_GROUP_START $@4 setting_list_optional TOK_GROUP_END  */
-#line 429 "grammar.y"
+#line 412 "grammar.y"
   {
     if(ctx->parent)
       ctx->parent = ctx->parent->parent;
+
+    scan_ctx->include_parent = NULL;
   }
-#line 1637 "grammar.c"
+#line 1627 "grammar.c"
     break;
 
 
-#line 1641 "grammar.c"
+#line 1631 "grammar.c"
 
       default: break;
     }
@@ -1830,5 +1820,5 @@ yyreturnlab:
   return yyresult;
 }
 
-#line 435 "grammar.y"
+#line 420 "grammar.y"
 
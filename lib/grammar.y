@@ -72,6 +72,27 @@ void libconfig_yyerror(void *scanner, struct parse_context *ctx,
   ctx->config->error_text = s;
 }
 
+/* Array elements are packed, and so have no source position of their own;
+ * list elements do.
+ */
+static int append_element(void *scanner, struct parse_context *ctx,
+                          struct scan_context *scan_ctx, int type,
+                          config_value_t value, unsigned short format)
+{
+  config_setting_t *e;
+
+  if(! libconfig_setting_append(ctx->parent, type, value, format, &e))
+  {
+    libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+    return(0);
+  }
+
+  if(e)
+    CAPTURE_PARSE_POS(e);
+
+  return(1);
+}
+
 %}
 
 %union
@@ -125,10 +146,14 @@ setting:
     else
     {
       CAPTURE_PARSE_POS(ctx->setting);
+      scan_ctx->include_parent = NULL;
     }
   }
 
   TOK_EQUALS value setting_terminator
+  {
+    scan_ctx->include_parent = ctx->parent;
+  }
   ;
 
 array:
@@ -185,8 +210,8 @@ value:
   ;
 
 string:
-  TOK_STRING { libconfig_parsectx_append_string(ctx, $1); free($1); }
-  | string TOK_STRING { libconfig_parsectx_append_string(ctx, $2); free($2); }
+  TOK_STRING { libconfig_parsectx_adopt_string(ctx, $1); }
+  | string TOK_STRING { libconfig_parsectx_adopt_string(ctx, $2); }
   ;
 
 simple_value:
@@ -194,18 +219,12 @@ simple_value:
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_bool_elem(ctx->parent, -1,
-                                                         (int)$1);
+      config_value_t value;
 
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      value.ival = (int)$1;
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_BOOL, value,
+                          CONFIG_FORMAT_DEFAULT))
         YYABORT;
-      }
-      else
-      {
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
       config_setting_set_bool(ctx->setting, (int)$1);
@@ -214,17 +233,12 @@ simple_value:
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int_elem(ctx->parent, -1, $1);
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.ival = $1;
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT, value,
+                          CONFIG_FORMAT_DEFAULT))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_DEFAULT);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -236,17 +250,12 @@ simple_value:
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int64_elem(ctx->parent, -1, $1);
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.llval = $1;
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT64, value,
+                          CONFIG_FORMAT_DEFAULT))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_DEFAULT);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -258,17 +267,12 @@ simple_value:
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int_elem(ctx->parent, -1, $1);
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.ival = $1;
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT, value,
+                          CONFIG_FORMAT_HEX))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_HEX);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -280,17 +284,12 @@ simple_value:
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int64_elem(ctx->parent, -1, $1);
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.llval = $1;
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT64, value,
+                          CONFIG_FORMAT_HEX))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_HEX);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -302,17 +301,12 @@ simple_value:
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int_elem(ctx->parent, -1, $1);
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.ival = $1;
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT, value,
+                          CONFIG_FORMAT_BIN))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_BIN);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -324,17 +318,12 @@ simple_value:
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_int64_elem(ctx->parent, -1, $1);
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.llval = $1;
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_INT64, value,
+                          CONFIG_FORMAT_BIN))
         YYABORT;
-      }
-      else
-      {
-        config_setting_set_format(e, CONFIG_FORMAT_BIN);
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
@@ -346,16 +335,12 @@ simple_value:
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      config_setting_t *e = config_setting_set_float_elem(ctx->parent, -1, $1);
-      if(! e)
-      {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+      config_value_t value;
+
+      value.fval = $1;
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_FLOAT, value,
+                          CONFIG_FORMAT_DEFAULT))
         YYABORT;
-      }
-      else
-      {
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
       config_setting_set_float(ctx->setting, $1);
@@ -364,25 +349,21 @@ simple_value:
   {
     if(IN_ARRAY() || IN_LIST())
     {
-      const char *s = libconfig_parsectx_take_string(ctx);
-      config_setting_t *e = config_setting_set_string_elem(ctx->parent, -1, s);
-      __delete(s);
+      config_value_t value;
 
-      if(! e)
+      value.sval = libconfig_parsectx_take_string(ctx);
+      if(! append_element(scanner, ctx, scan_ctx, CONFIG_TYPE_STRING, value,
+                          CONFIG_FORMAT_DEFAULT))
       {
-        libconfig_yyerror(scanner, ctx, scan_ctx, err_array_elem_type);
+        __delete(value.sval);
         YYABORT;
       }
-      else
-      {
-        CAPTURE_PARSE_POS(e);
-      }
     }
     else
     {
-      const char *s = libconfig_parsectx_take_string(ctx);
-      config_setting_set_string(ctx->setting, s);
-      __delete(s);
+      char *s = libconfig_parsectx_take_string(ctx);
+      if(! libconfig_setting_take_string(ctx->setting, s))
+        __delete(s);
     }
   }
   ;
@@ -423,12 +404,16 @@ group:
       ctx->parent = ctx->setting;
       ctx->setting = NULL;
     }
+
+    scan_ctx->include_parent = ctx->parent;
   }
   setting_list_optional
   TOK_GROUP_END
   {
     if(ctx->parent)
       ctx->parent = ctx->parent->parent;
+
+    scan_ctx->include_parent = NULL;
   }
   ;
 
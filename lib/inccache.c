@@ -0,0 +1,293 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#include "inccache.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define INCCACHE_MIN_BUCKETS 32
+#define INCCACHE_READ_SIZE 16384
+
+/* ------------------------------------------------------------------------- */
+
+/* Reads the file and records its modification time, size and a 64-bit
+ * FNV-1a hash of its contents. Returns zero if the file cannot be read.
+ */
+static int __inccache_stamp(struct include_cache_stamp *stamp,
+                            const char *path)
+{
+  struct stat statbuf;
+  unsigned char *buf;
+  unsigned long long h = 14695981039346656037ULL;
+  size_t n, i;
+  FILE *stream;
+  int ok;
+
+  if((stat(path, &statbuf) != 0) || S_ISDIR(statbuf.st_mode))
+    return(0);
+
+  stream = fopen(path, "rb");
+  if(! stream)
+    return(0);
+
+  buf = (unsigned char *)libconfig_malloc(INCCACHE_READ_SIZE);
+  while((n = fread(buf, 1, INCCACHE_READ_SIZE, stream)) > 0)
+  {
+    for(i = 0; i < n; ++i)
+    {
+      h ^= buf[i];
+      h *= 1099511628211ULL;
+    }
+  }
+
+  ok = ! ferror(stream);
+  __delete(buf);
+  fclose(stream);
+
+  stamp->mtime = statbuf.st_mtime;
+  stamp->size = (long long)statbuf.st_size;
+  stamp->hash = h;
+
+  return(ok);
+}
+
+/* ------------------------------------------------------------------------- */
+
+config_include_cache_t *config_include_cache_create(void)
+{
+  config_include_cache_t *cache = __new(config_include_cache_t);
+
+  cache->bucket_count = INCCACHE_MIN_BUCKETS;
+  cache->buckets = (struct include_cache_entry **)libconfig_calloc(
+    cache->bucket_count, sizeof(struct include_cache_entry *));
+
+  return(cache);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void config_include_cache_destroy(config_include_cache_t *cache)
+{
+  struct include_cache_entry *entry, *next;
+  struct include_cache_listing *listing;
+  unsigned int i;
+
+  if(! cache)
+    return;
+
+  for(i = 0; i < cache->bucket_count; ++i)
+  {
+    for(entry = cache->buckets[i]; entry; entry = next)
+    {
+      next = entry->next;
+      libconfig_inccache_reset(entry);
+      __delete(entry->path);
+      __delete(entry);
+    }
+  }
+
+  while((listing = cache->listings) != NULL)
+  {
+    cache->listings = listing->next;
+    libconfig_inccache_free_listing(listing);
+  }
+
+  __delete(cache->buckets);
+  __delete(cache);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void config_include_cache_get_stats(const config_include_cache_t *cache,
+                                    unsigned long *hits,
+                                    unsigned long *misses)
+{
+  if(hits)
+    *hits = cache ? cache->hits : 0;
+
+  if(misses)
+    *misses = cache ? cache->misses : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct include_cache_entry *libconfig_inccache_find(
+  config_include_cache_t *cache, const char *path)
+{
+  unsigned int hash = libconfig_hash_string(path, strlen(path));
+  struct include_cache_entry *entry;
+
+  for(entry = cache->buckets[hash & (cache->bucket_count - 1)]; entry;
+      entry = entry->next)
+  {
+    if((entry->hash == hash) && ! strcmp(entry->path, path))
+      return(entry);
+  }
+
+  return(NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct include_cache_entry *libconfig_inccache_add(
+  config_include_cache_t *cache, const char *path)
+{
+  struct include_cache_entry *entry = __new(struct include_cache_entry);
+  unsigned int slot;
+
+  if(cache->count >= cache->bucket_count)
+  {
+    /* Keep the chains short by doubling the table. */
+    unsigned int i, count = cache->bucket_count * 2;
+    struct include_cache_entry **buckets, *e, *next;
+
+    buckets = (struct include_cache_entry **)libconfig_calloc(
+      count, sizeof(struct include_cache_entry *));
+
+    for(i = 0; i < cache->bucket_count; ++i)
+    {
+      for(e = cache->buckets[i]; e; e = next)
+      {
+        next = e->next;
+        e->next = buckets[e->hash & (count - 1)];
+        buckets[e->hash & (count - 1)] = e;
+      }
+    }
+
+    __delete(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_count = count;
+  }
+
+  entry->path = strdup(path);
+  entry->hash = libconfig_hash_string(path, strlen(path));
+
+  slot = entry->hash & (cache->bucket_count - 1);
+  entry->next = cache->buckets[slot];
+  cache->buckets[slot] = entry;
+  ++cache->count;
+
+  return(entry);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_inccache_reset(struct include_cache_entry *entry)
+{
+  if(entry->tree)
+  {
+    config_destroy(entry->tree);
+    __delete(entry->tree);
+    entry->tree = NULL;
+  }
+
+  libconfig_inccache_free_stamps(entry->stamps, entry->stamp_count);
+  entry->stamps = NULL;
+  entry->stamp_count = 0;
+
+  __delete(entry->include_dir);
+  entry->include_dir = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct include_cache_stamp *libconfig_inccache_stamp_files(
+  const char * const *files, unsigned int count)
+{
+  struct include_cache_stamp *stamps;
+  unsigned int i;
+
+  stamps = (struct include_cache_stamp *)libconfig_calloc(
+    count, sizeof(struct include_cache_stamp));
+
+  for(i = 0; i < count; ++i)
+  {
+    stamps[i].path = strdup(files[i]);
+
+    /* A file that cannot be read now can never match later. */
+    if(! __inccache_stamp(&(stamps[i]), files[i]))
+      stamps[i].size = -1;
+  }
+
+  return(stamps);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int libconfig_inccache_stamps_fresh(const struct include_cache_stamp *stamps,
+                                    unsigned int count)
+{
+  struct include_cache_stamp now;
+  unsigned int i;
+
+  for(i = 0; i < count; ++i)
+  {
+    const struct include_cache_stamp *stamp = &(stamps[i]);
+    struct stat statbuf;
+
+    /* Only read the file when its time and size still match. */
+    if((stat(stamp->path, &statbuf) != 0)
+       || (statbuf.st_mtime != stamp->mtime)
+       || ((long long)statbuf.st_size != stamp->size))
+      return(0);
+
+    if(! __inccache_stamp(&now, stamp->path)
+       || (now.mtime != stamp->mtime) || (now.size != stamp->size)
+       || (now.hash != stamp->hash))
+      return(0);
+  }
+
+  return(count > 0);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_inccache_free_listing(struct include_cache_listing *listing)
+{
+  unsigned int i;
+
+  for(i = 0; i < listing->count; ++i)
+    __delete(listing->names[i]);
+
+  __delete(listing->names);
+  __delete(listing->path);
+  __delete(listing);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_inccache_free_stamps(struct include_cache_stamp *stamps,
+                                    unsigned int count)
+{
+  unsigned int i;
+
+  for(i = 0; i < count; ++i)
+    __delete(stamps[i].path);
+
+  __delete(stamps);
+}
+
+/* ------------------------------------------------------------------------- */
@@ -0,0 +1,132 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __libconfig_inccache_h
+#define __libconfig_inccache_h
+
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "libconfig.h"
+
+/* The state of a file that went into a cached fragment, or into a
+ * configuration watched by a reloader.
+ */
+struct include_cache_stamp
+{
+  char *path;
+  time_t mtime;
+  long long size;
+  unsigned long long hash;
+};
+
+/* A fragment that was parsed on its own, along with everything that its
+ * parse depended on. The tree is NULL if the fragment could not be parsed on
+ * its own; such fragments are scanned as part of the including file instead,
+ * until they change.
+ */
+struct include_cache_entry
+{
+  struct include_cache_entry *next;
+  char *path;
+  unsigned int hash;
+  int options;
+  char *include_dir;
+  config_include_fn_t include_fn;
+  config_t *tree;
+  int end; /* how the fragment ended; one of the SCANCTX_END_* values */
+  struct include_cache_stamp *stamps;
+  unsigned int stamp_count;
+  int building;
+};
+
+/* The names of the regular files in a directory, in strcmp() order, as last
+ * listed for a wildcard or directory include. The listing is reused for as
+ * long as the directory's modification time stays the same, provided that it
+ * was taken after that time.
+ */
+struct include_cache_listing
+{
+  struct include_cache_listing *next;
+  char *path;
+  time_t mtime;
+  time_t listed;
+  const char **names;
+  unsigned int count;
+};
+
+struct config_include_cache_t
+{
+  struct include_cache_entry **buckets;
+  unsigned int bucket_count;
+  unsigned int count;
+  unsigned long hits;
+  unsigned long misses;
+  int depth;
+  struct include_cache_listing *listings;
+  int listed; /* set when a directory is listed for an include */
+};
+
+/*
+ * Returns the entry for the resolved path, or NULL if there is none.
+ */
+extern struct include_cache_entry *libconfig_inccache_find(
+  config_include_cache_t *cache, const char *path);
+
+/*
+ * Adds an empty entry for the resolved path, which must not have one yet.
+ */
+extern struct include_cache_entry *libconfig_inccache_add(
+  config_include_cache_t *cache, const char *path);
+
+/*
+ * Empties an entry, releasing its tree and stamps.
+ */
+extern void libconfig_inccache_reset(struct include_cache_entry *entry);
+
+/*
+ * Returns the current state of the given files, as an array of count stamps.
+ */
+extern struct include_cache_stamp *libconfig_inccache_stamp_files(
+  const char * const *files, unsigned int count);
+
+/*
+ * Returns non-zero if none of the stamped files has changed: each must still
+ * have the same modification time, size and contents.
+ */
+extern int libconfig_inccache_stamps_fresh(
+  const struct include_cache_stamp *stamps, unsigned int count);
+
+/*
+ * Frees a directory listing.
+ */
+extern void libconfig_inccache_free_listing(
+  struct include_cache_listing *listing);
+
+/*
+ * Frees an array of stamps.
+ */
+extern void libconfig_inccache_free_stamps(struct include_cache_stamp *stamps,
+                                           unsigned int count);
+
+#endif /* __libconfig_inccache_h */
@@ -0,0 +1,441 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#include "inccache.h"
+#include "strvec.h"
+#include "util.h"
+#include "wincompat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#if ! defined(_WIN32)
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define INCGLOB_MIN_NAMES 16
+
+static const char *err_bad_include_dir = "cannot open include directory";
+
+/* ------------------------------------------------------------------------- */
+
+static int __incglob_is_separator(char c)
+{
+#if defined(_WIN32)
+  return((c == '/') || (c == '\\'));
+#else
+  return(c == '/');
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Matches a name against a pattern in which '*' stands for any run of
+ * characters, '?' for any one character, and "[...]" for any one of a set of
+ * characters, which may include ranges and is negated by a leading '!' or
+ * '^'. A '[' with no closing ']' matches itself.
+ */
+static int __incglob_match(const char *pattern, const char *name)
+{
+  const char *star = NULL, *resume = NULL;
+
+  while(*name)
+  {
+    if(*pattern == '*')
+    {
+      star = ++pattern;
+      resume = name;
+      continue;
+    }
+
+    if(*pattern == '[')
+    {
+      const char *p = pattern + 1;
+      int negate = 0, found = 0;
+
+      if((*p == '!') || (*p == '^'))
+      {
+        negate = 1;
+        ++p;
+      }
+
+      /* A ']' straight after the '[' is part of the set. */
+      if(*p == ']')
+      {
+        found = (*name == ']');
+        ++p;
+      }
+
+      while(*p && (*p != ']'))
+      {
+        if((p[1] == '-') && p[2] && (p[2] != ']'))
+        {
+          if(((unsigned char)*name >= (unsigned char)p[0])
+             && ((unsigned char)*name <= (unsigned char)p[2]))
+            found = 1;
+          p += 3;
+        }
+        else
+        {
+          if(*p == *name)
+            found = 1;
+          ++p;
+        }
+      }
+
+      if(*p == ']')
+      {
+        if(found != negate)
+        {
+          pattern = p + 1;
+          ++name;
+          continue;
+        }
+      }
+      else if(*name == '[')
+      {
+        ++pattern;
+        ++name;
+        continue;
+      }
+    }
+    else if((*pattern == '?') || ((*pattern == *name) && *pattern))
+    {
+      ++pattern;
+      ++name;
+      continue;
+    }
+
+    /* Let the last '*' take one more character, if there was one. */
+    if(! star)
+      return(0);
+
+    pattern = star;
+    name = ++resume;
+  }
+
+  while(*pattern == '*')
+    ++pattern;
+
+  return(*pattern == '\0');
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __incglob_compare(const void *a, const void *b)
+{
+  return(strcmp(*(const char * const *)a, *(const char * const *)b));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static char *__incglob_join(const char *dir, const char *name)
+{
+  size_t len = strlen(dir);
+  char *path = (char *)libconfig_malloc(len + strlen(name) + 2);
+
+  strcpy(path, dir);
+  if((len > 0) && ! __incglob_is_separator(dir[len - 1]))
+    strcat(path, FILE_SEPARATOR);
+  strcat(path, name);
+
+  return(path);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __incglob_add_name(struct include_cache_listing *listing,
+                               unsigned int *capacity, const char *name)
+{
+  if(listing->count == *capacity)
+  {
+    *capacity = *capacity ? *capacity * 2 : INCGLOB_MIN_NAMES;
+    listing->names = (const char **)libconfig_realloc(
+      (void *)listing->names, *capacity * sizeof(const char *));
+  }
+
+  listing->names[listing->count++] = strdup(name);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Lists the regular files in the directory into the listing, sorted by name.
+ * Returns zero if the directory cannot be read.
+ */
+static int __incglob_read_dir(struct include_cache_listing *listing)
+{
+  unsigned int capacity = 0;
+
+#if defined(_WIN32)
+
+  WIN32_FIND_DATAA data;
+  char *pattern = __incglob_join(listing->path, "*");
+  HANDLE find = FindFirstFileA(pattern, &data);
+
+  __delete(pattern);
+  if(find == INVALID_HANDLE_VALUE)
+    return(GetLastError() == ERROR_FILE_NOT_FOUND);
+
+  do
+  {
+    if(! (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+      __incglob_add_name(listing, &capacity, data.cFileName);
+  }
+  while(FindNextFileA(find, &data));
+
+  FindClose(find);
+
+#else
+
+  DIR *dir = opendir(listing->path);
+  struct dirent *entry;
+
+  if(! dir)
+    return(0);
+
+  while((entry = readdir(dir)) != NULL)
+  {
+    int regular;
+
+#if defined(_DIRENT_HAVE_D_TYPE)
+    if((entry->d_type != DT_UNKNOWN) && (entry->d_type != DT_LNK))
+      regular = (entry->d_type == DT_REG);
+    else
+#endif
+    {
+      /* Follow links, as opening the file would. */
+      struct stat statbuf;
+      char *path = __incglob_join(listing->path, entry->d_name);
+
+      regular = (stat(path, &statbuf) == 0) && S_ISREG(statbuf.st_mode);
+      __delete(path);
+    }
+
+    if(regular)
+      __incglob_add_name(listing, &capacity, entry->d_name);
+  }
+
+  closedir(dir);
+
+#endif
+
+  if(listing->count > 1)
+    qsort((void *)listing->names, listing->count, sizeof(const char *),
+          __incglob_compare);
+
+  return(1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the listing of a directory, or NULL if it cannot be read. With an
+ * include cache, the listing is kept in the cache, and is listed again only
+ * once the directory changes; otherwise *owned is set, and the caller must
+ * free the listing.
+ */
+static struct include_cache_listing *__incglob_listing(config_t *config,
+                                                       const char *path,
+                                                       int *owned)
+{
+  config_include_cache_t *cache = config->include_cache;
+  struct include_cache_listing *listing = NULL, **link;
+  struct stat statbuf;
+
+  *owned = (cache == NULL);
+
+  if((stat(path, &statbuf) != 0) || ! S_ISDIR(statbuf.st_mode))
+    return(NULL);
+
+  if(cache)
+  {
+    /* The fragment being cached, if any, now depends on this directory. */
+    cache->listed = 1;
+
+    for(link = &(cache->listings); *link; link = &((*link)->next))
+    {
+      if(! strcmp((*link)->path, path))
+        break;
+    }
+
+    if(*link)
+    {
+      /* A listing taken in the same second as the last change may have
+       * missed a later change in that second.
+       */
+      if(((*link)->mtime == statbuf.st_mtime)
+         && ((*link)->listed > (*link)->mtime))
+        return(*link);
+
+      listing = *link;
+      *link = listing->next;
+      libconfig_inccache_free_listing(listing);
+    }
+  }
+
+  listing = __new(struct include_cache_listing);
+  listing->path = strdup(path);
+  listing->mtime = statbuf.st_mtime;
+  listing->listed = time(NULL);
+
+  if(! __incglob_read_dir(listing))
+  {
+    libconfig_inccache_free_listing(listing);
+    return(NULL);
+  }
+
+  if(cache)
+  {
+    listing->next = cache->listings;
+    cache->listings = listing;
+  }
+
+  return(listing);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Asks the system to start reading the file into the page cache, so that it
+ * is ready by the time the scanner gets to it.
+ */
+static void __incglob_readahead(const char *path)
+{
+#if defined(POSIX_FADV_WILLNEED)
+  int fd = open(path, O_RDONLY);
+
+  if(fd >= 0)
+  {
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+  }
+#else
+  (void)path;
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+const char **config_glob_include_func(config_t *config,
+                                      const char *include_dir,
+                                      const char *path,
+                                      const char **error)
+{
+  struct include_cache_listing *listing;
+  struct stat statbuf;
+  strvec_t files = { NULL, NULL, 0, 0 };
+  const char **result;
+  const char *base, *pattern = NULL, *p;
+  char *resolved, *dir;
+  unsigned int i;
+  int owned;
+
+  if(include_dir && IS_RELATIVE_PATH(path))
+    resolved = __incglob_join(include_dir, path);
+  else
+    resolved = strdup(path);
+
+  *error = NULL;
+
+  for(base = p = resolved; *p; ++p)
+  {
+    if(__incglob_is_separator(*p))
+      base = p + 1;
+  }
+
+  /* Wildcards are expanded in the last part of the path only. */
+  if(strpbrk(base, "*?["))
+  {
+    pattern = base;
+    if(base == resolved)
+      dir = strdup(".");
+    else
+    {
+      size_t len = (size_t)(base - resolved - 1);
+
+      /* Keep the separator of a root directory. */
+      if(len == 0)
+        len = 1;
+
+      dir = (char *)libconfig_malloc(len + 1);
+      memcpy(dir, resolved, len);
+      dir[len] = '\0';
+    }
+  }
+  else if((*base == '\0')
+          || ((stat(resolved, &statbuf) == 0) && S_ISDIR(statbuf.st_mode)))
+  {
+    dir = resolved;
+    resolved = NULL;
+  }
+  else
+  {
+    /* A plain file is included as the default include function would. */
+    __incglob_readahead(resolved);
+    libconfig_strvec_append(&files, resolved);
+    return(libconfig_strvec_release(&files));
+  }
+
+  listing = __incglob_listing(config, dir, &owned);
+  if(! listing)
+  {
+    __delete(resolved);
+    __delete(dir);
+    *error = err_bad_include_dir;
+    return(NULL);
+  }
+
+  for(i = 0; i < listing->count; ++i)
+  {
+    const char *name = listing->names[i];
+
+    /* Hidden files are left out, unless the pattern asks for them. */
+    if(pattern ? (((*name == '.') && (*pattern != '.'))
+                  || ! __incglob_match(pattern, name))
+       : (*name == '.'))
+      continue;
+
+    libconfig_strvec_append(&files, pattern
+                            ? __incglob_join(base == resolved ? "" : dir, name)
+                            : __incglob_join(dir, name));
+  }
+
+  if(owned)
+    libconfig_inccache_free_listing(listing);
+
+  __delete(resolved);
+  __delete(dir);
+
+  result = libconfig_strvec_release(&files);
+  if(! result)
+    return((const char **)libconfig_calloc(1, sizeof(const char *)));
+
+  for(i = 0; result[i]; ++i)
+    __incglob_readahead(result[i]);
+
+  return(result);
+}
+
+/* ------------------------------------------------------------------------- */
@@ -0,0 +1,142 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#include "lazy.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+#if defined(_WIN32)
+
+typedef CRITICAL_SECTION lazy_mutex_t;
+
+#define LAZY_MUTEX_INIT(M) InitializeCriticalSection(M)
+#define LAZY_MUTEX_DESTROY(M) DeleteCriticalSection(M)
+#define LAZY_MUTEX_LOCK(M) EnterCriticalSection(M)
+#define LAZY_MUTEX_UNLOCK(M) LeaveCriticalSection(M)
+
+#else
+
+typedef pthread_mutex_t lazy_mutex_t;
+
+#define LAZY_MUTEX_INIT(M) pthread_mutex_init((M), NULL)
+#define LAZY_MUTEX_DESTROY(M) pthread_mutex_destroy(M)
+#define LAZY_MUTEX_LOCK(M) pthread_mutex_lock(M)
+#define LAZY_MUTEX_UNLOCK(M) pthread_mutex_unlock(M)
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+config_lazy_t *libconfig_lazy_create(mapfile_t *text)
+{
+  config_lazy_t *lazy = __new(config_lazy_t);
+  lazy_mutex_t *lock = __new(lazy_mutex_t);
+
+  LAZY_MUTEX_INIT(lock);
+  lazy->lock = lock;
+  lazy->text = *text;
+  __zero(text);
+
+  return(lazy);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_lazy_lock(config_lazy_t *lazy)
+{
+  LAZY_MUTEX_LOCK((lazy_mutex_t *)lazy->lock);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_lazy_unlock(config_lazy_t *lazy)
+{
+  LAZY_MUTEX_UNLOCK((lazy_mutex_t *)lazy->lock);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_lazy_add(config_lazy_t *lazy)
+{
+#if defined(_WIN32)
+  (void)InterlockedIncrement((volatile LONG *)&(lazy->deferred));
+#elif defined(__GNUC__)
+  (void)__atomic_add_fetch(&(lazy->deferred), 1, __ATOMIC_RELAXED);
+#else
+  ++(lazy->deferred);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_lazy_done(config_lazy_t *lazy)
+{
+#if defined(_WIN32)
+  (void)InterlockedDecrement((volatile LONG *)&(lazy->deferred));
+#elif defined(__GNUC__)
+  (void)__atomic_sub_fetch(&(lazy->deferred), 1, __ATOMIC_RELEASE);
+#else
+  --(lazy->deferred);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+int libconfig_lazy_pending(const config_lazy_t *lazy)
+{
+  if(! lazy)
+    return(0);
+
+#if defined(_WIN32)
+  return(InterlockedCompareExchange(
+           (volatile LONG *)&(((config_lazy_t *)lazy)->deferred), 0, 0) != 0);
+#elif defined(__GNUC__)
+  return(__atomic_load_n(&(lazy->deferred), __ATOMIC_ACQUIRE) != 0);
+#else
+  return(lazy->deferred != 0);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_lazy_destroy(config_lazy_t *lazy)
+{
+  if(! lazy)
+    return;
+
+  LAZY_MUTEX_DESTROY((lazy_mutex_t *)lazy->lock);
+  __delete(lazy->lock);
+  libconfig_mapfile_close(&(lazy->text));
+  __delete(lazy);
+}
+
+/* ------------------------------------------------------------------------- */
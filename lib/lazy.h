@@ -0,0 +1,87 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __libconfig_lazy_h
+#define __libconfig_lazy_h
+
+#include "libconfig.h"
+#include "mapfile.h"
+
+/* The input of a configuration read with CONFIG_OPTION_LAZY_LOAD, which the
+ * group, array and list bodies whose parsing was deferred point into, and
+ * the lock under which those bodies are parsed when they are first accessed.
+ */
+typedef struct config_lazy_t
+{
+  mapfile_t text;
+  long deferred; /* the number of deferred bodies still to be parsed */
+  void *lock;
+  /* The first syntax error found in a deferred body; set under the lock. */
+  const char *error_text;
+  const char *error_file;
+  int error_line;
+} config_lazy_t;
+
+/* The list of a group, array or list whose body has not been parsed yet. It
+ * is allocated, and freed, as the list; its "lazy" member points to itself
+ * until the body has been parsed into it.
+ */
+typedef struct config_lazy_body_t
+{
+  config_list_t list; /* must come first */
+  const char *text;   /* the body, up to and including its closing token */
+  size_t length;
+  int line;
+  const char *file;
+} config_lazy_body_t;
+
+/*
+ * Creates the state for a configuration, taking over the text, which is left
+ * empty.
+ */
+extern config_lazy_t *libconfig_lazy_create(mapfile_t *text);
+
+extern void libconfig_lazy_lock(config_lazy_t *lazy);
+extern void libconfig_lazy_unlock(config_lazy_t *lazy);
+
+/*
+ * Count the bodies that are deferred, and those that are parsed or destroyed
+ * before they were parsed. The count is updated atomically, so that readers
+ * can test it without the lock.
+ */
+extern void libconfig_lazy_add(config_lazy_t *lazy);
+extern void libconfig_lazy_done(config_lazy_t *lazy);
+
+/*
+ * Returns non-zero if lazy is not NULL and some deferred bodies have not been
+ * parsed yet. Once it returns zero, everything the parsing did is visible to
+ * the calling thread.
+ */
+extern int libconfig_lazy_pending(const config_lazy_t *lazy);
+
+/*
+ * Destroys the state and frees the text. Any bodies that point into it must
+ * have been destroyed first.
+ */
+extern void libconfig_lazy_destroy(config_lazy_t *lazy);
+
+#endif /* __libconfig_lazy_h */
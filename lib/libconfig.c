@@ -32,6 +32,7 @@
 
 #include <ctype.h>
 #include <float.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,8 +40,17 @@
 #include <sys/types.h>
 
 #include "libconfig.h"
+#include "arena.h"
+#include "format.h"
+#include "inccache.h"
+#include "lazy.h"
+#include "mapfile.h"
 #include "parsectx.h"
+#include "parser.h"
+#include "prefetch.h"
 #include "scanctx.h"
+#include "strbuf.h"
+#include "strpool.h"
 #include "strvec.h"
 #include "wincompat.h"
 #include "grammar.h"
@@ -53,6 +63,8 @@
 
 #define PATH_TOKENS ":./"
 #define CHUNK_SIZE 16
+#define INDEX_THRESHOLD 16
+#define INTERNED_STRING_MAX_LENGTH 32
 #define DEFAULT_TAB_WIDTH 2
 #define DEFAULT_FLOAT_PRECISION 6
 
@@ -72,87 +84,231 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 
 /* ------------------------------------------------------------------------- */
 
+/* Functions that take a const config_t or config_setting_t only read the
+ * tree: group indexes and interned names are maintained as settings are
+ * added and removed, never built lazily by a lookup. Any number of threads
+ * may therefore read the same configuration at once, without locking, as
+ * long as none of them modifies it. Keep it that way. The one exception is
+ * the parsing of bodies deferred by CONFIG_OPTION_LAZY_LOAD, which is done
+ * under a lock, and published atomically; see __config_setting_load(). The
+ * children of an aggregate, their names and their values, must therefore
+ * only be reached through __config_setting_list(), whose acquire load orders
+ * the reads after the parse. tests/threads.c++ is also run under
+ * ThreadSanitizer, with the library instrumented, to check this.
+ */
+
 static const char *__io_error = "file I/O error";
+static const char *__include_duplicate_error = "duplicate setting name";
+static const char *__syntax_error = "syntax error";
 
-static void __config_list_destroy(config_list_t *list);
+static void __config_list_destroy(config_t *config, config_list_t *list);
+static void __config_setting_destroy(config_setting_t *setting);
+static config_setting_t *config_setting_create(config_setting_t *parent,
+                                               const char *name,
+                                               int type, const char *comment);
+static const config_setting_t *__config_list_peek(const config_t *config,
+                                                  const config_list_t *list,
+                                                  unsigned int idx,
+                                                  config_setting_t *scratch);
 static void __config_write_setting(const config_t *config,
                                    const config_setting_t *setting,
-                                   FILE *stream, int depth);
+                                   strbuf_t *buf, int depth);
+static config_list_t *__config_setting_list(const config_setting_t *setting);
 
 /* ------------------------------------------------------------------------- */
 
-static void __config_locale_override(void)
-{
 #if (defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+#define LOCALE_SWITCH_WIN32
+#elif defined(__APPLE__) \
+  || ((defined HAVE_NEWLOCALE) && (defined HAVE_USELOCALE))
+#define LOCALE_SWITCH_THREAD
+#endif
 
-  _configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
-  setlocale(LC_NUMERIC, "C");
+#if defined(LOCALE_SWITCH_THREAD)
+
+typedef locale_t saved_locale_t;
+
+/* The "C" locale used while parsing and writing is created on first use and
+ * kept for the life of the process, so that switching the calling thread to
+ * it and back costs two uselocale() calls rather than a newlocale() and a
+ * freelocale() as well.
+ */
+static locale_t __config_c_locale = (locale_t)0;
+
+static locale_t __config_get_c_locale(void)
+{
+#if defined(__GNUC__)
+  locale_t loc = __atomic_load_n(&__config_c_locale, __ATOMIC_ACQUIRE);
+  locale_t expected = (locale_t)0;
+
+  if(loc)
+    return(loc);
+
+  loc = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+  if(! loc)
+    return(loc);
+
+  if(! __atomic_compare_exchange_n(&__config_c_locale, &expected, loc, 0,
+                                   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+  {
+    /* Another thread created it first. */
+#if defined(__APPLE__) || (defined HAVE_FREELOCALE)
+    freelocale(loc);
+#endif
+    loc = expected;
+  }
+
+  return(loc);
+#else
+  if(! __config_c_locale)
+    __config_c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+
+  return(__config_c_locale);
+#endif
+}
 
-#elif defined(__APPLE__)
+#else /* ! LOCALE_SWITCH_THREAD */
 
-  locale_t loc = newlocale(LC_NUMERIC_MASK, "C", NULL);
-  uselocale(loc);
+typedef int saved_locale_t;
+
+#endif /* LOCALE_SWITCH_THREAD */
+
+/* ------------------------------------------------------------------------- */
+
+static saved_locale_t __config_locale_override(void)
+{
+#if defined(LOCALE_SWITCH_WIN32)
+
+  _configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
+  setlocale(LC_NUMERIC, "C");
+  return(0);
 
-#elif ((defined HAVE_NEWLOCALE) && (defined HAVE_USELOCALE))
+#elif defined(LOCALE_SWITCH_THREAD)
 
-  locale_t loc = newlocale(LC_NUMERIC, "C", NULL);
-  uselocale(loc);
+  locale_t loc = __config_get_c_locale();
+  return(loc ? uselocale(loc) : (locale_t)0);
 
 #else
 
 #warning "No way to modify calling thread's locale!"
+  return(0);
 
 #endif
 }
 
 /* ------------------------------------------------------------------------- */
 
-static void __config_locale_restore(void)
+/* Puts back the locale that the calling thread had before
+ * __config_locale_override() was called.
+ */
+static void __config_locale_restore(saved_locale_t saved)
 {
-#if (defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+#if defined(LOCALE_SWITCH_WIN32)
 
-    _configthreadlocale(_DISABLE_PER_THREAD_LOCALE);
+  (void)saved;
+  _configthreadlocale(_DISABLE_PER_THREAD_LOCALE);
 
-#elif ((defined HAVE_USELOCALE) && (defined HAVE_FREELOCALE))
+#elif defined(LOCALE_SWITCH_THREAD)
 
-  locale_t loc = uselocale(LC_GLOBAL_LOCALE);
-  freelocale(loc);
+  if(saved)
+    uselocale(saved);
 
 #else
 
 #warning "No way to modify calling thread's locale!"
+  (void)saved;
 
 #endif
 }
 
 /* ------------------------------------------------------------------------- */
 
-static void __config_indent(FILE *stream, int depth, unsigned short w)
+/* The configuration is serialized into a strbuf_t, which the public write
+ * functions then hand to the caller or write out in one go.
+ */
+
+static void __config_indent(strbuf_t *buf, int depth, unsigned short w)
 {
   if(w)
-    fprintf(stream, "%*s", (depth - 1) * w, " ");
+    libconfig_strbuf_append_repeated(buf, ' ', (size_t)(depth - 1) * w);
   else
+    libconfig_strbuf_append_repeated(buf, '\t', (size_t)(depth - 1));
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Appends the string s in double quotes, escaping it as necessary. Runs of
+ * characters that need no escaping are copied in one piece.
+ */
+static void __config_write_string(strbuf_t *buf, const char *s)
+{
+  const char *run;
+
+  libconfig_strbuf_append_char(buf, '\"');
+
+  for(run = s; s && *s; s++)
   {
-    int i;
-    for(i = 0; i < (depth - 1); ++i)
-      fputc('\t', stream);
+    int c = (int)*s & 0xFF;
+    char escape[5];
+
+    if((c >= ' ') && (c != '\"') && (c != '\\'))
+      continue;
+
+    libconfig_strbuf_append(buf, run, (size_t)(s - run));
+    run = s + 1;
+
+    switch(c)
+    {
+      case '\"':
+      case '\\':
+        escape[0] = '\\';
+        escape[1] = (char)c;
+        libconfig_strbuf_append(buf, escape, 2);
+        break;
+
+      case '\n':
+        libconfig_strbuf_append(buf, "\\n", 2);
+        break;
+
+      case '\r':
+        libconfig_strbuf_append(buf, "\\r", 2);
+        break;
+
+      case '\f':
+        libconfig_strbuf_append(buf, "\\f", 2);
+        break;
+
+      case '\t':
+        libconfig_strbuf_append(buf, "\\t", 2);
+        break;
+
+      default:
+        snprintf(escape, sizeof(escape), "\\x%02X", c);
+        libconfig_strbuf_append(buf, escape, 4);
+        break;
+    }
   }
+
+  if(s)
+    libconfig_strbuf_append(buf, run, (size_t)(s - run));
+
+  libconfig_strbuf_append_char(buf, '\"');
 }
 
 /* ------------------------------------------------------------------------- */
 
 static void __config_write_value(const config_t *config,
                                  const config_value_t *value, int type,
-                                 int format, int depth, FILE *stream)
+                                 int format, int depth, strbuf_t *buf)
 {
-  char temp_buf[65]; /* Long enough for 64 binary digits + NULL terminator.
-                        Used to be 64 when just used for floats */
+  char temp_buf[LIBCONFIG_FORMAT_BUFSIZE];
+  size_t len;
 
   switch(type)
   {
     /* boolean */
     case CONFIG_TYPE_BOOL:
-      fputs(value->ival ? "true" : "false", stream);
+      libconfig_strbuf_append_string(buf, value->ival ? "true" : "false");
       break;
 
     /* int */
@@ -160,20 +316,22 @@ static void __config_write_value(const config_t *config,
       switch(format)
       {
         case CONFIG_FORMAT_HEX:
-          fprintf(stream, "0x%X", value->ival);
+          libconfig_strbuf_append(buf, "0x", 2);
+          len = libconfig_format_hex((unsigned int)value->ival, temp_buf);
           break;
 
         case CONFIG_FORMAT_BIN:
-          /* Once %b/%B become more widely supported, could feature test for them */
-          libconfig_format_bin(value->ival, temp_buf, sizeof(temp_buf));
-          fprintf(stream, "0b%s", temp_buf);
+          libconfig_strbuf_append(buf, "0b", 2);
+          len = libconfig_format_bin((uint64_t)(int64_t)value->ival,
+                                     temp_buf);
           break;
 
        case CONFIG_FORMAT_DEFAULT:
         default:
-          fprintf(stream, "%d", value->ival);
+          len = libconfig_format_dec(value->ival, temp_buf);
           break;
       }
+      libconfig_strbuf_append(buf, temp_buf, len);
       break;
 
     /* 64-bit int */
@@ -181,20 +339,22 @@ static void __config_write_value(const config_t *config,
       switch(format)
       {
         case CONFIG_FORMAT_HEX:
-          fprintf(stream, "0x" INT64_HEX_FMT "L", value->llval);
+          libconfig_strbuf_append(buf, "0x", 2);
+          len = libconfig_format_hex((uint64_t)value->llval, temp_buf);
           break;
 
         case CONFIG_FORMAT_BIN:
-          /* Once %b/%B become more widely supported, could feature test for them */
-          libconfig_format_bin(value->llval, temp_buf, sizeof(temp_buf));
-          fprintf(stream, "0b%sL", temp_buf);
+          libconfig_strbuf_append(buf, "0b", 2);
+          len = libconfig_format_bin((uint64_t)value->llval, temp_buf);
           break;
 
         case CONFIG_FORMAT_DEFAULT:
         default:
-          fprintf(stream, INT64_FMT "L", value->llval);
+          len = libconfig_format_dec(value->llval, temp_buf);
           break;
       }
+      temp_buf[len++] = 'L';
+      libconfig_strbuf_append(buf, temp_buf, len);
       break;
 
     /* float */
@@ -202,66 +362,28 @@ static void __config_write_value(const config_t *config,
     {
       const int sci_ok = config_get_option(
             config, CONFIG_OPTION_ALLOW_SCIENTIFIC_NOTATION);
-      libconfig_format_double(value->fval, config->float_precision, sci_ok,
-                              temp_buf, sizeof(temp_buf));
-      fputs(temp_buf, stream);
+      int precision = config->float_precision;
+
+      if(config_get_option(config, CONFIG_OPTION_SHORTEST_FLOATS))
+        precision = -1; /* Shortest round trip. */
+
+      len = libconfig_format_double(value->fval, precision, sci_ok, temp_buf,
+                                    sizeof(temp_buf));
+      libconfig_strbuf_append(buf, temp_buf, len);
       break;
     }
 
     /* string */
     case CONFIG_TYPE_STRING:
-    {
-      char *p;
-
-      fputc('\"', stream);
-
-      if(value->sval)
-      {
-        for(p = value->sval; *p; p++)
-        {
-          int c = (int)*p & 0xFF;
-          switch(c)
-          {
-            case '\"':
-            case '\\':
-              fputc('\\', stream);
-              fputc(c, stream);
-              break;
-
-            case '\n':
-              fputs("\\n", stream);
-              break;
-
-            case '\r':
-              fputs("\\r", stream);
-              break;
-
-            case '\f':
-              fputs("\\f", stream);
-              break;
-
-            case '\t':
-              fputs("\\t", stream);
-              break;
-
-            default:
-              if(c >= ' ')
-                fputc(c, stream);
-              else
-                fprintf(stream, "\\x%02X", c);
-          }
-        }
-      }
-      fputc('\"', stream);
+      __config_write_string(buf, value->sval);
       break;
-    }
 
     /* list */
     case CONFIG_TYPE_LIST:
     {
       config_list_t *list = value->list;
 
-      fputs("( ", stream);
+      libconfig_strbuf_append(buf, "( ", 2);
 
       if(list)
       {
@@ -270,18 +392,21 @@ static void __config_write_value(const config_t *config,
 
         for(s = list->elements; len--; s++)
         {
+          if(config_setting_is_aggregate(*s))
+            (void)__config_setting_list(*s);
+
           __config_write_value(config, &((*s)->value), (*s)->type,
                                config_setting_get_format(*s), depth + 1,
-                               stream);
+                               buf);
 
           if(len)
-            fputc(',', stream);
+            libconfig_strbuf_append_char(buf, ',');
 
-          fputc(' ', stream);
+          libconfig_strbuf_append_char(buf, ' ');
         }
       }
 
-      fputc(')', stream);
+      libconfig_strbuf_append_char(buf, ')');
       break;
     }
 
@@ -290,27 +415,29 @@ static void __config_write_value(const config_t *config,
     {
       config_list_t *list = value->list;
 
-      fputs("[ ", stream);
+      libconfig_strbuf_append(buf, "[ ", 2);
 
       if(list)
       {
-        int len = list->length;
-        config_setting_t **s;
+        config_setting_t scratch;
+        const config_setting_t *s;
+        unsigned int i;
 
-        for(s = list->elements; len--; s++)
+        for(i = 0; i < list->length; ++i)
         {
-          __config_write_value(config, &((*s)->value), (*s)->type,
-                               config_setting_get_format(*s), depth + 1,
-                               stream);
+          s = __config_list_peek(config, list, i, &scratch);
+          __config_write_value(config, &(s->value), s->type,
+                               config_setting_get_format(s), depth + 1,
+                               buf);
 
-          if(len)
-            fputc(',', stream);
+          if(i + 1 < list->length)
+            libconfig_strbuf_append_char(buf, ',');
 
-          fputc(' ', stream);
+          libconfig_strbuf_append_char(buf, ' ');
         }
       }
 
-      fputc(']', stream);
+      libconfig_strbuf_append_char(buf, ']');
       break;
     }
 
@@ -323,13 +450,13 @@ static void __config_write_value(const config_t *config,
       {
         if(config_get_option(config, CONFIG_OPTION_OPEN_BRACE_ON_SEPARATE_LINE))
         {
-          fputc('\n', stream);
+          libconfig_strbuf_append_char(buf, '\n');
 
           if(depth > 1)
-            __config_indent(stream, depth, config->tab_width);
+            __config_indent(buf, depth, config->tab_width);
         }
 
-        fputs("{\n", stream);
+        libconfig_strbuf_append(buf, "{\n", 2);
       }
 
       if(list)
@@ -338,387 +465,2773 @@ static void __config_write_value(const config_t *config,
         config_setting_t **s;
 
         for(s = list->elements; len--; s++)
-          __config_write_setting(config, *s, stream, depth + 1);
+          __config_write_setting(config, *s, buf, depth + 1);
       }
 
       if(depth > 1)
-        __config_indent(stream, depth, config->tab_width);
+        __config_indent(buf, depth, config->tab_width);
 
       if(depth > 0)
-        fputc('}', stream);
+        libconfig_strbuf_append_char(buf, '}');
 
       break;
     }
 
     default:
       /* this shouldn't happen, but handle it gracefully... */
-      fputs("???", stream);
+      libconfig_strbuf_append(buf, "???", 3);
       break;
   }
 }
 
 /* ------------------------------------------------------------------------- */
 
-static void __config_list_add(config_list_t *list, config_setting_t *setting)
+/* When the configuration has an arena, the nodes, names, string values and
+ * element arrays of its tree are carved out of it, and individual frees are
+ * no-ops; the arena is released as a whole by config_clear() and
+ * config_destroy().
+ */
+static void *__config_alloc(config_t *config, size_t size)
 {
-  if((list->length % CHUNK_SIZE) == 0)
-  {
-    list->elements = (config_setting_t **)libconfig_realloc(
-      list->elements,
-      (list->length + CHUNK_SIZE) * sizeof(config_setting_t *));
-  }
+  if(config->arena)
+    return(libconfig_arena_alloc(config->arena, size));
 
-  list->elements[list->length] = setting;
-  list->length++;
+  return(libconfig_calloc(1, size));
 }
 
 /* ------------------------------------------------------------------------- */
 
-/* This function takes the length of the name to be searched for, so that one
- * component of a longer path can be passed in.
- */
-static config_setting_t *__config_list_search(config_list_t *list,
-                                              const char *name,
-                                              size_t namelen,
-                                              unsigned int *idx)
+static void __config_free(const config_t *config, void *ptr)
 {
-  config_setting_t **found = NULL;
-  unsigned int i;
-
-  if(! list || ! name)
-    return(NULL);
+  if(! config->arena)
+    __delete(ptr);
+}
 
-  for(i = 0, found = list->elements; i < list->length; i++, found++)
-  {
-    if(! (*found)->name)
-      continue;
+/* ------------------------------------------------------------------------- */
 
-    if((strlen((*found)->name) == namelen)
-        && !strncmp(name, (*found)->name, namelen))
-    {
-      if(idx)
-        *idx = i;
+static char *__config_strdup(config_t *config, const char *s)
+{
+  if(! s)
+    return(NULL);
 
-      return(*found);
-    }
-  }
+  if(config->arena)
+    return(libconfig_arena_strdup(config->arena, s));
 
-  return(NULL);
+  return(strdup(s));
 }
 
 /* ------------------------------------------------------------------------- */
 
-static config_setting_t *__config_list_remove(config_list_t *list, int idx)
+/* When the configuration has a string pool, every setting name is interned,
+ * and so are string values of up to INTERNED_STRING_MAX_LENGTH characters
+ * while CONFIG_OPTION_INTERN_STRINGS is set. Pooled strings live until the
+ * configuration is cleared or destroyed.
+ */
+static char *__config_name_dup(config_t *config, const char *name,
+                               unsigned int hash)
 {
-  config_setting_t *removed = *(list->elements + idx);
-  int offset = (idx * sizeof(config_setting_t *));
-  int len = list->length - 1 - idx;
-  char *base = (char *)list->elements + offset;
-
-  memmove(base, base + sizeof(config_setting_t *),
-          len * sizeof(config_setting_t *));
-
-  list->length--;
-
-  /* possibly realloc smaller? */
+  if(name && config->strpool)
+    return((char *)libconfig_strpool_intern(config->strpool, name,
+                                            strlen(name), hash));
 
-  return(removed);
+  return(__config_strdup(config, name));
 }
 
 /* ------------------------------------------------------------------------- */
 
-static void __config_setting_destroy(config_setting_t *setting)
+static char *__config_string_dup(config_t *config, const char *s)
 {
-  if(setting)
+  if(s && config->strpool
+     && config_get_option(config, CONFIG_OPTION_INTERN_STRINGS))
   {
-    if(setting->name)
-      __delete(setting->name);
-
-    if(setting->type == CONFIG_TYPE_STRING)
-      __delete(setting->value.sval);
-
-    else if(config_setting_is_aggregate(setting))
-    {
-      if(setting->value.list)
-        __config_list_destroy(setting->value.list);
-    }
+    size_t len = strlen(s);
 
-    if(setting->hook && setting->config->destructor)
-      setting->config->destructor(setting->hook);
-
-    __delete(setting);
+    if(len <= INTERNED_STRING_MAX_LENGTH)
+      return((char *)libconfig_strpool_intern(
+               config->strpool, s, len, libconfig_hash_string(s, len)));
   }
+
+  return(__config_strdup(config, s));
 }
 
 /* ------------------------------------------------------------------------- */
 
-static void __config_list_destroy(config_list_t *list)
+static void __config_string_free(const config_t *config, char *s)
 {
-  config_setting_t **p;
-  unsigned int i;
-
-  if(! list)
+  if(s && config->strpool
+     && libconfig_strpool_owns(config->strpool, s,
+                               libconfig_hash_string(s, strlen(s))))
     return;
 
-  if(list->elements)
-  {
-    for(p = list->elements, i = 0; i < list->length; p++, i++)
-      __config_setting_destroy(*p);
+  __config_free(config, s);
+}
 
-    __delete(list->elements);
-  }
+/* ------------------------------------------------------------------------- */
+
+static void __config_index_insert(config_setting_t **index,
+                                  unsigned int size,
+                                  config_setting_t *setting)
+{
+  unsigned int mask = size - 1;
+  unsigned int slot = setting->hash & mask;
+
+  while(index[slot])
+    slot = (slot + 1) & mask;
 
-  __delete(list);
+  index[slot] = setting;
 }
 
 /* ------------------------------------------------------------------------- */
 
-static int __config_list_checktype(const config_setting_t *setting, int type)
+static void __config_index_remove(config_setting_t **index, unsigned int size,
+                                  const config_setting_t *setting)
 {
-  /* if the array is empty, then it has no type yet */
+  unsigned int mask = size - 1;
+  unsigned int i = setting->hash & mask;
+  unsigned int j, k;
 
-  if(! setting->value.list)
-    return(CONFIG_TRUE);
-
-  if(setting->value.list->length == 0)
-    return(CONFIG_TRUE);
+  while(index[i] != setting)
+  {
+    if(! index[i])
+      return; /* not indexed */
 
-  /* if it's a list, any type is allowed */
+    i = (i + 1) & mask;
+  }
 
-  if(setting->type == CONFIG_TYPE_LIST)
-    return(CONFIG_TRUE);
+  /* Backward-shift deletion, so that no tombstones are needed. */
+  for(;;)
+  {
+    index[i] = NULL;
 
-  /* otherwise the first element added determines the type of the array */
+    for(j = i;;)
+    {
+      j = (j + 1) & mask;
+      if(! index[j])
+        return;
 
-  return((setting->value.list->elements[0]->type == type)
-         ? CONFIG_TRUE : CONFIG_FALSE);
-}
+      /* Leave the entry alone if its home slot lies cyclically in (i, j]. */
+      k = index[j]->hash & mask;
+      if((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+        continue;
 
-/* ------------------------------------------------------------------------- */
+      break;
+    }
 
-static int __config_type_is_scalar(int type)
-{
-  return((type >= CONFIG_TYPE_INT) && (type <= CONFIG_TYPE_BOOL));
+    index[i] = index[j];
+    i = j;
+  }
 }
 
 /* ------------------------------------------------------------------------- */
 
-static int __config_validate_name(const char *name)
+static void __config_list_reindex(config_t *config, config_list_t *list)
 {
-  const char *p = name;
+  config_setting_t **s;
+  unsigned int i, size = INDEX_THRESHOLD * 2;
 
-  if(*p == '\0')
-    return(CONFIG_FALSE);
+  /* Keep the load factor at or below 1/2. */
+  while(size < (list->length * 2))
+    size <<= 1;
 
-  if(! isalpha((int)*p) && (*p != '*'))
-    return(CONFIG_FALSE);
+  __config_free(config, list->index);
+  list->index = (config_setting_t **)__config_alloc(
+    config, size * sizeof(config_setting_t *));
+  list->index_size = size;
 
-  for(++p; *p; ++p)
+  for(i = 0, s = list->elements; i < list->length; ++i, ++s)
   {
-    if(! (isalpha((int)*p) || isdigit((int)*p) || strchr("*_-", (int)*p)))
-      return(CONFIG_FALSE);
+    if((*s)->name)
+      __config_index_insert(list->index, size, *s);
   }
-
-  return(CONFIG_TRUE);
 }
 
 /* ------------------------------------------------------------------------- */
 
-static int __config_read(config_t *config, FILE *stream, const char *filename,
-                         const char *str)
+static void __config_list_add(config_t *config, config_list_t *list,
+                              config_setting_t *setting)
 {
-  yyscan_t scanner;
-  struct scan_context scan_ctx;
-  struct parse_context parse_ctx;
-  int r;
-
-  config_clear(config);
+  if(list->length == list->capacity)
+  {
+    /* Grow geometrically; arena-backed arrays cannot be resized in place, and
+     * the copies they leave behind must stay proportional to the list.
+     */
+    unsigned int capacity = list->capacity ? (list->capacity * 2) : CHUNK_SIZE;
 
-  libconfig_parsectx_init(&parse_ctx);
-  parse_ctx.config = config;
-  parse_ctx.parent = config->root;
-  parse_ctx.setting = config->root;
+    if(config->arena)
+    {
+      config_setting_t **elements = (config_setting_t **)__config_alloc(
+        config, capacity * sizeof(config_setting_t *));
 
-  __config_locale_override();
+      if(list->length)
+        memcpy(elements, list->elements,
+               list->length * sizeof(config_setting_t *));
 
-  libconfig_scanctx_init(&scan_ctx, filename);
-  config->root->file = libconfig_scanctx_current_filename(&scan_ctx);
-  scan_ctx.config = config;
-  libconfig_yylex_init_extra(&scan_ctx, &scanner);
+      list->elements = elements;
+    }
+    else
+    {
+      list->elements = (config_setting_t **)libconfig_realloc(
+        list->elements, capacity * sizeof(config_setting_t *));
+    }
 
-  if(stream)
-    libconfig_yyrestart(stream, scanner);
-  else /* read from string */
-    (void)libconfig_yy_scan_string(str, scanner);
+    list->capacity = capacity;
+  }
 
-  libconfig_yyset_lineno(1, scanner);
-  r = libconfig_yyparse(scanner, &parse_ctx, &scan_ctx);
+  setting->position = list->position_base + list->length;
+  list->elements[list->length] = setting;
+  list->length++;
 
-  if(r != 0)
+  if(list->index)
   {
-    YY_BUFFER_STATE buf;
-
-    config->error_file = libconfig_scanctx_current_filename(&scan_ctx);
-    config->error_type = CONFIG_ERR_PARSE;
-
-    /* Unwind the include stack, freeing the buffers and closing the files. */
-    while((buf = (YY_BUFFER_STATE)libconfig_scanctx_pop_include(&scan_ctx))
-          != NULL)
-      libconfig_yy_delete_buffer(buf, scanner);
+    if((list->length * 2) > list->index_size)
+      __config_list_reindex(config, list);
+    else if(setting->name)
+      __config_index_insert(list->index, list->index_size, setting);
   }
-
-  libconfig_yylex_destroy(scanner);
-  config->filenames = libconfig_scanctx_cleanup(&scan_ctx);
-  libconfig_parsectx_cleanup(&parse_ctx);
-
-  __config_locale_restore();
-
-  return(r == 0 ? CONFIG_TRUE : CONFIG_FALSE);
 }
 
 /* ------------------------------------------------------------------------- */
 
-int config_read(config_t *config, FILE *stream)
+/* A setting's index in its parent's list is its recorded position less the
+ * list's position base. Every change that moves elements renumbers them, or
+ * moves the base, so that the index is always exact; see
+ * __config_list_remove().
+ */
+static unsigned int __config_list_position(const config_list_t *list,
+                                           const config_setting_t *setting)
 {
-  return(__config_read(config, stream, NULL, NULL));
+  return(setting->position - list->position_base);
 }
 
 /* ------------------------------------------------------------------------- */
 
-int config_read_string(config_t *config, const char *str)
+static int __config_name_matches(const config_setting_t *setting,
+                                 const char *name, size_t namelen,
+                                 unsigned int hash, const char *interned)
 {
-  return(__config_read(config, NULL, NULL, str));
+  if(interned)
+    return(setting->name == interned);
+
+  return((setting->hash == hash) && setting->name
+         && !strncmp(name, setting->name, namelen)
+         && (setting->name[namelen] == '\0'));
 }
 
 /* ------------------------------------------------------------------------- */
 
-static void __config_write_setting(const config_t *config,
-                                   const config_setting_t *setting,
-                                   FILE *stream, int depth)
+/* Searches the children of the group for the name. The group's list is
+ * fetched through __config_setting_list(), so that a deferred body is parsed,
+ * or seen to have been parsed by another thread, before any of its names is
+ * read. This function takes the length of the name to be searched for, so
+ * that one component of a longer path can be passed in, and the hash of that
+ * name, so that compiled paths need not rehash it. Groups that have grown past
+ * INDEX_THRESHOLD members are searched through their hash index; smaller
+ * lists are scanned, comparing the precomputed name hashes first. If names
+ * are interned, a name that is not in the pool cannot be in the list, and
+ * one that is can be compared by address.
+ */
+static config_setting_t *__config_list_search_hashed(
+  const config_setting_t *group, const char *name, size_t namelen,
+  unsigned int hash, unsigned int *idx)
 {
-  char group_assign_char = config_get_option(
-    config, CONFIG_OPTION_COLON_ASSIGNMENT_FOR_GROUPS) ? ':' : '=';
+  const config_t *config = group->config;
+  const config_list_t *list;
+  config_setting_t **found = NULL;
+  const char *interned = NULL;
+  unsigned int i;
 
-  char nongroup_assign_char = config_get_option(
-    config, CONFIG_OPTION_COLON_ASSIGNMENT_FOR_NON_GROUPS) ? ':' : '=';
+  if(! name)
+    return(NULL);
 
-  if(setting->comment)
+  list = __config_setting_list(group);
+  if(! list)
+    return(NULL);
+
+  /* While bodies may still be parsed, and their names interned, on another
+   * thread, the pool cannot be searched without the lock; the names are then
+   * compared as they would be without it, until every body has been parsed.
+   */
+  if(config->strpool && ! libconfig_lazy_pending(config->lazy))
   {
-    if(depth > 1)
-      __config_indent(stream, depth, config->tab_width);
-    fprintf(stream, "// %s\n", setting->comment);
+    interned = libconfig_strpool_find(config->strpool, name, namelen, hash);
+    if(! interned)
+      return(NULL);
   }
 
-  if(depth > 1)
-    __config_indent(stream, depth, config->tab_width);
+  if(list->index)
+  {
+    unsigned int mask = list->index_size - 1;
+
+    for(i = hash & mask; list->index[i]; i = (i + 1) & mask)
+    {
+      if(__config_name_matches(list->index[i], name, namelen, hash,
+                               interned))
+      {
+        if(idx)
+          *idx = __config_list_position(list, list->index[i]);
 
+        return(list->index[i]);
+      }
+    }
 
-  if(setting->name)
-  {
-    fputs(setting->name, stream);
-    fprintf(stream, " %c ", ((setting->type == CONFIG_TYPE_GROUP)
-                             ? group_assign_char
-                             : nongroup_assign_char));
+    return(NULL);
   }
 
-  __config_write_value(config, &(setting->value), setting->type,
-                       config_setting_get_format(setting), depth, stream);
-
-  if(depth > 0)
+  for(i = 0, found = list->elements; i < list->length; i++, found++)
   {
-    if(config_get_option(config, CONFIG_OPTION_SEMICOLON_SEPARATORS))
-      fputc(';', stream);
+    if(__config_name_matches(*found, name, namelen, hash, interned))
+    {
+      if(idx)
+        *idx = i;
 
-    fputc('\n', stream);
+      return(*found);
+    }
   }
+
+  return(NULL);
 }
 
 /* ------------------------------------------------------------------------- */
 
-void config_write(const config_t *config, FILE *stream)
+static config_setting_t *__config_list_search(const config_setting_t *group,
+                                              const char *name,
+                                              size_t namelen,
+                                              unsigned int *idx)
 {
-  __config_locale_override();
-
-  __config_write_setting(config, config->root, stream, 0);
+  if(! name)
+    return(NULL);
 
-  __config_locale_restore();
+  return(__config_list_search_hashed(group, name, namelen,
+                                     libconfig_hash_string(name, namelen),
+                                     idx));
 }
 
 /* ------------------------------------------------------------------------- */
 
-int config_read_file(config_t *config, const char *filename)
+static config_setting_t *__config_list_remove(config_list_t *list, int idx)
 {
-  int ret, ok = 0;
-
-  FILE *stream = fopen(filename, "rt");
-  if(stream != NULL)
-  {
+  config_setting_t *removed = *(list->elements + idx);
+  int offset = (idx * sizeof(config_setting_t *));
+  int len = list->length - 1 - idx;
+  char *base = (char *)list->elements + offset;
+  unsigned int i;
+
+  memmove(base, base + sizeof(config_setting_t *),
+          len * sizeof(config_setting_t *));
+
+  list->length--;
+
+  /* The elements behind the removed one have moved up. Whichever side of it
+   * is shorter is renumbered: either those elements, or, after moving the
+   * base up by one, the elements in front of it. Removing from either end
+   * of a list thus stays cheap.
+   */
+  if((unsigned int)idx < (list->length - (unsigned int)idx))
+  {
+    ++(list->position_base);
+    for(i = 0; i < (unsigned int)idx; ++i)
+      ++(list->elements[i]->position);
+  }
+  else
+  {
+    for(i = (unsigned int)idx; i < list->length; ++i)
+      list->elements[i]->position = list->position_base + i;
+  }
+
+  if(list->index && removed->name)
+    __config_index_remove(list->index, list->index_size, removed);
+
+  /* possibly realloc smaller? */
+
+  return(removed);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Scalar arrays keep their values packed, in a vector of the element type,
+ * with a vector of element formats alongside only once some element has a
+ * format other than the default. Settings for the elements are made only
+ * when something asks for one; from then on the array works through them,
+ * like any other list, and its packed values are stale. Since that can
+ * happen while the array is being read, the element settings are made
+ * privately and published atomically, and the stale values are freed only
+ * when the array is next changed.
+ */
+
+static size_t __config_array_width(int type)
+{
+  switch(type)
+  {
+    case CONFIG_TYPE_INT:
+      return(sizeof(int));
+
+    case CONFIG_TYPE_INT64:
+      return(sizeof(long long));
+
+    case CONFIG_TYPE_FLOAT:
+      return(sizeof(double));
+
+    case CONFIG_TYPE_BOOL:
+      return(sizeof(unsigned char));
+
+    default:
+      return(sizeof(char *));
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static config_setting_t **__config_list_load_elements(
+  const config_list_t *list)
+{
+#if defined(_MSC_VER)
+  return((config_setting_t **)InterlockedCompareExchangePointer(
+           (PVOID *)&(list->elements), NULL, NULL));
+#elif defined(__GNUC__)
+  return(__atomic_load_n(&(list->elements), __ATOMIC_ACQUIRE));
+#else
+  return(list->elements);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __config_list_publish_elements(config_list_t *list,
+                                          config_setting_t **elements)
+{
+#if defined(_MSC_VER)
+  return(InterlockedCompareExchangePointer((PVOID *)&(list->elements),
+                                           elements, NULL) == NULL);
+#elif defined(__GNUC__)
+  config_setting_t **expected = NULL;
+
+  return(__atomic_compare_exchange_n(&(list->elements), &expected, elements,
+                                     0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+#else
+  list->elements = elements;
+  return(CONFIG_TRUE);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+static config_lazy_body_t *__config_list_load_lazy(const config_list_t *list)
+{
+#if defined(_MSC_VER)
+  return((config_lazy_body_t *)InterlockedCompareExchangePointer(
+           (PVOID *)&(list->lazy), NULL, NULL));
+#elif defined(__GNUC__)
+  return(__atomic_load_n(&(list->lazy), __ATOMIC_ACQUIRE));
+#else
+  return(list->lazy);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __config_list_publish_lazy(config_list_t *list)
+{
+#if defined(_MSC_VER)
+  (void)InterlockedExchangePointer((PVOID *)&(list->lazy), NULL);
+#elif defined(__GNUC__)
+  __atomic_store_n(&(list->lazy), NULL, __ATOMIC_RELEASE);
+#else
+  list->lazy = NULL;
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_setting_defer(config_setting_t *setting, const char *text,
+                             size_t length, int line, const char *file)
+{
+  config_t *config = setting->config;
+  config_lazy_body_t *body = (config_lazy_body_t *)__config_alloc(
+    config, sizeof(config_lazy_body_t));
+
+  body->list.lazy = body;
+  body->text = text;
+  body->length = length;
+  body->line = line;
+  body->file = file;
+
+  setting->value.list = &(body->list);
+  libconfig_lazy_add(config->lazy);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Parses the deferred body of the aggregate into its list. The first thread
+ * to get here parses it, into a setting of its own, under the lock; others
+ * wait for it. The list is filled in from that setting before it is published
+ * by clearing its "lazy" member, so that a thread that finds it clear can use
+ * the list without the lock. A syntax error in the body is recorded in the
+ * lazy state, under the lock, for config_lazy_error(); the error fields of
+ * the configuration are left alone, as other threads may be reading them.
+ * The settings that were read before the error are kept.
+ */
+static void __config_setting_load(const config_setting_t *setting)
+{
+  config_t *config = setting->config;
+  config_list_t *list = setting->value.list, *parsed;
+  config_lazy_body_t *body;
+  config_setting_t temp;
+  struct scan_context scan_ctx;
+  struct parse_context parse_ctx;
+  saved_locale_t saved_locale;
+  const char *error_text = NULL;
+  int error_line = 0;
+  unsigned int i;
+
+  libconfig_lazy_lock(config->lazy);
+
+  body = __config_list_load_lazy(list);
+  if(! body)
+  {
+    libconfig_lazy_unlock(config->lazy);
+    return;
+  }
+
+  __zero(&temp);
+  temp.type = setting->type;
+  temp.config = config;
+  temp.line = setting->line;
+  temp.file = setting->file;
+
+  libconfig_parsectx_init(&parse_ctx);
+  parse_ctx.config = config;
+  parse_ctx.parent = &temp;
+  parse_ctx.setting = &temp;
+
+  /* The file name belongs to the configuration already. */
+  libconfig_scanctx_init(&scan_ctx, NULL);
+  scan_ctx.config = config;
+  scan_ctx.top_filename = body->file;
+
+  saved_locale = __config_locale_override();
+
+  if((libconfig_parse_body(&parse_ctx, &scan_ctx, body->text, body->length,
+                           body->line, &error_text, &error_line) != 0)
+     && ! config->lazy->error_text)
+  {
+    config->lazy->error_text = error_text ? error_text : __syntax_error;
+    config->lazy->error_file = body->file;
+    config->lazy->error_line = error_line;
+  }
+
+  __config_locale_restore(saved_locale);
+
+  libconfig_strvec_delete(libconfig_scanctx_cleanup(&scan_ctx));
+  libconfig_parsectx_cleanup(&parse_ctx);
+
+  parsed = temp.value.list;
+  if(parsed)
+  {
+    list->length = parsed->length;
+    list->capacity = parsed->capacity;
+    list->elements = parsed->elements;
+    list->index_size = parsed->index_size;
+    list->index = parsed->index;
+    list->values = parsed->values;
+    list->formats = parsed->formats;
+    list->type = parsed->type;
+    list->position_base = parsed->position_base;
+
+    for(i = 0; list->elements && (i < list->length); ++i)
+      list->elements[i]->parent = (config_setting_t *)setting;
+
+    __config_free(config, parsed);
+  }
+
+  __config_list_publish_lazy(list);
+  libconfig_lazy_done(config->lazy);
+
+  libconfig_lazy_unlock(config->lazy);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the list of the aggregate, which may be NULL if it is empty,
+ * parsing its body first if that was deferred.
+ */
+static config_list_t *__config_setting_list(const config_setting_t *setting)
+{
+  config_list_t *list = setting->value.list;
+
+  if(list && __config_list_load_lazy(list))
+    __config_setting_load(setting);
+
+  return(list);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __config_array_read(const config_list_t *list, unsigned int idx,
+                                config_setting_t *element)
+{
+  element->type = list->type;
+  element->format = list->formats ? list->formats[idx]
+    : CONFIG_FORMAT_DEFAULT;
+
+  switch(list->type)
+  {
+    case CONFIG_TYPE_INT:
+      element->value.ival = ((const int *)list->values)[idx];
+      break;
+
+    case CONFIG_TYPE_INT64:
+      element->value.llval = ((const long long *)list->values)[idx];
+      break;
+
+    case CONFIG_TYPE_FLOAT:
+      element->value.fval = ((const double *)list->values)[idx];
+      break;
+
+    case CONFIG_TYPE_BOOL:
+      element->value.ival = ((const unsigned char *)list->values)[idx];
+      break;
+
+    default:
+      element->value.sval = ((char **)list->values)[idx];
+      break;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the element at the given index of the list, or NULL if there is
+ * none. An element of a packed array is read into the scratch setting,
+ * which is returned in its place.
+ */
+static const config_setting_t *__config_list_peek(const config_t *config,
+                                                  const config_list_t *list,
+                                                  unsigned int idx,
+                                                  config_setting_t *scratch)
+{
+  config_setting_t **elements;
+
+  if(! list || (idx >= list->length))
+    return(NULL);
+
+  elements = __config_list_load_elements(list);
+  if(elements)
+    return(elements[idx]);
+
+  __zero(scratch);
+  scratch->config = (config_t *)config;
+  __config_array_read(list, idx, scratch);
+
+  return(scratch);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the element settings of the array, making them if need be. In an
+ * arena, they are made in one detached block, which the arena adopts.
+ */
+static config_setting_t **__config_array_materialize(
+  const config_setting_t *array)
+{
+  config_t *config = array->config;
+  config_list_t *list = __config_setting_list(array);
+  config_setting_t **elements, *nodes = NULL;
+  unsigned int i;
+
+  elements = __config_list_load_elements(list);
+  if(elements)
+    return(elements);
+
+  if(config->arena)
+  {
+    nodes = (config_setting_t *)libconfig_arena_alloc_detached(
+      (list->length * sizeof(config_setting_t))
+      + (list->capacity * sizeof(config_setting_t *)));
+    elements = (config_setting_t **)(nodes + list->length);
+  }
+  else
+    elements = (config_setting_t **)libconfig_calloc(
+      list->capacity, sizeof(config_setting_t *));
+
+  for(i = 0; i < list->length; ++i)
+  {
+    config_setting_t *element = nodes ? (nodes + i)
+      : __new(config_setting_t);
+
+    element->parent = (config_setting_t *)array;
+    element->config = config;
+    element->line = array->line;
+    element->file = array->file;
+    element->position = list->position_base + i;
+    __config_array_read(list, i, element);
+    elements[i] = element;
+  }
+
+  if(__config_list_publish_elements(list, elements))
+  {
+    if(nodes)
+      libconfig_arena_adopt(config->arena, nodes);
+
+    return(elements);
+  }
+
+  /* Another thread got there first. */
+  if(nodes)
+    libconfig_arena_free_detached(nodes);
+  else
+  {
+    for(i = 0; i < list->length; ++i)
+      __delete(elements[i]);
+
+    __delete(elements);
+  }
+
+  return(__config_list_load_elements(list));
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Frees the packed values of the array. If the array has element settings,
+ * the strings among them belong to those.
+ */
+static void __config_array_free_values(config_t *config, config_list_t *list)
+{
+  unsigned int i;
+
+  if(! list->elements && (list->type == CONFIG_TYPE_STRING))
+  {
+    for(i = 0; i < list->length; ++i)
+      __config_string_free(config, ((char **)list->values)[i]);
+  }
+
+  __config_free(config, list->values);
+  __config_free(config, list->formats);
+  list->values = NULL;
+  list->formats = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Readies an array to be changed through element settings. */
+static void __config_array_unpack(config_setting_t *array)
+{
+  config_list_t *list = __config_setting_list(array);
+
+  if(! list || ! list->values)
+    return;
+
+  __config_array_materialize(array);
+  __config_array_free_values(array->config, list);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __config_array_grow(config_t *config, config_list_t *list,
+                                unsigned int capacity)
+{
+  size_t width = __config_array_width(list->type);
+
+  if(config->arena)
+  {
+    void *values = __config_alloc(config, capacity * width);
+
+    if(list->length)
+      memcpy(values, list->values, list->length * width);
+
+    list->values = values;
+
+    if(list->formats)
+    {
+      unsigned char *formats = (unsigned char *)__config_alloc(config,
+                                                               capacity);
+
+      memcpy(formats, list->formats, list->length);
+      list->formats = formats;
+    }
+  }
+  else
+  {
+    list->values = libconfig_realloc(list->values, capacity * width);
+
+    if(list->formats)
+    {
+      list->formats = (unsigned char *)libconfig_realloc(list->formats,
+                                                         capacity);
+      memset(list->formats + list->capacity, 0, capacity - list->capacity);
+    }
+  }
+
+  list->capacity = capacity;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Appends a value to an array that has no element settings, taking over a
+ * string value. The type must have been checked.
+ */
+static void __config_array_append(config_setting_t *array, int type,
+                                  const config_value_t *value,
+                                  unsigned short format)
+{
+  config_t *config = array->config;
+  config_list_t *list = __config_setting_list(array);
+
+  if(! list)
+    list = array->value.list = (config_list_t *)__config_alloc(
+      config, sizeof(config_list_t));
+
+  if((list->length == 0) && (list->type != type))
+  {
+    /* What is left of the values of another type is of no use. */
+    __config_array_free_values(config, list);
+    list->capacity = 0;
+    list->type = (unsigned short)type;
+  }
+
+  if(list->length == list->capacity)
+    __config_array_grow(config, list,
+                        list->capacity ? (list->capacity * 2) : CHUNK_SIZE);
+
+  switch(type)
+  {
+    case CONFIG_TYPE_INT:
+      ((int *)list->values)[list->length] = value->ival;
+      break;
+
+    case CONFIG_TYPE_INT64:
+      ((long long *)list->values)[list->length] = value->llval;
+      break;
+
+    case CONFIG_TYPE_FLOAT:
+      ((double *)list->values)[list->length] = value->fval;
+      break;
+
+    case CONFIG_TYPE_BOOL:
+      ((unsigned char *)list->values)[list->length] =
+        (unsigned char)(value->ival != 0);
+      break;
+
+    default:
+      ((char **)list->values)[list->length] = value->sval;
+      break;
+  }
+
+  if(format != CONFIG_FORMAT_DEFAULT)
+  {
+    if(! list->formats)
+      list->formats = (unsigned char *)__config_alloc(config,
+                                                      list->capacity);
+
+    list->formats[list->length] = (unsigned char)format;
+  }
+  else if(list->formats)
+    list->formats[list->length] = CONFIG_FORMAT_DEFAULT;
+
+  list->length++;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Removes a value from an array that has no element settings. */
+static void __config_array_remove(config_t *config, config_list_t *list,
+                                  unsigned int idx)
+{
+  size_t width = __config_array_width(list->type);
+  char *base = (char *)list->values + (idx * width);
+  unsigned int len = list->length - 1 - idx;
+
+  if(list->type == CONFIG_TYPE_STRING)
+    __config_string_free(config, ((char **)list->values)[idx]);
+
+  memmove(base, base + width, len * width);
+
+  if(list->formats)
+    memmove(list->formats + idx, list->formats + idx + 1, len);
+
+  list->length--;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Empties an array, so that it is packed again. */
+static void __config_array_clear(config_setting_t *array)
+{
+  config_t *config = array->config;
+  config_list_t *list = __config_setting_list(array);
+  unsigned int i;
+
+  if(! list)
+    return;
+
+  if(list->values)
+    __config_array_free_values(config, list);
+
+  if(list->elements)
+  {
+    for(i = 0; i < list->length; ++i)
+      __config_setting_destroy(list->elements[i]);
+
+    __config_free(config, list->elements);
+    list->elements = NULL;
+  }
+
+  list->length = 0;
+  list->capacity = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Appends a vector of values to an array. The type must have been checked;
+ * booleans come as ints.
+ */
+static void __config_array_append_values(config_setting_t *array, int type,
+                                         const void *values,
+                                         unsigned int count)
+{
+  config_t *config = array->config;
+  config_list_t *list = __config_setting_list(array);
+  size_t width = __config_array_width(type);
+  unsigned int i, capacity;
+
+  if(count == 0)
+    return;
+
+  if(list && list->elements)
+  {
+    /* The array works through its element settings by now. */
+    for(i = 0; i < count; ++i)
+    {
+      config_setting_t *element = config_setting_create(array, NULL, type,
+                                                        NULL);
+
+      if(type == CONFIG_TYPE_BOOL)
+        element->value.ival = (((const int *)values)[i] != 0);
+      else
+        memcpy(&(element->value), (const char *)values + (i * width),
+               width);
+    }
+
+    return;
+  }
+
+  if(! list)
+    list = array->value.list = (config_list_t *)__config_alloc(
+      config, sizeof(config_list_t));
+
+  if((list->length == 0) && (list->type != type))
+  {
+    __config_array_free_values(config, list);
+    list->capacity = 0;
+    list->type = (unsigned short)type;
+  }
+
+  if((list->length + count) > list->capacity)
+  {
+    capacity = list->capacity ? (list->capacity * 2) : CHUNK_SIZE;
+    if(capacity < (list->length + count))
+      capacity = list->length + count;
+
+    __config_array_grow(config, list, capacity);
+  }
+
+  if(type == CONFIG_TYPE_BOOL)
+  {
+    unsigned char *p = (unsigned char *)list->values + list->length;
+
+    for(i = 0; i < count; ++i)
+      p[i] = (unsigned char)(((const int *)values)[i] != 0);
+  }
+  else
+    memcpy((char *)list->values + (list->length * width), values,
+           count * width);
+
+  if(list->formats)
+    memset(list->formats + list->length, CONFIG_FORMAT_DEFAULT, count);
+
+  list->length += count;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Appends the setting to the parent's list, creating the list if need be. */
+static void __config_setting_attach(config_setting_t *parent,
+                                    config_setting_t *setting)
+{
+  config_list_t *list;
+
+  if(parent->type == CONFIG_TYPE_ARRAY)
+    __config_array_unpack(parent);
+
+  list = __config_setting_list(parent);
+
+  if(! list)
+    list = parent->value.list = (config_list_t *)__config_alloc(
+      parent->config, sizeof(config_list_t));
+
+  __config_list_add(parent->config, list, setting);
+
+  /* Wide groups get a hash index over their member names. */
+  if((parent->type == CONFIG_TYPE_GROUP) && ! list->index
+     && (list->length >= INDEX_THRESHOLD))
+    __config_list_reindex(parent->config, list);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the file name that a copy of the setting should carry: the one at
+ * the same index in the "to" vector as the original's is in the "from"
+ * vector, if they are given; otherwise the original's own, as long as the
+ * copy is in the same configuration, which owns the name.
+ */
+static const char *__config_clone_file(const config_t *config,
+                                       const config_setting_t *src,
+                                       const char * const *from,
+                                       const char * const *to)
+{
+  unsigned int i;
+
+  if(! from)
+    return((src->config == config) ? src->file : NULL);
+
+  for(i = 0; from[i]; ++i)
+  {
+    if(from[i] == src->file)
+      return(to[i]);
+  }
+
+  return(NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Makes a deep copy of the setting under the given name, with the given
+ * parent, but does not add it to the parent. Each list is allocated at its
+ * exact final length and filled in directly; the original tree is known to
+ * be well formed, so nothing in it is validated or looked up again, and the
+ * name hashes are carried over rather than recomputed. Hooks are not
+ * copied.
+ */
+static config_setting_t *__config_setting_clone(config_setting_t *parent,
+                                                const config_setting_t *src,
+                                                const char *name,
+                                                unsigned int hash,
+                                                const char * const *from,
+                                                const char * const *to)
+{
+  config_t *config = parent->config;
+  config_setting_t *copy;
+
+  copy = (config_setting_t *)__config_alloc(config, sizeof(config_setting_t));
+  copy->hash = hash;
+  copy->name = __config_name_dup(config, name, hash);
+  copy->type = src->type;
+  copy->format = src->format;
+  copy->parent = parent;
+  copy->config = config;
+  copy->hook = NULL;
+  copy->line = src->line;
+  copy->file = __config_clone_file(config, src, from, to);
+  copy->comment = __config_strdup(config, src->comment);
+
+  if(src->type == CONFIG_TYPE_STRING)
+    copy->value.sval = __config_string_dup(config, src->value.sval);
+
+  else if(config_setting_is_aggregate(src))
+  {
+    const config_list_t *list = __config_setting_list(src);
+    config_setting_t * const *elements;
+
+    if(list && list->length)
+    {
+      config_list_t *clist;
+      const config_setting_t *child;
+      unsigned int i;
+
+      clist = (config_list_t *)__config_alloc(config, sizeof(config_list_t));
+      clist->capacity = list->length;
+      elements = __config_list_load_elements(list);
+
+      if(! elements)
+      {
+        /* Packed values are copied as they are, but for the strings. */
+        size_t width = __config_array_width(list->type);
+
+        clist->type = list->type;
+        clist->values = __config_alloc(config, list->length * width);
+        memcpy(clist->values, list->values, list->length * width);
+
+        if(list->type == CONFIG_TYPE_STRING)
+        {
+          for(i = 0; i < list->length; ++i)
+            ((char **)clist->values)[i] = __config_string_dup(
+              config, ((char **)list->values)[i]);
+        }
+
+        if(list->formats)
+        {
+          clist->formats = (unsigned char *)__config_alloc(config,
+                                                           list->length);
+          memcpy(clist->formats, list->formats, list->length);
+        }
+      }
+      else
+      {
+        clist->elements = (config_setting_t **)__config_alloc(
+          config, list->length * sizeof(config_setting_t *));
+
+        for(i = 0; i < list->length; ++i)
+        {
+          child = elements[i];
+          clist->elements[i] = __config_setting_clone(copy, child,
+                                                      child->name,
+                                                      child->hash, from, to);
+          clist->elements[i]->position = clist->position_base + i;
+        }
+      }
+
+      clist->length = list->length;
+      copy->value.list = clist;
+
+      if((src->type == CONFIG_TYPE_GROUP)
+         && (clist->length >= INDEX_THRESHOLD))
+        __config_list_reindex(config, clist);
+    }
+  }
+  else
+    copy->value = src->value;
+
+  return(copy);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __config_setting_destroy(config_setting_t *setting)
+{
+  if(setting)
+  {
+    config_t *config = setting->config;
+
+    /* An arena-backed subtree only needs to be visited to run the hook
+     * destructor, or to count off the deferred bodies in it; its memory goes
+     * away with the arena.
+     */
+    if(config->arena && ! config->destructor
+       && ! libconfig_lazy_pending(config->lazy))
+      return;
+
+    if(setting->name && ! config->strpool)
+      __config_free(config, setting->name);
+
+    if(setting->type == CONFIG_TYPE_STRING)
+      __config_string_free(config, setting->value.sval);
+
+    else if(config_setting_is_aggregate(setting))
+    {
+      if(setting->value.list)
+        __config_list_destroy(config, setting->value.list);
+    }
+
+    if(setting->hook && config->destructor)
+      config->destructor(setting->hook);
+
+    __config_free(config, setting->comment);
+    __config_free(config, setting);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __config_list_destroy(config_t *config, config_list_t *list)
+{
+  config_setting_t **p;
+  unsigned int i;
+
+  if(! list)
+    return;
+
+  /* A body that was never parsed no longer needs to be. */
+  if(list->lazy)
+    libconfig_lazy_done(config->lazy);
+
+  if(list->values)
+    __config_array_free_values(config, list);
+
+  if(list->elements)
+  {
+    for(p = list->elements, i = 0; i < list->length; p++, i++)
+      __config_setting_destroy(*p);
+
+    __config_free(config, list->elements);
+  }
+
+  __config_free(config, list->index);
+  __config_free(config, list);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __config_list_checktype(const config_setting_t *setting, int type)
+{
+  const config_list_t *list = __config_setting_list(setting);
+  config_setting_t scratch;
+
+  /* if the array is empty, then it has no type yet */
+
+  if(! list)
+    return(CONFIG_TRUE);
+
+  if(list->length == 0)
+    return(CONFIG_TRUE);
+
+  /* if it's a list, any type is allowed */
+
+  if(setting->type == CONFIG_TYPE_LIST)
+    return(CONFIG_TRUE);
+
+  /* otherwise the first element added determines the type of the array */
+
+  return((__config_list_peek(setting->config, list, 0,
+                             &scratch)->type == type)
+         ? CONFIG_TRUE : CONFIG_FALSE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __config_type_is_scalar(int type)
+{
+  return((type >= CONFIG_TYPE_INT) && (type <= CONFIG_TYPE_BOOL));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __config_validate_name(const char *name)
+{
+  const char *p = name;
+
+  if(*p == '\0')
+    return(CONFIG_FALSE);
+
+  if(! isalpha((int)*p) && (*p != '*'))
+    return(CONFIG_FALSE);
+
+  for(++p; *p; ++p)
+  {
+    if(! (isalpha((int)*p) || isdigit((int)*p) || strchr("*_-", (int)*p)))
+      return(CONFIG_FALSE);
+  }
+
+  return(CONFIG_TRUE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static struct include_cache_entry *__config_include_cache_find(
+  config_t *config, const char *path);
+
+/* ------------------------------------------------------------------------- */
+
+struct prefetch_scan
+{
+  config_t *config;
+  struct include_prefetch *prefetch;
+};
+
+/* Resolves an @include directive found in the top-level file, and adds the
+ * files that it names to the ones to parse ahead.
+ */
+static void __config_prefetch_directive(const char *path, void *context)
+{
+  struct prefetch_scan *scan = (struct prefetch_scan *)context;
+  config_t *config = scan->config;
+  const char *error = NULL;
+  const char **files, **f;
+
+  if(! config->include_fn)
+    return;
+
+  files = config->include_fn(config, config->include_dir, path, &error);
+
+  for(f = files; ! error && f && *f; ++f)
+  {
+    /* Fragments that are current in the include cache are grafted from
+     * there.
+     */
+    if(config->include_cache && __config_include_cache_find(config, *f))
+      continue;
+
+    if(! scan->prefetch)
+      scan->prefetch = libconfig_prefetch_create(config);
+
+    libconfig_prefetch_add(scan->prefetch, *f);
+  }
+
+  libconfig_strvec_delete(files);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Starts parsing the files named by the @include directives of the text
+ * ahead, on worker threads. Returns NULL if there are none.
+ */
+static struct include_prefetch *__config_prefetch_start(config_t *config,
+                                                        const char *text,
+                                                        size_t length)
+{
+  struct prefetch_scan scan;
+
+  scan.config = config;
+  scan.prefetch = NULL;
+
+  libconfig_parse_includes(text, length, __config_prefetch_directive, &scan);
+
+  if(scan.prefetch)
+    libconfig_prefetch_start(scan.prefetch);
+
+  return(scan.prefetch);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reads the configuration from the stream, the NUL-terminated string, or the
+ * buffer, whose size includes two trailing NUL bytes. The input is read from
+ * the stream if one is given, or else scanned in place from the buffer if one
+ * is given, or else copied from the string. An included file that is read on
+ * its own is read at its include depth, and how it ended is stored at *end.
+ */
+static int __config_read(config_t *config, FILE *stream, const char *filename,
+                         const char *str, char *buffer, size_t size,
+                         int depth, int *end)
+{
+  yyscan_t scanner;
+  struct scan_context scan_ctx;
+  struct parse_context parse_ctx;
+  saved_locale_t saved_locale;
+  mapfile_t map;
+  const char *text = NULL;
+  size_t length = 0;
+  int direct, lazy, r;
+
+  config_clear(config);
+
+  /* Deferred bodies are parsed by the direct parser, and only those of a
+   * top-level file point into text that is kept.
+   */
+  lazy = (depth == 0) && config_get_option(config, CONFIG_OPTION_LAZY_LOAD);
+  direct = lazy || config_get_option(config, CONFIG_OPTION_DIRECT_PARSER);
+
+  /* The parsers keep the first error they find, so that of an earlier read
+   * must not linger.
+   */
+  config->error_text = NULL;
+  config->error_file = NULL;
+  config->error_line = 0;
+  config->error_type = CONFIG_ERR_NONE;
+
+  libconfig_parsectx_init(&parse_ctx);
+  parse_ctx.config = config;
+  parse_ctx.parent = config->root;
+  parse_ctx.setting = config->root;
+
+  saved_locale = __config_locale_override();
+
+  libconfig_scanctx_init(&scan_ctx, filename);
+  config->root->file = libconfig_scanctx_current_filename(&scan_ctx);
+  scan_ctx.config = config;
+  scan_ctx.include_parent = config->root;
+  scan_ctx.depth = depth;
+
+  /* The direct parser reads its whole input from memory. */
+  __zero(&map);
+  if(stream && direct)
+  {
+    libconfig_mapfile_read_stream(&map, stream);
+    text = map.data;
+    length = map.length;
+  }
+  else if(buffer)
+  {
+    text = buffer;
+    length = size - 2;
+  }
+  else if(str)
+  {
+    text = str;
+    length = strlen(str);
+  }
+
+  /* The text that deferred bodies point into must outlive the caller's. */
+  if(lazy)
+  {
+    if(text && (text != map.data))
+    {
+      map.data = (char *)libconfig_malloc(length + 2);
+      memcpy(map.data, text, length);
+      map.data[length] = map.data[length + 1] = '\0';
+      map.length = length;
+      text = map.data;
+    }
+
+    config->lazy = libconfig_lazy_create(&map);
+  }
+
+  /* The included files are parsed ahead only for a top-level file whose
+   * directives can be found before it is parsed.
+   */
+  if(text && (depth == 0)
+     && config_get_option(config, CONFIG_OPTION_PARALLEL_INCLUDES))
+    scan_ctx.prefetch = __config_prefetch_start(config, text, length);
+
+  if(direct)
+  {
+    /* The include stack is left to libconfig_scanctx_cleanup() to close. */
+    r = libconfig_parse(&parse_ctx, &scan_ctx, text, length);
+
+    if(r != 0)
+    {
+      config->error_file = libconfig_scanctx_current_filename(&scan_ctx);
+      config->error_type = CONFIG_ERR_PARSE;
+    }
+  }
+  else
+  {
+    libconfig_yylex_init_extra(&scan_ctx, &scanner);
+
+    if(stream)
+      libconfig_yyrestart(stream, scanner);
+    else if(buffer)
+      (void)libconfig_yy_scan_buffer(buffer, size, scanner);
+    else /* read from string */
+      (void)libconfig_yy_scan_string(str, scanner);
+
+    libconfig_yyset_lineno(1, scanner);
+    r = libconfig_yyparse(scanner, &parse_ctx, &scan_ctx);
+
+    if(r != 0)
+    {
+      YY_BUFFER_STATE buf;
+
+      config->error_file = libconfig_scanctx_current_filename(&scan_ctx);
+      config->error_type = CONFIG_ERR_PARSE;
+
+      /* Leave a buffer that was scanned in place as the caller passed it. */
+      if(buffer)
+        libconfig_yy_restore_buffer(scanner);
+
+      /* Unwind the include stack, freeing the buffers and closing the
+       * files.
+       */
+      while((buf = (YY_BUFFER_STATE)libconfig_scanctx_pop_include(&scan_ctx))
+            != NULL)
+        libconfig_yy_delete_buffer(buf, scanner);
+    }
+
+    libconfig_yylex_destroy(scanner);
+  }
+
+  if(end)
+    *end = scan_ctx.end;
+
+  if(scan_ctx.prefetch)
+    libconfig_prefetch_destroy(scan_ctx.prefetch);
+
+  libconfig_mapfile_close(&map);
+
+  /* The text need not be kept if nothing was deferred. */
+  if(config->lazy && ! libconfig_lazy_pending(config->lazy))
+  {
+    libconfig_lazy_destroy(config->lazy);
+    config->lazy = NULL;
+  }
+
+  config->filenames = libconfig_scanctx_cleanup(&scan_ctx);
+  libconfig_parsectx_cleanup(&parse_ctx);
+
+  __config_locale_restore(saved_locale);
+
+  return(r == 0 ? CONFIG_TRUE : CONFIG_FALSE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_read(config_t *config, FILE *stream)
+{
+  return(__config_read(config, stream, NULL, NULL, NULL, 0, 0, NULL));
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_read_string(config_t *config, const char *str)
+{
+  return(__config_read(config, NULL, NULL, str, NULL, 0, 0, NULL));
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_read_buffer(config_t *config, char *buffer, size_t length)
+{
+  char *copy;
+  int ret;
+
+  /* A buffer that ends in two NUL bytes can be scanned in place. */
+  if((length >= 2) && (buffer[length - 1] == '\0')
+     && (buffer[length - 2] == '\0'))
+    return(__config_read(config, NULL, NULL, NULL, buffer, length, 0,
+                         NULL));
+
+  copy = (char *)libconfig_malloc(length + 2);
+  if(length > 0)
+    memcpy(copy, buffer, length);
+  copy[length] = copy[length + 1] = '\0';
+
+  ret = __config_read(config, NULL, NULL, NULL, copy, length + 2, 0, NULL);
+  __delete(copy);
+
+  return(ret);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __config_write_setting(const config_t *config,
+                                   const config_setting_t *setting,
+                                   strbuf_t *buf, int depth)
+{
+  char group_assign_char = config_get_option(
+    config, CONFIG_OPTION_COLON_ASSIGNMENT_FOR_GROUPS) ? ':' : '=';
+
+  char nongroup_assign_char = config_get_option(
+    config, CONFIG_OPTION_COLON_ASSIGNMENT_FOR_NON_GROUPS) ? ':' : '=';
+
+  if(setting->comment)
+  {
+    if(depth > 1)
+      __config_indent(buf, depth, config->tab_width);
+    libconfig_strbuf_append(buf, "// ", 3);
+    libconfig_strbuf_append_string(buf, setting->comment);
+    libconfig_strbuf_append_char(buf, '\n');
+  }
+
+  if(depth > 1)
+    __config_indent(buf, depth, config->tab_width);
+
+
+  if(setting->name)
+  {
+    char assign[3];
+
+    assign[0] = ' ';
+    assign[1] = ((setting->type == CONFIG_TYPE_GROUP)
+                 ? group_assign_char
+                 : nongroup_assign_char);
+    assign[2] = ' ';
+
+    libconfig_strbuf_append_string(buf, setting->name);
+    libconfig_strbuf_append(buf, assign, 3);
+  }
+
+  /* A deferred body is parsed before it is written. */
+  if(config_setting_is_aggregate(setting))
+    (void)__config_setting_list(setting);
+
+  __config_write_value(config, &(setting->value), setting->type,
+                       config_setting_get_format(setting), depth, buf);
+
+  if(depth > 0)
+  {
+    if(config_get_option(config, CONFIG_OPTION_SEMICOLON_SEPARATORS))
+      libconfig_strbuf_append_char(buf, ';');
+
+    libconfig_strbuf_append_char(buf, '\n');
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __config_write(const config_t *config, strbuf_t *buf)
+{
+  saved_locale_t saved_locale = __config_locale_override();
+
+  __config_write_setting(config, config->root, buf, 0);
+
+  __config_locale_restore(saved_locale);
+
+  /* An empty configuration still yields an (empty) string. */
+  if(! buf->string)
+    libconfig_strbuf_append(buf, "", 0);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void config_write(const config_t *config, FILE *stream)
+{
+  strbuf_t buf = { NULL, 0, 0 };
+
+  __config_write(config, &buf);
+  fwrite(buf.string, 1, buf.length, stream);
+  __delete(buf.string);
+}
+
+/* ------------------------------------------------------------------------- */
+
+char *config_write_string(const config_t *config, size_t *length)
+{
+  strbuf_t buf = { NULL, 0, 0 };
+
+  __config_write(config, &buf);
+
+  if(length)
+    *length = buf.length;
+
+  return(libconfig_strbuf_release_trimmed(&buf));
+}
+
+/* ------------------------------------------------------------------------- */
+
+size_t config_write_buffer(const config_t *config, char *buffer, size_t size)
+{
+  strbuf_t buf = { NULL, 0, 0 };
+  size_t length;
+
+  __config_write(config, &buf);
+  length = buf.length;
+
+  if(buffer && (size > 0))
+  {
+    size_t n = (length < size) ? length : (size - 1);
+    memcpy(buffer, buf.string, n);
+    buffer[n] = '\0';
+  }
+
+  __delete(buf.string);
+  return(length);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __config_read_file(config_t *config, const char *filename,
+                              int depth, int *end)
+{
+  int ret, ok = 0;
+  mapfile_t map;
+
+  FILE *stream = fopen(filename, "rt");
+  if(stream != NULL)
+  {
     // On some operating systems, fopen() succeeds on a directory.
     int fd = posix_fileno(stream);
-    struct stat statbuf;
+    struct stat statbuf;
+
+    if(fstat(fd, &statbuf) == 0)
+    {
+      // Only proceed if this is not a directory.
+      if(!S_ISDIR(statbuf.st_mode))
+        ok = 1;
+    }
+  }
+
+  if(!ok)
+  {
+    if(stream != NULL)
+      fclose(stream);
+
+    config->error_text = __io_error;
+    config->error_type = CONFIG_ERR_FILE_IO;
+    return(CONFIG_FALSE);
+  }
+
+  /* Regular files are read into memory in one piece and scanned in place;
+   * anything else, such as a pipe, is read through the stream. A file that is
+   * read lazily is read through the stream too, into memory that is kept with
+   * the configuration.
+   */
+  if(! ((depth == 0) && config_get_option(config, CONFIG_OPTION_LAZY_LOAD))
+     && libconfig_mapfile_open(&map, posix_fileno(stream)))
+  {
+    ret = __config_read(config, NULL, filename, NULL, map.data,
+                        map.length + 2, depth, end);
+    libconfig_mapfile_close(&map);
+  }
+  else
+    ret = __config_read(config, stream, filename, NULL, NULL, 0, depth, end);
+
+  fclose(stream);
+
+  return(ret);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_read_file(config_t *config, const char *filename)
+{
+  return(__config_read_file(config, filename, 0, NULL));
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns CONFIG_TRUE if the setting is the given ancestor or lies below
+ * it.
+ */
+static int __config_setting_within(const config_setting_t *setting,
+                                   const config_setting_t *ancestor)
+{
+  for(; setting; setting = setting->parent)
+  {
+    if(setting == ancestor)
+      return(CONFIG_TRUE);
+  }
+
+  return(CONFIG_FALSE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Copies the setting and its children into the parent, under the given name
+ * or, if that is NULL, under the original's. If the "from" and "to" vectors
+ * are given, each copy takes its file name from "to" at the index that the
+ * original's has in "from". Only the copy's own name and place are checked;
+ * returns NULL if they are not valid. The copy is complete before it is
+ * added, so a setting may be copied into itself or any of its children.
+ */
+static config_setting_t *__config_setting_copy(config_setting_t *parent,
+                                               const config_setting_t *src,
+                                               const char *name,
+                                               const char * const *from,
+                                               const char * const *to)
+{
+  config_setting_t *copy, *existing = NULL;
+  config_list_t *list;
+  unsigned int hash = 0, idx = 0;
+
+  if(! parent || ! src || ! config_setting_is_aggregate(parent))
+    return(NULL);
+
+  list = __config_setting_list(parent);
+
+  if(parent->type == CONFIG_TYPE_GROUP)
+  {
+    if(! name)
+    {
+      name = src->name;
+      hash = src->hash;
+    }
+    else
+      hash = libconfig_hash_string(name, strlen(name));
+
+    if(! name || ! __config_validate_name(name))
+      return(NULL);
+
+    existing = __config_list_search_hashed(parent, name, strlen(name), hash,
+                                           &idx);
+    if(existing
+       && ! config_get_option(parent->config, CONFIG_OPTION_ALLOW_OVERRIDES))
+      return(NULL); /* already exists */
+  }
+  else
+  {
+    name = NULL;
+
+    if(parent->type == CONFIG_TYPE_ARRAY)
+    {
+      /* only scalars of one type can be added to arrays */
+      if(! __config_type_is_scalar(src->type))
+        return(NULL);
+
+      if(! __config_list_checktype(parent, src->type))
+        return(NULL);
+    }
+  }
+
+  copy = __config_setting_clone(parent, src, name, hash, from, to);
+
+  /* The setting being overridden may hold the original, so it is removed
+   * only once the copy has been made.
+   */
+  if(existing)
+  {
+    __config_list_remove(list, idx);
+    __config_setting_destroy(existing);
+  }
+
+  __config_setting_attach(parent, copy);
+
+  return(copy);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns a new configuration for parsing an included file on its own, with
+ * the settings of the configuration that includes it. The direct parser
+ * reports how the file ended, which decides whether it may be grafted.
+ */
+static config_t *__config_include_tree(const config_t *config)
+{
+  config_t *tree = __new(config_t);
+
+  config_init(tree);
+  tree->options = (config->options | CONFIG_OPTION_ARENA
+                   | CONFIG_OPTION_DIRECT_PARSER)
+    & ~(CONFIG_OPTION_PARALLEL_INCLUDES | CONFIG_OPTION_LAZY_LOAD);
+  if(config->include_dir)
+    config_set_include_dir(tree, config->include_dir);
+  tree->include_fn = config->include_fn;
+  tree->hook = config->hook;
+
+  return(tree);
+}
+
+/* ------------------------------------------------------------------------- */
+
+config_t *libconfig_read_include(const config_t *config, const char *path,
+                                 int depth, int *end)
+{
+  config_t *tree = __config_include_tree(config);
+
+  if(__config_read_file(tree, path, depth, end))
+    return(tree);
+
+  config_destroy(tree);
+  __delete(tree);
+
+  return(NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the include cache entry for an included file if it is current: the
+ * file and everything it depends on are unchanged, and it was parsed with the
+ * same settings. Returns NULL otherwise.
+ */
+static struct include_cache_entry *__config_include_cache_find(
+  config_t *config, const char *path)
+{
+  struct include_cache_entry *entry = libconfig_inccache_find(
+    config->include_cache, path);
+
+  if(entry && ! entry->building
+     && (((entry->options ^ config->options)
+          & CONFIG_OPTION_ALLOW_OVERRIDES) == 0)
+     && (entry->include_fn == config->include_fn)
+     && ((entry->include_dir && config->include_dir)
+         ? ! strcmp(entry->include_dir, config->include_dir)
+         : (entry->include_dir == config->include_dir))
+     && libconfig_inccache_stamps_fresh(entry->stamps, entry->stamp_count))
+    return(entry);
+
+  return(NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the include cache entry for an included file, parsing the file on
+ * its own if it is not cached or has changed since; or NULL if the file must
+ * be scanned as part of the including file.
+ */
+static struct include_cache_entry *__config_include_cache_get(
+  config_t *config, const char *path)
+{
+  config_include_cache_t *cache = config->include_cache;
+  struct include_cache_entry *entry = libconfig_inccache_find(cache, path);
+  config_t *tree;
+  unsigned int count;
+  int ok, listed, end = SCANCTX_END_UNKNOWN;
+
+  if(entry)
+  {
+    /* A file that includes itself is left to the scanner to reject. */
+    if(entry->building)
+      return(NULL);
+
+    if(__config_include_cache_find(config, path))
+    {
+      if(! entry->tree)
+      {
+        ++cache->misses;
+        return(NULL);
+      }
+
+      ++cache->hits;
+      return(entry);
+    }
+
+    libconfig_inccache_reset(entry);
+  }
+
+  if(cache->depth >= MAX_INCLUDE_DEPTH)
+    return(NULL);
+
+  if(! entry)
+    entry = libconfig_inccache_add(cache, path);
+
+  ++cache->misses;
+
+  tree = __config_include_tree(config);
+  tree->include_cache = cache;
+
+  listed = cache->listed;
+  cache->listed = 0;
+
+  entry->building = 1;
+  ++cache->depth;
+  ok = __config_read_file(tree, path, 0, &end);
+  --cache->depth;
+  entry->building = 0;
+
+  entry->options = config->options;
+  entry->include_fn = config->include_fn;
+  entry->include_dir = config->include_dir ? strdup(config->include_dir)
+    : NULL;
+  entry->end = end;
+
+  /* The fragment depends on every file that went into it. */
+  for(count = 0; tree->filenames && tree->filenames[count]; ++count);
+
+  if(count > 0)
+    entry->stamps = libconfig_inccache_stamp_files(tree->filenames, count);
+  else
+    entry->stamps = libconfig_inccache_stamp_files(&path, 1);
+  entry->stamp_count = count ? count : 1;
+
+  /* Stamps do not cover the directories listed for wildcard and directory
+   * includes, so a fragment that has such includes is never current.
+   */
+  if(cache->listed)
+  {
+    libconfig_inccache_free_stamps(entry->stamps, entry->stamp_count);
+    entry->stamps = NULL;
+    entry->stamp_count = 0;
+  }
+
+  cache->listed |= listed;
+
+  if(! ok)
+  {
+    config_destroy(tree);
+    __delete(tree);
+    return(NULL);
+  }
+
+  tree->include_cache = NULL;
+  entry->tree = tree;
+
+  return(entry);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns CONFIG_TRUE if a top-level setting of one of the fragments has the
+ * same name as a setting of the group, or of an earlier fragment.
+ */
+static int __config_include_conflicts(const config_setting_t *group,
+                                      config_t * const *trees,
+                                      unsigned int count)
+{
+  unsigned int i, j, k;
+
+  for(i = 0; i < count; ++i)
+  {
+    const config_list_t *list = trees[i]->root->value.list;
+
+    for(j = 0; list && (j < list->length); ++j)
+    {
+      const char *name = list->elements[j]->name;
+
+      if(config_setting_get_member(group, name))
+        return(CONFIG_TRUE);
+
+      for(k = 0; k < i; ++k)
+      {
+        if(config_setting_get_member(trees[k]->root, name))
+          return(CONFIG_TRUE);
+      }
+    }
+  }
+
+  return(CONFIG_FALSE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int libconfig_scanctx_graft_include(struct scan_context *ctx,
+                                    const char * const *files,
+                                    const char *follow,
+                                    const char **error)
+{
+  config_t *config = ctx->config;
+  config_t **trees;
+  struct include_cache_entry *entry;
+  unsigned int i, j, count, length;
+  int end = SCANCTX_END_EMPTY, file_end;
+  int ok = CONFIG_TRUE;
+
+  for(count = 0; files[count]; ++count);
+
+  trees = (config_t **)libconfig_calloc(count, sizeof(config_t *));
+
+  /* Either all of the files are grafted, or all of them are scanned. The
+   * files run into one another, and the last one into the text that follows
+   * the directive; a file that ends inside a comment or string, or that
+   * leaves a setting open for that text to continue, is scanned.
+   */
+  for(i = 0; ok && (i < count); ++i)
+  {
+    file_end = SCANCTX_END_UNKNOWN;
+
+    if(! (ctx->prefetch && (ctx->stack_depth == 0)
+          && libconfig_prefetch_get(ctx->prefetch, files[i], &(trees[i]),
+                                    &file_end))
+       && config->include_cache)
+    {
+      entry = __config_include_cache_get(config, files[i]);
+      if(entry)
+      {
+        trees[i] = entry->tree;
+        file_end = entry->end;
+      }
+    }
+
+    if(file_end != SCANCTX_END_EMPTY)
+      end = file_end;
+
+    ok = (trees[i] != NULL) && (end != SCANCTX_END_UNKNOWN);
+  }
+
+  if(ok && (end == SCANCTX_END_OPEN))
+    ok = libconfig_parse_can_follow(follow);
+
+  /* A setting that is defined twice is reported where the scanner finds
+   * it.
+   */
+  if(ok && ! config_get_option(config, CONFIG_OPTION_ALLOW_OVERRIDES))
+    ok = ! __config_include_conflicts(ctx->include_parent, trees, count);
+
+  if(! ok)
+  {
+    __delete(trees);
+    return(CONFIG_FALSE);
+  }
+
+  for(i = 0; (i < count) && ! *error; ++i)
+  {
+    config_t *tree = trees[i];
+    config_list_t *list = tree->root->value.list;
+    const char **to;
+
+    /* The file names of the copies must live as long as the configuration,
+     * so they go into its own list.
+     */
+    for(length = 0; tree->filenames[length]; ++length);
+
+    to = (const char **)libconfig_calloc(length + 1, sizeof(const char *));
+    to[0] = files[i];
+    for(j = 1; j < length; ++j)
+    {
+      to[j] = strdup(tree->filenames[j]);
+      libconfig_strvec_append(&(ctx->filenames), to[j]);
+    }
+
+    for(j = 0; list && (j < list->length); ++j)
+    {
+      if(! __config_setting_copy(ctx->include_parent, list->elements[j],
+                                 NULL, tree->filenames, to))
+      {
+        *error = __include_duplicate_error;
+        break;
+      }
+    }
+
+    __delete(to);
+  }
+
+  __delete(trees);
+
+  return(CONFIG_TRUE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Writes the data to the named file in a single write, and syncs it to disk
+ * if the FSYNC option is set.
+ */
+static int __config_write_out(config_t *config, const char *filename,
+                              const char *mode, const char *data,
+                              size_t length)
+{
+  size_t written;
+
+  FILE *stream = fopen(filename, mode);
+  if(stream == NULL)
+  {
+    config->error_text = __io_error;
+    config->error_type = CONFIG_ERR_FILE_IO;
+    return(CONFIG_FALSE);
+  }
+
+  written = length ? fwrite(data, 1, length, stream) : 0;
+
+  if((written != length) || (fflush(stream) != 0))
+  {
+    fclose(stream);
+    config->error_text = __io_error;
+    config->error_type = CONFIG_ERR_FILE_IO;
+    return(CONFIG_FALSE);
+  }
+
+  if(config_get_option(config, CONFIG_OPTION_FSYNC))
+  {
+    int fd = posix_fileno(stream);
+
+    if(fd >= 0)
+    {
+#if defined(_WIN32)
+      int fsync_res = _commit(fd);
+#else
+      int fsync_res = posix_fsync(fd);
+#endif
+      if(fsync_res != 0)
+      {
+        fclose(stream);
+        config->error_text = __io_error;
+        config->error_type = CONFIG_ERR_FILE_IO;
+        return(CONFIG_FALSE);
+      }
+    }
+  }
+
+  fclose(stream);
+  config->error_type = CONFIG_ERR_NONE;
+  return(CONFIG_TRUE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_write_file(config_t *config, const char *filename)
+{
+  strbuf_t buf = { NULL, 0, 0 };
+  int ret;
+
+  __config_write(config, &buf);
+  ret = __config_write_out(config, filename, "wt", buf.string, buf.length);
+  __delete(buf.string);
+
+  return(ret);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Binary snapshots. All integers are little-endian. A snapshot consists of:
+ *
+ *   - a header: the magic bytes, then the 32-bit version, flags, setting
+ *     count, file count and string table size, and 4 reserved bytes;
+ *   - one 32-byte record per setting, in breadth-first order, so that the
+ *     children of every aggregate are consecutive records: name, type,
+ *     format, hash, comment, child count, 4 reserved bytes, and a 64-bit
+ *     value, which is the index of the first child for aggregates;
+ *   - if SNAPSHOT_FLAG_SOURCE is set, the file number and line of each
+ *     setting;
+ *   - the string table offsets of the file names;
+ *   - the string table, of NUL-terminated strings.
+ *
+ * Strings are referred to by string table offset plus one, so that 0 can
+ * stand for none, and file numbers likewise. A snapshot is read in one piece
+ * into the arena; names and string values are used where they lie.
+ */
+
+#define SNAPSHOT_MAGIC "LCFGSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_FLAG_SOURCE 0x01
+#define SNAPSHOT_HEADER_SIZE 32
+#define SNAPSHOT_RECORD_SIZE 32
+#define SNAPSHOT_SOURCE_SIZE 8
+
+static const char *__snapshot_error = "invalid binary configuration";
+static const char *__snapshot_version_error =
+  "unsupported binary configuration version";
+
+typedef struct
+{
+  strbuf_t table;
+  unsigned int *slots; /* string table offsets plus one */
+  unsigned int size;
+  unsigned int count;
+} snapshot_strings_t;
+
+/* A setting to be written, or, if the index is not negative, an element of
+ * the array that it is.
+ */
+typedef struct
+{
+  const config_setting_t *setting;
+  int idx;
+} snapshot_item_t;
+
+/* ------------------------------------------------------------------------- */
+
+static void __snapshot_put32(unsigned char *p, unsigned int v)
+{
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8);
+  p[2] = (unsigned char)(v >> 16);
+  p[3] = (unsigned char)(v >> 24);
+}
 
-    if(fstat(fd, &statbuf) == 0)
+/* ------------------------------------------------------------------------- */
+
+static void __snapshot_put64(unsigned char *p, unsigned long long v)
+{
+  __snapshot_put32(p, (unsigned int)v);
+  __snapshot_put32(p + 4, (unsigned int)(v >> 32));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static unsigned int __snapshot_get32(const unsigned char *p)
+{
+  return((unsigned int)p[0] | ((unsigned int)p[1] << 8)
+         | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static unsigned long long __snapshot_get64(const unsigned char *p)
+{
+  return((unsigned long long)__snapshot_get32(p)
+         | ((unsigned long long)__snapshot_get32(p + 4) << 32));
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the reference to the string s in the string table, adding it if
+ * it is not there yet. Equal strings are stored once.
+ */
+static unsigned int __snapshot_string(snapshot_strings_t *strings,
+                                      const char *s)
+{
+  size_t len;
+  unsigned int mask, slot;
+
+  if(! s)
+    return(0);
+
+  if((strings->count + 1) * 2 > strings->size)
+  {
+    unsigned int *old = strings->slots, old_size = strings->size, i;
+
+    strings->size = old_size ? old_size * 2 : 256;
+    strings->slots = (unsigned int *)libconfig_calloc(strings->size,
+                                                      sizeof(unsigned int));
+    mask = strings->size - 1;
+
+    for(i = 0; i < old_size; ++i)
     {
-      // Only proceed if this is not a directory.
-      if(!S_ISDIR(statbuf.st_mode))
-        ok = 1;
+      if(old[i])
+      {
+        const char *t = strings->table.string + old[i] - 1;
+
+        for(slot = libconfig_hash_string(t, strlen(t)) & mask;
+            strings->slots[slot]; slot = (slot + 1) & mask);
+
+        strings->slots[slot] = old[i];
+      }
     }
+
+    __delete(old);
   }
 
-  if(!ok)
+  len = strlen(s);
+  mask = strings->size - 1;
+
+  for(slot = libconfig_hash_string(s, len) & mask; strings->slots[slot];
+      slot = (slot + 1) & mask)
   {
-    if(stream != NULL)
-      fclose(stream);
+    if(! strcmp(strings->table.string + strings->slots[slot] - 1, s))
+      return(strings->slots[slot]);
+  }
 
-    config->error_text = __io_error;
-    config->error_type = CONFIG_ERR_FILE_IO;
-    return(CONFIG_FALSE);
+  strings->slots[slot] = (unsigned int)strings->table.length + 1;
+  ++strings->count;
+  libconfig_strbuf_append(&strings->table, s, len + 1);
+
+  return(strings->slots[slot]);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_write_binary(config_t *config, const char *filename, int flags)
+{
+  snapshot_strings_t strings = { { NULL, 0, 0 }, NULL, 0, 0 };
+  strbuf_t records = { NULL, 0, 0 }, sources = { NULL, 0, 0 };
+  strbuf_t image = { NULL, 0, 0 };
+  snapshot_item_t *queue;
+  const char **files = config->filenames;
+  unsigned char header[SNAPSHOT_HEADER_SIZE];
+  unsigned int count = 1, capacity = CHUNK_SIZE, file_count = 0, i;
+  int ret;
+
+  if(flags & CONFIG_BINARY_SOURCE_INFO)
+    for(; files && files[file_count]; ++file_count);
+
+  queue = (snapshot_item_t *)libconfig_malloc(
+    capacity * sizeof(snapshot_item_t));
+  queue[0].setting = config->root;
+  queue[0].idx = -1;
+
+  /* The queue grows as the records are written, so that the children of
+   * each aggregate are appended to it together.
+   */
+  for(i = 0; i < count; ++i)
+  {
+    const config_setting_t *setting = queue[i].setting;
+    const config_list_t *list;
+    config_setting_t scratch;
+    unsigned char record[SNAPSHOT_RECORD_SIZE];
+    unsigned long long value = 0;
+    unsigned int children = 0, j;
+
+    if(queue[i].idx >= 0)
+    {
+      setting = __config_list_peek(config, __config_setting_list(setting),
+                                   (unsigned int)queue[i].idx, &scratch);
+
+      /* The element keeps the source position of its array. */
+      scratch.line = queue[i].setting->line;
+      scratch.file = queue[i].setting->file;
+    }
+
+    switch(setting->type)
+    {
+      case CONFIG_TYPE_INT:
+      case CONFIG_TYPE_BOOL:
+        value = (unsigned long long)(long long)setting->value.ival;
+        break;
+
+      case CONFIG_TYPE_INT64:
+        value = (unsigned long long)setting->value.llval;
+        break;
+
+      case CONFIG_TYPE_FLOAT:
+        memcpy(&value, &setting->value.fval, sizeof(value));
+        break;
+
+      case CONFIG_TYPE_STRING:
+        value = __snapshot_string(&strings, setting->value.sval);
+        break;
+
+      case CONFIG_TYPE_GROUP:
+      case CONFIG_TYPE_ARRAY:
+      case CONFIG_TYPE_LIST:
+        list = __config_setting_list(setting);
+        if(list && list->length)
+        {
+          config_setting_t * const *elements =
+            __config_list_load_elements(list);
+
+          if(count + list->length > capacity)
+          {
+            while(count + list->length > capacity)
+              capacity *= 2;
+
+            queue = (snapshot_item_t *)libconfig_realloc(
+              queue, capacity * sizeof(snapshot_item_t));
+          }
+
+          value = count;
+          children = list->length;
+
+          for(j = 0; j < list->length; ++j, ++count)
+          {
+            queue[count].setting = elements ? elements[j] : setting;
+            queue[count].idx = elements ? -1 : (int)j;
+          }
+        }
+        break;
+    }
+
+    __snapshot_put32(record, __snapshot_string(&strings, setting->name));
+    record[4] = (unsigned char)setting->type;
+    record[5] = (unsigned char)(setting->type >> 8);
+    record[6] = (unsigned char)setting->format;
+    record[7] = (unsigned char)(setting->format >> 8);
+    __snapshot_put32(record + 8, setting->hash);
+    __snapshot_put32(record + 12,
+                     __snapshot_string(&strings, setting->comment));
+    __snapshot_put32(record + 16, children);
+    __snapshot_put32(record + 20, 0);
+    __snapshot_put64(record + 24, value);
+    libconfig_strbuf_append(&records, (const char *)record, sizeof(record));
+
+    if(flags & CONFIG_BINARY_SOURCE_INFO)
+    {
+      unsigned char source[SNAPSHOT_SOURCE_SIZE];
+      unsigned int file = 0;
+
+      while((file < file_count) && (files[file] != setting->file))
+        ++file;
+
+      __snapshot_put32(source, (file < file_count) ? file + 1 : 0);
+      __snapshot_put32(source + 4, setting->line);
+      libconfig_strbuf_append(&sources, (const char *)source,
+                              sizeof(source));
+    }
   }
 
-  ret = __config_read(config, stream, filename, NULL);
-  fclose(stream);
+  memcpy(header, SNAPSHOT_MAGIC, 8);
+  __snapshot_put32(header + 8, SNAPSHOT_VERSION);
+  __snapshot_put32(header + 12, (flags & CONFIG_BINARY_SOURCE_INFO)
+                   ? SNAPSHOT_FLAG_SOURCE : 0);
+  __snapshot_put32(header + 16, count);
+  __snapshot_put32(header + 20, file_count);
+
+  for(i = 0; i < file_count; ++i)
+  {
+    unsigned char offset[4];
+
+    __snapshot_put32(offset, __snapshot_string(&strings, files[i]) - 1);
+    libconfig_strbuf_append(&sources, (const char *)offset, sizeof(offset));
+  }
+
+  __snapshot_put32(header + 24, (unsigned int)strings.table.length);
+  __snapshot_put32(header + 28, 0);
+
+  libconfig_strbuf_append(&image, (const char *)header, sizeof(header));
+  libconfig_strbuf_append(&image, records.string, records.length);
+  if(sources.length)
+    libconfig_strbuf_append(&image, sources.string, sources.length);
+  if(strings.table.length)
+    libconfig_strbuf_append(&image, strings.table.string,
+                            strings.table.length);
+
+  ret = __config_write_out(config, filename, "wb", image.string,
+                           image.length);
+
+  __delete(image.string);
+  __delete(strings.table.string);
+  __delete(strings.slots);
+  __delete(sources.string);
+  __delete(records.string);
+  __delete(queue);
 
   return(ret);
 }
 
 /* ------------------------------------------------------------------------- */
 
-int config_write_file(config_t *config, const char *filename)
+/* Checks the structure of the snapshot without building anything: that the
+ * sections fill it exactly, that every reference is in range, and that the
+ * child ranges of the aggregates, taken in order, cover all records but the
+ * root exactly once. Returns the number of non-empty aggregates, or -1.
+ */
+static int __snapshot_check(const unsigned char *image, size_t size)
 {
-  FILE *stream = fopen(filename, "wt");
-  if(stream == NULL)
+  unsigned int flags, count, file_count, string_bytes, i, next = 1;
+  const unsigned char *records, *sources, *files;
+  size_t expected;
+  int lists = 0;
+
+  flags = __snapshot_get32(image + 12);
+  count = __snapshot_get32(image + 16);
+  file_count = __snapshot_get32(image + 20);
+  string_bytes = __snapshot_get32(image + 24);
+
+  expected = SNAPSHOT_HEADER_SIZE + (size_t)count * SNAPSHOT_RECORD_SIZE
+    + ((flags & SNAPSHOT_FLAG_SOURCE) ? (size_t)count * SNAPSHOT_SOURCE_SIZE
+       : 0)
+    + (size_t)file_count * 4 + string_bytes;
+
+  if((flags & ~SNAPSHOT_FLAG_SOURCE) || (count == 0)
+     || (count > (size - SNAPSHOT_HEADER_SIZE) / SNAPSHOT_RECORD_SIZE)
+     || (file_count > size / 4) || (string_bytes > size)
+     || (expected != size)
+     || (string_bytes && (image[size - 1] != '\0')))
+    return(-1);
+
+  records = image + SNAPSHOT_HEADER_SIZE;
+  sources = records + (size_t)count * SNAPSHOT_RECORD_SIZE;
+  files = (flags & SNAPSHOT_FLAG_SOURCE)
+    ? sources + (size_t)count * SNAPSHOT_SOURCE_SIZE : sources;
+
+  for(i = 0; i < file_count; ++i)
   {
-    config->error_text = __io_error;
-    config->error_type = CONFIG_ERR_FILE_IO;
-    return(CONFIG_FALSE);
+    if(__snapshot_get32(files + i * 4) >= string_bytes)
+      return(-1);
   }
 
-  config_write(config, stream);
+  for(i = 0; i < count; ++i)
+  {
+    const unsigned char *record = records + (size_t)i * SNAPSHOT_RECORD_SIZE;
+    unsigned int type = record[4] | (record[5] << 8);
+    unsigned int children = __snapshot_get32(record + 16);
+    unsigned long long value = __snapshot_get64(record + 24);
+
+    if((__snapshot_get32(record) > string_bytes)
+       || (__snapshot_get32(record + 12) > string_bytes))
+      return(-1);
 
-  if(config_get_option(config, CONFIG_OPTION_FSYNC))
+    if((flags & SNAPSHOT_FLAG_SOURCE)
+       && (__snapshot_get32(sources + (size_t)i * SNAPSHOT_SOURCE_SIZE)
+           > file_count))
+      return(-1);
+
+    if((i == 0) && ((type != CONFIG_TYPE_GROUP) || __snapshot_get32(record)))
+      return(-1);
+
+    switch(type)
+    {
+      case CONFIG_TYPE_INT:
+      case CONFIG_TYPE_INT64:
+      case CONFIG_TYPE_FLOAT:
+      case CONFIG_TYPE_BOOL:
+        break;
+
+      case CONFIG_TYPE_STRING:
+        if(value > string_bytes)
+          return(-1);
+        break;
+
+      case CONFIG_TYPE_GROUP:
+      case CONFIG_TYPE_ARRAY:
+      case CONFIG_TYPE_LIST:
+      {
+        unsigned int j, element_type = CONFIG_TYPE_NONE;
+
+        if(! children)
+          break;
+
+        if((value != next) || (value <= i) || (children > count - next))
+          return(-1);
+
+        /* Group members are named and other elements are not; arrays hold
+         * scalars of a single type.
+         */
+        for(j = next; j < next + children; ++j)
+        {
+          const unsigned char *child = records
+            + (size_t)j * SNAPSHOT_RECORD_SIZE;
+          unsigned int child_type = child[4] | (child[5] << 8);
+
+          if((__snapshot_get32(child) != 0) != (type == CONFIG_TYPE_GROUP))
+            return(-1);
+
+          if(type == CONFIG_TYPE_ARRAY)
+          {
+            if((child_type < CONFIG_TYPE_INT)
+               || (child_type > CONFIG_TYPE_BOOL)
+               || ((element_type != CONFIG_TYPE_NONE)
+                   && (child_type != element_type)))
+              return(-1);
+
+            element_type = child_type;
+          }
+        }
+
+        next += children;
+        ++lists;
+        break;
+      }
+
+      default:
+        return(-1);
+    }
+
+    if((type != CONFIG_TYPE_GROUP) && (type != CONFIG_TYPE_ARRAY)
+       && (type != CONFIG_TYPE_LIST) && children)
+      return(-1);
+  }
+
+  return((next == count) ? lists : -1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Builds the tree from a checked snapshot, allocating all settings, all
+ * lists and all element arrays as one block each.
+ */
+static void __snapshot_load(config_t *config, const unsigned char *image,
+                            int list_count)
+{
+  unsigned int flags = __snapshot_get32(image + 12);
+  unsigned int count = __snapshot_get32(image + 16);
+  unsigned int file_count = __snapshot_get32(image + 20);
+  const unsigned char *records = image + SNAPSHOT_HEADER_SIZE;
+  const unsigned char *sources = records
+    + (size_t)count * SNAPSHOT_RECORD_SIZE;
+  const unsigned char *files = (flags & SNAPSHOT_FLAG_SOURCE)
+    ? sources + (size_t)count * SNAPSHOT_SOURCE_SIZE : sources;
+  char *strings = (char *)files + (size_t)file_count * 4 - 1;
+  config_setting_t *settings, **elements;
+  config_list_t *lists;
+  strvec_t filenames = { NULL, NULL, 0, 0 };
+  unsigned int i;
+
+  for(i = 0; i < file_count; ++i)
+    libconfig_strvec_append(&filenames,
+                            strdup(strings + __snapshot_get32(files + i * 4)
+                                   + 1));
+  config->filenames = libconfig_strvec_release(&filenames);
+
+  settings = (config_setting_t *)__config_alloc(
+    config, count * sizeof(config_setting_t));
+  lists = (config_list_t *)__config_alloc(
+    config, (list_count ? list_count : 1) * sizeof(config_list_t));
+  elements = (config_setting_t **)__config_alloc(
+    config, (count > 1 ? count - 1 : 1) * sizeof(config_setting_t *));
+
+  for(i = 0; i < count; ++i)
   {
-    int fd = posix_fileno(stream);
+    const unsigned char *record = records + (size_t)i * SNAPSHOT_RECORD_SIZE;
+    config_setting_t *setting = settings + i;
+    unsigned int name = __snapshot_get32(record);
+    unsigned int comment = __snapshot_get32(record + 12);
+    unsigned long long value = __snapshot_get64(record + 24);
+
+    setting->type = (unsigned short)(record[4] | (record[5] << 8));
+    setting->format = (unsigned short)(record[6] | (record[7] << 8));
+    setting->hash = __snapshot_get32(record + 8);
+    setting->config = config;
+
+    if(name)
+    {
+      setting->name = strings + name;
+      if(config->strpool)
+        setting->name = (char *)libconfig_strpool_intern(
+          config->strpool, setting->name, strlen(setting->name),
+          setting->hash);
+    }
 
-    if(fd >= 0)
+    if(comment)
+      setting->comment = strings + comment;
+
+    if(flags & SNAPSHOT_FLAG_SOURCE)
     {
-#if defined(_WIN32)
-      int fsync_res = _commit(fd);
-#else
-      int fsync_res = posix_fsync(fd);
-#endif
-      if(fsync_res != 0)
+      const unsigned char *source = sources
+        + (size_t)i * SNAPSHOT_SOURCE_SIZE;
+      unsigned int file = __snapshot_get32(source);
+
+      setting->file = file ? config->filenames[file - 1] : NULL;
+      setting->line = __snapshot_get32(source + 4);
+    }
+
+    switch(setting->type)
+    {
+      case CONFIG_TYPE_INT:
+      case CONFIG_TYPE_BOOL:
+        setting->value.ival = (int)(long long)value;
+        break;
+
+      case CONFIG_TYPE_INT64:
+        setting->value.llval = (long long)value;
+        break;
+
+      case CONFIG_TYPE_FLOAT:
+        memcpy(&setting->value.fval, &value, sizeof(value));
+        break;
+
+      case CONFIG_TYPE_STRING:
+        setting->value.sval = value ? strings + value : NULL;
+        break;
+
+      default: /* aggregate */
       {
-        fclose(stream);
-        config->error_text = __io_error;
-        config->error_type = CONFIG_ERR_FILE_IO;
-        return(CONFIG_FALSE);
+        unsigned int children = __snapshot_get32(record + 16), j;
+        config_list_t *list;
+
+        if(! children)
+          break;
+
+        list = lists++;
+        list->length = list->capacity = children;
+        list->elements = elements + (value - 1);
+
+        for(j = 0; j < children; ++j)
+        {
+          list->elements[j] = settings + value + j;
+          list->elements[j]->parent = setting;
+          list->elements[j]->position = list->position_base + j;
+        }
+
+        setting->value.list = list;
+
+        if((setting->type == CONFIG_TYPE_GROUP)
+           && (children >= INDEX_THRESHOLD))
+          __config_list_reindex(config, list);
+
+        break;
       }
     }
   }
 
+  config->root = settings;
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_read_binary(config_t *config, const char *filename)
+{
+  unsigned char *image;
+  struct stat statbuf;
+  size_t size = 0;
+  int lists = -1;
+  strvec_t filenames = { NULL, NULL, 0, 0 };
+
+  FILE *stream = fopen(filename, "rb");
+  if((stream == NULL) || (fstat(posix_fileno(stream), &statbuf) != 0)
+     || S_ISDIR(statbuf.st_mode))
+  {
+    if(stream != NULL)
+      fclose(stream);
+
+    config->error_text = __io_error;
+    config->error_type = CONFIG_ERR_FILE_IO;
+    return(CONFIG_FALSE);
+  }
+
+  config_clear(config);
+
+  /* The tree is always built in an arena, which also holds the snapshot
+   * itself, so that names and strings can point into it.
+   */
+  if(! config->arena)
+  {
+    __config_setting_destroy(config->root);
+    config->arena = libconfig_arena_create();
+    config->root = NULL;
+  }
+
+  size = (size_t)statbuf.st_size;
+  image = (unsigned char *)libconfig_arena_alloc(config->arena, size);
+  if(fread(image, 1, size, stream) != size)
+  {
+    fclose(stream);
+    config_clear(config);
+    config->error_text = __io_error;
+    config->error_type = CONFIG_ERR_FILE_IO;
+    return(CONFIG_FALSE);
+  }
+
   fclose(stream);
-  config->error_type = CONFIG_ERR_NONE;
-  return(CONFIG_TRUE);
+
+  if((size >= SNAPSHOT_HEADER_SIZE)
+     && (memcmp(image, SNAPSHOT_MAGIC, 8) == 0))
+  {
+    if(__snapshot_get32(image + 8) != SNAPSHOT_VERSION)
+      config->error_text = __snapshot_version_error;
+    else if((lists = __snapshot_check(image, size)) >= 0)
+    {
+      __snapshot_load(config, image, lists);
+      config->error_type = CONFIG_ERR_NONE;
+      return(CONFIG_TRUE);
+    }
+    else
+      config->error_text = __snapshot_error;
+  }
+  else
+    config->error_text = __snapshot_error;
+
+  /* Keep the file name for config_error_file(). */
+  config_clear(config);
+  libconfig_strvec_append(&filenames, strdup(filename));
+  config->filenames = libconfig_strvec_release(&filenames);
+  config->error_file = config->filenames[0];
+  config->error_line = 0;
+  config->error_type = CONFIG_ERR_PARSE;
+  return(CONFIG_FALSE);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -726,6 +3239,9 @@ int config_write_file(config_t *config, const char *filename)
 void config_destroy(config_t *config)
 {
   __config_setting_destroy(config->root);
+  libconfig_lazy_destroy(config->lazy);
+  libconfig_arena_destroy(config->arena);
+  libconfig_strpool_destroy(config->strpool);
   libconfig_strvec_delete(config->filenames);
   __delete(config->include_dir);
   __zero(config);
@@ -738,10 +3254,25 @@ void config_clear(config_t *config)
   /* Destroy the root setting (recursively) and then create a new one. */
   __config_setting_destroy(config->root);
 
+  libconfig_lazy_destroy(config->lazy);
+  config->lazy = NULL;
+
+  /* The arena and interning options take effect here, when there is no tree
+   * yet.
+   */
+  libconfig_arena_destroy(config->arena);
+  config->arena = config_get_option(config, CONFIG_OPTION_ARENA)
+    ? libconfig_arena_create() : NULL;
+
+  libconfig_strpool_destroy(config->strpool);
+  config->strpool = config_get_option(config, CONFIG_OPTION_INTERN_NAMES)
+    ? libconfig_strpool_create() : NULL;
+
   libconfig_strvec_delete(config->filenames);
   config->filenames = NULL;
 
-  config->root = __new(config_setting_t);
+  config->root = (config_setting_t *)__config_alloc(config,
+                                                    sizeof(config_setting_t));
   config->root->type = CONFIG_TYPE_GROUP;
   config->root->config = config;
 }
@@ -824,6 +3355,33 @@ int config_get_option(const config_t *config, int option)
 
 /* ------------------------------------------------------------------------- */
 
+const char *config_lazy_error(const config_t *config, const char **file,
+                              int *line)
+{
+  const char *text = NULL;
+
+  if(! config->lazy)
+    return(NULL);
+
+  libconfig_lazy_lock(config->lazy);
+
+  text = config->lazy->error_text;
+  if(text)
+  {
+    if(file)
+      *file = config->lazy->error_file;
+
+    if(line)
+      *line = config->lazy->error_line;
+  }
+
+  libconfig_lazy_unlock(config->lazy);
+
+  return(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
 void config_set_hook(config_t *config, void *hook)
 {
   config->hook = hook;
@@ -842,26 +3400,23 @@ static config_setting_t *config_setting_create(config_setting_t *parent,
                                                int type, const char *comment)
 {
   config_setting_t *setting;
-  config_list_t *list;
 
   if(!config_setting_is_aggregate(parent))
     return(NULL);
 
-  setting = __new(config_setting_t);
+  setting = (config_setting_t *)__config_alloc(parent->config,
+                                               sizeof(config_setting_t));
   setting->parent = parent;
-  setting->name = (name == NULL) ? NULL : strdup(name);
+  setting->hash = (name == NULL) ? 0 : libconfig_hash_string(name,
+                                                             strlen(name));
+  setting->name = __config_name_dup(parent->config, name, setting->hash);
   setting->type = type;
   setting->config = parent->config;
   setting->hook = NULL;
   setting->line = 0;
-  setting->comment = (comment == NULL) ? NULL : strdup(comment);
+  setting->comment = __config_strdup(parent->config, comment);
 
-  list = parent->value.list;
-
-  if(! list)
-    list = parent->value.list = __new(config_list_t);
-
-  __config_list_add(list, setting);
+  __config_setting_attach(parent, setting);
 
   return(setting);
 }
@@ -1197,10 +3752,84 @@ int config_setting_set_string(config_setting_t *setting, const char *value)
   else if(setting->type != CONFIG_TYPE_STRING)
     return(CONFIG_FALSE);
 
-  if(setting->value.sval)
-    __delete(setting->value.sval);
+  if(setting->value.sval)
+    __config_string_free(setting->config, setting->value.sval);
+
+  setting->value.sval = __config_string_dup(setting->config, value);
+  return(CONFIG_TRUE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int libconfig_setting_take_string(config_setting_t *setting, char *value)
+{
+  config_t *config = setting->config;
+
+  /* Values that belong in the arena or the string pool must be copied. */
+  if(config->arena || (config->strpool
+                       && config_get_option(config,
+                                            CONFIG_OPTION_INTERN_STRINGS)))
+  {
+    if(! config_setting_set_string(setting, value))
+      return(CONFIG_FALSE);
+
+    __delete(value);
+    return(CONFIG_TRUE);
+  }
+
+  if(setting->type == CONFIG_TYPE_NONE)
+    setting->type = CONFIG_TYPE_STRING;
+  else if(setting->type != CONFIG_TYPE_STRING)
+    return(CONFIG_FALSE);
+
+  if(setting->value.sval)
+    __config_string_free(config, setting->value.sval);
+
+  setting->value.sval = value;
+  return(CONFIG_TRUE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int libconfig_setting_append(config_setting_t *parent, int type,
+                             config_value_t value, unsigned short format,
+                             config_setting_t **element)
+{
+  config_t *config = parent->config;
+  char *s = NULL;
+
+  *element = NULL;
+
+  if(! __config_list_checktype(parent, type))
+    return(CONFIG_FALSE);
+
+  if((parent->type == CONFIG_TYPE_ARRAY)
+     && ! (parent->value.list && parent->value.list->elements))
+  {
+    /* Values that belong in the arena or the string pool must be copied. */
+    if((type == CONFIG_TYPE_STRING)
+       && (config->arena
+           || (config->strpool
+               && config_get_option(config, CONFIG_OPTION_INTERN_STRINGS))))
+    {
+      s = value.sval;
+      value.sval = __config_string_dup(config, s);
+    }
+
+    __config_array_append(parent, type, &value, format);
+    __delete(s);
+
+    return(CONFIG_TRUE);
+  }
+
+  *element = config_setting_create(parent, NULL, type, NULL);
+
+  if(type == CONFIG_TYPE_STRING)
+    return(libconfig_setting_take_string(*element, value.sval));
+
+  (*element)->value = value;
+  (*element)->format = format;
 
-  setting->value.sval = (value == NULL) ? NULL : strdup(value);
   return(CONFIG_TRUE);
 }
 
@@ -1256,8 +3885,7 @@ const config_setting_t *config_setting_lookup_const(
       while(*q && !strchr(PATH_TOKENS, *q))
         ++q;
 
-      found = __config_list_search(found->value.list, p, (size_t)(q - p),
-                                   NULL);
+      found = __config_list_search(found, p, (size_t)(q - p), NULL);
       p = q;
     }
     else
@@ -1292,6 +3920,139 @@ const config_setting_t *config_lookup_const(const config_t *config,
 
 /* ------------------------------------------------------------------------- */
 
+/* A compiled path is a single allocation: the component array, followed by
+ * a copy of the names. A name component whose name is empty and which ends
+ * the path records a trailing path separator, as in "a.b."; see
+ * config_setting_lookup_path().
+ */
+
+typedef struct
+{
+  const char *name;
+  size_t namelen;
+  unsigned int hash;
+  unsigned int index;
+} config_path_component_t;
+
+struct config_path_t
+{
+  unsigned int length;
+  config_path_component_t components[1];
+};
+
+config_path_t *config_path_compile(const char *path)
+{
+  config_path_t *compiled;
+  config_path_component_t *component;
+  const char *p;
+  char *names;
+  unsigned int count = 0;
+  size_t pathlen;
+
+  if(! path)
+    return(NULL);
+
+  pathlen = strlen(path);
+
+  /* Each component is preceded by at most one separator, so a path can't
+   * have more components than it has characters.
+   */
+  compiled = (config_path_t *)libconfig_calloc(
+    1, sizeof(config_path_t)
+    + (pathlen * sizeof(config_path_component_t)) + pathlen + 1);
+  names = (char *)(compiled->components + (pathlen ? pathlen : 1));
+
+  for(p = path; *p; ++count)
+  {
+    component = compiled->components + count;
+
+    if(strchr(PATH_TOKENS, *p))
+      ++p;
+
+    if(*p == '[')
+    {
+      char *q;
+      long index = strtol(++p, &q, 10);
+      if(*q != ']')
+      {
+        __delete(compiled);
+        return(NULL);
+      }
+
+      p = ++q;
+      component->index = (unsigned int)index;
+    }
+    else
+    {
+      const char *q = p;
+
+      while(*q && !strchr(PATH_TOKENS, *q))
+        ++q;
+
+      component->namelen = (size_t)(q - p);
+      memcpy(names, p, component->namelen);
+      component->name = names;
+      component->hash = libconfig_hash_string(names, component->namelen);
+      names += component->namelen + 1;
+      p = q;
+    }
+  }
+
+  compiled->length = count;
+  return(compiled);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void config_path_free(config_path_t *path)
+{
+  __delete(path);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* This follows config_setting_lookup_const() step for step, so that a
+ * compiled path always finds the same setting as the string it was compiled
+ * from.
+ */
+config_setting_t *config_setting_lookup_path(const config_setting_t *setting,
+                                             const config_path_t *path)
+{
+  const config_setting_t *found = setting;
+  const config_path_component_t *component;
+  unsigned int i;
+
+  if(! path)
+    return(NULL);
+
+  for(i = 0, component = path->components; (i < path->length) && found;
+      ++i, ++component)
+  {
+    if(! component->name)
+      found = config_setting_get_elem(found, component->index);
+    else if(found->type == CONFIG_TYPE_GROUP)
+      found = __config_list_search_hashed(found, component->name,
+                                          component->namelen,
+                                          component->hash, NULL);
+    else if((component->namelen == 0) && (i == path->length - 1))
+      break;
+    else
+      return(NULL);
+  }
+
+  return((found == setting) ? NULL : (config_setting_t *)found);
+}
+
+/* ------------------------------------------------------------------------- */
+
+config_setting_t *config_lookup_path(const config_t *config,
+                                     const config_path_t *path)
+{
+  return(config_setting_lookup_path(config->root, path));
+}
+
+/* ------------------------------------------------------------------------- */
+
 int config_lookup_string(const config_t *config, const char *path,
                          const char **value)
 {
@@ -1360,9 +4121,217 @@ int config_lookup_bool(const config_t *config, const char *path, int *value)
 
 /* ------------------------------------------------------------------------- */
 
+/* Stores the value of the setting `found' (NULL if it was not found) in the
+ * destination of the entry, or the entry's default if the setting is
+ * missing or of the wrong type.
+ */
+static void __config_lookup_entry_store(config_lookup_entry_t *entry,
+                                        const config_setting_t *found)
+{
+  int ival;
+  long long llval;
+  double fval;
+  int ok = CONFIG_FALSE;
+
+  switch(entry->type)
+  {
+    case CONFIG_TYPE_INT:
+      ival = entry->default_value.ival;
+      ok = found && __config_setting_get_int(found, &ival);
+      if(entry->value)
+        *(int *)entry->value = ok ? ival : entry->default_value.ival;
+      break;
+
+    case CONFIG_TYPE_INT64:
+      llval = entry->default_value.llval;
+      ok = found && __config_setting_get_int64(found, &llval);
+      if(entry->value)
+        *(long long *)entry->value = ok ? llval : entry->default_value.llval;
+      break;
+
+    case CONFIG_TYPE_FLOAT:
+      fval = entry->default_value.fval;
+      ok = found && __config_setting_get_float(found, &fval);
+      if(entry->value)
+        *(double *)entry->value = ok ? fval : entry->default_value.fval;
+      break;
+
+    case CONFIG_TYPE_BOOL:
+      ok = found && (found->type == CONFIG_TYPE_BOOL);
+      if(entry->value)
+        *(int *)entry->value = ok ? found->value.ival
+          : entry->default_value.ival;
+      break;
+
+    case CONFIG_TYPE_STRING:
+      ok = found && (found->type == CONFIG_TYPE_STRING);
+      if(entry->value)
+        *(const char **)entry->value = ok ? found->value.sval
+          : entry->default_value.sval;
+      break;
+
+    default:
+      ok = found && ((entry->type == CONFIG_TYPE_NONE)
+                     || (found->type == entry->type));
+      if(entry->value)
+        *(const config_setting_t **)entry->value = ok ? found : NULL;
+      break;
+  }
+
+  if(ok)
+    entry->status = CONFIG_LOOKUP_FOUND;
+  else
+    entry->status = found ? CONFIG_LOOKUP_TYPE_MISMATCH
+      : CONFIG_LOOKUP_NOT_FOUND;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* The settings found along the previous entry's path are kept, with the
+ * offset at which each component ended; the walk for the next path resumes
+ * from the deepest of those whose component is also a prefix of the new
+ * path. From any (offset, setting) pair the walk below proceeds exactly as
+ * config_setting_lookup_const() would. The entries are not sorted, as
+ * sorting them costs more than the lookups it would save; callers get the
+ * most out of this by keeping paths with a common prefix together.
+ */
+int config_setting_lookup_values(const config_setting_t *setting,
+                                 config_lookup_entry_t *entries,
+                                 unsigned int count)
+{
+  const config_setting_t **steps = NULL;
+  size_t *ends = NULL;
+  unsigned char *named = NULL;
+  size_t capacity = 0;
+  const char *prev = NULL;
+  unsigned int i, depth = 0;
+  int found_count = 0;
+
+  if(! entries || (count == 0))
+    return(0);
+
+  for(i = 0; i < count; ++i)
+  {
+    config_lookup_entry_t *entry = entries + i;
+    const char *path = entry->path ? entry->path : "";
+    const config_setting_t *found = setting;
+    const char *p = path;
+    size_t common = 0, pathlen = strlen(path);
+
+    if(pathlen >= capacity)
+    {
+      capacity = pathlen + 1;
+      steps = (const config_setting_t **)libconfig_realloc(
+        steps, capacity * sizeof(config_setting_t *));
+      ends = (size_t *)libconfig_realloc(ends, capacity * sizeof(size_t));
+      named = (unsigned char *)libconfig_realloc(named, capacity);
+    }
+
+    if(prev)
+    {
+      while(path[common] && (path[common] == prev[common]))
+        ++common;
+    }
+
+    /* A name only ends where the new path has a separator or ends, too. */
+    while((depth > 0)
+          && ((ends[depth - 1] > common)
+              || ((ends[depth - 1] == common) && named[depth - 1]
+                  && path[common] && !strchr(PATH_TOKENS, path[common]))))
+      --depth;
+
+    if(depth > 0)
+    {
+      found = steps[depth - 1];
+      p = path + ends[depth - 1];
+    }
+
+    while(*p && found)
+    {
+      if(strchr(PATH_TOKENS, *p))
+        ++p;
+
+      if(*p == '[')
+      {
+        char *q;
+        long index = strtol(++p, &q, 10);
+        if(*q != ']')
+        {
+          found = setting;
+          break;
+        }
+
+        p = ++q;
+        found = config_setting_get_elem(found, index);
+        named[depth] = 0;
+      }
+      else if(found->type == CONFIG_TYPE_GROUP)
+      {
+        const char *q = p;
+
+        while(*q && !strchr(PATH_TOKENS, *q))
+          ++q;
+
+        found = __config_list_search(found, p, (size_t)(q - p), NULL);
+        p = q;
+        named[depth] = 1;
+      }
+      else
+        break;
+
+      if(found)
+      {
+        steps[depth] = found;
+        ends[depth] = (size_t)(p - path);
+        ++depth;
+      }
+    }
+
+    __config_lookup_entry_store(entry,
+                                (*p || (found == setting)) ? NULL : found);
+    if(entry->status == CONFIG_LOOKUP_FOUND)
+      ++found_count;
+
+    prev = path;
+  }
+
+  __delete(named);
+  __delete(ends);
+  __delete(steps);
+
+  return(found_count);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_lookup_values(const config_t *config,
+                         config_lookup_entry_t *entries, unsigned int count)
+{
+  return(config_setting_lookup_values(config->root, entries, count));
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* The element getters read packed arrays directly, through a scratch
+ * setting, rather than make element settings for them.
+ */
+static const config_setting_t *__config_setting_peek_elem(
+  const config_setting_t *setting, int idx, config_setting_t *scratch)
+{
+  if(! config_setting_is_aggregate(setting) || (idx < 0))
+    return(NULL);
+
+  return(__config_list_peek(setting->config, __config_setting_list(setting),
+                            (unsigned int)idx, scratch));
+}
+
+/* ------------------------------------------------------------------------- */
+
 int config_setting_get_int_elem(const config_setting_t *setting, int idx)
 {
-  const config_setting_t *element = config_setting_get_elem(setting, idx);
+  config_setting_t scratch;
+  const config_setting_t *element = __config_setting_peek_elem(setting, idx,
+                                                               &scratch);
 
   return(element ? config_setting_get_int(element) : 0);
 }
@@ -1404,7 +4373,9 @@ config_setting_t *config_setting_set_int_elem(config_setting_t *setting,
 long long config_setting_get_int64_elem(const config_setting_t *setting,
                                         int idx)
 {
-  const config_setting_t *element = config_setting_get_elem(setting, idx);
+  config_setting_t scratch;
+  const config_setting_t *element = __config_setting_peek_elem(setting, idx,
+                                                               &scratch);
 
   return(element ? config_setting_get_int64(element) : 0);
 }
@@ -1445,7 +4416,9 @@ config_setting_t *config_setting_set_int64_elem(config_setting_t *setting,
 
 double config_setting_get_float_elem(const config_setting_t *setting, int idx)
 {
-  config_setting_t *element = config_setting_get_elem(setting, idx);
+  config_setting_t scratch;
+  const config_setting_t *element = __config_setting_peek_elem(setting, idx,
+                                                               &scratch);
 
   return(element ? config_setting_get_float(element) : 0.0);
 }
@@ -1484,7 +4457,9 @@ config_setting_t *config_setting_set_float_elem(config_setting_t *setting,
 
 int config_setting_get_bool_elem(const config_setting_t *setting, int idx)
 {
-  config_setting_t *element = config_setting_get_elem(setting, idx);
+  config_setting_t scratch;
+  const config_setting_t *element = __config_setting_peek_elem(setting, idx,
+                                                               &scratch);
 
   if(! element)
     return(CONFIG_FALSE);
@@ -1530,7 +4505,9 @@ config_setting_t *config_setting_set_bool_elem(config_setting_t *setting,
 const char *config_setting_get_string_elem(const config_setting_t *setting,
                                            int idx)
 {
-  config_setting_t *element = config_setting_get_elem(setting, idx);
+  config_setting_t scratch;
+  const config_setting_t *element = __config_setting_peek_elem(setting, idx,
+                                                               &scratch);
 
   if(! element)
     return(NULL);
@@ -1562,13 +4539,219 @@ config_setting_t *config_setting_set_string_elem(config_setting_t *setting,
   else
     element = config_setting_get_elem(setting, idx);
 
-  if(! element)
-    return(NULL);
+  if(! element)
+    return(NULL);
+
+  if(! config_setting_set_string(element, value))
+    return(NULL);
+
+  return(element);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Packed values of the type asked for are copied as they are; anything else
+ * is converted element by element, as the scalar getters would.
+ */
+static ptrdiff_t __config_setting_get_array(const config_setting_t *setting,
+                                            int type, void *values,
+                                            size_t count)
+{
+  const config_list_t *list;
+  const config_setting_t *element;
+  config_setting_t scratch;
+  unsigned int i;
+  int ok;
+
+  if((setting->type != CONFIG_TYPE_ARRAY)
+     && (setting->type != CONFIG_TYPE_LIST))
+    return(-1);
+
+  list = __config_setting_list(setting);
+  if(! list)
+    return(0);
+
+  if(count > list->length)
+    count = list->length;
+
+  if(! __config_list_load_elements(list) && (list->type == type))
+  {
+    if(type == CONFIG_TYPE_BOOL)
+    {
+      for(i = 0; i < count; ++i)
+        ((int *)values)[i] = ((const unsigned char *)list->values)[i];
+    }
+    else
+      memcpy(values, list->values, count * __config_array_width(type));
+
+    return((ptrdiff_t)count);
+  }
+
+  for(i = 0; i < count; ++i)
+  {
+    element = __config_list_peek(setting->config, list, i, &scratch);
+
+    switch(type)
+    {
+      case CONFIG_TYPE_INT:
+        ok = __config_setting_get_int(element, (int *)values + i);
+        break;
+
+      case CONFIG_TYPE_INT64:
+        ok = __config_setting_get_int64(element, (long long *)values + i);
+        break;
+
+      case CONFIG_TYPE_FLOAT:
+        ok = __config_setting_get_float(element, (double *)values + i);
+        break;
+
+      default:
+        ok = (element->type == CONFIG_TYPE_BOOL);
+        if(ok)
+          ((int *)values)[i] = element->value.ival;
+        break;
+    }
+
+    if(! ok)
+      return(-1);
+  }
+
+  return((ptrdiff_t)count);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __config_setting_set_array(config_setting_t *setting, int type,
+                                      const void *values, size_t count,
+                                      int append)
+{
+  const config_list_t *list;
+  unsigned int length;
+
+  if(setting->type != CONFIG_TYPE_ARRAY)
+    return(CONFIG_FALSE);
+
+  /* The length of a list is an unsigned int. */
+  list = append ? __config_setting_list(setting) : NULL;
+  length = list ? list->length : 0;
+  if(count > (size_t)(UINT_MAX - length))
+    return(CONFIG_FALSE);
+
+  if(! append)
+    __config_array_clear(setting);
+  else if(! __config_list_checktype(setting, type))
+    return(CONFIG_FALSE);
+
+  __config_array_append_values(setting, type, values, (unsigned int)count);
+
+  return(CONFIG_TRUE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+ptrdiff_t config_setting_get_int_array(const config_setting_t *setting,
+                                       int *values, size_t count)
+{
+  return(__config_setting_get_array(setting, CONFIG_TYPE_INT, values, count));
+}
+
+/* ------------------------------------------------------------------------- */
+
+ptrdiff_t config_setting_get_int64_array(const config_setting_t *setting,
+                                         long long *values, size_t count)
+{
+  return(__config_setting_get_array(setting, CONFIG_TYPE_INT64, values,
+                                    count));
+}
+
+/* ------------------------------------------------------------------------- */
+
+ptrdiff_t config_setting_get_float_array(const config_setting_t *setting,
+                                         double *values, size_t count)
+{
+  return(__config_setting_get_array(setting, CONFIG_TYPE_FLOAT, values,
+                                    count));
+}
+
+/* ------------------------------------------------------------------------- */
+
+ptrdiff_t config_setting_get_bool_array(const config_setting_t *setting,
+                                        int *values, size_t count)
+{
+  return(__config_setting_get_array(setting, CONFIG_TYPE_BOOL, values,
+                                    count));
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_setting_set_int_array(config_setting_t *setting,
+                                 const int *values, size_t count)
+{
+  return(__config_setting_set_array(setting, CONFIG_TYPE_INT, values, count,
+                                    CONFIG_FALSE));
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_setting_set_int64_array(config_setting_t *setting,
+                                   const long long *values, size_t count)
+{
+  return(__config_setting_set_array(setting, CONFIG_TYPE_INT64, values,
+                                    count, CONFIG_FALSE));
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_setting_set_float_array(config_setting_t *setting,
+                                   const double *values, size_t count)
+{
+  return(__config_setting_set_array(setting, CONFIG_TYPE_FLOAT, values,
+                                    count, CONFIG_FALSE));
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_setting_set_bool_array(config_setting_t *setting,
+                                  const int *values, size_t count)
+{
+  return(__config_setting_set_array(setting, CONFIG_TYPE_BOOL, values, count,
+                                    CONFIG_FALSE));
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_setting_append_int_array(config_setting_t *setting,
+                                    const int *values, size_t count)
+{
+  return(__config_setting_set_array(setting, CONFIG_TYPE_INT, values, count,
+                                    CONFIG_TRUE));
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_setting_append_int64_array(config_setting_t *setting,
+                                      const long long *values, size_t count)
+{
+  return(__config_setting_set_array(setting, CONFIG_TYPE_INT64, values,
+                                    count, CONFIG_TRUE));
+}
+
+/* ------------------------------------------------------------------------- */
 
-  if(! config_setting_set_string(element, value))
-    return(NULL);
+int config_setting_append_float_array(config_setting_t *setting,
+                                      const double *values, size_t count)
+{
+  return(__config_setting_set_array(setting, CONFIG_TYPE_FLOAT, values,
+                                    count, CONFIG_TRUE));
+}
 
-  return(element);
+/* ------------------------------------------------------------------------- */
+
+int config_setting_append_bool_array(config_setting_t *setting,
+                                     const int *values, size_t count)
+{
+  return(__config_setting_set_array(setting, CONFIG_TYPE_BOOL, values, count,
+                                    CONFIG_TRUE));
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1577,18 +4760,23 @@ config_setting_t *config_setting_get_elem(const config_setting_t *setting,
                                           unsigned int idx)
 {
   config_list_t *list;
+  config_setting_t **elements;
 
   if(! config_setting_is_aggregate(setting))
     return(NULL);
 
-  list = setting->value.list;
+  list = __config_setting_list(setting);
   if(! list)
     return(NULL);
 
   if(idx >= list->length)
     return(NULL);
 
-  return(list->elements[idx]);
+  elements = __config_list_load_elements(list);
+  if(! elements)
+    elements = __config_array_materialize(setting);
+
+  return(elements[idx]);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1602,7 +4790,7 @@ config_setting_t *config_setting_get_member(const config_setting_t *setting,
   if(!name)
     return(NULL);
 
-  return(__config_list_search(setting->value.list, name, strlen(name), NULL));
+  return(__config_list_search(setting, name, strlen(name), NULL));
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1629,15 +4817,26 @@ void config_set_include_func(config_t *config, config_include_fn_t func)
 
 /* ------------------------------------------------------------------------- */
 
+void config_set_include_cache(config_t *config,
+                              config_include_cache_t *cache)
+{
+  config->include_cache = cache;
+}
+
+/* ------------------------------------------------------------------------- */
+
 int config_setting_length(const config_setting_t *setting)
 {
+  const config_list_t *list;
+
   if(! config_setting_is_aggregate(setting))
     return(0);
 
-  if(! setting->value.list)
+  list = __config_setting_list(setting);
+  if(! list)
     return(0);
 
-  return(setting->value.list->length);
+  return(list->length);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1686,17 +4885,14 @@ config_setting_t *config_setting_add_with_comment(config_setting_t *parent,
 config_setting_t *config_setting_add(config_setting_t *parent,
                                      const char *name, int type)
 {
-  config_setting_add_with_comment(parent, name, type, NULL);
+  return(config_setting_add_with_comment(parent, name, type, NULL));
 }
 
 /* ------------------------------------------------------------------------- */
 
 int config_setting_remove(config_setting_t *parent, const char *name)
 {
-  unsigned int idx;
   config_setting_t *setting;
-  const char *settingName;
-  const char *lastFound;
 
   if(! parent || !name)
     return(CONFIG_FALSE);
@@ -1704,34 +4900,12 @@ int config_setting_remove(config_setting_t *parent, const char *name)
   if(parent->type != CONFIG_TYPE_GROUP)
     return(CONFIG_FALSE);
 
+  /* Only named settings can be removed by name. */
   setting = config_setting_lookup(parent, name);
-  if(! setting)
-    return(CONFIG_FALSE);
-
-  settingName = name;
-  do
-  {
-    lastFound = settingName;
-    while(settingName && !strchr(PATH_TOKENS, *settingName))
-      ++settingName;
-
-    if(*settingName == '\0')
-    {
-      settingName = lastFound;
-      break;
-    }
-
-  }
-  while(*++settingName);
-
-  if(!(setting = __config_list_search(setting->parent->value.list, settingName,
-                                      strlen(settingName), &idx)))
+  if(! setting || ! setting->name)
     return(CONFIG_FALSE);
 
-  __config_list_remove(setting->parent->value.list, idx);
-  __config_setting_destroy(setting);
-
-  return(CONFIG_TRUE);
+  return(config_setting_remove_setting(setting));
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1747,13 +4921,22 @@ int config_setting_remove_elem(config_setting_t *parent, unsigned int idx)
   if(! config_setting_is_aggregate(parent))
     return(CONFIG_FALSE);
 
-  list = parent->value.list;
+  list = __config_setting_list(parent);
   if(! list)
     return(CONFIG_FALSE);
 
   if(idx >= list->length)
     return(CONFIG_FALSE);
 
+  if(! list->elements)
+  {
+    __config_array_remove(parent->config, list, idx);
+    return(CONFIG_TRUE);
+  }
+
+  /* The packed values, if any, are stale by now. */
+  __config_array_unpack(parent);
+
   removed = __config_list_remove(list, idx);
   __config_setting_destroy(removed);
 
@@ -1762,24 +4945,257 @@ int config_setting_remove_elem(config_setting_t *parent, unsigned int idx)
 
 /* ------------------------------------------------------------------------- */
 
-int config_setting_index(const config_setting_t *setting)
+int config_setting_remove_setting(config_setting_t *setting)
 {
-  config_setting_t **found = NULL;
   config_list_t *list;
-  int i;
 
-  if(! setting->parent)
-    return(-1);
+  if(! setting || ! setting->parent)
+    return(CONFIG_FALSE);
 
   list = setting->parent->value.list;
+  __config_array_unpack(setting->parent);
+  __config_list_remove(list, (int)__config_list_position(list, setting));
+  __config_setting_destroy(setting);
+
+  return(CONFIG_TRUE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Calls the predicate on every child before any of them is removed, so that
+ * it sees the parent as it was; the elements of a packed array are passed
+ * through a scratch setting. Returns a mark for each child, or NULL if there
+ * are no children, and stores the number marked at *count.
+ */
+static unsigned char *__config_remove_if_mark(config_setting_t *parent,
+                                              const config_list_t *list,
+                                              config_predicate_fn_t predicate,
+                                              void *context,
+                                              unsigned int *count)
+{
+  const config_setting_t *element;
+  config_setting_t scratch;
+  unsigned char *marks;
+  unsigned int i;
+
+  *count = 0;
+
+  if(list->length == 0)
+    return(NULL);
+
+  marks = (unsigned char *)libconfig_calloc(list->length, 1);
+
+  for(i = 0; i < list->length; ++i)
+  {
+    if(list->elements)
+      element = list->elements[i];
+    else
+    {
+      __config_list_peek(parent->config, list, i, &scratch);
+      scratch.parent = parent;
+      scratch.line = parent->line;
+      scratch.file = parent->file;
+      scratch.position = list->position_base + i;
+      element = &scratch;
+    }
+
+    if(predicate(element, context))
+    {
+      marks[i] = 1;
+      ++(*count);
+    }
+  }
+
+  return(marks);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Packed values are compacted in place. */
+static void __config_array_remove_marked(config_t *config,
+                                         config_list_t *list,
+                                         const unsigned char *marks)
+{
+  size_t width = __config_array_width(list->type);
+  unsigned int i, j;
+
+  for(i = j = 0; i < list->length; ++i)
+  {
+    if(marks[i])
+    {
+      if(list->type == CONFIG_TYPE_STRING)
+        __config_string_free(config, ((char **)list->values)[i]);
+
+      continue;
+    }
+
+    if(j < i)
+    {
+      memcpy((char *)list->values + (j * width),
+             (char *)list->values + (i * width), width);
+
+      if(list->formats)
+        list->formats[j] = list->formats[i];
+    }
+
+    ++j;
+  }
+
+  list->length = j;
+}
+
+/* ------------------------------------------------------------------------- */
+
+unsigned int config_setting_remove_if(config_setting_t *parent,
+                                      config_predicate_fn_t predicate,
+                                      void *context)
+{
+  config_list_t *list;
+  config_setting_t *element;
+  unsigned char *marks;
+  unsigned int i, j, count;
+
+  if(! parent || ! predicate || ! config_setting_is_aggregate(parent))
+    return(0);
+
+  list = __config_setting_list(parent);
+  if(! list)
+    return(0);
 
-  for(i = 0, found = list->elements; i < (int)list->length; ++i, ++found)
+  marks = __config_remove_if_mark(parent, list, predicate, context, &count);
+  if(count == 0)
   {
-    if(*found == setting)
-      return(i);
+    __delete(marks);
+    return(0);
+  }
+
+  if(! list->elements)
+  {
+    __config_array_remove_marked(parent->config, list, marks);
+    __delete(marks);
+    return(count);
+  }
+
+  /* The packed values, if any, are stale by now. */
+  __config_array_unpack(parent);
+
+  /* Every element that is kept is renumbered. */
+  list->position_base = 0;
+
+  for(i = j = 0; i < list->length; ++i)
+  {
+    element = list->elements[i];
+
+    if(marks[i])
+    {
+      if(list->index && element->name)
+        __config_index_remove(list->index, list->index_size, element);
+
+      __config_setting_destroy(element);
+      continue;
+    }
+
+    element->position = j;
+    list->elements[j++] = element;
+  }
+
+  list->length = j;
+  __delete(marks);
+
+  return(count);
+}
+
+/* ------------------------------------------------------------------------- */
+
+config_setting_t *config_setting_copy(config_setting_t *parent,
+                                      const config_setting_t *src,
+                                      const char *name)
+{
+  return(__config_setting_copy(parent, src, name, NULL, NULL));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __config_setting_merge(config_setting_t *dst,
+                                   const config_setting_t *src, int flags)
+{
+  const config_list_t *list = __config_setting_list(src);
+  config_setting_t *member, *existing, *copy;
+  config_list_t *dlist;
+  unsigned int i, idx;
+
+  for(i = 0; list && (i < list->length); ++i)
+  {
+    member = list->elements[i];
+    existing = __config_list_search_hashed(dst, member->name,
+                                           strlen(member->name), member->hash,
+                                           &idx);
+
+    if(! existing)
+    {
+      __config_setting_attach(dst, __config_setting_clone(
+                                dst, member, member->name, member->hash,
+                                NULL, NULL));
+    }
+    else if((existing->type == CONFIG_TYPE_GROUP)
+            && (member->type == CONFIG_TYPE_GROUP))
+    {
+      __config_setting_merge(existing, member, flags);
+    }
+    else if(flags & CONFIG_MERGE_OVERRIDE)
+    {
+      /* The copy takes the overridden setting's place. */
+      copy = __config_setting_clone(dst, member, member->name, member->hash,
+                                    NULL, NULL);
+      dlist = dst->value.list;
+      dlist->elements[idx] = copy;
+      copy->position = dlist->position_base + idx;
+
+      if(dlist->index)
+      {
+        __config_index_remove(dlist->index, dlist->index_size, existing);
+        __config_index_insert(dlist->index, dlist->index_size, copy);
+      }
+
+      __config_setting_destroy(existing);
+    }
   }
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_setting_merge(config_setting_t *dst, const config_setting_t *src,
+                         int flags)
+{
+  config_setting_t *detached = NULL;
+
+  if(! dst || ! src || (dst->type != CONFIG_TYPE_GROUP)
+     || (src->type != CONFIG_TYPE_GROUP))
+    return(CONFIG_FALSE);
+
+  if(dst == src)
+    return(CONFIG_TRUE);
+
+  /* If one group lies within the other, the merge would change the tree
+   * that it reads from, so it reads from a detached copy instead.
+   */
+  if(__config_setting_within(dst, src) || __config_setting_within(src, dst))
+    src = detached = __config_setting_clone(dst, src, NULL, 0, NULL, NULL);
+
+  __config_setting_merge(dst, src, flags);
+  __config_setting_destroy(detached);
+
+  return(CONFIG_TRUE);
+}
+
+/* ------------------------------------------------------------------------- */
 
-  return(-1);
+int config_setting_index(const config_setting_t *setting)
+{
+  if(! setting->parent)
+    return(-1);
+
+  return((int)__config_list_position(setting->parent->value.list, setting));
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1828,3 +5244,249 @@ int config_setting_is_aggregate(const config_setting_t *setting)
 }
 
 /* ------------------------------------------------------------------------- */
+
+/* Compares two scalars of the same type. Two NaNs are taken to be equal, so
+ * that an unchanged NaN is not reported as modified.
+ */
+static int __config_scalar_equal(const config_setting_t *a,
+                                 const config_setting_t *b)
+{
+  switch(a->type)
+  {
+    case CONFIG_TYPE_INT:
+    case CONFIG_TYPE_BOOL:
+      return(a->value.ival == b->value.ival);
+
+    case CONFIG_TYPE_INT64:
+      return(a->value.llval == b->value.llval);
+
+    case CONFIG_TYPE_FLOAT:
+      return((a->value.fval == b->value.fval)
+             || ((a->value.fval != a->value.fval)
+                 && (b->value.fval != b->value.fval)));
+
+    case CONFIG_TYPE_STRING:
+      return((a->value.sval && b->value.sval)
+             ? ! strcmp(a->value.sval, b->value.sval)
+             : (a->value.sval == b->value.sval));
+
+    default:
+      return(CONFIG_TRUE);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the member of the group that has the given setting's name, trying
+ * the one at the same position first: groups that are read again from the
+ * same source usually have their members in the same order.
+ */
+static const config_setting_t *__config_diff_match(
+  const config_setting_t *group, unsigned int idx,
+  const config_setting_t *setting)
+{
+  const config_list_t *list = __config_setting_list(group);
+
+  if(list && (idx < list->length))
+  {
+    const config_setting_t *guess = list->elements[idx];
+
+    if((guess->hash == setting->hash) && ! strcmp(guess->name, setting->name))
+      return(guess);
+  }
+
+  return(config_setting_get_member(group, setting->name));
+}
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  strbuf_t path;
+  config_diff_fn_t fn;
+  void *context;
+  unsigned int count;
+} config_diff_state_t;
+
+/* ------------------------------------------------------------------------- */
+
+static void __config_diff_report(config_diff_state_t *state,
+                                 config_diff_t change,
+                                 const config_setting_t *old_setting,
+                                 const config_setting_t *new_setting)
+{
+  ++state->count;
+
+  if(state->fn)
+    state->fn(change, state->path.string ? state->path.string : "",
+              old_setting, new_setting, state->context);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Appends the path component for the child at the given index of the
+ * parent to the path, and returns the length to truncate the path back to.
+ */
+static size_t __config_diff_push(config_diff_state_t *state,
+                                 const config_setting_t *child,
+                                 unsigned int idx)
+{
+  size_t length = state->path.length;
+  char digits[LIBCONFIG_FORMAT_BUFSIZE];
+
+  if(length > 0)
+    libconfig_strbuf_append_char(&(state->path), '.');
+
+  if(child->name)
+    libconfig_strbuf_append_string(&(state->path), child->name);
+  else
+  {
+    libconfig_strbuf_append_char(&(state->path), '[');
+    libconfig_strbuf_append(&(state->path), digits,
+                            libconfig_format_dec(idx, digits));
+    libconfig_strbuf_append_char(&(state->path), ']');
+  }
+
+  return(length);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __config_diff_pop(config_diff_state_t *state, size_t length)
+{
+  state->path.length = length;
+  state->path.string[length] = '\0';
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __config_diff(config_diff_state_t *state,
+                          const config_setting_t *old_setting,
+                          const config_setting_t *new_setting)
+{
+  const config_list_t *old_list, *new_list;
+  unsigned int old_length, new_length, i;
+  size_t length;
+
+  if(old_setting->type != new_setting->type)
+  {
+    __config_diff_report(state, CONFIG_DIFF_MODIFIED, old_setting,
+                         new_setting);
+    return;
+  }
+
+  if(! config_setting_is_aggregate(new_setting))
+  {
+    if(! __config_scalar_equal(old_setting, new_setting))
+      __config_diff_report(state, CONFIG_DIFF_MODIFIED, old_setting,
+                           new_setting);
+    return;
+  }
+
+  old_list = __config_setting_list(old_setting);
+  new_list = __config_setting_list(new_setting);
+  old_length = old_list ? old_list->length : 0;
+  new_length = new_list ? new_list->length : 0;
+
+  if(new_setting->type == CONFIG_TYPE_GROUP)
+  {
+    /* Members are matched by name; those of the new group are reported in
+     * order, followed by the members that were removed.
+     */
+    for(i = 0; i < new_length; ++i)
+    {
+      const config_setting_t *child = new_list->elements[i];
+      const config_setting_t *match = __config_diff_match(old_setting, i,
+                                                          child);
+
+      /* Most settings are unchanged scalars; skip them without touching the
+       * path.
+       */
+      if(match && (match->type == child->type)
+         && ! config_setting_is_aggregate(child)
+         && __config_scalar_equal(match, child))
+        continue;
+
+      length = __config_diff_push(state, child, i);
+      if(match)
+        __config_diff(state, match, child);
+      else
+        __config_diff_report(state, CONFIG_DIFF_ADDED, NULL, child);
+      __config_diff_pop(state, length);
+    }
+
+    for(i = 0; i < old_length; ++i)
+    {
+      const config_setting_t *child = old_list->elements[i];
+
+      if(! __config_diff_match(new_setting, i, child))
+      {
+        length = __config_diff_push(state, child, i);
+        __config_diff_report(state, CONFIG_DIFF_REMOVED, child, NULL);
+        __config_diff_pop(state, length);
+      }
+    }
+  }
+  else
+  {
+    config_setting_t old_scratch, new_scratch;
+
+    /* Elements are matched by position. Those of packed arrays are compared
+     * where they are, and only made into settings to be reported.
+     */
+    for(i = 0; (i < old_length) || (i < new_length); ++i)
+    {
+      const config_setting_t *old_child = __config_list_peek(
+        old_setting->config, old_list, i, &old_scratch);
+      const config_setting_t *new_child = __config_list_peek(
+        new_setting->config, new_list, i, &new_scratch);
+
+      if(old_child && new_child && (old_child->type == new_child->type)
+         && ! config_setting_is_aggregate(new_child)
+         && __config_scalar_equal(old_child, new_child))
+        continue;
+
+      if(old_child == &old_scratch)
+        old_child = config_setting_get_elem(old_setting, i);
+
+      if(new_child == &new_scratch)
+        new_child = config_setting_get_elem(new_setting, i);
+
+      length = __config_diff_push(state, new_child ? new_child : old_child,
+                                  i);
+      if(! old_child)
+        __config_diff_report(state, CONFIG_DIFF_ADDED, NULL, new_child);
+      else if(! new_child)
+        __config_diff_report(state, CONFIG_DIFF_REMOVED, old_child, NULL);
+      else
+        __config_diff(state, old_child, new_child);
+      __config_diff_pop(state, length);
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+unsigned int config_diff(const config_setting_t *old_root,
+                         const config_setting_t *new_root,
+                         config_diff_fn_t fn, void *context)
+{
+  config_diff_state_t state;
+
+  __zero(&state);
+  state.fn = fn;
+  state.context = context;
+
+  if(old_root && new_root)
+    __config_diff(&state, old_root, new_root);
+  else if(new_root)
+    __config_diff_report(&state, CONFIG_DIFF_ADDED, NULL, new_root);
+  else if(old_root)
+    __config_diff_report(&state, CONFIG_DIFF_REMOVED, old_root, NULL);
+
+  __delete(libconfig_strbuf_release(&(state.path)));
+
+  return(state.count);
+}
+
+/* ------------------------------------------------------------------------- */
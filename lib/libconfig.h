@@ -40,9 +40,10 @@ extern "C" {
 #endif /* WIN32 */
 
 #define LIBCONFIG_VER_MAJOR    1
-#define LIBCONFIG_VER_MINOR    7
-#define LIBCONFIG_VER_REVISION 4
+#define LIBCONFIG_VER_MINOR    8
+#define LIBCONFIG_VER_REVISION 0
 
+#include <stddef.h>
 #include <stdio.h>
 
 #define CONFIG_TYPE_NONE    0
@@ -67,6 +68,17 @@ extern "C" {
 #define CONFIG_OPTION_ALLOW_SCIENTIFIC_NOTATION       0x20
 #define CONFIG_OPTION_FSYNC                           0x40
 #define CONFIG_OPTION_ALLOW_OVERRIDES                 0x80
+#define CONFIG_OPTION_ARENA                           0x100
+#define CONFIG_OPTION_INTERN_NAMES                    0x200
+#define CONFIG_OPTION_INTERN_STRINGS                  0x400
+#define CONFIG_OPTION_SHORTEST_FLOATS                 0x800
+#define CONFIG_OPTION_DIRECT_PARSER                   0x1000
+#define CONFIG_OPTION_PARALLEL_INCLUDES               0x2000
+#define CONFIG_OPTION_LAZY_LOAD                       0x4000
+
+#define CONFIG_BINARY_SOURCE_INFO 0x01
+
+#define CONFIG_MERGE_OVERRIDE 0x01
 
 #define CONFIG_TRUE  (1)
 #define CONFIG_FALSE (0)
@@ -92,6 +104,8 @@ typedef struct config_setting_t
   unsigned int line;
   const char *file;
   char *comment;
+  unsigned int hash;
+  unsigned int position;
 } config_setting_t;
 
 typedef enum
@@ -104,7 +118,15 @@ typedef enum
 typedef struct config_list_t
 {
   unsigned int length;
+  unsigned int capacity;
   config_setting_t **elements;
+  unsigned int index_size;
+  config_setting_t **index;
+  void *values;
+  unsigned char *formats;
+  unsigned short type;
+  struct config_lazy_body_t *lazy;
+  unsigned int position_base;
 } config_list_t;
 
 typedef const char ** (*config_include_fn_t)(struct config_t *,
@@ -114,6 +136,48 @@ typedef const char ** (*config_include_fn_t)(struct config_t *,
 
 typedef void (*config_fatal_error_fn_t)(const char *);
 
+typedef struct config_include_cache_t config_include_cache_t;
+typedef struct config_reloader_t config_reloader_t;
+
+typedef enum
+{
+  CONFIG_DIFF_ADDED = 0,
+  CONFIG_DIFF_REMOVED = 1,
+  CONFIG_DIFF_MODIFIED = 2
+} config_diff_t;
+
+typedef void (*config_diff_fn_t)(config_diff_t change, const char *path,
+                                 const config_setting_t *old_setting,
+                                 const config_setting_t *new_setting,
+                                 void *context);
+
+typedef int (*config_predicate_fn_t)(const config_setting_t *setting,
+                                     void *context);
+
+typedef struct config_path_t config_path_t;
+
+typedef enum
+{
+  CONFIG_LOOKUP_FOUND = 0,
+  CONFIG_LOOKUP_NOT_FOUND = 1,
+  CONFIG_LOOKUP_TYPE_MISMATCH = 2
+} config_lookup_status_t;
+
+typedef struct config_lookup_entry_t
+{
+  const char *path;
+  int type;
+  void *value;
+  union
+  {
+    int ival;
+    long long llval;
+    double fval;
+    const char *sval;
+  } default_value;
+  config_lookup_status_t status;
+} config_lookup_entry_t;
+
 typedef struct config_t
 {
   config_setting_t *root;
@@ -130,6 +194,10 @@ typedef struct config_t
   config_error_t error_type;
   const char **filenames;
   void *hook;
+  struct config_arena_t *arena;
+  struct config_strpool_t *strpool;
+  config_include_cache_t *include_cache;
+  struct config_lazy_t *lazy;
 } config_t;
 
 extern LIBCONFIG_API int config_read(config_t *config, FILE *stream);
@@ -145,12 +213,27 @@ extern LIBCONFIG_API void config_set_option(config_t *config, int option,
                                             int flag);
 extern LIBCONFIG_API int config_get_option(const config_t *config, int option);
 
+extern LIBCONFIG_API const char *config_lazy_error(const config_t *config,
+                                                   const char **file,
+                                                   int *line);
+
 extern LIBCONFIG_API int config_read_string(config_t *config, const char *str);
+extern LIBCONFIG_API int config_read_buffer(config_t *config, char *buffer,
+                                            size_t length);
 
 extern LIBCONFIG_API int config_read_file(config_t *config,
                                           const char *filename);
 extern LIBCONFIG_API int config_write_file(config_t *config,
                                            const char *filename);
+extern LIBCONFIG_API char *config_write_string(const config_t *config,
+                                              size_t *length);
+extern LIBCONFIG_API size_t config_write_buffer(const config_t *config,
+                                                char *buffer, size_t size);
+
+extern LIBCONFIG_API int config_read_binary(config_t *config,
+                                            const char *filename);
+extern LIBCONFIG_API int config_write_binary(config_t *config,
+                                             const char *filename, int flags);
 
 extern LIBCONFIG_API void config_set_destructor(config_t *config,
                                                 void (*destructor)(void *));
@@ -159,6 +242,29 @@ extern LIBCONFIG_API void config_set_include_dir(config_t *config,
 extern LIBCONFIG_API void config_set_include_func(config_t *config,
                                                   config_include_fn_t func);
 
+extern LIBCONFIG_API config_include_cache_t *config_include_cache_create(void);
+extern LIBCONFIG_API void config_include_cache_destroy(
+  config_include_cache_t *cache);
+extern LIBCONFIG_API void config_include_cache_get_stats(
+  const config_include_cache_t *cache, unsigned long *hits,
+  unsigned long *misses);
+extern LIBCONFIG_API void config_set_include_cache(
+  config_t *config, config_include_cache_t *cache);
+
+typedef void (*config_reloader_setup_fn_t)(config_t *config, void *context);
+
+extern LIBCONFIG_API config_reloader_t *config_reloader_create(
+  const char *filename, config_reloader_setup_fn_t setup, void *context);
+extern LIBCONFIG_API void config_reloader_destroy(
+  config_reloader_t *reloader);
+extern LIBCONFIG_API int config_reloader_check(config_reloader_t *reloader);
+extern LIBCONFIG_API int config_reloader_reload(config_reloader_t *reloader);
+extern LIBCONFIG_API const config_t *config_reloader_get_failure(
+  const config_reloader_t *reloader);
+extern LIBCONFIG_API const config_t *config_reloader_acquire(
+  config_reloader_t *reloader);
+extern LIBCONFIG_API void config_reloader_release(const config_t *config);
+
 extern LIBCONFIG_API void config_set_float_precision(config_t *config,
                                                      unsigned short digits);
 extern LIBCONFIG_API unsigned short config_get_float_precision(
@@ -240,19 +346,58 @@ extern LIBCONFIG_API config_setting_t *config_setting_set_bool_elem(
 extern LIBCONFIG_API config_setting_t *config_setting_set_string_elem(
   config_setting_t *setting, int idx, const char *value);
 
+extern LIBCONFIG_API ptrdiff_t config_setting_get_int_array(
+  const config_setting_t *setting, int *values, size_t count);
+extern LIBCONFIG_API ptrdiff_t config_setting_get_int64_array(
+  const config_setting_t *setting, long long *values, size_t count);
+extern LIBCONFIG_API ptrdiff_t config_setting_get_float_array(
+  const config_setting_t *setting, double *values, size_t count);
+extern LIBCONFIG_API ptrdiff_t config_setting_get_bool_array(
+  const config_setting_t *setting, int *values, size_t count);
+
+extern LIBCONFIG_API int config_setting_set_int_array(
+  config_setting_t *setting, const int *values, size_t count);
+extern LIBCONFIG_API int config_setting_set_int64_array(
+  config_setting_t *setting, const long long *values, size_t count);
+extern LIBCONFIG_API int config_setting_set_float_array(
+  config_setting_t *setting, const double *values, size_t count);
+extern LIBCONFIG_API int config_setting_set_bool_array(
+  config_setting_t *setting, const int *values, size_t count);
+
+extern LIBCONFIG_API int config_setting_append_int_array(
+  config_setting_t *setting, const int *values, size_t count);
+extern LIBCONFIG_API int config_setting_append_int64_array(
+  config_setting_t *setting, const long long *values, size_t count);
+extern LIBCONFIG_API int config_setting_append_float_array(
+  config_setting_t *setting, const double *values, size_t count);
+extern LIBCONFIG_API int config_setting_append_bool_array(
+  config_setting_t *setting, const int *values, size_t count);
+
 extern LIBCONFIG_API const char **config_default_include_func(
     config_t *config, const char *include_dir, const char *path,
     const char **error);
 
+extern LIBCONFIG_API const char **config_glob_include_func(
+    config_t *config, const char *include_dir, const char *path,
+    const char **error);
+
 extern LIBCONFIG_API int config_setting_is_scalar(
     const config_setting_t *setting);
 
 extern LIBCONFIG_API int config_setting_is_aggregate(
     const config_setting_t *setting);
 
+extern LIBCONFIG_API unsigned int config_diff(
+  const config_setting_t *old_root, const config_setting_t *new_root,
+  config_diff_fn_t fn, void *context);
+
 #define /* const char * */ config_get_include_dir(/* const config_t * */ C) \
   ((C)->include_dir)
 
+#define /* config_include_cache_t * */ config_get_include_cache( \
+  /* const config_t * */ C)                                      \
+  ((C)->include_cache)
+
 #define /* void */ config_set_auto_convert(/* config_t * */ C, F) \
   config_set_option((C), CONFIG_OPTION_AUTOCONVERT, (F))
 #define /* int */ config_get_auto_convert(/* const config_t * */ C) \
@@ -303,6 +448,15 @@ extern LIBCONFIG_API int config_setting_remove(config_setting_t *parent,
                                                const char *name);
 extern LIBCONFIG_API int config_setting_remove_elem(config_setting_t *parent,
                                                     unsigned int idx);
+extern LIBCONFIG_API int config_setting_remove_setting(
+  config_setting_t *setting);
+extern LIBCONFIG_API unsigned int config_setting_remove_if(
+  config_setting_t *parent, config_predicate_fn_t predicate, void *context);
+extern LIBCONFIG_API config_setting_t *config_setting_copy(
+  config_setting_t *parent, const config_setting_t *src, const char *name);
+extern LIBCONFIG_API int config_setting_merge(config_setting_t *dst,
+                                              const config_setting_t *src,
+                                              int flags);
 extern LIBCONFIG_API void config_setting_set_hook(config_setting_t *setting,
                                                   void *hook);
 
@@ -318,6 +472,14 @@ extern LIBCONFIG_API config_setting_t *config_setting_lookup(
 extern LIBCONFIG_API const config_setting_t *config_setting_lookup_const(
   const config_setting_t *setting, const char *path);
 
+extern LIBCONFIG_API config_path_t *config_path_compile(const char *path);
+extern LIBCONFIG_API void config_path_free(config_path_t *path);
+
+extern LIBCONFIG_API config_setting_t *config_lookup_path(
+  const config_t *config, const config_path_t *path);
+extern LIBCONFIG_API config_setting_t *config_setting_lookup_path(
+  const config_setting_t *setting, const config_path_t *path);
+
 extern LIBCONFIG_API int config_lookup_int(const config_t *config,
                                            const char *path, int *value);
 extern LIBCONFIG_API int config_lookup_int64(const config_t *config,
@@ -331,6 +493,13 @@ extern LIBCONFIG_API int config_lookup_string(const config_t *config,
                                               const char *path,
                                               const char **value);
 
+extern LIBCONFIG_API int config_lookup_values(const config_t *config,
+                                              config_lookup_entry_t *entries,
+                                              unsigned int count);
+extern LIBCONFIG_API int config_setting_lookup_values(
+  const config_setting_t *setting, config_lookup_entry_t *entries,
+  unsigned int count);
+
 #define /* config_setting_t * */ config_root_setting( \
   /* const config_t * */ C)                           \
   ((C)->root)
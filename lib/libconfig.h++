@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
 #if defined(LIBCONFIGXX_STATIC)
@@ -40,8 +41,8 @@
 #endif /* WIN32 */
 
 #define LIBCONFIGXX_VER_MAJOR    1
-#define LIBCONFIGXX_VER_MINOR    7
-#define LIBCONFIGXX_VER_REVISION 4
+#define LIBCONFIGXX_VER_MINOR    8
+#define LIBCONFIGXX_VER_REVISION 0
 
 #if __cplusplus < 201103L
 #define LIBCONFIGXX_NOEXCEPT throw()
@@ -51,6 +52,7 @@
 
 struct config_t; // fwd decl
 struct config_setting_t; // fwd decl
+struct config_path_t; // fwd decl
 
 namespace libconfig {
 
@@ -169,6 +171,142 @@ class LIBCONFIGXX_API ParseException : public ConfigException
   const char *_error;
 };
 
+class LIBCONFIGXX_API Path
+{
+  friend class Config;
+  friend class Setting;
+
+  public:
+
+  explicit Path(const char *path);
+  explicit Path(const std::string &path);
+
+  Path(const Path &other);
+  Path & operator=(const Path &other);
+
+  ~Path();
+
+  inline const char *c_str() const
+  { return(_path.c_str()); }
+
+  inline bool isValid() const
+  { return(_compiled != NULL); }
+
+  private:
+
+  std::string _path;
+  config_path_t *_compiled;
+};
+
+class LIBCONFIGXX_API LookupValue
+{
+  friend class Config;
+  friend class Setting;
+
+  public:
+
+  enum Status
+  {
+    StatusFound = 0,
+    StatusNotFound,
+    StatusTypeMismatch
+  };
+
+  LookupValue(const char *path, bool &value, bool defaultValue = false);
+  LookupValue(const char *path, int &value, int defaultValue = 0);
+  LookupValue(const char *path, unsigned int &value,
+              unsigned int defaultValue = 0);
+  LookupValue(const char *path, long long &value,
+              long long defaultValue = 0);
+  LookupValue(const char *path, unsigned long long &value,
+              unsigned long long defaultValue = 0);
+  LookupValue(const char *path, double &value, double defaultValue = 0.0);
+  LookupValue(const char *path, float &value, float defaultValue = 0.0f);
+  LookupValue(const char *path, const char *&value,
+              const char *defaultValue = NULL);
+  LookupValue(const char *path, std::string &value,
+              const std::string &defaultValue = std::string());
+
+  inline const char *getPath() const
+  { return(_path); }
+
+  inline Status getStatus() const
+  { return(_status); }
+
+  inline bool isFound() const
+  { return(_status == StatusFound); }
+
+  private:
+
+  enum Kind
+  {
+    KindBool,
+    KindInt,
+    KindUnsignedInt,
+    KindInt64,
+    KindUnsignedInt64,
+    KindDouble,
+    KindFloat,
+    KindCString,
+    KindString
+  };
+
+  void assign(const Setting *setting);
+
+  const char *_path;
+  Kind _kind;
+  void *_value;
+  union
+  {
+    bool bval;
+    int ival;
+    unsigned int uval;
+    long long llval;
+    unsigned long long ullval;
+    double dval;
+    float fval;
+    const char *sval;
+  } _default;
+  std::string _defaultString;
+  Status _status;
+};
+
+class LIBCONFIGXX_API SettingChange
+{
+  friend class Setting;
+
+  public:
+
+  enum Type
+  {
+    ChangeAdded = 0,
+    ChangeRemoved,
+    ChangeModified
+  };
+
+  inline Type getType() const
+  { return(_type); }
+
+  inline const std::string &getPath() const
+  { return(_path); }
+
+  inline const Setting *getOldSetting() const
+  { return(_oldSetting); }
+
+  inline const Setting *getNewSetting() const
+  { return(_newSetting); }
+
+  private:
+
+  SettingChange(Type type, const char *path, const Setting *oldSetting,
+                const Setting *newSetting);
+
+  Type _type;
+  std::string _path;
+  const Setting *_oldSetting;
+  const Setting *_newSetting;
+};
+
 class LIBCONFIGXX_API Setting
 {
   friend class Config;
@@ -236,6 +374,12 @@ class LIBCONFIGXX_API Setting
   inline Setting & lookup(const std::string &path) const
   { return(lookup(path.c_str())); }
 
+  Setting & lookup(const Path &path) const;
+
+  int lookupValues(LookupValue *lookups, unsigned int count) const;
+
+  std::vector<SettingChange> diff(const Setting &newSetting) const;
+
   Setting & operator[](const char *name) const;
 
   inline Setting & operator[](const std::string &name) const
@@ -295,6 +439,40 @@ class LIBCONFIGXX_API Setting
 
   Setting & add(Type type);
 
+  Setting & add(const char *name, const Setting &setting);
+
+  inline Setting & add(const std::string &name, const Setting &setting)
+  { return(add(name.c_str(), setting)); }
+
+  Setting & add(const Setting &setting);
+
+  void merge(const Setting &setting, bool override = true);
+
+  void getArray(std::vector<int> &values) const;
+  void getArray(std::vector<long long> &values) const;
+  void getArray(std::vector<double> &values) const;
+  void getArray(std::vector<bool> &values) const;
+
+  template<typename T>
+  inline std::vector<T> getArray() const
+  {
+    std::vector<T> values;
+    getArray(values);
+    return(values);
+  }
+
+  void setArray(const int *values, size_t count);
+  void setArray(const long long *values, size_t count);
+  void setArray(const double *values, size_t count);
+  void setArray(const std::vector<bool> &values);
+
+  template<typename T>
+  inline void setArray(const std::vector<T> &values)
+  {
+    setArray(values.empty() ? static_cast<const T *>(NULL) : &values[0],
+             values.size());
+  }
+
   bool exists(const char *name) const;
 
   inline bool exists(const std::string &name) const
@@ -479,7 +657,14 @@ class LIBCONFIGXX_API Config
     OptionOpenBraceOnSeparateLine = 0x10,
     OptionAllowScientificNotation = 0x20,
     OptionFsync = 0x40,
-    OptionAllowOverrides = 0x80
+    OptionAllowOverrides = 0x80,
+    OptionArena = 0x100,
+    OptionInternNames = 0x200,
+    OptionInternStrings = 0x400,
+    OptionShortestFloats = 0x800,
+    OptionDirectParser = 0x1000,
+    OptionParallelIncludes = 0x2000,
+    OptionLazyLoad = 0x4000
   };
 
   Config();
@@ -516,11 +701,14 @@ class LIBCONFIGXX_API Config
 
   void read(FILE *stream);
   void write(FILE *stream) const;
+  std::string writeString() const;
 
   void readString(const char *str);
   inline void readString(const std::string &str)
   { return(readString(str.c_str())); }
 
+  void readBuffer(char *buffer, size_t length);
+
   void readFile(const char *filename);
   inline void readFile(const std::string &filename)
   { readFile(filename.c_str()); }
@@ -529,14 +717,27 @@ class LIBCONFIGXX_API Config
   inline void writeFile(const std::string &filename)
   { writeFile(filename.c_str()); }
 
+  void readBinary(const char *filename);
+  inline void readBinary(const std::string &filename)
+  { readBinary(filename.c_str()); }
+
+  void writeBinary(const char *filename, bool sourceInfo = false);
+  inline void writeBinary(const std::string &filename,
+                          bool sourceInfo = false)
+  { writeBinary(filename.c_str(), sourceInfo); }
+
   Setting & lookup(const char *path) const;
   inline Setting & lookup(const std::string &path) const
   { return(lookup(path.c_str())); }
 
+  Setting & lookup(const Path &path) const;
+
   bool exists(const char *path) const;
   inline bool exists(const std::string &path) const
   { return(exists(path.c_str())); }
 
+  bool exists(const Path &path) const;
+
   bool lookupValue(const char *path, bool &value) const;
   bool lookupValue(const char *path, int &value) const;
   bool lookupValue(const char *path, unsigned int &value) const;
@@ -575,6 +776,8 @@ class LIBCONFIGXX_API Config
   inline bool lookupValue(const std::string &path, std::string &value) const
   { return(lookupValue(path.c_str(), value)); }
 
+  int lookupValues(LookupValue *lookups, unsigned int count) const;
+
   Setting & getRoot() const;
 
   private:
@@ -32,6 +32,7 @@
 #include <cstring>
 #include <cstdlib>
 #include <sstream>
+#include <vector>
 
 namespace libconfig {
 
@@ -49,6 +50,43 @@ static const char **__include_func(config_t *config,
 
 // ---------------------------------------------------------------------------
 
+// Setting wrappers are created on first access and published through the
+// setting's hook with a compare-and-swap, so that threads reading the same
+// configuration concurrently see either no wrapper or a fully constructed
+// one, and all agree on which.
+
+static void *__load_hook(config_setting_t *setting)
+{
+#if defined(_MSC_VER)
+  return(InterlockedCompareExchangePointer(&(setting->hook), NULL, NULL));
+#else
+  return(__atomic_load_n(&(setting->hook), __ATOMIC_ACQUIRE));
+#endif
+}
+
+// ---------------------------------------------------------------------------
+
+// Installs the hook if the setting has none yet, and returns the hook that
+// is installed afterwards.
+
+static void *__publish_hook(config_setting_t *setting, void *hook)
+{
+#if defined(_MSC_VER)
+  void *prev = InterlockedCompareExchangePointer(&(setting->hook), hook,
+                                                 NULL);
+  return(prev ? prev : hook);
+#else
+  void *expected = NULL;
+  if(__atomic_compare_exchange_n(&(setting->hook), &expected, hook, false,
+                                 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    return(hook);
+
+  return(expected);
+#endif
+}
+
+// ---------------------------------------------------------------------------
+
 static void __fatal_error_func(const char *message)
 {
   // Assume memory allocation failure; this is the only fatal error
@@ -400,6 +438,203 @@ void Config::ConfigDestructor(void *arg)
 
 // ---------------------------------------------------------------------------
 
+Path::Path(const char *path)
+  : _path(path),
+    _compiled(config_path_compile(path))
+{
+}
+
+// ---------------------------------------------------------------------------
+
+Path::Path(const std::string &path)
+  : _path(path),
+    _compiled(config_path_compile(path.c_str()))
+{
+}
+
+// ---------------------------------------------------------------------------
+
+Path::Path(const Path &other)
+  : _path(other._path),
+    _compiled(config_path_compile(other._path.c_str()))
+{
+}
+
+// ---------------------------------------------------------------------------
+
+Path & Path::operator=(const Path &other)
+{
+  if(&other != this)
+  {
+    config_path_t *compiled = config_path_compile(other._path.c_str());
+
+    config_path_free(_compiled);
+    _path = other._path;
+    _compiled = compiled;
+  }
+
+  return(*this);
+}
+
+// ---------------------------------------------------------------------------
+
+Path::~Path()
+{
+  config_path_free(_compiled);
+}
+
+// ---------------------------------------------------------------------------
+
+#define LOOKUP_VALUE_CONSTRUCTOR(T, K, M)                       \
+  LookupValue::LookupValue(const char *path, T &value, T defaultValue) \
+    : _path(path),                                                \
+      _kind(K),                                                   \
+      _value(&value),                                             \
+      _status(StatusNotFound)                                     \
+  {                                                               \
+    _default.M = defaultValue;                                    \
+  }
+
+LOOKUP_VALUE_CONSTRUCTOR(bool, KindBool, bval)
+LOOKUP_VALUE_CONSTRUCTOR(int, KindInt, ival)
+LOOKUP_VALUE_CONSTRUCTOR(unsigned int, KindUnsignedInt, uval)
+LOOKUP_VALUE_CONSTRUCTOR(long long, KindInt64, llval)
+LOOKUP_VALUE_CONSTRUCTOR(unsigned long long, KindUnsignedInt64, ullval)
+LOOKUP_VALUE_CONSTRUCTOR(double, KindDouble, dval)
+LOOKUP_VALUE_CONSTRUCTOR(float, KindFloat, fval)
+LOOKUP_VALUE_CONSTRUCTOR(const char *, KindCString, sval)
+
+#undef LOOKUP_VALUE_CONSTRUCTOR
+
+// ---------------------------------------------------------------------------
+
+LookupValue::LookupValue(const char *path, std::string &value,
+                         const std::string &defaultValue)
+  : _path(path),
+    _kind(KindString),
+    _value(&value),
+    _defaultString(defaultValue),
+    _status(StatusNotFound)
+{
+  _default.sval = NULL;
+}
+
+// ---------------------------------------------------------------------------
+
+// Converts the setting exactly as Config::lookupValue() would, falling back
+// to the default if the setting is missing or can't be converted.
+
+void LookupValue::assign(const Setting *setting)
+{
+  if(setting)
+  {
+    try
+    {
+      switch(_kind)
+      {
+        case KindBool:
+          *static_cast<bool *>(_value) = (bool)*setting;
+          break;
+
+        case KindInt:
+          *static_cast<int *>(_value) = (int)*setting;
+          break;
+
+        case KindUnsignedInt:
+          *static_cast<unsigned int *>(_value) = (unsigned int)*setting;
+          break;
+
+        case KindInt64:
+          *static_cast<long long *>(_value) = (long long)*setting;
+          break;
+
+        case KindUnsignedInt64:
+          *static_cast<unsigned long long *>(_value)
+            = (unsigned long long)*setting;
+          break;
+
+        case KindDouble:
+          *static_cast<double *>(_value) = (double)*setting;
+          break;
+
+        case KindFloat:
+          *static_cast<float *>(_value) = (float)*setting;
+          break;
+
+        case KindCString:
+          *static_cast<const char **>(_value) = (const char *)*setting;
+          break;
+
+        case KindString:
+          *static_cast<std::string *>(_value) = (const char *)*setting;
+          break;
+      }
+
+      _status = StatusFound;
+      return;
+    }
+    catch(const ConfigException &)
+    {
+      _status = StatusTypeMismatch;
+    }
+  }
+  else
+    _status = StatusNotFound;
+
+  switch(_kind)
+  {
+    case KindBool:
+      *static_cast<bool *>(_value) = _default.bval;
+      break;
+
+    case KindInt:
+      *static_cast<int *>(_value) = _default.ival;
+      break;
+
+    case KindUnsignedInt:
+      *static_cast<unsigned int *>(_value) = _default.uval;
+      break;
+
+    case KindInt64:
+      *static_cast<long long *>(_value) = _default.llval;
+      break;
+
+    case KindUnsignedInt64:
+      *static_cast<unsigned long long *>(_value) = _default.ullval;
+      break;
+
+    case KindDouble:
+      *static_cast<double *>(_value) = _default.dval;
+      break;
+
+    case KindFloat:
+      *static_cast<float *>(_value) = _default.fval;
+      break;
+
+    case KindCString:
+      *static_cast<const char **>(_value) = _default.sval;
+      break;
+
+    case KindString:
+      *static_cast<std::string *>(_value) = _defaultString;
+      break;
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+SettingChange::SettingChange(Type type, const char *path,
+                             const Setting *oldSetting,
+                             const Setting *newSetting)
+  : _type(type),
+    _path(path),
+    _oldSetting(oldSetting),
+    _newSetting(newSetting)
+{
+}
+
+// ---------------------------------------------------------------------------
+
 Config::Config()
   : _defaultFormat(Setting::FormatDefault)
 {
@@ -554,6 +789,14 @@ void Config::readString(const char *str)
 
 // ---------------------------------------------------------------------------
 
+void Config::readBuffer(char *buffer, size_t length)
+{
+  if(! config_read_buffer(_config, buffer, length))
+    handleError();
+}
+
+// ---------------------------------------------------------------------------
+
 void Config::write(FILE *stream) const
 {
   config_write(_config, stream);
@@ -561,6 +804,19 @@ void Config::write(FILE *stream) const
 
 // ---------------------------------------------------------------------------
 
+std::string Config::writeString() const
+{
+  size_t length = 0;
+  char *text = config_write_string(_config, &length);
+
+  std::string str(text, length);
+  std::free(text);
+
+  return(str);
+}
+
+// ---------------------------------------------------------------------------
+
 void Config::readFile(const char *filename)
 {
   if(! config_read_file(_config, filename))
@@ -577,6 +833,23 @@ void Config::writeFile(const char *filename)
 
 // ---------------------------------------------------------------------------
 
+void Config::readBinary(const char *filename)
+{
+  if(! config_read_binary(_config, filename))
+    handleError();
+}
+
+// ---------------------------------------------------------------------------
+
+void Config::writeBinary(const char *filename, bool sourceInfo)
+{
+  if(! config_write_binary(_config, filename,
+                           sourceInfo ? CONFIG_BINARY_SOURCE_INFO : 0))
+    handleError();
+}
+
+// ---------------------------------------------------------------------------
+
 Setting & Config::lookup(const char *path) const
 {
   config_setting_t *s = config_lookup(_config, path);
@@ -588,6 +861,17 @@ Setting & Config::lookup(const char *path) const
 
 // ---------------------------------------------------------------------------
 
+Setting & Config::lookup(const Path &path) const
+{
+  config_setting_t *s = config_lookup_path(_config, path._compiled);
+  if(! s)
+    throw SettingNotFoundException(path.c_str());
+
+  return(Setting::wrapSetting(s));
+}
+
+// ---------------------------------------------------------------------------
+
 bool Config::exists(const char *path) const
 {
   config_setting_t *s = config_lookup(_config, path);
@@ -597,6 +881,15 @@ bool Config::exists(const char *path) const
 
 // ---------------------------------------------------------------------------
 
+bool Config::exists(const Path &path) const
+{
+  config_setting_t *s = config_lookup_path(_config, path._compiled);
+
+  return(s != NULL);
+}
+
+// ---------------------------------------------------------------------------
+
 #define CONFIG_LOOKUP_NO_EXCEPTIONS(P, T, V)    \
   try                                           \
   {                                             \
@@ -674,6 +967,13 @@ bool Config::lookupValue(const char *path, std::string &value) const
 
 // ---------------------------------------------------------------------------
 
+int Config::lookupValues(LookupValue *lookups, unsigned int count) const
+{
+  return(getRoot().lookupValues(lookups, count));
+}
+
+// ---------------------------------------------------------------------------
+
 Setting & Config::getRoot() const
 {
   return(Setting::wrapSetting(config_root_setting(_config)));
@@ -1012,6 +1312,99 @@ Setting & Setting::lookup(const char *path) const
 
 // ---------------------------------------------------------------------------
 
+Setting & Setting::lookup(const Path &path) const
+{
+  assertType(TypeGroup);
+
+  config_setting_t *setting = config_setting_lookup_path(_setting,
+                                                         path._compiled);
+
+  if(! setting)
+    throw SettingNotFoundException(*this, path.c_str());
+
+  return(wrapSetting(setting));
+}
+
+// ---------------------------------------------------------------------------
+
+int Setting::lookupValues(LookupValue *lookups, unsigned int count) const
+{
+  if(count == 0)
+    return(0);
+
+  std::vector<config_lookup_entry_t> entries(count);
+  std::vector<config_setting_t *> found(count);
+
+  for(unsigned int i = 0; i < count; ++i)
+  {
+    entries[i].path = lookups[i]._path;
+    entries[i].type = CONFIG_TYPE_NONE;
+    entries[i].value = &found[i];
+  }
+
+  config_setting_lookup_values(_setting, &entries[0], count);
+
+  int n = 0;
+  for(unsigned int i = 0; i < count; ++i)
+  {
+    lookups[i].assign(found[i] ? &wrapSetting(found[i]) : NULL);
+    if(lookups[i].isFound())
+      ++n;
+  }
+
+  return(n);
+}
+
+// ---------------------------------------------------------------------------
+
+// The C callback cannot wrap the settings itself, so it only collects them.
+
+struct DiffEntry
+{
+  config_diff_t change;
+  std::string path;
+  config_setting_t *oldSetting;
+  config_setting_t *newSetting;
+};
+
+static void __diff_func(config_diff_t change, const char *path,
+                        const config_setting_t *oldSetting,
+                        const config_setting_t *newSetting, void *context)
+{
+  DiffEntry entry;
+
+  entry.change = change;
+  entry.path = path;
+  entry.oldSetting = const_cast<config_setting_t *>(oldSetting);
+  entry.newSetting = const_cast<config_setting_t *>(newSetting);
+
+  static_cast<std::vector<DiffEntry> *>(context)->push_back(entry);
+}
+
+// ---------------------------------------------------------------------------
+
+std::vector<SettingChange> Setting::diff(const Setting &newSetting) const
+{
+  std::vector<DiffEntry> entries;
+  std::vector<SettingChange> changes;
+
+  config_diff(_setting, newSetting._setting, __diff_func, &entries);
+
+  changes.reserve(entries.size());
+  for(std::vector<DiffEntry>::const_iterator it = entries.begin();
+      it != entries.end(); ++it)
+  {
+    changes.push_back(SettingChange(
+      static_cast<SettingChange::Type>(it->change), it->path.c_str(),
+      it->oldSetting ? &wrapSetting(it->oldSetting) : NULL,
+      it->newSetting ? &wrapSetting(it->newSetting) : NULL));
+  }
+
+  return(changes);
+}
+
+// ---------------------------------------------------------------------------
+
 Setting & Setting::operator[](const char *name) const
 {
   assertType(TypeGroup);
@@ -1304,6 +1697,141 @@ Setting & Setting::add(Setting::Type type)
 
 // ---------------------------------------------------------------------------
 
+Setting & Setting::add(const char *name, const Setting &setting)
+{
+  assertType(TypeGroup);
+
+  config_setting_t *s = config_setting_copy(_setting, setting._setting, name);
+
+  if(! s)
+    throw SettingNameException(*this, name);
+
+  return(wrapSetting(s));
+}
+
+// ---------------------------------------------------------------------------
+
+Setting & Setting::add(const Setting &setting)
+{
+  if((_type != TypeArray) && (_type != TypeList))
+    throw SettingTypeException(*this);
+
+  config_setting_t *s = config_setting_copy(_setting, setting._setting, NULL);
+
+  if(! s)
+    throw SettingTypeException(*this, getLength());
+
+  return(wrapSetting(s));
+}
+
+// ---------------------------------------------------------------------------
+
+void Setting::merge(const Setting &setting, bool override)
+{
+  assertType(TypeGroup);
+  setting.assertType(TypeGroup);
+
+  config_setting_merge(_setting, setting._setting,
+                       override ? CONFIG_MERGE_OVERRIDE : 0);
+}
+
+// ---------------------------------------------------------------------------
+
+void Setting::getArray(std::vector<int> &values) const
+{
+  if((_type != TypeArray) && (_type != TypeList))
+    throw SettingTypeException(*this);
+
+  values.resize(getLength());
+  if(config_setting_get_int_array(_setting, values.empty() ? NULL
+                                  : &values[0], values.size()) < 0)
+    throw SettingTypeException(*this);
+}
+
+// ---------------------------------------------------------------------------
+
+void Setting::getArray(std::vector<long long> &values) const
+{
+  if((_type != TypeArray) && (_type != TypeList))
+    throw SettingTypeException(*this);
+
+  values.resize(getLength());
+  if(config_setting_get_int64_array(_setting, values.empty() ? NULL
+                                    : &values[0], values.size()) < 0)
+    throw SettingTypeException(*this);
+}
+
+// ---------------------------------------------------------------------------
+
+void Setting::getArray(std::vector<double> &values) const
+{
+  if((_type != TypeArray) && (_type != TypeList))
+    throw SettingTypeException(*this);
+
+  values.resize(getLength());
+  if(config_setting_get_float_array(_setting, values.empty() ? NULL
+                                    : &values[0], values.size()) < 0)
+    throw SettingTypeException(*this);
+}
+
+// ---------------------------------------------------------------------------
+
+void Setting::getArray(std::vector<bool> &values) const
+{
+  std::vector<int> ivalues;
+
+  if((_type != TypeArray) && (_type != TypeList))
+    throw SettingTypeException(*this);
+
+  ivalues.resize(getLength());
+  if(config_setting_get_bool_array(_setting, ivalues.empty() ? NULL
+                                   : &ivalues[0], ivalues.size()) < 0)
+    throw SettingTypeException(*this);
+
+  values.assign(ivalues.begin(), ivalues.end());
+}
+
+// ---------------------------------------------------------------------------
+
+void Setting::setArray(const int *values, size_t count)
+{
+  assertType(TypeArray);
+
+  config_setting_set_int_array(_setting, values, count);
+}
+
+// ---------------------------------------------------------------------------
+
+void Setting::setArray(const long long *values, size_t count)
+{
+  assertType(TypeArray);
+
+  config_setting_set_int64_array(_setting, values, count);
+}
+
+// ---------------------------------------------------------------------------
+
+void Setting::setArray(const double *values, size_t count)
+{
+  assertType(TypeArray);
+
+  config_setting_set_float_array(_setting, values, count);
+}
+
+// ---------------------------------------------------------------------------
+
+void Setting::setArray(const std::vector<bool> &values)
+{
+  std::vector<int> ivalues(values.begin(), values.end());
+
+  assertType(TypeArray);
+
+  config_setting_set_bool_array(_setting, ivalues.empty() ? NULL
+                                : &ivalues[0], ivalues.size());
+}
+
+// ---------------------------------------------------------------------------
+
 void Setting::assertType(Setting::Type type) const
 {
   if(type != _type)
@@ -1318,18 +1846,17 @@ void Setting::assertType(Setting::Type type) const
 
 Setting & Setting::wrapSetting(config_setting_t *s)
 {
-  Setting *setting = NULL;
-
-  void *hook = config_setting_get_hook(s);
+  void *hook = __load_hook(s);
   if(! hook)
   {
-    setting = new Setting(s);
-    config_setting_set_hook(s, reinterpret_cast<void *>(setting));
+    Setting *setting = new Setting(s);
+
+    hook = __publish_hook(s, reinterpret_cast<void *>(setting));
+    if(hook != reinterpret_cast<void *>(setting))
+      delete setting; // another thread got there first
   }
-  else
-    setting = reinterpret_cast<Setting *>(hook);
 
-  return(*setting);
+  return(*reinterpret_cast<Setting *>(hook));
 }
 
 // ---------------------------------------------------------------------------
@@ -0,0 +1,125 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#include "mapfile.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if ! defined(_WIN32)
+#include <unistd.h>
+#endif
+
+/* The initial buffer size for reading a stream. */
+#define MAPFILE_STREAM_BLOCK_SIZE 4096
+
+/* ------------------------------------------------------------------------- */
+
+int libconfig_mapfile_open(mapfile_t *map, int fd)
+{
+#if defined(_WIN32)
+
+  /* Files are read through text-mode streams, which translate line endings. */
+  __zero(map);
+  return(0);
+
+#else
+
+  struct stat st;
+  size_t length, done = 0;
+
+  __zero(map);
+
+  if((fstat(fd, &st) != 0) || ! S_ISREG(st.st_mode))
+    return(0);
+
+  /* Only as much as the file held when it was opened is read; if it grows or
+   * shrinks meanwhile, the contents are cut short, and the trailing NUL bytes
+   * are still there.
+   */
+  length = (size_t)st.st_size;
+  map->data = (char *)libconfig_malloc(length + 2);
+
+  while(done < length)
+  {
+    ssize_t r = pread(fd, map->data + done, length - done, (off_t)done);
+    if(r < 0)
+    {
+      __delete(map->data);
+      __zero(map);
+      return(0);
+    }
+
+    if(r == 0)
+      break; /* the file shrank */
+
+    done += (size_t)r;
+  }
+
+  map->data[done] = map->data[done + 1] = '\0';
+  map->length = done;
+
+  return(1);
+
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_mapfile_read_stream(mapfile_t *map, FILE *stream)
+{
+  size_t capacity = MAPFILE_STREAM_BLOCK_SIZE;
+
+  __zero(map);
+  map->data = (char *)libconfig_malloc(capacity);
+
+  for(;;)
+  {
+    size_t r;
+
+    if(capacity - map->length <= 2)
+    {
+      capacity *= 2;
+      map->data = (char *)libconfig_realloc(map->data, capacity);
+    }
+
+    r = fread(map->data + map->length, 1, capacity - map->length - 2, stream);
+    if(r == 0)
+      break;
+
+    map->length += r;
+  }
+
+  map->data[map->length] = map->data[map->length + 1] = '\0';
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_mapfile_close(mapfile_t *map)
+{
+  __delete(map->data);
+  __zero(map);
+}
+
+/* ------------------------------------------------------------------------- */
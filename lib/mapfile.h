@@ -0,0 +1,59 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __libconfig_mapfile_h
+#define __libconfig_mapfile_h
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+
+/*
+ * The contents of a file, held in memory so that the scanner can scan them in
+ * place with yy_scan_buffer(). The contents are followed by two NUL bytes,
+ * which are not included in the length.
+ */
+typedef struct
+{
+  char *data;
+  size_t length;
+} mapfile_t;
+
+/*
+ * Reads the regular file open on the descriptor fd into a buffer, in one
+ * piece. The file is not mapped: a mapping of a file that another process
+ * truncates would fault while it is being scanned. Returns non-zero on
+ * success, and zero if the file is not a regular file, if this is not
+ * supported on the platform, or if reading the file failed; the file should
+ * then be read as a stream.
+ */
+extern int libconfig_mapfile_open(mapfile_t *map, int fd);
+
+/*
+ * Reads the rest of the stream into a buffer, for input that is not a
+ * regular file. Reading stops at the end of the stream or at the first error.
+ */
+extern void libconfig_mapfile_read_stream(mapfile_t *map, FILE *stream);
+
+extern void libconfig_mapfile_close(mapfile_t *map);
+
+#endif /* __libconfig_mapfile_h */
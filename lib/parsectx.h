@@ -43,7 +43,35 @@ struct parse_context
 
 #define libconfig_parsectx_append_string(C, S) \
   libconfig_strbuf_append_string(&((C)->string), (S))
+#define libconfig_parsectx_adopt_string(C, S) \
+  libconfig_strbuf_take_string(&((C)->string), (S))
 #define libconfig_parsectx_take_string(C) \
-  libconfig_strbuf_release(&((C)->string))
+  libconfig_strbuf_release_trimmed(&((C)->string))
+
+/* Defined in libconfig.c. Like config_setting_set_string(), but takes
+ * ownership of the malloc'd value rather than copying it.
+ */
+extern int libconfig_setting_take_string(config_setting_t *setting,
+                                         char *value);
+
+/* Defined in libconfig.c. Appends a scalar of the given type and format to
+ * the array or list, taking ownership of a malloc'd string value. Returns
+ * CONFIG_FALSE if the type does not fit. The new element is returned through
+ * "element", unless the array holds it packed, in which case that is set to
+ * NULL.
+ */
+extern int libconfig_setting_append(config_setting_t *parent, int type,
+                                    config_value_t value,
+                                    unsigned short format,
+                                    config_setting_t **element);
+
+/* Defined in libconfig.c. Defers the parsing of the body of the group, array
+ * or list, which runs from text up to and including its closing token and
+ * starts on the given line of the file, until the setting is first accessed.
+ * The text must stay in memory for as long as the configuration does.
+ */
+extern void libconfig_setting_defer(config_setting_t *setting,
+                                    const char *text, size_t length,
+                                    int line, const char *file);
 
 #endif /* __libconfig_parsectx_h */
@@ -0,0 +1,1328 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+
+#include "parser.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fastscan.h"
+#include "util.h"
+
+/* ------------------------------------------------------------------------- */
+
+/* The parser reads the input with a small hand-written lexer, one token
+ * ahead at most, and builds the setting tree as it goes. The lexer follows
+ * the rules in scanner.l, including the ones that are easy to overlook: the
+ * lexer state carries over from an included file into the file that included
+ * it, and an @include directive must start its line. The parser reads a
+ * lookahead token at exactly the points where the generated parser does, so
+ * that settings record the same source lines, errors are reported on the same
+ * line, and included files are grafted from the include cache in the same
+ * places.
+ */
+
+static const char *err_syntax = "syntax error";
+static const char *err_array_elem_type = "mismatched element type in array";
+static const char *err_duplicate_setting = "duplicate setting name";
+
+enum
+{
+  TOKEN_NONE = -1,
+  TOKEN_CONTINUE = -2,
+  TOKEN_EOF = 0,
+  TOKEN_ERROR,
+  TOKEN_GARBAGE,
+  TOKEN_NAME,
+  TOKEN_STRING,
+  TOKEN_BOOLEAN,
+  TOKEN_INTEGER,
+  TOKEN_INTEGER64,
+  TOKEN_HEX,
+  TOKEN_HEX64,
+  TOKEN_BIN,
+  TOKEN_BIN64,
+  TOKEN_FLOAT,
+  TOKEN_EQUALS,
+  TOKEN_COMMA,
+  TOKEN_SEMICOLON,
+  TOKEN_GROUP_START,
+  TOKEN_GROUP_END,
+  TOKEN_ARRAY_START,
+  TOKEN_ARRAY_END,
+  TOKEN_LIST_START,
+  TOKEN_LIST_END
+};
+
+enum
+{
+  STATE_INITIAL,
+  STATE_LINE_COMMENT,
+  STATE_BLOCK_COMMENT,
+  STATE_STRING,
+  STATE_INCLUDE
+};
+
+struct source
+{
+  const char *start;
+  const char *end;
+  const char *pos;
+  int line;
+};
+
+struct parser
+{
+  struct parse_context *ctx;
+  struct scan_context *scan_ctx;
+  config_t *config;
+  /* Where a syntax error is stored: in the configuration, or for a deferred
+   * body, in the caller's variables.
+   */
+  const char **error_text;
+  int *error_line;
+  struct source source;
+  /* The positions to resume at in the files on the include stack. */
+  struct source parents[MAX_INCLUDE_DEPTH];
+  int state;
+  int token;
+  int last; /* the last token consumed */
+  config_value_t value;
+  strbuf_t text; /* the text of the last name or number */
+  /* Set when the input is only scanned for its @include directives. */
+  parser_include_fn_t visit;
+  void *visit_context;
+  /* Set when the bodies of aggregates in the top-level input may be left
+   * unparsed until they are accessed.
+   */
+  int lazy;
+};
+
+/* Bodies shorter than this are parsed straight away, as deferring them would
+ * cost more than it saves.
+ */
+#define PARSER_LAZY_MIN_BODY 128
+#define PARSER_LAZY_MAX_DEPTH 64
+
+#define PARSER_IS_DIGIT(C) \
+  (((C) >= '0') && ((C) <= '9'))
+
+#define PARSER_IS_HEX_DIGIT(C) \
+  (PARSER_IS_DIGIT(C) || (((C) >= 'a') && ((C) <= 'f')) \
+   || (((C) >= 'A') && ((C) <= 'F')))
+
+#define PARSER_IS_NAME_START(C) \
+  ((((C) >= 'a') && ((C) <= 'z')) || (((C) >= 'A') && ((C) <= 'Z')) \
+   || ((C) == '*'))
+
+#define PARSER_IS_NAME(C) \
+  (PARSER_IS_NAME_START(C) || PARSER_IS_DIGIT(C) || ((C) == '-') \
+   || ((C) == '_'))
+
+/* ------------------------------------------------------------------------- */
+
+static void __parser_open(struct parser *p)
+{
+  size_t length;
+  const char *text = libconfig_scanctx_load_current_buffer(p->scan_ctx,
+                                                           &length);
+
+  p->source.start = p->source.pos = text;
+  p->source.end = text + length;
+  p->source.line = 1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __parser_include_error(struct parser *p, const char *error)
+{
+  p->config->error_text = error;
+  p->config->error_file = libconfig_scanctx_current_filename(p->scan_ctx);
+  p->config->error_line = p->source.line;
+
+  return(TOKEN_ERROR);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __parser_include(struct parser *p)
+{
+  struct scan_context *scan_ctx = p->scan_ctx;
+  const char *error = NULL;
+  char *path = libconfig_scanctx_take_string(scan_ctx);
+  FILE *fp;
+
+  if(p->visit)
+  {
+    p->visit(path, p->visit_context);
+    __delete(path);
+    p->state = STATE_INITIAL;
+    return(TOKEN_CONTINUE);
+  }
+
+  fp = libconfig_scanctx_push_include(scan_ctx,
+                                      p->parents + scan_ctx->stack_depth,
+                                      path, p->source.pos, &error);
+  __delete(path);
+
+  if(fp)
+  {
+    p->parents[scan_ctx->stack_depth - 1] = p->source;
+    __parser_open(p);
+  }
+  else if(error)
+    return(__parser_include_error(p, error));
+
+  p->state = STATE_INITIAL;
+  return(TOKEN_CONTINUE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Moves on to the next file in the current include list, or back to the file
+ * that included it.
+ */
+
+static int __parser_end_of_input(struct parser *p)
+{
+  const char *error = NULL;
+  struct source *parent;
+
+  if(libconfig_scanctx_next_include_file(p->scan_ctx, &error))
+  {
+    __parser_open(p);
+    return(TOKEN_CONTINUE);
+  }
+
+  if(error)
+    return(__parser_include_error(p, error));
+
+  parent = (struct source *)libconfig_scanctx_pop_include(p->scan_ctx);
+  if(! parent)
+    return(TOKEN_EOF);
+
+  p->source = *parent;
+  return(TOKEN_CONTINUE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __parser_hex_value(char c)
+{
+  if(PARSER_IS_DIGIT(c))
+    return(c - '0');
+
+  return((c | 0x20) - 'a' + 10);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Appends the escape sequence at s to the string being read, and returns the
+ * position after it. A backslash that starts no escape sequence stands for
+ * itself.
+ */
+
+static const char *__parser_escape(struct parser *p, const char *s)
+{
+  char c;
+
+  switch(s[1])
+  {
+    case 'a': c = '\a'; break;
+    case 'b': c = '\b'; break;
+    case 'n': c = '\n'; break;
+    case 'r': c = '\r'; break;
+    case 't': c = '\t'; break;
+    case 'v': c = '\v'; break;
+    case 'f': c = '\f'; break;
+    case '\\': c = '\\'; break;
+    case '\"': c = '\"'; break;
+
+    case 'x':
+    case 'X':
+      if(PARSER_IS_HEX_DIGIT(s[2]) && PARSER_IS_HEX_DIGIT(s[3]))
+      {
+        c = (char)((__parser_hex_value(s[2]) << 4)
+                   | __parser_hex_value(s[3]));
+        libconfig_scanctx_append_char(p->scan_ctx, c);
+        return(s + 4);
+      }
+      /* fall through */
+
+    default:
+      libconfig_scanctx_append_char(p->scan_ctx, '\\');
+      return(s + 1);
+  }
+
+  libconfig_scanctx_append_char(p->scan_ctx, c);
+  return(s + 2);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns non-zero if the '@' at s is preceded only by spaces and tabs on its
+ * line.
+ */
+
+static int __parser_at_line_start(const struct parser *p, const char *s)
+{
+  while((s > p->source.start) && ((s[-1] == ' ') || (s[-1] == '\t')))
+    --s;
+
+  return((s == p->source.start) || (s[-1] == '\n'));
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the length of the "@include" directive at s, up to and including
+ * the opening quote of its argument, or 0 if there is none.
+ */
+
+static size_t __parser_match_include(const char *s)
+{
+  const char *e = s + 8;
+
+  if(strncmp(s, "@include", 8) != 0)
+    return(0);
+
+  if((*e != ' ') && (*e != '\t'))
+    return(0);
+
+  while((*e == ' ') || (*e == '\t'))
+    ++e;
+
+  return((*e == '\"') ? (size_t)(e + 1 - s) : 0);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const char *__parser_exponent(const char *s)
+{
+  const char *e = s + 1;
+
+  if((*s != 'e') && (*s != 'E'))
+    return(s);
+
+  if((*e == '-') || (*e == '+'))
+    ++e;
+
+  if(! PARSER_IS_DIGIT(*e))
+    return(s);
+
+  while(PARSER_IS_DIGIT(*e))
+    ++e;
+
+  return(e);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Matches the longest number at s, choosing between the integer, binary,
+ * hexadecimal and float forms as the scanner does, and converts it.
+ */
+
+static int __parser_number(struct parser *p, const char *s)
+{
+  const char *d = s, *e, *f = NULL;
+  size_t len = 0;
+  int token = TOKEN_GARBAGE;
+  int ok;
+
+  if((*d == '-') || (*d == '+'))
+    ++d;
+
+  for(e = d; PARSER_IS_DIGIT(*e); ++e);
+
+  if(e > d)
+  {
+    token = TOKEN_INTEGER;
+    len = (size_t)(e - s);
+
+    if(*e == 'L')
+    {
+      token = TOKEN_INTEGER64;
+      len += (e[1] == 'L') ? 2 : 1;
+    }
+  }
+
+  /* Binary and hexadecimal numbers have no sign. */
+  if((d == s) && (s[0] == '0'))
+  {
+    const char *b = s + 2;
+
+    if((s[1] == 'b') || (s[1] == 'B'))
+    {
+      while((*b == '0') || (*b == '1'))
+        ++b;
+
+      if(b > s + 2)
+        token = TOKEN_BIN;
+    }
+    else if((s[1] == 'x') || (s[1] == 'X'))
+    {
+      while(PARSER_IS_HEX_DIGIT(*b))
+        ++b;
+
+      if(b > s + 2)
+        token = TOKEN_HEX;
+    }
+
+    if(b > s + 2)
+    {
+      len = (size_t)(b - s);
+
+      if(*b == 'L')
+      {
+        ++token; /* TOKEN_BIN64 or TOKEN_HEX64 */
+        len += (b[1] == 'L') ? 2 : 1;
+      }
+    }
+  }
+
+  if(*e == '.')
+  {
+    for(f = e + 1; PARSER_IS_DIGIT(*f); ++f);
+    f = __parser_exponent(f);
+  }
+  else if(e > d)
+  {
+    f = __parser_exponent(e);
+    if(f == e)
+      f = NULL;
+  }
+
+  if(f && ((size_t)(f - s) > len))
+  {
+    token = TOKEN_FLOAT;
+    len = (size_t)(f - s);
+  }
+
+  if(token == TOKEN_GARBAGE)
+  {
+    p->source.pos = s + 1;
+    return(token);
+  }
+
+  p->source.pos = s + len;
+  p->text.length = 0;
+  libconfig_strbuf_append(&(p->text), s, len);
+
+  switch(token)
+  {
+    case TOKEN_INTEGER:
+      p->value.llval = libconfig_parse_integer(p->text.string, &ok, 0);
+      if(! ok)
+        return(TOKEN_ERROR);
+
+      if((p->value.llval < INT_MIN) || (p->value.llval > INT_MAX))
+        return(TOKEN_INTEGER64);
+
+      p->value.ival = (int)p->value.llval;
+      return(TOKEN_INTEGER);
+
+    case TOKEN_INTEGER64:
+      p->value.llval = libconfig_parse_integer(p->text.string, &ok, 1);
+      return(ok ? TOKEN_INTEGER64 : TOKEN_ERROR);
+
+    case TOKEN_BIN:
+    case TOKEN_HEX:
+      p->value.llval = (long long)((token == TOKEN_BIN)
+        ? libconfig_parse_bin64(p->text.string, &ok, 0)
+        : libconfig_parse_hex64(p->text.string, &ok, 0));
+      if(! ok)
+        return(TOKEN_ERROR);
+
+      if((unsigned long long)p->value.llval < INT_MAX)
+      {
+        p->value.ival = (int)p->value.llval;
+        return(token);
+      }
+
+      return(token + 1); /* TOKEN_BIN64 or TOKEN_HEX64 */
+
+    case TOKEN_BIN64:
+    case TOKEN_HEX64:
+      p->value.llval = (long long)((token == TOKEN_BIN64)
+        ? libconfig_parse_bin64(p->text.string, &ok, 1)
+        : libconfig_parse_hex64(p->text.string, &ok, 1));
+      return(ok ? token : TOKEN_ERROR);
+
+    default: /* TOKEN_FLOAT */
+      p->value.fval = atof(p->text.string);
+      return(TOKEN_FLOAT);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __parser_name(struct parser *p, const char *s)
+{
+  const char *e = s + 1;
+  size_t len;
+
+  while(PARSER_IS_NAME(*e))
+    ++e;
+
+  len = (size_t)(e - s);
+  p->source.pos = e;
+
+  if((len == 4) && ((s[0] | 0x20) == 't') && ((s[1] | 0x20) == 'r')
+     && ((s[2] | 0x20) == 'u') && ((s[3] | 0x20) == 'e'))
+  {
+    p->value.ival = 1;
+    return(TOKEN_BOOLEAN);
+  }
+
+  if((len == 5) && ((s[0] | 0x20) == 'f') && ((s[1] | 0x20) == 'a')
+     && ((s[2] | 0x20) == 'l') && ((s[3] | 0x20) == 's')
+     && ((s[4] | 0x20) == 'e'))
+  {
+    p->value.ival = 0;
+    return(TOKEN_BOOLEAN);
+  }
+
+  p->text.length = 0;
+  libconfig_strbuf_append(&(p->text), s, len);
+  return(TOKEN_NAME);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reads the next token in the INITIAL state, or returns TOKEN_CONTINUE if it
+ * reached the start of a comment, string or include directive.
+ */
+
+static int __parser_token(struct parser *p)
+{
+  struct source *src = &(p->source);
+  const char *s = libconfig_fastscan_blank(src->pos, src->end,
+                                           &(src->line));
+  size_t n;
+
+  src->pos = s + 1;
+
+  if(s == src->end)
+  {
+    src->pos = s;
+    return(TOKEN_CONTINUE);
+  }
+
+  switch(*s)
+  {
+    case '=':
+    case ':':
+      return(TOKEN_EQUALS);
+
+    case ',':
+      return(TOKEN_COMMA);
+
+    case ';':
+      return(TOKEN_SEMICOLON);
+
+    case '{':
+      return(TOKEN_GROUP_START);
+
+    case '}':
+      return(TOKEN_GROUP_END);
+
+    case '[':
+      return(TOKEN_ARRAY_START);
+
+    case ']':
+      return(TOKEN_ARRAY_END);
+
+    case '(':
+      return(TOKEN_LIST_START);
+
+    case ')':
+      return(TOKEN_LIST_END);
+
+    case '\"':
+      p->state = STATE_STRING;
+      return(TOKEN_CONTINUE);
+
+    case '#':
+      p->state = STATE_LINE_COMMENT;
+      return(TOKEN_CONTINUE);
+
+    case '/':
+      if(s[1] == '/')
+        p->state = STATE_LINE_COMMENT;
+      else if(s[1] == '*')
+        p->state = STATE_BLOCK_COMMENT;
+      else
+        return(TOKEN_GARBAGE);
+
+      src->pos = s + 2;
+      return(TOKEN_CONTINUE);
+
+    case '@':
+      if(__parser_at_line_start(p, s) && (n = __parser_match_include(s)))
+      {
+        p->state = STATE_INCLUDE;
+        src->pos = s + n;
+        return(TOKEN_CONTINUE);
+      }
+
+      return(TOKEN_GARBAGE);
+
+    case '-':
+    case '+':
+    case '.':
+      return(__parser_number(p, s));
+
+    default:
+      if(PARSER_IS_DIGIT(*s))
+        return(__parser_number(p, s));
+
+      if(PARSER_IS_NAME_START(*s))
+        return(__parser_name(p, s));
+
+      return(TOKEN_GARBAGE);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __parser_lex(struct parser *p)
+{
+  struct source *src = &(p->source);
+
+  for(;;)
+  {
+    const char *s = src->pos;
+    const char *run;
+    int token;
+
+    if(s == src->end)
+    {
+      token = __parser_end_of_input(p);
+      if(token != TOKEN_CONTINUE)
+        return(token);
+
+      continue;
+    }
+
+    switch(p->state)
+    {
+      case STATE_INITIAL:
+        token = __parser_token(p);
+        if(token != TOKEN_CONTINUE)
+          return(token);
+
+        break;
+
+      case STATE_LINE_COMMENT:
+        s = libconfig_fastscan_eol(s, src->end, &(src->line));
+        if((s < src->end) && (*s == '\n'))
+        {
+          ++(src->line);
+          p->state = STATE_INITIAL;
+        }
+
+        /* Otherwise this is the end of the input, or a NUL within it. */
+        src->pos = (s < src->end) ? s + 1 : s;
+        break;
+
+      case STATE_BLOCK_COMMENT:
+        s = libconfig_fastscan_comment(s, src->end, &(src->line));
+        if(((src->end - s) >= 2) && (s[0] == '*') && (s[1] == '/'))
+        {
+          p->state = STATE_INITIAL;
+          ++s;
+        }
+
+        src->pos = (s < src->end) ? s + 1 : s;
+        break;
+
+      case STATE_STRING:
+        for(run = s;; ++s)
+        {
+          s = libconfig_fastscan_string(s, src->end, &(src->line));
+          if((s == src->end) || (*s != '\0'))
+            break;
+        }
+
+        if(s > run)
+          libconfig_scanctx_append(p->scan_ctx, run, (size_t)(s - run));
+
+        if(s == src->end)
+          src->pos = s;
+        else if(*s == '\"')
+        {
+          src->pos = s + 1;
+          p->state = STATE_INITIAL;
+          p->value.sval = libconfig_scanctx_take_string(p->scan_ctx);
+          return(TOKEN_STRING);
+        }
+        else
+          src->pos = __parser_escape(p, s);
+
+        break;
+
+      case STATE_INCLUDE:
+        for(run = s; (s < src->end) && (*s != '\"') && (*s != '\\'); ++s)
+        {
+          if(*s == '\n')
+            ++(src->line);
+        }
+
+        if(s > run)
+          libconfig_scanctx_append(p->scan_ctx, run, (size_t)(s - run));
+
+        src->pos = s;
+        if(s == src->end)
+          break;
+
+        if(*s == '\"')
+        {
+          src->pos = s + 1;
+          token = __parser_include(p);
+          if(token != TOKEN_CONTINUE)
+            return(token);
+
+          break;
+        }
+
+        /* A backslash escapes a backslash or a quote, and is dropped
+         * otherwise.
+         */
+        if((s[1] == '\\') || (s[1] == '\"'))
+        {
+          libconfig_scanctx_append_char(p->scan_ctx, s[1]);
+          ++s;
+        }
+
+        src->pos = s + 1;
+        break;
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __parser_peek(struct parser *p)
+{
+  if(p->token == TOKEN_NONE)
+    p->token = __parser_lex(p);
+
+  return(p->token);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __parser_consume(struct parser *p)
+{
+  p->last = p->token;
+  p->token = TOKEN_NONE;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __parser_error(struct parser *p, const char *message)
+{
+  if(! *(p->error_text))
+  {
+    *(p->error_line) = p->source.line;
+    *(p->error_text) = message;
+  }
+
+  return(0);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __parser_capture_pos(struct parser *p, config_setting_t *setting)
+{
+  setting->line = (unsigned int)p->source.line;
+  setting->file = libconfig_scanctx_current_filename(p->scan_ctx);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reads a scalar value into the setting, or appends it to the array or list
+ * if setting is NULL.
+ */
+
+static int __parser_scalar(struct parser *p, config_setting_t *aggregate,
+                           config_setting_t *setting)
+{
+  int token = __parser_peek(p);
+  config_value_t value = p->value;
+  unsigned short format = CONFIG_FORMAT_DEFAULT;
+  int type;
+  config_setting_t *e;
+
+  switch(token)
+  {
+    case TOKEN_BOOLEAN:
+      type = CONFIG_TYPE_BOOL;
+      break;
+
+    case TOKEN_INTEGER:
+    case TOKEN_HEX:
+    case TOKEN_BIN:
+      type = CONFIG_TYPE_INT;
+      break;
+
+    case TOKEN_INTEGER64:
+    case TOKEN_HEX64:
+    case TOKEN_BIN64:
+      type = CONFIG_TYPE_INT64;
+      break;
+
+    case TOKEN_FLOAT:
+      type = CONFIG_TYPE_FLOAT;
+      break;
+
+    case TOKEN_STRING:
+      type = CONFIG_TYPE_STRING;
+      break;
+
+    default:
+      return(__parser_error(p, err_syntax));
+  }
+
+  if((token == TOKEN_HEX) || (token == TOKEN_HEX64))
+    format = CONFIG_FORMAT_HEX;
+  else if((token == TOKEN_BIN) || (token == TOKEN_BIN64))
+    format = CONFIG_FORMAT_BIN;
+
+  __parser_consume(p);
+
+  /* Adjacent string literals are concatenated; the lookahead that ends the
+   * string is read before the value is stored.
+   */
+  if(token == TOKEN_STRING)
+  {
+    libconfig_parsectx_adopt_string(p->ctx, value.sval);
+    while(__parser_peek(p) == TOKEN_STRING)
+    {
+      libconfig_parsectx_adopt_string(p->ctx, p->value.sval);
+      __parser_consume(p);
+    }
+
+    value.sval = libconfig_parsectx_take_string(p->ctx);
+  }
+
+  if(! setting)
+  {
+    if(! libconfig_setting_append(aggregate, type, value, format, &e))
+    {
+      if(type == CONFIG_TYPE_STRING)
+        __delete(value.sval);
+
+      return(__parser_error(p, err_array_elem_type));
+    }
+
+    if(e)
+      __parser_capture_pos(p, e);
+
+    return(1);
+  }
+
+  /* The setting was just added, and so has no type yet; there is nothing
+   * for the public setters to check.
+   */
+  if(type == CONFIG_TYPE_STRING)
+  {
+    if(! libconfig_setting_take_string(setting, value.sval))
+      __delete(value.sval);
+
+    return(1);
+  }
+
+  setting->type = (unsigned short)type;
+  setting->value = value;
+  if((type == CONFIG_TYPE_INT) || (type == CONFIG_TYPE_INT64))
+    setting->format = format;
+
+  return(1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __parser_value(struct parser *p, config_setting_t *aggregate,
+                          config_setting_t *setting);
+
+static int __parser_settings(struct parser *p, config_setting_t *group,
+                             int nested);
+
+/* Reads the elements of an array or list, up to and including the closing
+ * token.
+ */
+
+static int __parser_elements(struct parser *p, config_setting_t *aggregate,
+                             int end)
+{
+  int array = (aggregate->type == CONFIG_TYPE_ARRAY);
+
+  if(__parser_peek(p) == end)
+  {
+    __parser_consume(p);
+    return(1);
+  }
+
+  for(;;)
+  {
+    if(! (array ? __parser_scalar(p, aggregate, NULL)
+          : __parser_value(p, aggregate, NULL)))
+      return(0);
+
+    if(__parser_peek(p) != TOKEN_COMMA)
+    {
+      if(p->token != end)
+        return(__parser_error(p, err_syntax));
+
+      break;
+    }
+
+    /* After the first element, commas may be repeated, and may trail. */
+    while(__parser_peek(p) == TOKEN_COMMA)
+      __parser_consume(p);
+
+    if(p->token == end)
+      break;
+  }
+
+  __parser_consume(p);
+  return(1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Finds the end of the body of an aggregate, given the character that closes
+ * it, by matching brackets and skipping over strings and comments, without
+ * parsing it or reading past end. Returns the position after the closing
+ * character, and adds the newlines it passed to *lines; or returns NULL if
+ * the body holds anything that the match cannot account for, such as a
+ * directive, a NUL byte or a mismatched bracket, if it is nested too deeply,
+ * or if the input ends first.
+ */
+
+static const char *__parser_skip_body(const char *s, const char *end,
+                                      char close, int *lines)
+{
+  char stack[PARSER_LAZY_MAX_DEPTH];
+  int depth = 0;
+
+  for(; s < end; ++s)
+  {
+    switch(*s)
+    {
+      case '\0':
+      case '@':
+        return(NULL);
+
+      case '\n':
+        ++(*lines);
+        break;
+
+      case '{':
+      case '[':
+      case '(':
+        if(depth == PARSER_LAZY_MAX_DEPTH)
+          return(NULL);
+
+        stack[depth++] = close;
+        close = (*s == '{') ? '}' : ((*s == '[') ? ']' : ')');
+        break;
+
+      case '}':
+      case ']':
+      case ')':
+        if(*s != close)
+          return(NULL);
+
+        if(depth == 0)
+          return(s + 1);
+
+        close = stack[--depth];
+        break;
+
+      case '\"':
+        /* As in __parser_escape(), a backslash escapes only a backslash or
+         * a quote here; other sequences cannot hide one.
+         */
+        for(++s;;)
+        {
+          s = libconfig_fastscan_string(s, end, lines);
+          if((s == end) || (*s != '\\'))
+            break;
+
+          s += (((end - s) >= 2) && ((s[1] == '\\') || (s[1] == '\"')))
+            ? 2 : 1;
+        }
+
+        if((s == end) || (*s != '\"'))
+          return(NULL);
+
+        break;
+
+      case '#':
+        s = libconfig_fastscan_eol(s, end, lines) - 1;
+        break;
+
+      case '/':
+        if((end - s) < 2)
+          return(NULL);
+
+        if(s[1] == '/')
+          s = libconfig_fastscan_eol(s, end, lines) - 1;
+        else if(s[1] == '*')
+        {
+          s = libconfig_fastscan_comment(s + 2, end, lines);
+          if(((end - s) < 2) || (s[0] != '*') || (s[1] != '/'))
+            return(NULL);
+
+          ++s;
+        }
+
+        break;
+    }
+  }
+
+  return(NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Leaves the body of the aggregate that was just opened to be parsed when
+ * the setting is first accessed, and moves past it as though it had been
+ * parsed. Returns zero if the body is to be parsed now instead.
+ */
+
+static int __parser_defer(struct parser *p, config_setting_t *setting)
+{
+  struct source *src = &(p->source);
+  const char *end;
+  int lines = 0, token;
+  char close;
+
+  switch(setting->type)
+  {
+    case CONFIG_TYPE_ARRAY:
+      close = ']';
+      token = TOKEN_ARRAY_END;
+      break;
+
+    case CONFIG_TYPE_LIST:
+      close = ')';
+      token = TOKEN_LIST_END;
+      break;
+
+    default:
+      close = '}';
+      token = TOKEN_GROUP_END;
+      break;
+  }
+
+  end = __parser_skip_body(src->pos, src->end, close, &lines);
+  if(! end || ((size_t)(end - src->pos) < PARSER_LAZY_MIN_BODY))
+    return(0);
+
+  libconfig_setting_defer(setting, src->pos, (size_t)(end - src->pos),
+                          src->line,
+                          libconfig_scanctx_current_filename(p->scan_ctx));
+
+  src->pos = end;
+  src->line += lines;
+  p->last = token;
+
+  if(token == TOKEN_GROUP_END)
+    p->scan_ctx->include_parent = NULL;
+
+  return(1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reads a value into the setting, or appends it to the list if setting is
+ * NULL.
+ */
+
+static int __parser_value(struct parser *p, config_setting_t *aggregate,
+                          config_setting_t *setting)
+{
+  int token = __parser_peek(p);
+  int type;
+
+  switch(token)
+  {
+    case TOKEN_ARRAY_START:
+      type = CONFIG_TYPE_ARRAY;
+      break;
+
+    case TOKEN_LIST_START:
+      type = CONFIG_TYPE_LIST;
+      break;
+
+    case TOKEN_GROUP_START:
+      type = CONFIG_TYPE_GROUP;
+      break;
+
+    default:
+      return(__parser_scalar(p, aggregate, setting));
+  }
+
+  __parser_consume(p);
+
+  if(setting)
+    setting->type = type;
+  else
+  {
+    setting = config_setting_add(aggregate, NULL, type);
+    __parser_capture_pos(p, setting);
+  }
+
+  /* Only the top-level input stays in memory after the read. */
+  if(p->lazy && (p->scan_ctx->stack_depth == 0) && __parser_defer(p, setting))
+    return(1);
+
+  if(type == CONFIG_TYPE_ARRAY)
+    return(__parser_elements(p, setting, TOKEN_ARRAY_END));
+
+  if(type == CONFIG_TYPE_LIST)
+    return(__parser_elements(p, setting, TOKEN_LIST_END));
+
+  p->scan_ctx->include_parent = setting;
+  if(! __parser_settings(p, setting, 1))
+    return(0);
+
+  __parser_consume(p); /* '}' */
+  p->scan_ctx->include_parent = NULL;
+
+  return(1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reads settings into the group, up to the closing brace of a nested group,
+ * which is left as the lookahead, or up to the end of the input.
+ */
+
+static int __parser_settings(struct parser *p, config_setting_t *group,
+                             int nested)
+{
+  for(;;)
+  {
+    int token = __parser_peek(p);
+    config_setting_t *setting;
+
+    if(token != TOKEN_NAME)
+    {
+      if(token == (nested ? TOKEN_GROUP_END : TOKEN_EOF))
+        return(1);
+
+      return(__parser_error(p, err_syntax));
+    }
+
+    __parser_consume(p);
+
+    setting = config_setting_add(group, p->text.string, CONFIG_TYPE_NONE);
+    if(! setting)
+      return(__parser_error(p, err_duplicate_setting));
+
+    __parser_capture_pos(p, setting);
+    p->scan_ctx->include_parent = NULL;
+
+    if(__parser_peek(p) != TOKEN_EQUALS)
+      return(__parser_error(p, err_syntax));
+
+    __parser_consume(p);
+
+    if(! __parser_value(p, group, setting))
+      return(0);
+
+    token = __parser_peek(p);
+    if((token == TOKEN_SEMICOLON) || (token == TOKEN_COMMA))
+      __parser_consume(p);
+
+    p->scan_ctx->include_parent = group;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __parser_init(struct parser *p, struct parse_context *ctx,
+                          struct scan_context *scan_ctx, const char *text,
+                          size_t length)
+{
+  __zero(p);
+  p->ctx = ctx;
+  p->scan_ctx = scan_ctx;
+  p->config = ctx->config;
+  p->error_text = &(ctx->config->error_text);
+  p->error_line = &(ctx->config->error_line);
+  p->source.start = p->source.pos = text;
+  p->source.end = text + length;
+  p->source.line = 1;
+  p->state = STATE_INITIAL;
+  p->token = TOKEN_NONE;
+  p->last = TOKEN_NONE;
+  p->lazy = (scan_ctx->depth == 0)
+    && config_get_option(ctx->config, CONFIG_OPTION_LAZY_LOAD);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int libconfig_parse(struct parse_context *ctx, struct scan_context *scan_ctx,
+                    const char *text, size_t length)
+{
+  struct parser p;
+  int ok;
+
+  __parser_init(&p, ctx, scan_ctx, text, length);
+
+  ok = __parser_settings(&p, ctx->parent, 0);
+
+  if(p.state != STATE_INITIAL)
+    scan_ctx->end = SCANCTX_END_UNKNOWN;
+  else if(p.last == TOKEN_NONE)
+    scan_ctx->end = SCANCTX_END_EMPTY;
+  else if((p.last == TOKEN_SEMICOLON) || (p.last == TOKEN_COMMA))
+    scan_ctx->end = SCANCTX_END_CLOSED;
+  else
+    scan_ctx->end = SCANCTX_END_OPEN;
+
+  if(p.token == TOKEN_STRING)
+    __delete(p.value.sval);
+
+  __delete(libconfig_strbuf_release(&(p.text)));
+
+  return(ok ? 0 : 1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int libconfig_parse_body(struct parse_context *ctx,
+                         struct scan_context *scan_ctx,
+                         const char *text, size_t length, int line,
+                         const char **error_text, int *error_line)
+{
+  struct parser p;
+  config_setting_t *aggregate = ctx->parent;
+  int ok;
+
+  __parser_init(&p, ctx, scan_ctx, text, length);
+  p.source.line = line;
+  p.error_text = error_text;
+  p.error_line = error_line;
+
+  /* A group's closing brace is left as the lookahead. */
+  if(aggregate->type == CONFIG_TYPE_ARRAY)
+    ok = __parser_elements(&p, aggregate, TOKEN_ARRAY_END);
+  else if(aggregate->type == CONFIG_TYPE_LIST)
+    ok = __parser_elements(&p, aggregate, TOKEN_LIST_END);
+  else
+    ok = __parser_settings(&p, aggregate, 1);
+
+  if(p.token == TOKEN_STRING)
+    __delete(p.value.sval);
+
+  __delete(libconfig_strbuf_release(&(p.text)));
+
+  return(ok ? 0 : 1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_parse_includes(const char *text, size_t length,
+                              parser_include_fn_t fn, void *context)
+{
+  struct parser p;
+  struct scan_context scan_ctx;
+  int token;
+
+  libconfig_scanctx_init(&scan_ctx, NULL);
+
+  __zero(&p);
+  p.scan_ctx = &scan_ctx;
+  p.source.start = p.source.pos = text;
+  p.source.end = text + length;
+  p.source.line = 1;
+  p.state = STATE_INITIAL;
+  p.token = TOKEN_NONE;
+  p.visit = fn;
+  p.visit_context = context;
+
+  while((token = __parser_lex(&p)) != TOKEN_EOF)
+  {
+    if(token == TOKEN_STRING)
+      __delete(p.value.sval);
+  }
+
+  __delete(libconfig_strbuf_release(&(p.text)));
+  libconfig_strvec_delete(libconfig_scanctx_cleanup(&scan_ctx));
+}
+
+/* ------------------------------------------------------------------------- */
+
+int libconfig_parse_can_follow(const char *text)
+{
+  const char *s = text;
+
+  if(! s)
+    return(0);
+
+  /* The text is known to end only at a NUL, so it is not handed to the
+   * fastscan routines; a directive is rarely followed by more than a few
+   * blanks or a comment before the next token.
+   */
+  for(;;)
+  {
+    while((*s == ' ') || ((*s >= '\a') && (*s <= '\r')))
+      ++s;
+
+    if((*s == '#') || ((s[0] == '/') && (s[1] == '/')))
+    {
+      s = strchr(s, '\n');
+      if(! s)
+        return(0);
+    }
+    else if((s[0] == '/') && (s[1] == '*'))
+    {
+      s = strstr(s + 2, "*/");
+      if(! s)
+        return(0);
+
+      s += 2;
+    }
+    else
+      break;
+  }
+
+  switch(*s)
+  {
+    case '\0':
+    case ';':
+    case ',':
+    case '\"':
+    case '@':
+      return(0);
+
+    default:
+      return(1);
+  }
+}
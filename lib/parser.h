@@ -0,0 +1,89 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+
+#ifndef __libconfig_parser_h
+#define __libconfig_parser_h
+
+#include <string.h>
+#include <sys/types.h>
+
+#include "parsectx.h"
+#include "scanctx.h"
+
+typedef void (*parser_include_fn_t)(const char *path, void *context);
+
+/*
+ * A hand-written parser for the configuration language, which reads its
+ * input in a single pass without going through the generated scanner and
+ * parser. It accepts exactly the same language, builds the same setting tree,
+ * and reports errors with the same text, file and line.
+ *
+ * ctx - The parse context, set up as for libconfig_yyparse()
+ * scan_ctx - The scan context, which provides the include stack
+ * text - The input, which must be followed by a NUL byte; NUL bytes within
+ * the input are treated like any other byte
+ * length - The length of the input, not counting the trailing NUL
+ *
+ * Returns 0 on success and non-zero on failure, like libconfig_yyparse(). On
+ * success, how the input ended is stored in scan_ctx->end. On failure, the
+ * error is stored in ctx->config and the include stack is left as it was, so
+ * that the file in which the error occurred can be determined.
+ */
+extern int libconfig_parse(struct parse_context *ctx,
+                           struct scan_context *scan_ctx,
+                           const char *text, size_t length);
+
+/*
+ * Parses the body of a group, array or list whose parsing was deferred by
+ * CONFIG_OPTION_LAZY_LOAD into ctx->parent, which must have the type of the
+ * aggregate. The text runs up to and including the closing token, and starts
+ * on the given line. Any aggregates within the body are deferred in turn.
+ * Returns 0 on success and non-zero on failure, as libconfig_parse() does,
+ * but the error is stored in *error_text and *error_line, which must be
+ * initialized to NULL and 0, rather than in ctx->config, whose error may be
+ * read at the same time by other threads.
+ */
+extern int libconfig_parse_body(struct parse_context *ctx,
+                                struct scan_context *scan_ctx,
+                                const char *text, size_t length, int line,
+                                const char **error_text, int *error_line);
+
+/*
+ * Scans the input for @include directives, as libconfig_parse() would find
+ * them, without parsing it or reading the included files, and calls fn with
+ * the path of each directive in turn. The input must be followed by a NUL
+ * byte.
+ */
+extern void libconfig_parse_includes(const char *text, size_t length,
+                                     parser_include_fn_t fn, void *context);
+
+/*
+ * Returns non-zero if the text that follows an @include directive starts,
+ * after any blanks and comments, with a token that cannot continue a setting
+ * that an included file left open: anything but a ';', ',', string or
+ * directive. Returns zero if that is not so, or not known because the text is
+ * NULL or ends first.
+ */
+extern int libconfig_parse_can_follow(const char *text);
+
+#endif /* __libconfig_parser_h */
@@ -0,0 +1,350 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#include "prefetch.h"
+#include "scanctx.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define PREFETCH_MAX_THREADS 64
+
+/* ------------------------------------------------------------------------- */
+
+/* The jobs are kept in the order in which their directives appear, which is
+ * the order in which the parser asks for them. Workers take the first job
+ * that nobody has started on; the parser starts on a job itself rather than
+ * wait for a worker to get to it. A single lock guards the job states, and is
+ * held only to change them.
+ */
+
+#if defined(_WIN32)
+
+typedef HANDLE prefetch_thread_t;
+typedef CRITICAL_SECTION prefetch_mutex_t;
+typedef CONDITION_VARIABLE prefetch_cond_t;
+
+#define PREFETCH_LOCK(P) EnterCriticalSection(&((P)->lock))
+#define PREFETCH_UNLOCK(P) LeaveCriticalSection(&((P)->lock))
+#define PREFETCH_WAIT(P) \
+  SleepConditionVariableCS(&((P)->done), &((P)->lock), INFINITE)
+#define PREFETCH_BROADCAST(P) WakeAllConditionVariable(&((P)->done))
+
+#else
+
+typedef pthread_t prefetch_thread_t;
+typedef pthread_mutex_t prefetch_mutex_t;
+typedef pthread_cond_t prefetch_cond_t;
+
+#define PREFETCH_LOCK(P) pthread_mutex_lock(&((P)->lock))
+#define PREFETCH_UNLOCK(P) pthread_mutex_unlock(&((P)->lock))
+#define PREFETCH_WAIT(P) pthread_cond_wait(&((P)->done), &((P)->lock))
+#define PREFETCH_BROADCAST(P) pthread_cond_broadcast(&((P)->done))
+
+#endif
+
+enum
+{
+  PREFETCH_PENDING,
+  PREFETCH_RUNNING,
+  PREFETCH_DONE
+};
+
+struct prefetch_job
+{
+  char *path;
+  config_t *tree;
+  int end;
+  int state;
+};
+
+struct include_prefetch
+{
+  const config_t *config;
+  struct prefetch_job *jobs;
+  unsigned int count;
+  unsigned int capacity;
+  unsigned int next;   /* no job before this one is pending */
+  unsigned int cursor; /* the job after the one last asked for */
+  int stop;
+  prefetch_thread_t *threads;
+  unsigned int thread_count;
+  prefetch_mutex_t lock;
+  prefetch_cond_t done;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static unsigned int __prefetch_processors(void)
+{
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+
+  GetSystemInfo(&info);
+  return((unsigned int)info.dwNumberOfProcessors);
+#elif defined(_SC_NPROCESSORS_ONLN)
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return((n > 0) ? (unsigned int)n : 1);
+#else
+  return(1);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __prefetch_run(struct include_prefetch *prefetch,
+                           struct prefetch_job *job)
+{
+  config_t *tree;
+  int end = SCANCTX_END_UNKNOWN;
+
+  /* The files are included by the top-level file, at depth 1. */
+  tree = libconfig_read_include(prefetch->config, job->path, 1, &end);
+
+  PREFETCH_LOCK(prefetch);
+  job->tree = tree;
+  job->end = end;
+  job->state = PREFETCH_DONE;
+  PREFETCH_BROADCAST(prefetch);
+  PREFETCH_UNLOCK(prefetch);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __prefetch_work(struct include_prefetch *prefetch)
+{
+  struct prefetch_job *job;
+
+  for(;;)
+  {
+    PREFETCH_LOCK(prefetch);
+
+    while((prefetch->next < prefetch->count)
+          && (prefetch->jobs[prefetch->next].state != PREFETCH_PENDING))
+      ++(prefetch->next);
+
+    if(prefetch->stop || (prefetch->next == prefetch->count))
+    {
+      PREFETCH_UNLOCK(prefetch);
+      return;
+    }
+
+    job = &(prefetch->jobs[prefetch->next++]);
+    job->state = PREFETCH_RUNNING;
+    PREFETCH_UNLOCK(prefetch);
+
+    __prefetch_run(prefetch, job);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+#if defined(_WIN32)
+
+static DWORD WINAPI __prefetch_thread(LPVOID arg)
+{
+  __prefetch_work((struct include_prefetch *)arg);
+  return(0);
+}
+
+#else
+
+static void *__prefetch_thread(void *arg)
+{
+  __prefetch_work((struct include_prefetch *)arg);
+  return(NULL);
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+struct include_prefetch *libconfig_prefetch_create(const config_t *config)
+{
+  struct include_prefetch *prefetch = __new(struct include_prefetch);
+
+  prefetch->config = config;
+
+#if defined(_WIN32)
+  InitializeCriticalSection(&(prefetch->lock));
+  InitializeConditionVariable(&(prefetch->done));
+#else
+  pthread_mutex_init(&(prefetch->lock), NULL);
+  pthread_cond_init(&(prefetch->done), NULL);
+#endif
+
+  return(prefetch);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_prefetch_add(struct include_prefetch *prefetch,
+                            const char *path)
+{
+  if(prefetch->count == prefetch->capacity)
+  {
+    prefetch->capacity = prefetch->capacity ? prefetch->capacity * 2 : 16;
+    prefetch->jobs = (struct prefetch_job *)libconfig_realloc(
+      prefetch->jobs, prefetch->capacity * sizeof(struct prefetch_job));
+  }
+
+  __zero(&(prefetch->jobs[prefetch->count]));
+  prefetch->jobs[prefetch->count].path = strdup(path);
+  ++(prefetch->count);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_prefetch_start(struct include_prefetch *prefetch)
+{
+  unsigned int n = __prefetch_processors() - 1, i;
+
+  if(n > prefetch->count)
+    n = prefetch->count;
+
+  if(n > PREFETCH_MAX_THREADS)
+    n = PREFETCH_MAX_THREADS;
+
+  if(n == 0)
+    return;
+
+  prefetch->threads = (prefetch_thread_t *)libconfig_calloc(
+    n, sizeof(prefetch_thread_t));
+
+  /* If a thread cannot be started, the parser does its share of the jobs. */
+  for(i = 0; i < n; ++i)
+  {
+    prefetch_thread_t *thread = &(prefetch->threads[prefetch->thread_count]);
+
+#if defined(_WIN32)
+    *thread = CreateThread(NULL, 0, __prefetch_thread, prefetch, 0, NULL);
+    if(*thread == NULL)
+      break;
+#else
+    if(pthread_create(thread, NULL, __prefetch_thread, prefetch) != 0)
+      break;
+#endif
+
+    ++(prefetch->thread_count);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+int libconfig_prefetch_get(struct include_prefetch *prefetch,
+                           const char *path, config_t **tree, int *end)
+{
+  struct prefetch_job *job = NULL;
+  unsigned int i, j;
+
+  /* The files are usually asked for in the order in which they were
+   * added.
+   */
+  for(i = 0; (i < prefetch->count) && ! job; ++i)
+  {
+    j = (prefetch->cursor + i) % prefetch->count;
+    if(! strcmp(prefetch->jobs[j].path, path))
+    {
+      job = &(prefetch->jobs[j]);
+      prefetch->cursor = j + 1;
+    }
+  }
+
+  if(! job)
+    return(0);
+
+  PREFETCH_LOCK(prefetch);
+
+  if(job->state == PREFETCH_PENDING)
+  {
+    job->state = PREFETCH_RUNNING;
+    PREFETCH_UNLOCK(prefetch);
+
+    __prefetch_run(prefetch, job);
+
+    PREFETCH_LOCK(prefetch);
+  }
+
+  while(job->state != PREFETCH_DONE)
+    PREFETCH_WAIT(prefetch);
+
+  PREFETCH_UNLOCK(prefetch);
+
+  *tree = job->tree;
+  *end = job->end;
+
+  return(1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_prefetch_destroy(struct include_prefetch *prefetch)
+{
+  unsigned int i;
+
+  PREFETCH_LOCK(prefetch);
+  prefetch->stop = 1;
+  PREFETCH_UNLOCK(prefetch);
+
+  for(i = 0; i < prefetch->thread_count; ++i)
+  {
+#if defined(_WIN32)
+    WaitForSingleObject(prefetch->threads[i], INFINITE);
+    CloseHandle(prefetch->threads[i]);
+#else
+    pthread_join(prefetch->threads[i], NULL);
+#endif
+  }
+
+  for(i = 0; i < prefetch->count; ++i)
+  {
+    struct prefetch_job *job = &(prefetch->jobs[i]);
+
+    if(job->tree)
+    {
+      config_destroy(job->tree);
+      __delete(job->tree);
+    }
+
+    __delete(job->path);
+  }
+
+#if defined(_WIN32)
+  DeleteCriticalSection(&(prefetch->lock));
+#else
+  pthread_cond_destroy(&(prefetch->done));
+  pthread_mutex_destroy(&(prefetch->lock));
+#endif
+
+  __delete(prefetch->threads);
+  __delete(prefetch->jobs);
+  __delete(prefetch);
+}
@@ -0,0 +1,83 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __libconfig_prefetch_h
+#define __libconfig_prefetch_h
+
+#include "libconfig.h"
+
+/* The files named by the @include directives of a top-level file, parsed
+ * ahead on worker threads while the top-level file itself is parsed, so that
+ * they can be grafted into the configuration rather than scanned in turn.
+ * Each file is parsed on its own, into a configuration of its own.
+ */
+struct include_prefetch;
+
+/*
+ * Creates an empty set of files to parse ahead for the configuration. Only
+ * the settings of the configuration may change until the set is destroyed.
+ */
+extern struct include_prefetch *libconfig_prefetch_create(
+  const config_t *config);
+
+/*
+ * Adds a file to the set, which takes a copy of the path. Files must be added
+ * before the set is started.
+ */
+extern void libconfig_prefetch_add(struct include_prefetch *prefetch,
+                                   const char *path);
+
+/*
+ * Starts the worker threads: one for each online processor but the one that
+ * the caller runs on, and no more than there are files.
+ */
+extern void libconfig_prefetch_start(struct include_prefetch *prefetch);
+
+/*
+ * Returns zero if the file is not in the set. Otherwise, waits for the file
+ * to be parsed, parsing it on the calling thread if no worker has started on
+ * it yet, and stores the configuration that it was parsed into at *tree, or
+ * NULL if it could not be parsed on its own, and how it ended at *end. The
+ * configuration remains owned by the set.
+ */
+extern int libconfig_prefetch_get(struct include_prefetch *prefetch,
+                                  const char *path, config_t **tree,
+                                  int *end);
+
+/*
+ * Stops the worker threads, once they have finished the files they started
+ * on, and destroys the set along with the configurations in it.
+ */
+extern void libconfig_prefetch_destroy(struct include_prefetch *prefetch);
+
+/*
+ * Defined in libconfig.c. Parses an included file on its own into a new
+ * configuration, with the settings of the configuration that includes it
+ * and as though it were included at the given depth. Returns NULL if the file
+ * could not be parsed; otherwise stores how it ended at *end, as one of the
+ * SCANCTX_END_* values.
+ */
+extern config_t *libconfig_read_include(const config_t *config,
+                                        const char *path, int depth,
+                                        int *end);
+
+#endif /* __libconfig_prefetch_h */
@@ -0,0 +1,296 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#include "libconfig.h"
+#include "inccache.h"
+#include "util.h"
+#include "wincompat.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <sched.h>
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+/* Readers never lock. A reader announces itself in the counter of the
+ * current epoch, loads the current snapshot, takes a reference to it, and
+ * withdraws its announcement. A reload publishes the new snapshot, moves to
+ * the next epoch, and then waits for the counter of the previous epoch to
+ * drain before it drops its own reference to the old snapshot: a reader that
+ * found the old snapshot has taken its reference by then. The snapshot is
+ * freed when the last reference goes.
+ */
+
+#if defined(_MSC_VER)
+
+#define RELOADER_LOAD(P) InterlockedCompareExchange((P), 0, 0)
+#define RELOADER_STORE(P, V) InterlockedExchange((P), (V))
+#define RELOADER_EXCHANGE(P, V) InterlockedExchange((P), (V))
+#define RELOADER_INC(P) InterlockedIncrement(P)
+#define RELOADER_DEC(P) InterlockedDecrement(P)
+#define RELOADER_LOAD_PTR(P) \
+  InterlockedCompareExchangePointer((PVOID *)(P), NULL, NULL)
+#define RELOADER_EXCHANGE_PTR(P, V) \
+  InterlockedExchangePointer((PVOID *)(P), (V))
+
+#else
+
+#define RELOADER_LOAD(P) __atomic_load_n((P), __ATOMIC_SEQ_CST)
+#define RELOADER_STORE(P, V) __atomic_store_n((P), (V), __ATOMIC_SEQ_CST)
+#define RELOADER_EXCHANGE(P, V) __atomic_exchange_n((P), (V), __ATOMIC_SEQ_CST)
+#define RELOADER_INC(P) __atomic_add_fetch((P), 1, __ATOMIC_SEQ_CST)
+#define RELOADER_DEC(P) __atomic_sub_fetch((P), 1, __ATOMIC_SEQ_CST)
+#define RELOADER_LOAD_PTR(P) __atomic_load_n((P), __ATOMIC_SEQ_CST)
+#define RELOADER_EXCHANGE_PTR(P, V) \
+  __atomic_exchange_n((P), (V), __ATOMIC_SEQ_CST)
+
+#endif
+
+#if defined(_WIN32)
+#define RELOADER_YIELD() SwitchToThread()
+#else
+#define RELOADER_YIELD() sched_yield()
+#endif
+
+/* The configuration comes first, so that readers can be handed a pointer to
+ * it and give it back.
+ */
+typedef struct
+{
+  config_t config;
+  long refs;
+} reloader_snapshot_t;
+
+struct config_reloader_t
+{
+  char *filename;
+  config_reloader_setup_fn_t setup;
+  void *context;
+  reloader_snapshot_t *current;
+  long epoch;
+  long readers[2];
+  long busy;
+  reloader_snapshot_t *failed;
+  struct include_cache_stamp *stamps;
+  unsigned int stamp_count;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static void __reloader_free_snapshot(reloader_snapshot_t *snapshot)
+{
+  if(snapshot)
+  {
+    config_destroy(&(snapshot->config));
+    __delete(snapshot);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __reloader_unref(reloader_snapshot_t *snapshot)
+{
+  if(snapshot && (RELOADER_DEC(&(snapshot->refs)) == 0))
+    __reloader_free_snapshot(snapshot);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __reloader_publish(config_reloader_t *reloader,
+                               reloader_snapshot_t *snapshot)
+{
+  reloader_snapshot_t *old;
+  long epoch;
+
+  snapshot->refs = 1; /* the reloader's own reference */
+  old = (reloader_snapshot_t *)RELOADER_EXCHANGE_PTR(&(reloader->current),
+                                                     snapshot);
+
+  epoch = RELOADER_LOAD(&(reloader->epoch));
+  RELOADER_STORE(&(reloader->epoch), epoch + 1);
+
+  while(RELOADER_LOAD(&(reloader->readers[epoch & 1])) != 0)
+    RELOADER_YIELD();
+
+  __reloader_unref(old);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reads the configuration afresh and publishes it if it could be read. The
+ * files that went into the attempt are watched for the next one either way,
+ * so that fixing a broken included file triggers a reload as well.
+ */
+static int __reloader_load(config_reloader_t *reloader)
+{
+  reloader_snapshot_t *snapshot = __new(reloader_snapshot_t);
+  config_t *config = &(snapshot->config);
+  const char * const *files;
+  unsigned int count;
+  int ok;
+
+  config_init(config);
+  if(reloader->setup)
+    reloader->setup(config, reloader->context);
+
+  ok = config_read_file(config, reloader->filename);
+
+  libconfig_inccache_free_stamps(reloader->stamps, reloader->stamp_count);
+
+  files = config->filenames;
+  for(count = 0; files && files[count]; ++count);
+
+  if(count == 0)
+  {
+    files = (const char * const *)&(reloader->filename);
+    count = 1;
+  }
+
+  reloader->stamps = libconfig_inccache_stamp_files(files, count);
+  reloader->stamp_count = count;
+
+  __reloader_free_snapshot(reloader->failed);
+  reloader->failed = NULL;
+
+  if(! ok)
+  {
+    reloader->failed = snapshot;
+    return(CONFIG_FALSE);
+  }
+
+  __reloader_publish(reloader, snapshot);
+  return(CONFIG_TRUE);
+}
+
+/* ------------------------------------------------------------------------- */
+
+config_reloader_t *config_reloader_create(const char *filename,
+                                          config_reloader_setup_fn_t setup,
+                                          void *context)
+{
+  config_reloader_t *reloader = __new(config_reloader_t);
+
+  reloader->filename = strdup(filename);
+  reloader->setup = setup;
+  reloader->context = context;
+
+  (void)__reloader_load(reloader);
+
+  return(reloader);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void config_reloader_destroy(config_reloader_t *reloader)
+{
+  if(! reloader)
+    return;
+
+  __reloader_unref(reloader->current);
+  __reloader_free_snapshot(reloader->failed);
+  libconfig_inccache_free_stamps(reloader->stamps, reloader->stamp_count);
+  __delete(reloader->filename);
+  __delete(reloader);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __reloader_run(config_reloader_t *reloader, int force)
+{
+  int ok = CONFIG_FALSE;
+
+  /* Only one reload runs at a time; others find it busy and return. */
+  if(RELOADER_EXCHANGE(&(reloader->busy), 1) != 0)
+    return(CONFIG_FALSE);
+
+  if(force || ! libconfig_inccache_stamps_fresh(reloader->stamps,
+                                                reloader->stamp_count))
+    ok = __reloader_load(reloader);
+
+  RELOADER_STORE(&(reloader->busy), 0);
+
+  return(ok);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_reloader_check(config_reloader_t *reloader)
+{
+  return(__reloader_run(reloader, CONFIG_FALSE));
+}
+
+/* ------------------------------------------------------------------------- */
+
+int config_reloader_reload(config_reloader_t *reloader)
+{
+  return(__reloader_run(reloader, CONFIG_TRUE));
+}
+
+/* ------------------------------------------------------------------------- */
+
+const config_t *config_reloader_get_failure(
+  const config_reloader_t *reloader)
+{
+  return(reloader->failed ? &(reloader->failed->config) : NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+const config_t *config_reloader_acquire(config_reloader_t *reloader)
+{
+  reloader_snapshot_t *snapshot;
+  long epoch;
+
+  /* Retry if a reload moved to the next epoch before the reader was
+   * counted in this one.
+   */
+  for(;;)
+  {
+    epoch = RELOADER_LOAD(&(reloader->epoch));
+    RELOADER_INC(&(reloader->readers[epoch & 1]));
+
+    if(RELOADER_LOAD(&(reloader->epoch)) == epoch)
+      break;
+
+    RELOADER_DEC(&(reloader->readers[epoch & 1]));
+  }
+
+  snapshot = (reloader_snapshot_t *)RELOADER_LOAD_PTR(&(reloader->current));
+  if(snapshot)
+    RELOADER_INC(&(snapshot->refs));
+
+  RELOADER_DEC(&(reloader->readers[epoch & 1]));
+
+  return(snapshot ? &(snapshot->config) : NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void config_reloader_release(const config_t *config)
+{
+  __reloader_unref((reloader_snapshot_t *)config);
+}
+
+/* ------------------------------------------------------------------------- */
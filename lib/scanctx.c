@@ -28,6 +28,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 /* ------------------------------------------------------------------------- */
 
@@ -59,6 +60,7 @@ const char **libconfig_scanctx_cleanup(struct scan_context *ctx)
     if(frame->current_stream)
       fclose(frame->current_stream);
 
+    libconfig_mapfile_close(&(frame->current_map));
     __delete(frame->files);
   }
 
@@ -70,13 +72,14 @@ const char **libconfig_scanctx_cleanup(struct scan_context *ctx)
 /* ------------------------------------------------------------------------- */
 
 FILE *libconfig_scanctx_push_include(struct scan_context *ctx, void *prev_buffer,
-                                     const char *path, const char **error)
+                                     const char *path, const char *follow,
+                                     const char **error)
 {
   struct include_stack_frame *frame;
   const char **files = NULL, **f;
   FILE *fp;
 
-  if(ctx->stack_depth == MAX_INCLUDE_DEPTH)
+  if(ctx->depth + ctx->stack_depth == MAX_INCLUDE_DEPTH)
   {
     *error = err_include_too_deep;
     return(NULL);
@@ -100,11 +103,24 @@ FILE *libconfig_scanctx_push_include(struct scan_context *ctx, void *prev_buffer
     return(NULL);
   }
 
-  frame = &(ctx->include_stack[ctx->stack_depth]);
-
   for(f = files; *f; ++f)
     libconfig_strvec_append(&(ctx->filenames), *f);
 
+  /* Between settings, fragments that were parsed ahead, or that are
+   * unchanged in the include cache, are grafted rather than scanned again.
+   * Only the directives of the top-level file are parsed ahead.
+   */
+  if(ctx->include_parent
+     && (ctx->config->include_cache
+         || (ctx->prefetch && (ctx->stack_depth == 0)))
+     && libconfig_scanctx_graft_include(ctx, files, follow, error))
+  {
+    __delete(files);
+    return(NULL);
+  }
+
+  frame = &(ctx->include_stack[ctx->stack_depth]);
+
   frame->files = files;
   frame->current_file = NULL;
   frame->current_stream = NULL;
@@ -143,12 +159,30 @@ FILE *libconfig_scanctx_next_include_file(struct scan_context *ctx,
     include_frame->current_stream = NULL;
   }
 
+  libconfig_mapfile_close(&(include_frame->current_map));
+
   if(!*(include_frame->current_file))
     return(NULL);
 
   include_frame->current_stream = fopen(*(include_frame->current_file), "rt");
+  if(include_frame->current_stream)
+  {
+    struct stat statbuf;
+
+    /* Some systems open a directory, only to fail when it is read. */
+    if((fstat(posix_fileno(include_frame->current_stream), &statbuf) == 0)
+       && S_ISDIR(statbuf.st_mode))
+    {
+      fclose(include_frame->current_stream);
+      include_frame->current_stream = NULL;
+    }
+  }
+
   if(!include_frame->current_stream)
     *error = err_bad_include;
+  else
+    (void)libconfig_mapfile_open(&(include_frame->current_map),
+                                 posix_fileno(include_frame->current_stream));
 
   return(include_frame->current_stream);
 }
@@ -173,11 +207,49 @@ void *libconfig_scanctx_pop_include(struct scan_context *ctx)
     frame->current_stream = NULL;
   }
 
+  libconfig_mapfile_close(&(frame->current_map));
+
   return(frame->parent_buffer);
 }
 
 /* ------------------------------------------------------------------------- */
 
+char *libconfig_scanctx_current_buffer(struct scan_context *ctx,
+                                       size_t *length)
+{
+  struct include_stack_frame *frame;
+
+  if(ctx->stack_depth == 0)
+    return(NULL);
+
+  frame = &(ctx->include_stack[ctx->stack_depth - 1]);
+  *length = frame->current_map.length;
+
+  return(frame->current_map.data);
+}
+
+/* ------------------------------------------------------------------------- */
+
+char *libconfig_scanctx_load_current_buffer(struct scan_context *ctx,
+                                            size_t *length)
+{
+  struct include_stack_frame *frame;
+
+  if(ctx->stack_depth == 0)
+    return(NULL);
+
+  frame = &(ctx->include_stack[ctx->stack_depth - 1]);
+  if(! frame->current_map.data)
+    libconfig_mapfile_read_stream(&(frame->current_map),
+                                  frame->current_stream);
+
+  *length = frame->current_map.length;
+
+  return(frame->current_map.data);
+}
+
+/* ------------------------------------------------------------------------- */
+
 char *libconfig_scanctx_take_string(struct scan_context *ctx)
 {
   char *r = libconfig_strbuf_release(&(ctx->string));
@@ -28,11 +28,26 @@
 #include <sys/types.h>
 
 #include "libconfig.h"
+#include "mapfile.h"
 #include "strbuf.h"
 #include "strvec.h"
 
 #define MAX_INCLUDE_DEPTH 10
 
+/*
+ * How an input ended, as far as the text that follows it in an including
+ * file is concerned: inside a comment, string or @include directive, or in a
+ * way that is not known; without any tokens; after a ';' or ','; or after the
+ * last value of a setting, which a ';', ',' or string that follows could
+ * still continue.
+ */
+#define SCANCTX_END_UNKNOWN 0
+#define SCANCTX_END_EMPTY   1
+#define SCANCTX_END_CLOSED  2
+#define SCANCTX_END_OPEN    3
+
+struct include_prefetch;
+
 struct include_stack_frame
 {
   /*
@@ -42,6 +57,7 @@ struct include_stack_frame
   const char **files;
   const char **current_file;
   FILE *current_stream;
+  mapfile_t current_map;
   void *parent_buffer;
 };
 
@@ -53,6 +69,27 @@ struct scan_context
   int stack_depth;
   strbuf_t string;
   strvec_t filenames;
+  /*
+   * The group that settings read at this point would be added to, if the
+   * parser is between two settings; NULL otherwise. Maintained by the parser,
+   * so that included fragments can be grafted from the include cache.
+   */
+  config_setting_t *include_parent;
+  /*
+   * The include depth of the input itself, when it is an included file that
+   * is parsed on its own; 0 otherwise.
+   */
+  int depth;
+  /*
+   * How the input ended; one of the SCANCTX_END_* values. Set by
+   * libconfig_parse() on success.
+   */
+  int end;
+  /*
+   * The included files that are being parsed ahead on worker threads, if
+   * any.
+   */
+  struct include_prefetch *prefetch;
 };
 
 extern void libconfig_scanctx_init(struct scan_context *ctx,
@@ -68,6 +105,8 @@ extern const char **libconfig_scanctx_cleanup(struct scan_context *ctx);
  * popped
  * path - The string argument to the @include directive, to be expanded into a
  * list of zero or more filenames using the function ctx->config->include_fn
+ * follow - The input that follows the directive, up to a NUL byte, or NULL if
+ * it is not known; used to decide whether the included files can be grafted
  * error - A pointer at which to store a static error message, if any.
  *
  * On success, the new frame will be pushed and the stream to the first file
@@ -80,6 +119,7 @@ extern const char **libconfig_scanctx_cleanup(struct scan_context *ctx);
 extern FILE *libconfig_scanctx_push_include(struct scan_context *ctx,
                                             void *prev_buffer,
                                             const char *path,
+                                            const char *follow,
                                             const char **error);
 
 /*
@@ -91,6 +131,24 @@ extern FILE *libconfig_scanctx_push_include(struct scan_context *ctx,
 extern FILE *libconfig_scanctx_next_include_file(struct scan_context *ctx,
                                                  const char **error);
 
+/*
+ * Returns the contents of the current include file, if it could be read into
+ * memory in one piece, and stores their length at *length. The contents are
+ * followed by two NUL bytes, so that they can be scanned in place with
+ * yy_scan_buffer(). Returns NULL if the file must be read from its stream
+ * instead.
+ */
+extern char *libconfig_scanctx_current_buffer(struct scan_context *ctx,
+                                              size_t *length);
+
+/*
+ * Like libconfig_scanctx_current_buffer(), but reads the current include file
+ * from its stream if it could not be read in one piece, so that its contents are always
+ * returned.
+ */
+extern char *libconfig_scanctx_load_current_buffer(struct scan_context *ctx,
+                                                   size_t *length);
+
 /*
  * Pops a frame off the include stack.
  */
@@ -99,6 +157,9 @@ extern void *libconfig_scanctx_pop_include(struct scan_context *ctx);
 #define libconfig_scanctx_append_string(C, S) \
   libconfig_strbuf_append_string(&((C)->string), (S))
 
+#define libconfig_scanctx_append(C, S, L) \
+  libconfig_strbuf_append(&((C)->string), (S), (L))
+
 #define libconfig_scanctx_append_char(C, X) \
   libconfig_strbuf_append_char(&((C)->string), (X))
 
@@ -106,4 +167,23 @@ extern char *libconfig_scanctx_take_string(struct scan_context *ctx);
 
 extern const char *libconfig_scanctx_current_filename(struct scan_context *ctx);
 
+/*
+ * Defined in libconfig.c. Adds the settings of the included files to
+ * ctx->include_parent from the files parsed ahead on worker threads or from
+ * the include cache, parsing and caching any that are not cached or have
+ * changed. Returns non-zero if the files were grafted or if grafting failed
+ * with an error, which is stored at *error; returns zero if the files must be
+ * scanned instead, so that the result is the same as if they had been.
+ */
+extern int libconfig_scanctx_graft_include(struct scan_context *ctx,
+                                           const char * const *files,
+                                           const char *follow,
+                                           const char **error);
+
+/*
+ * Defined in scanner.l. Undoes the scanner's temporary modification of the
+ * current input buffer.
+ */
+extern void libconfig_yy_restore_buffer(void *scanner);
+
 #endif /* __libconfig_scanctx_h */
@@ -808,6 +808,7 @@ static const flex_int32_t yy_rule_can_match_eol[50] =
 #include <string.h>
 #include <limits.h>
 
+#include "fastscan.h"
 #include "parsectx.h"
 #include "scanctx.h"
 #include "grammar.h"
@@ -816,9 +817,15 @@ static const flex_int32_t yy_rule_can_match_eol[50] =
 
 #define YY_NO_INPUT // Suppress generation of useless input() function
 
-#line 819 "scanner.c"
+static void __yy_skip(void *yyscanner,
+                      const char *(*skip)(const char *, const char *, int *));
+static void __yy_skip_blank(void *yyscanner);
+static void __yy_skip_string(void *yyscanner);
+static const char *__yy_rest(void *yyscanner);
 
-#line 821 "scanner.c"
+#line 826 "scanner.c"
+
+#line 828 "scanner.c"
 
 #define INITIAL 0
 #define SINGLE_LINE_COMMENT 1
@@ -1095,10 +1102,10 @@ YY_DECL
 		}
 
 	{
-#line 73 "scanner.l"
+#line 80 "scanner.l"
 
 
-#line 1101 "scanner.c"
+#line 1108 "scanner.c"
 
 	while ( /*CONSTCOND*/1 )		/* loops until end-of-file is reached */
 		{
@@ -1166,100 +1173,109 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 75 "scanner.l"
-{ BEGIN SINGLE_LINE_COMMENT; }
+#line 82 "scanner.l"
+{
+                               BEGIN SINGLE_LINE_COMMENT;
+                               __yy_skip(yyscanner, libconfig_fastscan_eol);
+                             }
 	YY_BREAK
 case 2:
 /* rule 2 can match eol */
 YY_RULE_SETUP
-#line 76 "scanner.l"
-{ BEGIN INITIAL; }
+#line 86 "scanner.l"
+{
+                               BEGIN INITIAL;
+                               __yy_skip_blank(yyscanner);
+                             }
 	YY_BREAK
 case 3:
 YY_RULE_SETUP
-#line 77 "scanner.l"
-{ /* ignore */ }
+#line 90 "scanner.l"
+{ __yy_skip(yyscanner, libconfig_fastscan_eol); }
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 79 "scanner.l"
-{ BEGIN MULTI_LINE_COMMENT; }
+#line 92 "scanner.l"
+{
+                               BEGIN MULTI_LINE_COMMENT;
+                               __yy_skip(yyscanner, libconfig_fastscan_comment);
+                             }
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 80 "scanner.l"
+#line 96 "scanner.l"
 { BEGIN INITIAL; }
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 81 "scanner.l"
-{ /* ignore */ }
+#line 97 "scanner.l"
+{ __yy_skip(yyscanner, libconfig_fastscan_comment); }
 	YY_BREAK
 case 7:
 /* rule 7 can match eol */
 YY_RULE_SETUP
-#line 82 "scanner.l"
-{ /* ignore */ }
+#line 98 "scanner.l"
+{ __yy_skip(yyscanner, libconfig_fastscan_comment); }
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 84 "scanner.l"
-{ BEGIN STRING; }
+#line 100 "scanner.l"
+{ BEGIN STRING; __yy_skip_string(yyscanner); }
 	YY_BREAK
 case 9:
 /* rule 9 can match eol */
 YY_RULE_SETUP
-#line 85 "scanner.l"
-{ libconfig_scanctx_append_string(yyextra, yytext); }
+#line 101 "scanner.l"
+{ libconfig_scanctx_append(yyextra, yytext, yyleng); }
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 86 "scanner.l"
+#line 102 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\a'); }
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 87 "scanner.l"
+#line 103 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\b'); }
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 88 "scanner.l"
+#line 104 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\n'); }
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 89 "scanner.l"
+#line 105 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\r'); }
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 90 "scanner.l"
+#line 106 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\t'); }
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 91 "scanner.l"
+#line 107 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\v'); }
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 92 "scanner.l"
+#line 108 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\f'); }
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 93 "scanner.l"
+#line 109 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\\'); }
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 94 "scanner.l"
+#line 110 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\"'); }
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 95 "scanner.l"
+#line 111 "scanner.l"
 {
                     char c = (char)(strtol(yytext + 2, NULL, 16) & 0xFF);
                     libconfig_scanctx_append_char(yyextra, c);
@@ -1267,12 +1283,12 @@ YY_RULE_SETUP
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 99 "scanner.l"
+#line 115 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\\'); }
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 100 "scanner.l"
+#line 116 "scanner.l"
 {
                     yylval->sval = libconfig_scanctx_take_string(yyextra);
                     BEGIN INITIAL;
@@ -1281,40 +1297,51 @@ YY_RULE_SETUP
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 106 "scanner.l"
+#line 122 "scanner.l"
 { BEGIN INCLUDE; }
 	YY_BREAK
 case 23:
 /* rule 23 can match eol */
 YY_RULE_SETUP
-#line 107 "scanner.l"
-{ libconfig_scanctx_append_string(yyextra, yytext); }
+#line 123 "scanner.l"
+{ libconfig_scanctx_append(yyextra, yytext, yyleng); }
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 108 "scanner.l"
+#line 124 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\\'); }
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
-#line 109 "scanner.l"
+#line 125 "scanner.l"
 { libconfig_scanctx_append_char(yyextra, '\"'); }
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
-#line 110 "scanner.l"
+#line 126 "scanner.l"
 {
   const char *error = NULL;
   const char *path = libconfig_scanctx_take_string(yyextra);
   FILE *fp = libconfig_scanctx_push_include(yyextra, (void *)YY_CURRENT_BUFFER,
-                                            path, &error);
+                                            path, __yy_rest(yyscanner),
+                                            &error);
   __delete(path);
 
   if(fp)
   {
+    size_t len;
+    char *buf = libconfig_scanctx_current_buffer(yyextra, &len);
+
+    /* Scan the file in place if it is in memory. */
     yyin = fp;
-    yy_switch_to_buffer(yy_create_buffer(yyin, YY_BUF_SIZE, yyscanner),
-                        yyscanner);
+    if(buf)
+    {
+      (void)yy_scan_buffer(buf, len + 2, yyscanner);
+      yylineno = 1;
+    }
+    else
+      yy_switch_to_buffer(yy_create_buffer(yyin, YY_BUF_SIZE, yyscanner),
+                          yyscanner);
   }
   else if(error)
   {
@@ -1329,57 +1356,57 @@ YY_RULE_SETUP
 case 27:
 /* rule 27 can match eol */
 YY_RULE_SETUP
-#line 133 "scanner.l"
-{ /* ignore */ }
+#line 160 "scanner.l"
+{ __yy_skip_blank(yyscanner); }
 	YY_BREAK
 case 28:
 YY_RULE_SETUP
-#line 134 "scanner.l"
+#line 161 "scanner.l"
 { /* ignore */ }
 	YY_BREAK
 case 29:
 YY_RULE_SETUP
-#line 136 "scanner.l"
+#line 163 "scanner.l"
 { return(TOK_EQUALS); }
 	YY_BREAK
 case 30:
 YY_RULE_SETUP
-#line 137 "scanner.l"
+#line 164 "scanner.l"
 { return(TOK_COMMA); }
 	YY_BREAK
 case 31:
 YY_RULE_SETUP
-#line 138 "scanner.l"
+#line 165 "scanner.l"
 { return(TOK_GROUP_START); }
 	YY_BREAK
 case 32:
 YY_RULE_SETUP
-#line 139 "scanner.l"
+#line 166 "scanner.l"
 { return(TOK_GROUP_END); }
 	YY_BREAK
 case 33:
 YY_RULE_SETUP
-#line 140 "scanner.l"
+#line 167 "scanner.l"
 { yylval->ival = 1; return(TOK_BOOLEAN); }
 	YY_BREAK
 case 34:
 YY_RULE_SETUP
-#line 141 "scanner.l"
+#line 168 "scanner.l"
 { yylval->ival = 0; return(TOK_BOOLEAN); }
 	YY_BREAK
 case 35:
 YY_RULE_SETUP
-#line 142 "scanner.l"
+#line 169 "scanner.l"
 { yylval->sval = yytext; return(TOK_NAME); }
 	YY_BREAK
 case 36:
 YY_RULE_SETUP
-#line 143 "scanner.l"
+#line 170 "scanner.l"
 { yylval->fval = atof(yytext); return(TOK_FLOAT); }
 	YY_BREAK
 case 37:
 YY_RULE_SETUP
-#line 144 "scanner.l"
+#line 171 "scanner.l"
 {
                     int ok;
                     long long llval = libconfig_parse_integer(yytext, &ok,0);
@@ -1400,7 +1427,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 38:
 YY_RULE_SETUP
-#line 161 "scanner.l"
+#line 188 "scanner.l"
 {
                     int ok;
                     long long llval = libconfig_parse_integer(yytext,&ok,1);
@@ -1413,7 +1440,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 39:
 YY_RULE_SETUP
-#line 170 "scanner.l"
+#line 197 "scanner.l"
 {
                     int ok;
                     unsigned long long llval = libconfig_parse_bin64(yytext,&ok,0);
@@ -1432,7 +1459,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 40:
 YY_RULE_SETUP
-#line 185 "scanner.l"
+#line 212 "scanner.l"
 {
                     int ok;
                     unsigned long long llval = libconfig_parse_bin64(yytext,&ok,1);
@@ -1444,7 +1471,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 41:
 YY_RULE_SETUP
-#line 193 "scanner.l"
+#line 220 "scanner.l"
 {
                     int ok;
                     unsigned long long llval = libconfig_parse_hex64(yytext,&ok,0);
@@ -1463,7 +1490,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 42:
 YY_RULE_SETUP
-#line 208 "scanner.l"
+#line 235 "scanner.l"
 {
                     int ok;
                     unsigned long long llval = libconfig_parse_hex64(yytext,&ok,1);
@@ -1475,32 +1502,32 @@ YY_RULE_SETUP
 	YY_BREAK
 case 43:
 YY_RULE_SETUP
-#line 216 "scanner.l"
+#line 243 "scanner.l"
 { return(TOK_ARRAY_START); }
 	YY_BREAK
 case 44:
 YY_RULE_SETUP
-#line 217 "scanner.l"
+#line 244 "scanner.l"
 { return(TOK_ARRAY_END); }
 	YY_BREAK
 case 45:
 YY_RULE_SETUP
-#line 218 "scanner.l"
+#line 245 "scanner.l"
 { return(TOK_LIST_START); }
 	YY_BREAK
 case 46:
 YY_RULE_SETUP
-#line 219 "scanner.l"
+#line 246 "scanner.l"
 { return(TOK_LIST_END); }
 	YY_BREAK
 case 47:
 YY_RULE_SETUP
-#line 220 "scanner.l"
+#line 247 "scanner.l"
 { return(TOK_SEMICOLON); }
 	YY_BREAK
 case 48:
 YY_RULE_SETUP
-#line 221 "scanner.l"
+#line 248 "scanner.l"
 { return(TOK_GARBAGE); }
 	YY_BREAK
 case YY_STATE_EOF(INITIAL):
@@ -1508,7 +1535,7 @@ case YY_STATE_EOF(SINGLE_LINE_COMMENT):
 case YY_STATE_EOF(MULTI_LINE_COMMENT):
 case YY_STATE_EOF(STRING):
 case YY_STATE_EOF(INCLUDE):
-#line 223 "scanner.l"
+#line 250 "scanner.l"
 {
   const char *error = NULL;
   FILE *fp;
@@ -1516,10 +1543,19 @@ case YY_STATE_EOF(INCLUDE):
   fp = libconfig_scanctx_next_include_file(yyextra, &error);
   if(fp)
   {
+    size_t len;
+    char *buf = libconfig_scanctx_current_buffer(yyextra, &len);
+
     yyin = fp;
     yy_delete_buffer(YY_CURRENT_BUFFER, yyscanner);
-    yy_switch_to_buffer(yy_create_buffer(yyin, YY_BUF_SIZE, yyscanner),
-                        yyscanner);
+    if(buf)
+    {
+      (void)yy_scan_buffer(buf, len + 2, yyscanner);
+      yylineno = 1;
+    }
+    else
+      yy_switch_to_buffer(yy_create_buffer(yyin, YY_BUF_SIZE, yyscanner),
+                          yyscanner);
   }
   else if(error)
   {
@@ -1544,10 +1580,10 @@ case YY_STATE_EOF(INCLUDE):
 	YY_BREAK
 case 49:
 YY_RULE_SETUP
-#line 256 "scanner.l"
+#line 292 "scanner.l"
 ECHO;
 	YY_BREAK
-#line 1550 "scanner.c"
+#line 1586 "scanner.c"
 
 	case YY_END_OF_BUFFER:
 		{
@@ -2676,7 +2712,7 @@ void yyfree (void * ptr , yyscan_t yyscanner)
 
 #define YYTABLES_NAME "yytables"
 
-#line 256 "scanner.l"
+#line 292 "scanner.l"
 
 
 void *libconfig_yyalloc(size_t bytes, void *yyscanner)
@@ -2689,3 +2725,106 @@ void *libconfig_yyrealloc(void *ptr, size_t bytes, void *yyscanner)
   return(libconfig_realloc(ptr, bytes));
 }
 
+/* The scanner's fast paths. In the actions below, the rules only match the
+ * first byte of a comment body, string or run of whitespace; the rest is
+ * skipped with the routines in fastscan.c, which scan many bytes at a time.
+ * A skip stops at the end of the buffer, and the rules then resume where it
+ * left off once the next block of a stream has been read.
+ */
+
+static char *__yy_skip_begin(struct yyguts_t *yyg)
+{
+  /* Undo the termination of yytext, which the rule's action is done with. */
+  *(yyg->yy_c_buf_p) = yyg->yy_hold_char;
+  return(yyg->yy_c_buf_p);
+}
+
+/* Returns the end of the data in the current buffer, where the scanner's
+ * end-of-buffer NULs start.
+ */
+static const char *__yy_skip_limit(struct yyguts_t *yyg)
+{
+  return(YY_CURRENT_BUFFER_LVALUE->yy_ch_buf + yyg->yy_n_chars);
+}
+
+static void __yy_skip_end(struct yyguts_t *yyg, char *start, char *end,
+                          int lines)
+{
+  if(end == start)
+    return;
+
+  /* The next call to yylex() puts yy_hold_char back at yy_c_buf_p. */
+  yyg->yy_c_buf_p = end;
+  yyg->yy_hold_char = *end;
+  yylineno += lines;
+  YY_CURRENT_BUFFER_LVALUE->yy_at_bol = (end[-1] == '\n');
+}
+
+static void __yy_skip(void *yyscanner,
+                      const char *(*skip)(const char *p, const char *end,
+                                          int *lines))
+{
+  struct yyguts_t *yyg = (struct yyguts_t *)yyscanner;
+  char *start = __yy_skip_begin(yyg);
+  int lines = 0;
+  char *end = (char *)skip(start, __yy_skip_limit(yyg), &lines);
+
+  __yy_skip_end(yyg, start, end, lines);
+}
+
+static void __yy_skip_blank(void *yyscanner)
+{
+  struct yyguts_t *yyg = (struct yyguts_t *)yyscanner;
+  char *start = __yy_skip_begin(yyg);
+  int lines = 0;
+  char *end = (char *)libconfig_fastscan_blank(start, __yy_skip_limit(yyg),
+                                               &lines);
+
+  /* The @include rule must see the indentation at the start of its line. */
+  if(*end == '@')
+  {
+    while((end > start) && (end[-1] != '\n'))
+      --end;
+  }
+
+  __yy_skip_end(yyg, start, end, lines);
+}
+
+static void __yy_skip_string(void *yyscanner)
+{
+  struct yyguts_t *yyg = (struct yyguts_t *)yyscanner;
+  char *start = __yy_skip_begin(yyg);
+  int lines = 0;
+  char *end = (char *)libconfig_fastscan_string(start, __yy_skip_limit(yyg),
+                                                &lines);
+
+  if(end > start)
+    libconfig_scanctx_append(yyextra, start, end - start);
+
+  __yy_skip_end(yyg, start, end, lines);
+}
+
+/* Returns the input that follows the current token, up to the end of the
+ * current buffer.
+ */
+static const char *__yy_rest(void *yyscanner)
+{
+  struct yyguts_t *yyg = (struct yyguts_t *)yyscanner;
+
+  return(__yy_skip_begin(yyg));
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Puts back the character that the scanner replaced with a NUL to terminate
+ * the current token, so that a buffer scanned in place is left unmodified
+ * when scanning stops early.
+ */
+void libconfig_yy_restore_buffer(void *yyscanner)
+{
+  struct yyguts_t *yyg = (struct yyguts_t *)yyscanner;
+
+  if(YY_CURRENT_BUFFER && yyg->yy_c_buf_p)
+    *(yyg->yy_c_buf_p) = yyg->yy_hold_char;
+}
+
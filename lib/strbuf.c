@@ -32,12 +32,19 @@
 
 void libconfig_strbuf_ensure_capacity(strbuf_t *buf, size_t len)
 {
-  static const size_t mask = ~(STRING_BLOCK_SIZE - 1);
-
   size_t newlen = buf->length + len + 1; /* add 1 for NUL */
   if(newlen > buf->capacity)
   {
-    buf->capacity = (newlen + (STRING_BLOCK_SIZE - 1)) & mask;
+    /* Grow geometrically, so that a long string assembled from many fragments
+     * is reallocated only a logarithmic number of times.
+     */
+    size_t capacity = (buf->capacity < STRING_BLOCK_SIZE)
+      ? STRING_BLOCK_SIZE : buf->capacity;
+
+    while(capacity < newlen)
+      capacity *= 2;
+
+    buf->capacity = capacity;
     buf->string = (char *)libconfig_realloc(buf->string, buf->capacity);
   }
 }
@@ -53,12 +60,32 @@ char *libconfig_strbuf_release(strbuf_t *buf)
 
 /* ------------------------------------------------------------------------- */
 
-void libconfig_strbuf_append_string(strbuf_t *buf, const char *s)
+char *libconfig_strbuf_release_trimmed(strbuf_t *buf)
+{
+  char *r = buf->string;
+
+  if(r && (buf->capacity > (buf->length + 1)))
+    r = (char *)libconfig_realloc(r, buf->length + 1);
+
+  __zero(buf);
+  return(r);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_strbuf_append(strbuf_t *buf, const char *s, size_t len)
 {
-  size_t len = strlen(s);
   libconfig_strbuf_ensure_capacity(buf, len);
-  strcpy(buf->string + buf->length, s);
+  memcpy(buf->string + buf->length, s, len);
   buf->length += len;
+  *(buf->string + buf->length) = '\0';
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_strbuf_append_string(strbuf_t *buf, const char *s)
+{
+  libconfig_strbuf_append(buf, s, strlen(s));
 }
 
 /* ------------------------------------------------------------------------- */
@@ -72,3 +99,29 @@ void libconfig_strbuf_append_char(strbuf_t *buf, char c)
 }
 
 /* ------------------------------------------------------------------------- */
+
+void libconfig_strbuf_append_repeated(strbuf_t *buf, char c, size_t count)
+{
+  libconfig_strbuf_ensure_capacity(buf, count);
+  memset(buf->string + buf->length, c, count);
+  buf->length += count;
+  *(buf->string + buf->length) = '\0';
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_strbuf_take_string(strbuf_t *buf, char *s)
+{
+  if(! buf->string)
+  {
+    buf->string = s;
+    buf->length = strlen(s);
+    buf->capacity = buf->length + 1;
+    return;
+  }
+
+  libconfig_strbuf_append_string(buf, s);
+  __delete(s);
+}
+
+/* ------------------------------------------------------------------------- */
@@ -33,10 +33,24 @@ typedef struct
   size_t capacity;
 } strbuf_t;
 
+void libconfig_strbuf_append(strbuf_t *buf, const char *s, size_t len);
+
 void libconfig_strbuf_append_string(strbuf_t *buf, const char *s);
 
 void libconfig_strbuf_append_char(strbuf_t *buf, char c);
 
+void libconfig_strbuf_append_repeated(strbuf_t *buf, char c, size_t count);
+
+/* Appends the malloc'd string s and takes ownership of it. If the buffer is
+ * empty, s becomes its contents without being copied.
+ */
+void libconfig_strbuf_take_string(strbuf_t *buf, char *s);
+
 char *libconfig_strbuf_release(strbuf_t *buf);
 
+/* Like libconfig_strbuf_release(), but first shrinks the allocation to fit the
+ * string.
+ */
+char *libconfig_strbuf_release_trimmed(strbuf_t *buf);
+
 #endif /* __libconfig_strbuf_h */
@@ -0,0 +1,165 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#include "strpool.h"
+#include "util.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#define STRPOOL_INITIAL_SIZE 64
+
+/* The pool is an open-addressing hash set of strings, which are copied into
+ * an arena and live until the pool is destroyed. The hashes are those
+ * computed by libconfig_hash_string(), so callers that already have a
+ * string's hash can pass it in.
+ */
+
+/* ------------------------------------------------------------------------- */
+
+config_strpool_t *libconfig_strpool_create(void)
+{
+  config_strpool_t *pool = __new(config_strpool_t);
+
+  pool->arena = libconfig_arena_create();
+  pool->size = STRPOOL_INITIAL_SIZE;
+  pool->entries = (strpool_entry_t *)libconfig_calloc(
+    pool->size, sizeof(strpool_entry_t));
+
+  return(pool);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void libconfig_strpool_destroy(config_strpool_t *pool)
+{
+  if(! pool)
+    return;
+
+  libconfig_arena_destroy(pool->arena);
+  __delete(pool->entries);
+  __delete(pool);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static strpool_entry_t *__strpool_probe(const config_strpool_t *pool,
+                                        const char *s, size_t len,
+                                        unsigned int hash)
+{
+  unsigned int mask = pool->size - 1;
+  strpool_entry_t *entry;
+
+  for(entry = pool->entries + (hash & mask); entry->string;
+      entry = pool->entries + ((entry - pool->entries + 1) & mask))
+  {
+    if((entry->hash == hash) && ! strncmp(entry->string, s, len)
+       && (entry->string[len] == '\0'))
+      break;
+  }
+
+  return(entry);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void __strpool_grow(config_strpool_t *pool)
+{
+  strpool_entry_t *old = pool->entries, *entry;
+  unsigned int old_size = pool->size, mask, i;
+
+  pool->size *= 2;
+  pool->entries = (strpool_entry_t *)libconfig_calloc(
+    pool->size, sizeof(strpool_entry_t));
+  mask = pool->size - 1;
+
+  for(i = 0; i < old_size; ++i)
+  {
+    if(! old[i].string)
+      continue;
+
+    for(entry = pool->entries + (old[i].hash & mask); entry->string;
+        entry = pool->entries + ((entry - pool->entries + 1) & mask))
+      ;
+
+    *entry = old[i];
+  }
+
+  __delete(old);
+}
+
+/* ------------------------------------------------------------------------- */
+
+const char *libconfig_strpool_intern(config_strpool_t *pool, const char *s,
+                                     size_t len, unsigned int hash)
+{
+  strpool_entry_t *entry = __strpool_probe(pool, s, len, hash);
+  const char *copy;
+
+  if(entry->string)
+    return(entry->string);
+
+  /* Keep the load factor at or below 1/2. */
+  if(((pool->count + 1) * 2) > pool->size)
+  {
+    __strpool_grow(pool);
+    entry = __strpool_probe(pool, s, len, hash);
+  }
+
+  copy = libconfig_arena_strndup(pool->arena, s, len);
+
+  entry->string = copy;
+  entry->hash = hash;
+  ++(pool->count);
+
+  return(copy);
+}
+
+/* ------------------------------------------------------------------------- */
+
+const char *libconfig_strpool_find(const config_strpool_t *pool,
+                                   const char *s, size_t len,
+                                   unsigned int hash)
+{
+  return(__strpool_probe(pool, s, len, hash)->string);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int libconfig_strpool_owns(const config_strpool_t *pool, const char *s,
+                           unsigned int hash)
+{
+  unsigned int mask = pool->size - 1;
+  const strpool_entry_t *entry;
+
+  /* Only the pointer is compared, so this does not read the string. */
+  for(entry = pool->entries + (hash & mask); entry->string;
+      entry = pool->entries + ((entry - pool->entries + 1) & mask))
+  {
+    if(entry->string == s)
+      return(1);
+  }
+
+  return(0);
+}
+
+/* ------------------------------------------------------------------------- */
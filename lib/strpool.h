@@ -0,0 +1,60 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __libconfig_strpool_h
+#define __libconfig_strpool_h
+
+#include <string.h>
+#include <sys/types.h>
+
+#include "arena.h"
+
+typedef struct
+{
+  const char *string;
+  unsigned int hash;
+} strpool_entry_t;
+
+typedef struct config_strpool_t
+{
+  config_arena_t *arena;
+  strpool_entry_t *entries;
+  unsigned int size;
+  unsigned int count;
+} config_strpool_t;
+
+extern config_strpool_t *libconfig_strpool_create(void);
+
+extern void libconfig_strpool_destroy(config_strpool_t *pool);
+
+extern const char *libconfig_strpool_intern(config_strpool_t *pool,
+                                            const char *s, size_t len,
+                                            unsigned int hash);
+
+extern const char *libconfig_strpool_find(const config_strpool_t *pool,
+                                          const char *s, size_t len,
+                                          unsigned int hash);
+
+extern int libconfig_strpool_owns(const config_strpool_t *pool,
+                                  const char *s, unsigned int hash);
+
+#endif /* __libconfig_strpool_h */
@@ -94,6 +94,23 @@ void *libconfig_realloc(void *ptr, size_t size)
 
 /* ------------------------------------------------------------------------- */
 
+unsigned int libconfig_hash_string(const char *s, size_t len)
+{
+  /* 32-bit FNV-1a. */
+  unsigned int h = 2166136261U;
+  const unsigned char *p = (const unsigned char *)s;
+
+  while(len--)
+  {
+    h ^= *p++;
+    h *= 16777619U;
+  }
+
+  return(h);
+}
+
+/* ------------------------------------------------------------------------- */
+
 long long libconfig_parse_integer(const char *s, int *ok, int L)
 {
   long long llval;
@@ -246,70 +263,3 @@ unsigned long long libconfig_parse_bin64(const char *s, int * ok, int L)
 {
  return parse_uinteger(s,ok,L,2);
 }
-
-/* ------------------------------------------------------------------------- */
-
-void libconfig_format_double(double val, int precision, int sci_ok, char *buf,
-                             size_t buflen)
-{
-  const char *fmt = sci_ok ? "%.*g" : "%.*f";
-  char *p, *q;
-
-  snprintf(buf, buflen - 3, fmt, precision, val);
-
-  /* Check for exponent. */
-  p = strchr(buf, 'e');
-  if(p) return;
-
-  /* Check for decimal point. */
-  p = strchr(buf, '.');
-  if(!p)
-  {
-    /* No decimal point. Add trailing ".0". */
-    strcat(buf, ".0");
-  }
-  else
-  {
-    /* Remove any excess trailing 0's after decimal point. */
-    for(q = buf + strlen(buf) - 1; q > p + 1; --q)
-    {
-      if(*q == '0')
-        *q = '\0';
-      else
-        break;
-    }
-  }
-}
-
-/* ------------------------------------------------------------------------- */
-
-
-#ifdef __GNUC__
-#define clzl(x) __builtin_clzl(x)
-#else
-static int clzl(int64_t val)
-{
-  int leading = 0;
-  int64_t check = (1ll << 63);
-  while (!(val & check) && check)
-  {
-    leading++;
-    check >>= 1;
-  }
-  return leading;
-}
-#endif
-
-void libconfig_format_bin(int64_t val, char *buf, size_t buflen)
-{
-  /* find number of leading 0's */
-  unsigned c = clzl(val);
-  unsigned i = 0;
-  while ( (c < 64) && (i < buflen - 1) )
-  {
-    buf[i] = (val & (1ll << (63 - c))) ? '1' : '0';
-    i++;
-    c++;
-  }
-  buf[i] = 0;
-}
@@ -35,10 +35,9 @@ extern void *libconfig_realloc(void *ptr, size_t size);
 #define __delete(P) free((void *)(P))
 #define __zero(P) memset((void *)(P), 0, sizeof(*P))
 
+extern unsigned int libconfig_hash_string(const char *s, size_t len);
+
 extern long long libconfig_parse_integer(const char *s, int *ok, int L_ok);
 extern unsigned long long libconfig_parse_hex64(const char *s, int *ok, int L_ok);
 extern unsigned long long libconfig_parse_bin64(const char *s, int *ok, int L_ok);
 
-extern void libconfig_format_double(double val, int precision, int sci_ok,
-                                    char *buf, size_t buflen);
-extern void libconfig_format_bin(int64_t val, char *buf, size_t buflen);
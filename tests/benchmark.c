@@ -0,0 +1,1526 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+/*
+ * Micro-benchmarks for libconfig. These are not part of the test suite; run
+ * the program with no arguments to run every benchmark, or pass the names of
+ * the benchmarks to run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__GLIBC__) \
+  && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 33)))
+#include <malloc.h>
+#define HAVE_MALLINFO2
+#endif
+
+#include <libconfig.h>
+
+/* The lexer benchmark drives the scanner directly. */
+#include "parsectx.h"
+#include "scanctx.h"
+#include "grammar.h"
+#include "scanner.h"
+
+/* ------------------------------------------------------------------------- */
+
+static double bench_now(void)
+{
+#if defined(_WIN32)
+  LARGE_INTEGER freq, now;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&now);
+  return((double)now.QuadPart / (double)freq.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((double)ts.tv_sec + ((double)ts.tv_nsec / 1e9));
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns the number of bytes currently allocated from the heap, or 0 if
+ * that cannot be determined on this platform.
+ */
+static size_t bench_heap_in_use(void)
+{
+#if defined(HAVE_MALLINFO2)
+  struct mallinfo2 mi = mallinfo2();
+  return(mi.uordblks + mi.hblkhd);
+#else
+  return(0);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Lookup time should stay flat as the group gets wider. */
+
+static void bench_wide_group_lookup(void)
+{
+  static const int widths[] = { 8, 64, 512, 4096, 32768, 65536, 0 };
+  const int lookups = 1000000;
+  const int *width;
+
+  for(width = widths; *width; ++width)
+  {
+    config_t cfg;
+    config_setting_t *root;
+    char name[32];
+    double start, elapsed;
+    int i, found = 0;
+
+    config_init(&cfg);
+    root = config_root_setting(&cfg);
+
+    for(i = 0; i < *width; ++i)
+    {
+      sprintf(name, "member_%d", i);
+      config_setting_set_int(config_setting_add(root, name, CONFIG_TYPE_INT),
+                             i);
+    }
+
+    start = bench_now();
+    for(i = 0; i < lookups; ++i)
+    {
+      sprintf(name, "member_%d", (int)((i * 2654435761U) % *width));
+      if(config_setting_get_member(root, name))
+        ++found;
+    }
+    elapsed = bench_now() - start;
+
+    printf("wide_group_lookup: width=%-6d %8.1f ns/lookup (%d found)\n",
+           *width, (elapsed * 1e9) / lookups, found);
+
+    config_destroy(&cfg);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Builds a configuration of roughly 200000 settings in groups of 100. */
+
+static char *bench_make_config(int groups)
+{
+  size_t size = (size_t)groups * 4096, len = 0;
+  char *text = (char *)malloc(size);
+  int g, i;
+
+  for(g = 0; g < groups; ++g)
+  {
+    len += sprintf(text + len, "group_%d = {\n", g);
+    for(i = 0; i < 25; ++i)
+    {
+      len += sprintf(text + len,
+                     "  int_%d = %d;\n  float_%d = %d.5;\n"
+                     "  str_%d = \"value %d\";\n  list_%d = ( %d );\n",
+                     i, i, i, i, i, i, i, i);
+    }
+    len += sprintf(text + len, "};\n");
+  }
+
+  return(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Parse and teardown times, with and without CONFIG_OPTION_ARENA. */
+
+static void bench_arena_load(void)
+{
+  char *text = bench_make_config(2000);
+  int arena;
+
+  for(arena = 0; arena <= 1; ++arena)
+  {
+    config_t cfg;
+    double start, parsed, destroyed;
+
+    config_init(&cfg);
+    config_set_option(&cfg, CONFIG_OPTION_ARENA, arena);
+
+    start = bench_now();
+    if(! config_read_string(&cfg, text))
+      printf("arena_load: parse error on line %d\n", config_error_line(&cfg));
+    parsed = bench_now();
+    config_destroy(&cfg);
+    destroyed = bench_now();
+
+    printf("arena_load: arena=%d parse %8.2f ms, destroy %8.2f ms\n",
+           arena, (parsed - start) * 1e3, (destroyed - parsed) * 1e3);
+  }
+
+  free(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Heap usage of a long list of groups with the same members, with and without
+ * interning.
+ */
+
+static void bench_intern_memory(void)
+{
+  static const struct
+  {
+    const char *label;
+    int options;
+  } modes[] = {
+    { "plain", 0 },
+    { "intern names", CONFIG_OPTION_INTERN_NAMES },
+    { "intern names+strings",
+      CONFIG_OPTION_INTERN_NAMES | CONFIG_OPTION_INTERN_STRINGS },
+    { "arena+intern names+strings", CONFIG_OPTION_ARENA
+      | CONFIG_OPTION_INTERN_NAMES | CONFIG_OPTION_INTERN_STRINGS },
+    { NULL, 0 }
+  };
+  const int count = 50000;
+  size_t len = 0;
+  char *text = (char *)malloc((size_t)count * 128 + 32);
+  int i, m;
+
+  len += sprintf(text + len, "servers = (\n");
+  for(i = 0; i < count; ++i)
+  {
+    len += sprintf(text + len,
+                   "  { host = \"host%d\"; port = %d; protocol = \"tcp\";"
+                   " enabled = true; weight = %d; },\n",
+                   i % 100, 8000 + (i % 1000), i % 10);
+  }
+  sprintf(text + len - 2, "\n);\n");
+
+  for(m = 0; modes[m].label; ++m)
+  {
+    config_t cfg;
+    size_t before, after;
+    double start, elapsed;
+
+    config_init(&cfg);
+    config_set_options(&cfg, config_get_options(&cfg) | modes[m].options);
+
+    before = bench_heap_in_use();
+    start = bench_now();
+    if(! config_read_string(&cfg, text))
+      printf("intern_memory: parse error on line %d\n",
+             config_error_line(&cfg));
+    elapsed = bench_now() - start;
+    after = bench_heap_in_use();
+
+    printf("intern_memory: %-28s %8.2f MB heap, parse %8.2f ms\n",
+           modes[m].label, (double)(after - before) / (1024.0 * 1024.0),
+           elapsed * 1e3);
+
+    config_destroy(&cfg);
+  }
+
+  free(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Writes a configuration of about `megabytes' MB to the named file. */
+
+static int bench_write_file(const char *filename, int megabytes)
+{
+  FILE *fp = fopen(filename, "wb");
+  long size = 0, limit = (long)megabytes * 1024 * 1024;
+  int g = 0, i;
+
+  if(! fp)
+    return(0);
+
+  while(size < limit)
+  {
+    size += fprintf(fp, "group_%d = {\n", g++);
+    for(i = 0; i < 1000; ++i)
+    {
+      size += fprintf(fp, "  // setting %d of group %d\n"
+                      "  key_%d = \"%s\"; value_%d = %d.25;\n", i, g, i,
+                      "the quick brown fox jumps over the lazy dog", i, i);
+    }
+    size += fprintf(fp, "};\n");
+  }
+
+  fclose(fp);
+  return(1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* config_read_file(), which scans regular files in place, against reading the
+ * same file through a stdio stream.
+ */
+
+static void bench_read_file(void)
+{
+  static const int sizes[] = { 1, 10, 100, 0 };
+  const char *filename = "bench_read_file.cfg";
+  const int *mb;
+
+  for(mb = sizes; *mb; ++mb)
+  {
+    int mode;
+
+    if(! bench_write_file(filename, *mb))
+    {
+      printf("read_file: cannot write %s\n", filename);
+      return;
+    }
+
+    for(mode = 0; mode <= 1; ++mode)
+    {
+      config_t cfg;
+      double start, elapsed;
+      int ok;
+
+      config_init(&cfg);
+      config_set_option(&cfg, CONFIG_OPTION_ARENA, CONFIG_TRUE);
+
+      start = bench_now();
+      if(mode == 0)
+      {
+        FILE *fp = fopen(filename, "rt");
+        ok = config_read(&cfg, fp);
+        fclose(fp);
+      }
+      else
+        ok = config_read_file(&cfg, filename);
+      elapsed = bench_now() - start;
+
+      printf("read_file: %3d MB %-6s %8.2f ms %8.1f MB/s%s\n", *mb,
+             mode ? "file" : "stream", elapsed * 1e3, *mb / elapsed,
+             ok ? "" : " (parse error)");
+
+      config_destroy(&cfg);
+    }
+  }
+
+  remove(filename);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Scanning of long string literals: one 1 MB string with no escapes, the same
+ * string split into adjacent 64-byte literals, and a 1 MB string in which
+ * every fourth character is escaped.
+ */
+
+static void bench_scan_strings(void)
+{
+  static const char *labels[] = { "plain", "concatenated", "escaped" };
+  const size_t length = 1024 * 1024;
+  const int rounds = 20;
+  char *text = (char *)malloc(length * 3 + 64);
+  int kind;
+
+  for(kind = 0; kind < 3; ++kind)
+  {
+    config_t cfg;
+    size_t i, len = 0;
+    double start, elapsed;
+    int r, ok = 1;
+
+    len += sprintf(text, "cert = \"");
+    for(i = 0; i < length; ++i)
+    {
+      if((kind == 1) && (i > 0) && ((i % 64) == 0))
+        len += sprintf(text + len, "\"\n  \"");
+
+      if((kind == 2) && ((i % 4) == 3))
+      {
+        text[len++] = '\\';
+        text[len++] = 'n';
+      }
+      else
+        text[len++] = (char)('A' + (i % 26));
+    }
+    sprintf(text + len, "\";\n");
+
+    config_init(&cfg);
+
+    start = bench_now();
+    for(r = 0; r < rounds; ++r)
+      ok &= config_read_string(&cfg, text);
+    elapsed = (bench_now() - start) / rounds;
+
+    printf("scan_strings: %-12s %8.2f ms %8.1f MB/s%s\n", labels[kind],
+           elapsed * 1e3, 1.0 / elapsed, ok ? "" : " (parse error)");
+
+    config_destroy(&cfg);
+  }
+
+  free(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Evaluating the same 300 paths as strings and as compiled paths. */
+
+static void bench_compiled_paths(void)
+{
+  const int count = 300, rounds = 10000;
+  char *text = bench_make_config(100);
+  char (*paths)[64] = (char (*)[64])calloc(count, 64);
+  config_path_t **compiled = (config_path_t **)calloc(count,
+                                                      sizeof(config_path_t *));
+  config_t cfg;
+  int mode, i, r;
+
+  config_init(&cfg);
+  if(! config_read_string(&cfg, text))
+    printf("compiled_paths: parse error on line %d\n", config_error_line(&cfg));
+
+  for(i = 0; i < count; ++i)
+  {
+    int g = (int)((i * 2654435761U) % 100), m = i % 25;
+
+    if(i % 3 == 0)
+      sprintf(paths[i], "group_%d.str_%d", g, m);
+    else if(i % 3 == 1)
+      sprintf(paths[i], "group_%d.list_%d.[0]", g, m);
+    else
+      sprintf(paths[i], "group_%d.float_%d", g, m);
+
+    compiled[i] = config_path_compile(paths[i]);
+  }
+
+  for(mode = 0; mode <= 1; ++mode)
+  {
+    double start, elapsed;
+    int found = 0;
+
+    start = bench_now();
+    for(r = 0; r < rounds; ++r)
+    {
+      for(i = 0; i < count; ++i)
+      {
+        if(mode ? config_lookup_path(&cfg, compiled[i])
+           : config_lookup(&cfg, paths[i]))
+          ++found;
+      }
+    }
+    elapsed = bench_now() - start;
+
+    printf("compiled_paths: %-8s %8.1f ns/lookup (%d found)\n",
+           mode ? "compiled" : "string", (elapsed * 1e9) / (count * rounds),
+           found);
+  }
+
+  for(i = 0; i < count; ++i)
+    config_path_free(compiled[i]);
+
+  free(compiled);
+  free(paths);
+  config_destroy(&cfg);
+  free(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* 300 typed lookups, 25 under each of 12 groups, made one at a time and as a
+ * batch.
+ */
+
+static void bench_batch_lookup(void)
+{
+  const int count = 300, rounds = 10000;
+  char *text = bench_make_config(100);
+  char (*paths)[64] = (char (*)[64])calloc(count, 64);
+  config_lookup_entry_t *entries = (config_lookup_entry_t *)calloc(
+    count, sizeof(config_lookup_entry_t));
+  int *values = (int *)calloc(count, sizeof(int));
+  config_t cfg;
+  int mode, i, r;
+
+  config_init(&cfg);
+  if(! config_read_string(&cfg, text))
+    printf("batch_lookup: parse error on line %d\n", config_error_line(&cfg));
+
+  for(i = 0; i < count; ++i)
+  {
+    sprintf(paths[i], "group_%d.int_%d", i / 25, i % 25);
+    entries[i].path = paths[i];
+    entries[i].type = CONFIG_TYPE_INT;
+    entries[i].value = &values[i];
+  }
+
+  for(mode = 0; mode <= 1; ++mode)
+  {
+    double start, elapsed;
+    int found = 0;
+
+    start = bench_now();
+    for(r = 0; r < rounds; ++r)
+    {
+      if(mode)
+        found += config_lookup_values(&cfg, entries, count);
+      else
+      {
+        for(i = 0; i < count; ++i)
+          found += config_lookup_int(&cfg, paths[i], &values[i]);
+      }
+    }
+    elapsed = bench_now() - start;
+
+    printf("batch_lookup: %-8s %8.1f ns/lookup (%d found)\n",
+           mode ? "batch" : "single", (elapsed * 1e9) / (count * rounds),
+           found);
+  }
+
+  config_destroy(&cfg);
+  free(values);
+  free(entries);
+  free(paths);
+  free(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Per-call overhead: parsing a tiny fragment over and over. */
+
+static void bench_tiny_reads(void)
+{
+  const char *text = "port = 8080; ratio = 0.75;";
+  const int rounds = 500000;
+  config_t cfg;
+  double start, elapsed;
+  int i, ok = 1;
+
+  config_init(&cfg);
+
+  start = bench_now();
+  for(i = 0; i < rounds; ++i)
+    ok &= config_read_string(&cfg, text);
+  elapsed = bench_now() - start;
+
+  printf("tiny_reads: %8.1f ns/read%s\n", (elapsed * 1e9) / rounds,
+         ok ? "" : " (parse error)");
+
+  config_destroy(&cfg);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Serializing a large tree: to a file, to a stdio stream, and to memory. */
+
+static void bench_write(void)
+{
+  const char *filename = "bench_write.cfg";
+  const char *outname = "bench_write.out";
+  config_t cfg;
+  int mode;
+
+  if(! bench_write_file(filename, 50))
+  {
+    printf("write: cannot write %s\n", filename);
+    return;
+  }
+
+  config_init(&cfg);
+  if(! config_read_file(&cfg, filename))
+    printf("write: parse error on line %d\n", config_error_line(&cfg));
+
+  for(mode = 0; mode < 3; ++mode)
+  {
+    static const char *labels[] = { "file", "stream", "string" };
+    double start, elapsed;
+    size_t length = 0;
+
+    start = bench_now();
+    if(mode == 0)
+      config_write_file(&cfg, outname);
+    else if(mode == 1)
+    {
+      FILE *fp = fopen(outname, "wt");
+      config_write(&cfg, fp);
+      fclose(fp);
+    }
+    else
+      free(config_write_string(&cfg, &length));
+    elapsed = bench_now() - start;
+
+    if(mode < 2)
+    {
+      FILE *fp = fopen(outname, "rb");
+      fseek(fp, 0, SEEK_END);
+      length = (size_t)ftell(fp);
+      fclose(fp);
+    }
+
+    printf("write: %-6s %8.2f ms %8.1f MB/s\n", labels[mode], elapsed * 1e3,
+           (double)length / (1024.0 * 1024.0) / elapsed);
+  }
+
+  config_destroy(&cfg);
+  remove(outname);
+  remove(filename);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void bench_format_numbers(void)
+{
+  static const struct
+  {
+    const char *label;
+    int type;
+    int format;
+    int options;
+  } modes[] = {
+    { "float %f", CONFIG_TYPE_FLOAT, CONFIG_FORMAT_DEFAULT, 0 },
+    { "float %g", CONFIG_TYPE_FLOAT, CONFIG_FORMAT_DEFAULT,
+      CONFIG_OPTION_ALLOW_SCIENTIFIC_NOTATION },
+    { "float shortest", CONFIG_TYPE_FLOAT, CONFIG_FORMAT_DEFAULT,
+      CONFIG_OPTION_ALLOW_SCIENTIFIC_NOTATION
+      | CONFIG_OPTION_SHORTEST_FLOATS },
+    { "int64 decimal", CONFIG_TYPE_INT64, CONFIG_FORMAT_DEFAULT, 0 },
+    { "int64 hex", CONFIG_TYPE_INT64, CONFIG_FORMAT_HEX, 0 },
+    { "int64 binary", CONFIG_TYPE_INT64, CONFIG_FORMAT_BIN, 0 }
+  };
+  const int count = 1000000;
+  unsigned int seed = 12345;
+  size_t m;
+
+  for(m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m)
+  {
+    config_t cfg;
+    config_setting_t *array;
+    double start, elapsed;
+    size_t length;
+    int i;
+
+    config_init(&cfg);
+    config_set_options(&cfg, modes[m].options);
+    array = config_setting_add(config_root_setting(&cfg), "table",
+                               CONFIG_TYPE_ARRAY);
+
+    for(i = 0; i < count; ++i)
+    {
+      config_setting_t *elem = config_setting_add(array, NULL, modes[m].type);
+      seed = seed * 1103515245 + 12345;
+
+      if(modes[m].type == CONFIG_TYPE_FLOAT)
+        config_setting_set_float(elem, (seed >> 8) * 1e-4 - 800.0);
+      else
+      {
+        config_setting_set_int64(elem, (long long)seed * (seed >> 12));
+        config_setting_set_format(elem, (short)modes[m].format);
+      }
+    }
+
+    start = bench_now();
+    free(config_write_string(&cfg, &length));
+    elapsed = bench_now() - start;
+
+    printf("format_numbers: %-14s %6.1f ns/value %8.1f MB/s\n",
+           modes[m].label, (elapsed * 1e9) / count,
+           (double)length / (1024.0 * 1024.0) / elapsed);
+
+    config_destroy(&cfg);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void bench_snapshot_load(void)
+{
+  const char *filename = "bench_snapshot.cfg";
+  const char *binname = "bench_snapshot.bin";
+  config_t cfg;
+  int mode;
+
+  if(! bench_write_file(filename, 30))
+  {
+    printf("snapshot_load: cannot write %s\n", filename);
+    return;
+  }
+
+  for(mode = 0; mode < 4; ++mode)
+  {
+    static const char *labels[] = {
+      "text", "text+arena", "binary", "binary+lines"
+    };
+    double start, elapsed;
+    int ok;
+
+    if(mode >= 2)
+    {
+      config_init(&cfg);
+      config_read_file(&cfg, filename);
+      config_write_binary(&cfg, binname,
+                          (mode == 3) ? CONFIG_BINARY_SOURCE_INFO : 0);
+      config_destroy(&cfg);
+    }
+
+    config_init(&cfg);
+    if(mode == 1)
+      config_set_option(&cfg, CONFIG_OPTION_ARENA, CONFIG_TRUE);
+
+    start = bench_now();
+    if(mode < 2)
+      ok = config_read_file(&cfg, filename);
+    else
+      ok = config_read_binary(&cfg, binname);
+    config_destroy(&cfg);
+    elapsed = bench_now() - start;
+
+    printf("snapshot_load: %-12s %8.2f ms (load and destroy)%s\n",
+           labels[mode], elapsed * 1e3, ok ? "" : " (error)");
+  }
+
+  remove(binname);
+  remove(filename);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reloading a configuration made of many included fragments, with and
+ * without an include cache; none of the fragments change between reloads.
+ */
+
+static void bench_include_cache(void)
+{
+  static const int FRAGMENTS = 200, SETTINGS = 200, RELOADS = 10;
+  const char *filename = "bench_include.cfg";
+  char fragment[64];
+  config_include_cache_t *cache;
+  unsigned long hits, misses;
+  FILE *fp, *frag;
+  int f, i, mode;
+
+  fp = fopen(filename, "wb");
+  if(! fp)
+  {
+    printf("include_cache: cannot write %s\n", filename);
+    return;
+  }
+
+  for(f = 0; f < FRAGMENTS; ++f)
+  {
+    sprintf(fragment, "bench_include_%d.cfg", f);
+    frag = fopen(fragment, "wb");
+    if(! frag)
+      break;
+
+    for(i = 0; i < SETTINGS; ++i)
+      fprintf(frag, "key_%d = \"%s\"; value_%d = %d.25;\n", i,
+              "the quick brown fox jumps over the lazy dog", i, i);
+    fclose(frag);
+
+    fprintf(fp, "service_%d = {\n@include \"%s\"\n};\n", f, fragment);
+  }
+
+  fclose(fp);
+
+  cache = config_include_cache_create();
+
+  for(mode = 0; mode <= 1; ++mode)
+  {
+    config_t cfg;
+    double start, first = 0, elapsed;
+    int ok = 1;
+
+    config_init(&cfg);
+    if(mode == 1)
+      config_set_include_cache(&cfg, cache);
+
+    start = bench_now();
+    for(i = 0; i <= RELOADS; ++i)
+    {
+      ok &= config_read_file(&cfg, filename);
+      if(i == 0)
+        first = bench_now() - start;
+    }
+    elapsed = bench_now() - start - first;
+
+    printf("include_cache: %-8s first %8.2f ms, reload %8.2f ms%s\n",
+           mode ? "cached" : "uncached", first * 1e3,
+           elapsed * 1e3 / RELOADS, ok ? "" : " (error)");
+
+    config_destroy(&cfg);
+  }
+
+  config_include_cache_get_stats(cache, &hits, &misses);
+  printf("include_cache: %lu hits, %lu misses\n", hits, misses);
+  config_include_cache_destroy(cache);
+
+  for(f = 0; f < FRAGMENTS; ++f)
+  {
+    sprintf(fragment, "bench_include_%d.cfg", f);
+    remove(fragment);
+  }
+
+  remove(filename);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void bench_count_change(config_diff_t change, const char *path,
+                               const config_setting_t *old_setting,
+                               const config_setting_t *new_setting,
+                               void *context)
+{
+  ++*(unsigned int *)context;
+}
+
+/* Diffing a reloaded tree against the old one, with a few changes, as the
+ * tree grows to about 10^6 settings; the time per setting should stay flat.
+ */
+
+static void bench_diff(void)
+{
+  static const int sizes[] = { 1000, 2000, 4000, 8000, 0 };
+  const int *groups;
+
+  for(groups = sizes; *groups; ++groups)
+  {
+    char *text = bench_make_config(*groups);
+    config_t cfg, cfg2;
+    double start, elapsed;
+    unsigned int count = 0, nodes;
+    int g;
+
+    config_init(&cfg);
+    config_init(&cfg2);
+    config_read_string(&cfg, text);
+    config_read_string(&cfg2, text);
+
+    for(g = 0; g < *groups; g += 100)
+    {
+      char path[64];
+
+      sprintf(path, "group_%d.int_7", g);
+      config_setting_set_int(config_lookup(&cfg2, path), -1);
+    }
+
+    /* Each group holds 100 settings, 25 of them lists of one element. */
+    nodes = (unsigned int)*groups * 126;
+
+    start = bench_now();
+    config_diff(config_root_setting(&cfg), config_root_setting(&cfg2),
+                bench_count_change, &count);
+    elapsed = bench_now() - start;
+
+    printf("diff: %8u settings %8.2f ms %6.1f ns/setting, %u changes\n",
+           nodes, elapsed * 1e3, elapsed * 1e9 / nodes, count);
+
+    config_destroy(&cfg2);
+    config_destroy(&cfg);
+    free(text);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Copies a setting one add and one set at a time, the way an application
+ * would have to without config_setting_copy().
+ */
+static void bench_copy_by_hand(config_setting_t *parent,
+                               const config_setting_t *src)
+{
+  config_setting_t *copy = config_setting_add(parent, src->name, src->type);
+  unsigned int i;
+
+  switch(src->type)
+  {
+    case CONFIG_TYPE_GROUP:
+    case CONFIG_TYPE_ARRAY:
+    case CONFIG_TYPE_LIST:
+      for(i = 0; i < (unsigned int)config_setting_length(src); ++i)
+        bench_copy_by_hand(copy, config_setting_get_elem(src, i));
+      break;
+
+    case CONFIG_TYPE_STRING:
+      config_setting_set_string(copy, config_setting_get_string(src));
+      break;
+
+    default:
+      copy->value = src->value;
+      break;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void bench_copy(void)
+{
+  static const int options[] = { 0, CONFIG_OPTION_ARENA, -1 };
+  char *text = bench_make_config(8000);
+  config_t src;
+  const int *option;
+
+  /* 8000 groups of 100 settings, 25 of them lists of one element. */
+  config_init(&src);
+  config_read_string(&src, text);
+
+  for(option = options; *option >= 0; ++option)
+  {
+    config_t dst;
+    double start, by_hand, copied;
+    config_setting_t *copy;
+
+    config_init(&dst);
+    config_set_options(&dst, *option);
+    start = bench_now();
+    bench_copy_by_hand(config_root_setting(&dst),
+                       config_root_setting(&src));
+    by_hand = bench_now() - start;
+    config_destroy(&dst);
+
+    config_init(&dst);
+    config_set_options(&dst, *option);
+    start = bench_now();
+    copy = config_setting_copy(config_root_setting(&dst),
+                               config_root_setting(&src), "copy");
+    copied = bench_now() - start;
+
+    printf("copy: %u settings%s: by hand %8.2f ms, copied %8.2f ms, "
+           "%u differences\n", 8000 * 126, *option ? " (arena)" : "",
+           by_hand * 1e3, copied * 1e3,
+           config_diff(config_root_setting(&src), copy, NULL, NULL));
+    config_destroy(&dst);
+  }
+
+  config_destroy(&src);
+  free(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Heap usage and parse and read times of a large array of floats, packed and
+ * once its element settings have been made.
+ */
+
+static void bench_packed_array(void)
+{
+  const int count = 1000000;
+  size_t len = 0, before, packed, expanded;
+  char *text = (char *)malloc((size_t)count * 16 + 32);
+  config_t cfg;
+  config_setting_t *array;
+  double start, parsed, read, sum = 0.0;
+  int i;
+
+  len += sprintf(text + len, "samples = [");
+  for(i = 0; i < count; ++i)
+    len += sprintf(text + len, " %d.25,", i % 1000);
+  sprintf(text + len - 1, " ];\n");
+
+  config_init(&cfg);
+
+  before = bench_heap_in_use();
+  start = bench_now();
+  if(! config_read_string(&cfg, text))
+    printf("packed_array: parse error on line %d\n", config_error_line(&cfg));
+  parsed = bench_now() - start;
+  packed = bench_heap_in_use();
+
+  array = config_lookup(&cfg, "samples");
+  start = bench_now();
+  for(i = 0; i < count; ++i)
+    sum += config_setting_get_float_elem(array, i);
+  read = bench_now() - start;
+
+  printf("packed_array: %d floats: packed %8.2f MB heap, parse %8.2f ms, "
+         "read %8.2f ms (sum %.0f)\n", count,
+         (double)(packed - before) / (1024.0 * 1024.0), parsed * 1e3,
+         read * 1e3, sum);
+
+  config_setting_get_elem(array, 0);
+  expanded = bench_heap_in_use();
+
+  printf("packed_array: %d floats: with element settings %8.2f MB heap\n",
+         count, (double)(expanded - before) / (1024.0 * 1024.0));
+
+  config_destroy(&cfg);
+  free(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reading and building an array of 10^6 floats one element at a time and in
+ * bulk.
+ */
+
+static void bench_bulk_array(void)
+{
+  const unsigned int count = 1000000;
+  double *values = (double *)malloc(count * sizeof(double));
+  double start, by_elem, bulk, sum = 0.0;
+  config_t cfg;
+  config_setting_t *array;
+  unsigned int i;
+
+  for(i = 0; i < count; ++i)
+    values[i] = (double)(i % 1000) + 0.25;
+
+  config_init(&cfg);
+  array = config_setting_add(config_root_setting(&cfg), "samples",
+                             CONFIG_TYPE_ARRAY);
+
+  start = bench_now();
+  for(i = 0; i < count; ++i)
+    config_setting_set_float_elem(array, -1, values[i]);
+  by_elem = bench_now() - start;
+
+  config_setting_remove(config_root_setting(&cfg), "samples");
+  array = config_setting_add(config_root_setting(&cfg), "samples",
+                             CONFIG_TYPE_ARRAY);
+
+  start = bench_now();
+  config_setting_set_float_array(array, values, count);
+  bulk = bench_now() - start;
+
+  printf("bulk_array: set %u floats: by element %8.2f ms, bulk %8.2f ms\n",
+         count, by_elem * 1e3, bulk * 1e3);
+
+  start = bench_now();
+  for(i = 0; i < count; ++i)
+    sum += config_setting_get_float_elem(array, (int)i);
+  by_elem = bench_now() - start;
+
+  start = bench_now();
+  config_setting_get_float_array(array, values, count);
+  for(i = 0; i < count; ++i)
+    sum -= values[i];
+  bulk = bench_now() - start;
+
+  printf("bulk_array: get %u floats: by element %8.2f ms, bulk %8.2f ms "
+         "(%.0f)\n", count, by_elem * 1e3, bulk * 1e3, sum);
+
+  config_destroy(&cfg);
+  free(values);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int bench_is_odd(const config_setting_t *setting, void *context)
+{
+  (void)context;
+  return(config_setting_get_int(setting) & 1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Index queries over, and pruning of, a list of 10^5 groups. */
+
+static void bench_remove(void)
+{
+  const int count = 100000;
+  config_t cfg;
+  config_setting_t *list;
+  double start, indexed, by_elem, by_predicate, front;
+  long sum = 0;
+  int i, pass;
+
+  for(pass = 0; pass < 3; ++pass)
+  {
+    config_init(&cfg);
+    list = config_setting_add(config_root_setting(&cfg), "list",
+                              CONFIG_TYPE_LIST);
+    for(i = 0; i < count; ++i)
+      config_setting_set_int_elem(list, -1, i);
+
+    if(pass == 0)
+    {
+      start = bench_now();
+      for(i = 0; i < count; ++i)
+        sum += config_setting_index(config_setting_get_elem(list, i));
+      indexed = bench_now() - start;
+
+      start = bench_now();
+      for(i = count - 1; i >= 0; --i)
+      {
+        if(config_setting_get_int_elem(list, i) & 1)
+          config_setting_remove_elem(list, i);
+      }
+      by_elem = bench_now() - start;
+    }
+    else if(pass == 1)
+    {
+      start = bench_now();
+      config_setting_remove_if(list, bench_is_odd, NULL);
+      by_predicate = bench_now() - start;
+    }
+    else
+    {
+      /* Pruning from the front, asking for the index of the last element
+       * after each removal.
+       */
+      start = bench_now();
+      for(i = 0; i < count / 2; ++i)
+      {
+        config_setting_remove_setting(config_setting_get_elem(list, 0));
+        sum += config_setting_index(config_setting_get_elem(
+                                      list, (unsigned int)(count - i - 2)));
+      }
+      front = bench_now() - start;
+    }
+
+    config_destroy(&cfg);
+  }
+
+  printf("remove: %d elements: index all %8.2f ms (%ld), prune by element "
+         "%8.2f ms, by predicate %8.2f ms, from the front %8.2f ms\n", count,
+         indexed * 1e3, sum, by_elem * 1e3, by_predicate * 1e3, front * 1e3);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Lexer throughput, without the parser: mostly comments, mostly long strings,
+ * and an ordinary mix of settings, comments and indentation.
+ */
+
+static void bench_lex(void)
+{
+  static const char *labels[] = { "comments", "strings", "mixed" };
+  const size_t size = 32 * 1024 * 1024;
+  const int rounds = 5;
+  char *text = (char *)malloc(size + 1024);
+  int kind;
+
+  for(kind = 0; kind < 3; ++kind)
+  {
+    size_t len = 0;
+    double start, elapsed;
+    long tokens = 0;
+    int r, i = 0;
+
+    while(len < size)
+    {
+      if(kind == 0)
+        len += sprintf(text + len,
+                       "// Line comment number %d, which explains the "
+                       "setting below it at some length.\n"
+                       "/* A block comment\n * that spans\n * three lines."
+                       " */\nkey_%d = %d;\n", i, i, i);
+      else if(kind == 1)
+        len += sprintf(text + len,
+                       "key_%d = \"-----BEGIN CERTIFICATE----- MIIDdzCCAl"
+                       "+gAwIBAgIEAgAAuTANBgkqhkiG9w0BAQUFADBaMQswCQYDVQQG"
+                       "EwJJRTESMBAGA1UEChMJQmFsdGltb3JlMRMwEQYDVQQLEwpDeW"
+                       "JlclRydXN0MSIwIAYDVQQDExlCYWx0aW1vcmUgQ3liZXJUcnVz"
+                       "dCBSb290\";\n", i);
+      else
+        len += sprintf(text + len,
+                       "  # setting %d\n\n  key_%d = \"value %d\";"
+                       "  /* trailing */\n  num_%d = %d.25;\n", i, i, i, i,
+                       i);
+      ++i;
+    }
+    text[len] = text[len + 1] = '\0';
+
+    start = bench_now();
+    for(r = 0; r < rounds; ++r)
+    {
+      config_t cfg;
+      struct scan_context scan_ctx;
+      yyscan_t scanner;
+      YYSTYPE value;
+      int token;
+
+      config_init(&cfg);
+      libconfig_scanctx_init(&scan_ctx, NULL);
+      scan_ctx.config = &cfg;
+      libconfig_yylex_init_extra(&scan_ctx, &scanner);
+      (void)libconfig_yy_scan_buffer(text, len + 2, scanner);
+
+      while((token = libconfig_yylex(&value, scanner)) > 0)
+      {
+        if(token == TOK_STRING)
+          free(value.sval);
+        ++tokens;
+      }
+
+      libconfig_yylex_destroy(scanner);
+      free((void *)libconfig_scanctx_cleanup(&scan_ctx));
+      config_destroy(&cfg);
+    }
+    elapsed = (bench_now() - start) / rounds;
+
+    printf("lex: %-8s %8.2f ms %8.1f MB/s (%ld tokens)\n", labels[kind],
+           elapsed * 1e3, (len / (1024.0 * 1024.0)) / elapsed,
+           tokens / rounds);
+  }
+
+  free(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* The generated scanner and parser against the direct parser, reading the
+ * same configuration from memory: nested groups of settings, long numeric
+ * arrays, and settings interleaved with comments.
+ */
+
+static void bench_parse_engines(void)
+{
+  static const char *labels[] = { "groups", "arrays", "commented" };
+  const size_t size = 32 * 1024 * 1024;
+  const int rounds = 3;
+  char *text = (char *)malloc(size + 1024);
+  int kind;
+
+  for(kind = 0; kind < 3; ++kind)
+  {
+    size_t len = 0;
+    int engine, i = 0, j;
+
+    while(len < size)
+    {
+      if(kind == 0)
+        len += sprintf(text + len,
+                       "server_%d = {\n  name = \"host-%d\";\n  port = %d;\n"
+                       "  enabled = true;\n  weight = %d.5;\n"
+                       "  limits = { rate = 0x%X; burst = %dL; };\n};\n",
+                       i, i, i % 65536, i, i, i);
+      else if(kind == 1)
+      {
+        len += sprintf(text + len, "samples_%d = [", i);
+        for(j = 0; j < 100; ++j)
+          len += sprintf(text + len, "%d, ", (i * 100 + j) % 100003);
+        len += sprintf(text + len, "0 ];\n");
+      }
+      else
+        len += sprintf(text + len,
+                       "# Setting %d, with a comment that describes it.\n"
+                       "key_%d = \"value %d\"; /* inline */ num_%d = %d;\n",
+                       i, i, i, i, i);
+      ++i;
+    }
+    text[len] = text[len + 1] = '\0';
+
+    for(engine = 0; engine <= 1; ++engine)
+    {
+      double start, elapsed;
+      int r, ok = 1;
+
+      start = bench_now();
+      for(r = 0; r < rounds; ++r)
+      {
+        config_t cfg;
+
+        config_init(&cfg);
+        config_set_option(&cfg, CONFIG_OPTION_ARENA, CONFIG_TRUE);
+        config_set_option(&cfg, CONFIG_OPTION_DIRECT_PARSER, engine);
+        ok &= config_read_buffer(&cfg, text, len + 2);
+        config_destroy(&cfg);
+      }
+      elapsed = (bench_now() - start) / rounds;
+
+      printf("parse_engines: %-9s %-6s %8.2f ms %8.1f MB/s%s\n",
+             labels[kind], engine ? "direct" : "bison", elapsed * 1e3,
+             (len / (1024.0 * 1024.0)) / elapsed,
+             ok ? "" : " (parse error)");
+    }
+  }
+
+  free(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reading a configuration that includes hundreds of fragment files, with the
+ * fragments read in turn and read ahead on worker threads.
+ */
+
+static void bench_parallel_includes(void)
+{
+  static const int FRAGMENTS = 400, SETTINGS = 500, ROUNDS = 5;
+  const char *filename = "bench_parallel.cfg";
+  char fragment[64];
+  FILE *fp, *frag;
+  int f, i, mode;
+
+  fp = fopen(filename, "wb");
+  if(! fp)
+  {
+    printf("parallel_includes: cannot write %s\n", filename);
+    return;
+  }
+
+  for(f = 0; f < FRAGMENTS; ++f)
+  {
+    sprintf(fragment, "bench_parallel_%d.cfg", f);
+    frag = fopen(fragment, "wb");
+    if(! frag)
+      break;
+
+    fprintf(frag, "service_%d = {\n", f);
+    for(i = 0; i < SETTINGS; ++i)
+      fprintf(frag,
+              "  key_%d = \"%s\"; value_%d = %d.25; list_%d = [%d, %d];\n",
+              i, "the quick brown fox jumps over the lazy dog", i, i, i, i,
+              f);
+    fprintf(frag, "};\n");
+    fclose(frag);
+
+    fprintf(fp, "@include \"%s\"\n", fragment);
+  }
+
+  fclose(fp);
+
+  for(mode = 0; mode <= 1; ++mode)
+  {
+    double start, elapsed;
+    int ok = 1;
+
+    start = bench_now();
+    for(i = 0; i < ROUNDS; ++i)
+    {
+      config_t cfg;
+
+      config_init(&cfg);
+      config_set_option(&cfg, CONFIG_OPTION_PARALLEL_INCLUDES, mode);
+      ok &= config_read_file(&cfg, filename);
+      config_destroy(&cfg);
+    }
+    elapsed = (bench_now() - start) / ROUNDS;
+
+    printf("parallel_includes: %-8s %8.2f ms%s\n",
+           mode ? "parallel" : "serial", elapsed * 1e3,
+           ok ? "" : " (error)");
+  }
+
+  for(f = 0; f < FRAGMENTS; ++f)
+  {
+    sprintf(fragment, "bench_parallel_%d.cfg", f);
+    remove(fragment);
+  }
+
+  remove(filename);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reloading a configuration that includes hundreds of fragments through a
+ * wildcard, with the directory listed on every reload, and with the listing
+ * and the fragments kept in an include cache.
+ */
+
+static void bench_glob_includes(void)
+{
+  static const int FRAGMENTS = 400, SETTINGS = 50, RELOADS = 10;
+  const char *filename = "bench_glob.cfg";
+  char fragment[64];
+  config_include_cache_t *cache;
+  FILE *fp, *frag;
+  int f, i, mode;
+
+  fp = fopen(filename, "wb");
+  if(! fp)
+  {
+    printf("glob_includes: cannot write %s\n", filename);
+    return;
+  }
+
+  fprintf(fp, "@include \"bench_glob_*.cfg\"\n");
+  fclose(fp);
+
+  for(f = 0; f < FRAGMENTS; ++f)
+  {
+    sprintf(fragment, "bench_glob_%03d.cfg", f);
+    frag = fopen(fragment, "wb");
+    if(! frag)
+      break;
+
+    fprintf(frag, "service_%d = {\n", f);
+    for(i = 0; i < SETTINGS; ++i)
+      fprintf(frag, "  key_%d = \"value %d\"; weight_%d = %d;\n", i, i, i, i);
+    fprintf(frag, "};\n");
+    fclose(frag);
+  }
+
+  for(mode = 0; mode <= 1; ++mode)
+  {
+    config_t cfg;
+    double start, first = 0, elapsed;
+    int ok = 1;
+
+    cache = mode ? config_include_cache_create() : NULL;
+
+    config_init(&cfg);
+    config_set_include_func(&cfg, config_glob_include_func);
+    config_set_include_cache(&cfg, cache);
+
+    start = bench_now();
+    for(i = 0; i <= RELOADS; ++i)
+    {
+      ok &= config_read_file(&cfg, filename);
+      if(i == 0)
+        first = bench_now() - start;
+    }
+    elapsed = bench_now() - start - first;
+
+    printf("glob_includes: %-8s first %8.2f ms, reload %8.2f ms, "
+           "%d settings%s\n", mode ? "cached" : "uncached", first * 1e3,
+           elapsed * 1e3 / RELOADS, config_setting_length(
+             config_root_setting(&cfg)), ok ? "" : " (error)");
+
+    config_destroy(&cfg);
+    config_include_cache_destroy(cache);
+  }
+
+  for(f = 0; f < FRAGMENTS; ++f)
+  {
+    sprintf(fragment, "bench_glob_%03d.cfg", f);
+    remove(fragment);
+  }
+
+  remove(filename);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reading a large configuration of which only a handful of settings are
+ * looked up, with the direct parser, with every group parsed up front and
+ * with group bodies parsed on first access.
+ */
+
+static void bench_lazy_load(void)
+{
+  static const int SERVICES = 2000, SETTINGS = 100, ROUNDS = 5, LOOKUPS = 10;
+  const char *filename = "bench_lazy.cfg";
+  char path[64];
+  FILE *fp;
+  int s, i, mode;
+
+  fp = fopen(filename, "wb");
+  if(! fp)
+  {
+    printf("lazy_load: cannot write %s\n", filename);
+    return;
+  }
+
+  for(s = 0; s < SERVICES; ++s)
+  {
+    fprintf(fp, "service_%d = {\n", s);
+    for(i = 0; i < SETTINGS; ++i)
+      fprintf(fp, "  key_%d = \"value %d\"; weight_%d = %d; port_%d = [%d];\n",
+              i, i, i, i, i, s);
+    fprintf(fp, "};\n");
+  }
+
+  fclose(fp);
+
+  for(mode = 0; mode <= 1; ++mode)
+  {
+    double start, elapsed;
+    int ok = 1;
+
+    start = bench_now();
+    for(i = 0; i < ROUNDS; ++i)
+    {
+      config_t cfg;
+      int n, weight;
+
+      config_init(&cfg);
+      config_set_option(&cfg, CONFIG_OPTION_DIRECT_PARSER, 1);
+      config_set_option(&cfg, CONFIG_OPTION_LAZY_LOAD, mode);
+      ok &= config_read_file(&cfg, filename);
+
+      for(n = 0; n < LOOKUPS; ++n)
+      {
+        sprintf(path, "service_%d.weight_%d", (n * 7919) % SERVICES,
+                n % SETTINGS);
+        ok &= config_lookup_int(&cfg, path, &weight);
+      }
+
+      config_destroy(&cfg);
+    }
+    elapsed = (bench_now() - start) / ROUNDS;
+
+    printf("lazy_load: %-6s %8.2f ms%s\n", mode ? "lazy" : "eager",
+           elapsed * 1e3, ok ? "" : " (error)");
+  }
+
+  remove(filename);
+}
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  const char *name;
+  void (*function)(void);
+} benchmark_t;
+
+static const benchmark_t benchmarks[] =
+{
+  { "wide_group_lookup", bench_wide_group_lookup },
+  { "arena_load", bench_arena_load },
+  { "intern_memory", bench_intern_memory },
+  { "read_file", bench_read_file },
+  { "scan_strings", bench_scan_strings },
+  { "compiled_paths", bench_compiled_paths },
+  { "batch_lookup", bench_batch_lookup },
+  { "tiny_reads", bench_tiny_reads },
+  { "write", bench_write },
+  { "format_numbers", bench_format_numbers },
+  { "snapshot_load", bench_snapshot_load },
+  { "include_cache", bench_include_cache },
+  { "diff", bench_diff },
+  { "copy", bench_copy },
+  { "packed_array", bench_packed_array },
+  { "bulk_array", bench_bulk_array },
+  { "remove", bench_remove },
+  { "lex", bench_lex },
+  { "parse_engines", bench_parse_engines },
+  { "parallel_includes", bench_parallel_includes },
+  { "glob_includes", bench_glob_includes },
+  { "lazy_load", bench_lazy_load },
+  { NULL, NULL }
+};
+
+/* ------------------------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+  const benchmark_t *b;
+  int i;
+
+  for(b = benchmarks; b->name; ++b)
+  {
+    int run = (argc < 2);
+
+    for(i = 1; i < argc; ++i)
+    {
+      if(! strcmp(argv[i], b->name))
+        run = 1;
+    }
+
+    if(run)
+      b->function();
+  }
+
+  return(EXIT_SUCCESS);
+}
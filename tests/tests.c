@@ -20,17 +20,27 @@
    ----------------------------------------------------------------------------
 */
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 
 #ifdef _MSC_VER
 #define snprintf _snprintf
 #endif
 
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <locale.h>
+#define HAVE_THREAD_LOCALE
+#endif
+
 #include <libconfig.h>
 #include <tinytest.h>
 
+/* The lazy-load test checks the count of bodies still to be parsed. */
+#include "lazy.h"
+
 /* ------------------------------------------------------------------------- */
 
 static void parse_and_compare(const char *input_file, const char *output_file)
@@ -709,6 +719,2306 @@ TT_TEST(BinaryAndHex)
 
 /* ------------------------------------------------------------------------- */
 
+TT_TEST(WideGroupLookups)
+{
+  config_t cfg;
+  config_setting_t *root, *setting;
+  char name[32];
+  int i, ival;
+
+  config_init(&cfg);
+  root = config_root_setting(&cfg);
+
+  for(i = 0; i < 1000; ++i)
+  {
+    sprintf(name, "key%d", i);
+    setting = config_setting_add(root, name, CONFIG_TYPE_INT);
+    TT_ASSERT_PTR_NOTNULL(setting);
+    config_setting_set_int(setting, i);
+  }
+
+  /* Duplicate names are still rejected. */
+  TT_ASSERT_PTR_NULL(config_setting_add(root, "key500", CONFIG_TYPE_INT));
+
+  for(i = 0; i < 1000; ++i)
+  {
+    sprintf(name, "key%d", i);
+    TT_ASSERT_TRUE(config_lookup_int(&cfg, name, &ival));
+    TT_ASSERT_INT_EQ(i, ival);
+  }
+
+  TT_ASSERT_PTR_NULL(config_setting_get_member(root, "key1000"));
+  TT_ASSERT_PTR_NULL(config_setting_get_member(root, "key"));
+
+  /* Remove every odd member, by name and by index. */
+  for(i = 1; i < 1000; i += 2)
+  {
+    sprintf(name, "key%d", i);
+    if(i % 4 == 1)
+      TT_ASSERT_TRUE(config_setting_remove(root, name));
+    else
+    {
+      setting = config_setting_get_member(root, name);
+      TT_ASSERT_PTR_NOTNULL(setting);
+      TT_ASSERT_TRUE(config_setting_remove_elem(
+                       root, config_setting_index(setting)));
+    }
+  }
+
+  TT_ASSERT_INT_EQ(500, config_setting_length(root));
+
+  for(i = 0; i < 1000; ++i)
+  {
+    sprintf(name, "key%d", i);
+    setting = config_setting_get_member(root, name);
+    if(i % 2)
+      TT_ASSERT_PTR_NULL(setting);
+    else
+    {
+      TT_ASSERT_PTR_NOTNULL(setting);
+      TT_ASSERT_INT_EQ(i, config_setting_get_int(setting));
+    }
+  }
+
+  setting = config_setting_add(root, "key1", CONFIG_TYPE_INT);
+  TT_ASSERT_PTR_NOTNULL(setting);
+  TT_ASSERT_PTR_EQ(setting, config_lookup(&cfg, "key1"));
+
+  config_destroy(&cfg);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int hooks_destroyed = 0;
+
+static void count_destroyed_hook(void *hook)
+{
+  ++hooks_destroyed;
+}
+
+TT_TEST(ArenaAllocation)
+{
+  config_t cfg;
+  config_setting_t *root, *group, *setting;
+  char name[32];
+  int i, ok;
+
+  config_init(&cfg);
+  config_set_option(&cfg, CONFIG_OPTION_ARENA, CONFIG_TRUE);
+  config_set_include_dir(&cfg, "./testdata");
+
+  /* A tree read into the arena is written out exactly as before. */
+  ok = config_read_file(&cfg, "testdata/input_0.cfg");
+  if(!ok)
+  {
+    printf("error: %s:%d\n", config_error_text(&cfg),
+           config_error_line(&cfg));
+  }
+  TT_ASSERT_TRUE(ok);
+
+  remove("temp.cfg");
+  TT_ASSERT_TRUE(config_write_file(&cfg, "temp.cfg"));
+  TT_ASSERT_TXTFILE_EQ("temp.cfg", "testdata/output_0.cfg");
+  remove("temp.cfg");
+
+  /* Arena-backed trees can still be modified. */
+  config_clear(&cfg);
+  root = config_root_setting(&cfg);
+  group = config_setting_add(root, "group", CONFIG_TYPE_GROUP);
+  TT_ASSERT_PTR_NOTNULL(group);
+
+  for(i = 0; i < 200; ++i)
+  {
+    sprintf(name, "s%d", i);
+    setting = config_setting_add(group, name, CONFIG_TYPE_STRING);
+    TT_ASSERT_PTR_NOTNULL(setting);
+    TT_ASSERT_TRUE(config_setting_set_string(setting, name));
+    TT_ASSERT_TRUE(config_setting_set_string(setting, "replaced"));
+  }
+
+  for(i = 0; i < 200; i += 2)
+  {
+    sprintf(name, "s%d", i);
+    TT_ASSERT_TRUE(config_setting_remove(group, name));
+  }
+
+  TT_ASSERT_INT_EQ(100, config_setting_length(group));
+  TT_ASSERT_PTR_NULL(config_lookup(&cfg, "group.s0"));
+  TT_ASSERT_STR_EQ("replaced", config_setting_get_string(
+                     config_lookup(&cfg, "group.s199")));
+
+  /* Hooks are still destroyed, both on removal and on teardown. */
+  config_set_destructor(&cfg, count_destroyed_hook);
+  config_setting_set_hook(config_lookup(&cfg, "group.s1"), &cfg);
+  config_setting_set_hook(config_lookup(&cfg, "group.s3"), &cfg);
+  config_setting_set_hook(group, &cfg);
+
+  hooks_destroyed = 0;
+  TT_ASSERT_TRUE(config_setting_remove(group, "s1"));
+  TT_ASSERT_INT_EQ(1, hooks_destroyed);
+
+  config_destroy(&cfg);
+  TT_ASSERT_INT_EQ(3, hooks_destroyed);
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(InternedNames)
+{
+  config_t cfg;
+  config_setting_t *root, *list, *group, *setting;
+  const char *long_value = "a string value that is too long to be interned";
+  int i, arena, ok;
+
+  for(arena = 0; arena <= 1; ++arena)
+  {
+    config_init(&cfg);
+    config_set_option(&cfg, CONFIG_OPTION_ARENA, arena);
+    config_set_option(&cfg, CONFIG_OPTION_INTERN_NAMES, CONFIG_TRUE);
+    config_set_option(&cfg, CONFIG_OPTION_INTERN_STRINGS, CONFIG_TRUE);
+    config_set_include_dir(&cfg, "./testdata");
+
+    ok = config_read_file(&cfg, "testdata/input_0.cfg");
+    if(!ok)
+    {
+      printf("error: %s:%d\n", config_error_text(&cfg),
+             config_error_line(&cfg));
+    }
+    TT_ASSERT_TRUE(ok);
+
+    remove("temp.cfg");
+    TT_ASSERT_TRUE(config_write_file(&cfg, "temp.cfg"));
+    TT_ASSERT_TXTFILE_EQ("temp.cfg", "testdata/output_0.cfg");
+    remove("temp.cfg");
+
+    config_clear(&cfg);
+    root = config_root_setting(&cfg);
+    list = config_setting_add(root, "servers", CONFIG_TYPE_LIST);
+
+    for(i = 0; i < 100; ++i)
+    {
+      group = config_setting_add(list, NULL, CONFIG_TYPE_GROUP);
+      setting = config_setting_add(group, "host", CONFIG_TYPE_STRING);
+      TT_ASSERT_TRUE(config_setting_set_string(setting, "localhost"));
+      setting = config_setting_add(group, "port", CONFIG_TYPE_INT);
+      TT_ASSERT_TRUE(config_setting_set_int(setting, 8000 + i));
+      TT_ASSERT_PTR_NULL(config_setting_add(group, "port", CONFIG_TYPE_INT));
+    }
+
+    /* Equal names and short values share storage. */
+    setting = config_lookup(&cfg, "servers.[0].host");
+    TT_ASSERT_PTR_NOTNULL(setting);
+    TT_ASSERT_PTR_EQ(config_setting_name(setting),
+                     config_setting_name(config_lookup(&cfg,
+                                                       "servers.[99].host")));
+    TT_ASSERT_PTR_EQ(config_setting_get_string(setting),
+                     config_setting_get_string(
+                       config_lookup(&cfg, "servers.[99].host")));
+
+    TT_ASSERT_PTR_NULL(config_lookup(&cfg, "servers.[0].hos"));
+    TT_ASSERT_PTR_NULL(config_lookup(&cfg, "servers.[0].address"));
+    TT_ASSERT_PTR_NULL(config_lookup(&cfg, "servers.[0].servers"));
+
+    /* Replacing a shared value leaves the other settings alone. */
+    TT_ASSERT_TRUE(config_setting_set_string(setting, long_value));
+    TT_ASSERT_TRUE(config_setting_set_string(setting, long_value));
+    TT_ASSERT_TRUE(config_setting_set_string(setting, "remotehost"));
+    TT_ASSERT_STR_EQ("localhost", config_setting_get_string(
+                       config_lookup(&cfg, "servers.[1].host")));
+    TT_ASSERT_STR_EQ("remotehost", config_setting_get_string(setting));
+
+    group = config_lookup(&cfg, "servers.[5]");
+    TT_ASSERT_TRUE(config_setting_remove(group, "host"));
+    TT_ASSERT_PTR_NULL(config_setting_get_member(group, "host"));
+    TT_ASSERT_PTR_NOTNULL(config_setting_add(group, "host",
+                                             CONFIG_TYPE_STRING));
+    TT_ASSERT_INT_EQ(8005, config_setting_get_int(
+                       config_setting_get_member(group, "port")));
+
+    config_destroy(&cfg);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Writes a configuration of exactly `size' bytes, ending in `tail'. */
+
+static int write_sized_config(const char *filename, long size,
+                              const char *tail)
+{
+  FILE *fp = fopen(filename, "wb");
+  long len = 0;
+  int i;
+
+  if(!fp)
+    return(0);
+
+  for(i = 0; len < size - 64; ++i)
+    len += fprintf(fp, "s%d = %d;\n", i, i);
+
+  len += fprintf(fp, "%s", tail);
+  fprintf(fp, "#");
+  for(++len; len < size - 1; ++len)
+    fputc('-', fp);
+  fputc('\n', fp);
+
+  fclose(fp);
+  return(i);
+}
+
+TT_TEST(InMemoryFiles)
+{
+  /* Sizes either side of the page boundaries check that the two NUL bytes
+   * that follow the contents read into memory are always there.
+   */
+  static const long sizes[] = { 100, 65536 * 2, 65536 * 2 - 1, 65536 * 2 - 2,
+                                200003, 0 };
+  const long *size;
+  config_t cfg, bad_cfg;
+  FILE *fp;
+  int count, ival;
+  char name[32];
+
+  config_init(&cfg);
+
+  for(size = sizes; *size; ++size)
+  {
+    struct stat st;
+
+    count = write_sized_config("temp_in_memory.cfg", *size, "");
+    TT_ASSERT_INT_EQ(0, stat("temp_in_memory.cfg", &st));
+    TT_ASSERT_INT_EQ(*size, (long)st.st_size);
+
+    TT_ASSERT_TRUE(config_read_file(&cfg, "temp_in_memory.cfg"));
+    TT_ASSERT_INT_EQ(count, config_setting_length(config_root_setting(&cfg)));
+    sprintf(name, "s%d", count - 1);
+    TT_ASSERT_TRUE(config_lookup_int(&cfg, name, &ival));
+    TT_ASSERT_INT_EQ(count - 1, ival);
+
+    /* The same file, included from another one. */
+    fp = fopen("temp_include.cfg", "wt");
+    TT_ASSERT_PTR_NOTNULL(fp);
+    fprintf(fp, "before = 1;\n@include \"temp_in_memory.cfg\"\nafter = 2;\n");
+    fclose(fp);
+
+    TT_ASSERT_TRUE(config_read_file(&cfg, "temp_include.cfg"));
+    TT_ASSERT_INT_EQ(count + 2,
+                     config_setting_length(config_root_setting(&cfg)));
+    TT_ASSERT_TRUE(config_lookup_int(&cfg, name, &ival));
+    TT_ASSERT_INT_EQ(count - 1, ival);
+    TT_ASSERT_TRUE(config_lookup_int(&cfg, "after", &ival));
+    TT_ASSERT_INT_EQ(2, ival);
+
+    /* Errors are reported on the right line. */
+    count = write_sized_config("temp_in_memory.cfg", *size, "x = ];\n");
+    config_init(&bad_cfg);
+    TT_ASSERT_FALSE(config_read_file(&bad_cfg, "temp_in_memory.cfg"));
+    TT_ASSERT_INT_EQ(count + 1, config_error_line(&bad_cfg));
+    config_destroy(&bad_cfg);
+  }
+
+  remove("temp_in_memory.cfg");
+  remove("temp_include.cfg");
+  config_destroy(&cfg);
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(ReadBuffer)
+{
+  static const char text[] = "a = 1;\nb = \"two\";\nc = [ 3.0, 4.5 ];\n";
+  static const char bad_text[] = "a = 1;\nb = ];\nc = 3;\n";
+  char buffer[sizeof(text) + 8], saved[sizeof(text) + 8], empty[2] = { 0, 0 };
+  size_t len = strlen(text);
+  config_t cfg;
+  int ival;
+
+  config_init(&cfg);
+
+  /* Not NUL-terminated: the contents are copied. */
+  memcpy(buffer, text, len);
+  memset(buffer + len, 'x', sizeof(buffer) - len);
+  TT_ASSERT_TRUE(config_read_buffer(&cfg, buffer, len));
+  TT_ASSERT_TRUE(config_lookup_int(&cfg, "a", &ival));
+  TT_ASSERT_INT_EQ(1, ival);
+  TT_ASSERT_STR_EQ("two", config_setting_get_string(config_lookup(&cfg, "b")));
+  TT_ASSERT_INT_EQ(2, config_setting_length(config_lookup(&cfg, "c")));
+
+  /* Only part of the buffer. */
+  TT_ASSERT_TRUE(config_read_buffer(&cfg, buffer, 7));
+  TT_ASSERT_INT_EQ(1, config_setting_length(config_root_setting(&cfg)));
+
+  /* Two trailing NULs: the buffer is scanned in place, and left intact. */
+  memset(buffer, 0, sizeof(buffer));
+  memcpy(buffer, text, len);
+  memcpy(saved, buffer, sizeof(buffer));
+  TT_ASSERT_TRUE(config_read_buffer(&cfg, buffer, len + 2));
+  TT_ASSERT_INT_EQ(3, config_setting_length(config_root_setting(&cfg)));
+  TT_ASSERT_STR_EQ("two", config_setting_get_string(config_lookup(&cfg, "b")));
+  TT_ASSERT_TRUE(memcmp(buffer, saved, sizeof(buffer)) == 0);
+
+  TT_ASSERT_TRUE(config_read_buffer(&cfg, empty, sizeof(empty)));
+  TT_ASSERT_INT_EQ(0, config_setting_length(config_root_setting(&cfg)));
+
+  config_destroy(&cfg);
+
+  /* A parse error leaves the buffer intact as well. */
+  config_init(&cfg);
+  len = strlen(bad_text);
+  memset(buffer, 0, sizeof(buffer));
+  memcpy(buffer, bad_text, len);
+  memcpy(saved, buffer, sizeof(buffer));
+  TT_ASSERT_FALSE(config_read_buffer(&cfg, buffer, len + 2));
+  TT_ASSERT_INT_EQ(2, config_error_line(&cfg));
+  TT_ASSERT_TRUE(memcmp(buffer, saved, sizeof(buffer)) == 0);
+  config_destroy(&cfg);
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(LongStrings)
+{
+  const size_t length = 200000;
+  char *text = (char *)malloc(length * 3 + 64);
+  char *expected = (char *)malloc(length + 1);
+  size_t i, len;
+  config_t cfg;
+  int arena;
+
+  /* One long string, split into adjacent literals and full of escapes, both
+   * as a setting and as an array element.
+   */
+  len = sprintf(text, "a = \"");
+  for(i = 0; i < length; ++i)
+  {
+    if((i % 1000) == 999)
+      len += sprintf(text + len, "\" \"");
+
+    if((i % 7) == 0)
+    {
+      len += sprintf(text + len, "\\n");
+      expected[i] = '\n';
+    }
+    else
+      text[len++] = expected[i] = (char)('a' + (i % 26));
+  }
+  expected[length] = '\0';
+  len += sprintf(text + len, "\";\n");
+  sprintf(text + len, "b = [ \"x\", \"%.*s\" \"\" ];\n", 100, expected + 1);
+
+  for(arena = 0; arena <= 1; ++arena)
+  {
+    config_init(&cfg);
+    config_set_option(&cfg, CONFIG_OPTION_ARENA, arena);
+
+    TT_ASSERT_TRUE(config_read_string(&cfg, text));
+    TT_ASSERT_TRUE(strcmp(expected,
+                          config_setting_get_string(
+                            config_lookup(&cfg, "a"))) == 0);
+    TT_ASSERT_STR_EQ("x", config_setting_get_string_elem(
+                       config_lookup(&cfg, "b"), 0));
+    TT_ASSERT_INT_EQ(100, (int)strlen(config_setting_get_string_elem(
+                                        config_lookup(&cfg, "b"), 1)));
+
+    config_destroy(&cfg);
+  }
+
+  free(expected);
+  free(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(CompiledPaths)
+{
+  static const char *paths[] = {
+    "a", "a.b", "a.b.c", "a:b/c", ".a.b", "a.b.", "a.b..c", "a.list",
+    "a.list.[0]", "a.list.[2].name", "a.list.[2]name", "a.list.[]",
+    "a.list.[-1]", "a.list.[9]", "a.list[0]", "a.array.[1]",
+    "a.array.[1].x", "a.s.", "a.s.x", "a.s.[0]", "[0]", "[0].b", "[1]",
+    "x", "a.x", "a..", "", ".", "..", "a.b.c.", "a.list.[2].name.",
+    "a.list.[2.name", "a.list.[x]", NULL
+  };
+  const char *text =
+    "a = { b = { c = 1; }; list = ( 1, \"two\", { name = \"three\"; } );"
+    " array = [ 4, 5 ]; s = \"str\"; };\n"
+    "y = 2;\n";
+  config_t cfg;
+  const char **path;
+  int interned;
+
+  for(interned = 0; interned <= 1; ++interned)
+  {
+    config_init(&cfg);
+    config_set_option(&cfg, CONFIG_OPTION_INTERN_NAMES, interned);
+    TT_ASSERT_TRUE(config_read_string(&cfg, text));
+
+    /* A compiled path must find exactly what the string path finds. */
+    for(path = paths; *path; ++path)
+    {
+      config_path_t *compiled = config_path_compile(*path);
+
+      TT_ASSERT_PTR_EQ(config_lookup(&cfg, *path),
+                       config_lookup_path(&cfg, compiled));
+      TT_ASSERT_PTR_EQ(config_setting_lookup(config_lookup(&cfg, "a"),
+                                             *path),
+                       config_setting_lookup_path(config_lookup(&cfg, "a"),
+                                                  compiled));
+      config_path_free(compiled);
+    }
+
+    TT_ASSERT_PTR_NULL(config_lookup_path(&cfg, NULL));
+
+    config_destroy(&cfg);
+  }
+
+  TT_ASSERT_PTR_NULL(config_path_compile("a.[1"));
+  TT_ASSERT_PTR_NULL(config_path_compile(NULL));
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(BatchLookups)
+{
+  static const char *paths[] = {
+    "a", "a.b", "a.b.c", "a:b/c", ".a.b", "a.b.", "a.b..c", "a.bc",
+    "a.bc.d", "a.b.cd", "a.list", "a.list.[0]", "a.list.[2].name",
+    "a.list.[2]name", "a.list.[2].names", "a.list.[]", "a.list.[-1]",
+    "a.list.[9]", "a.list[0]", "a.array.[1]", "a.array.[1].x", "a.s.",
+    "a.s.x", "a.s.[0]", "[0]", "[0].b", "x", "a.x", "a..", "", ".", "a.b.c.",
+    "a.list.[2.name", "a.list.[x]", "y", "y.", "a.list.[2].name.", NULL
+  };
+  const char *text =
+    "a = { b = { c = 1; cd = 2; }; bc = { d = 3; };"
+    " list = ( 1, \"two\", { name = \"three\"; names = 4; } );"
+    " array = [ 4, 5 ]; s = \"str\"; };\n"
+    "y = 2;\n";
+  config_lookup_entry_t entries[64];
+  config_setting_t *found[64];
+  config_t cfg;
+  unsigned int i, count, round;
+  int ival = -1, bval = -1, ival2 = -1;
+  long long llval = -1;
+  double fval = -1.0;
+  const char *sval = NULL;
+
+  config_init(&cfg);
+  TT_ASSERT_TRUE(config_read_string(&cfg, text));
+
+  for(count = 0; paths[count]; ++count)
+    ;
+
+  /* The batch must find what each path finds on its own, whatever order
+   * the paths come in.
+   */
+  for(round = 0; round < 8; ++round)
+  {
+    memset(entries, 0, sizeof(entries));
+    for(i = 0; i < count; ++i)
+    {
+      entries[i].path = paths[(i * (2 * round + 1) + round) % count];
+      entries[i].type = CONFIG_TYPE_NONE;
+      entries[i].value = &found[i];
+    }
+
+    config_lookup_values(&cfg, entries, count);
+
+    for(i = 0; i < count; ++i)
+    {
+      config_setting_t *expected = config_lookup(&cfg, entries[i].path);
+
+      TT_ASSERT_PTR_EQ(expected, found[i]);
+      TT_ASSERT_INT_EQ(expected ? CONFIG_LOOKUP_FOUND
+                       : CONFIG_LOOKUP_NOT_FOUND, entries[i].status);
+    }
+  }
+
+  /* Typed lookups, with defaults for missing and mismatched settings. */
+  memset(entries, 0, sizeof(entries));
+  entries[0].path = "a.b.c";
+  entries[0].type = CONFIG_TYPE_INT;
+  entries[0].value = &ival;
+  entries[1].path = "a.b.cd";
+  entries[1].type = CONFIG_TYPE_INT64;
+  entries[1].value = &llval;
+  entries[2].path = "a.s";
+  entries[2].type = CONFIG_TYPE_STRING;
+  entries[2].value = &sval;
+  entries[3].path = "a.b.missing";
+  entries[3].type = CONFIG_TYPE_FLOAT;
+  entries[3].value = &fval;
+  entries[3].default_value.fval = 2.5;
+  entries[4].path = "a.s";
+  entries[4].type = CONFIG_TYPE_BOOL;
+  entries[4].value = &bval;
+  entries[4].default_value.ival = CONFIG_TRUE;
+  entries[5].path = "y";
+  entries[5].type = CONFIG_TYPE_INT;
+  entries[5].value = &ival2;
+
+  TT_ASSERT_INT_EQ(4, config_lookup_values(&cfg, entries, 6));
+  TT_ASSERT_INT_EQ(CONFIG_LOOKUP_FOUND, entries[0].status);
+  TT_ASSERT_INT_EQ(1, ival);
+  TT_ASSERT_INT_EQ(CONFIG_LOOKUP_FOUND, entries[1].status);
+  TT_ASSERT_TRUE(llval == 2);
+  TT_ASSERT_INT_EQ(CONFIG_LOOKUP_FOUND, entries[2].status);
+  TT_ASSERT_STR_EQ("str", sval);
+  TT_ASSERT_INT_EQ(CONFIG_LOOKUP_NOT_FOUND, entries[3].status);
+  TT_ASSERT_TRUE(fval == 2.5);
+  TT_ASSERT_INT_EQ(CONFIG_LOOKUP_TYPE_MISMATCH, entries[4].status);
+  TT_ASSERT_INT_EQ(CONFIG_TRUE, bval);
+  TT_ASSERT_INT_EQ(CONFIG_LOOKUP_FOUND, entries[5].status);
+  TT_ASSERT_INT_EQ(2, ival2);
+
+  /* Relative to a setting. */
+  TT_ASSERT_INT_EQ(0, config_setting_lookup_values(
+                     config_lookup(&cfg, "a.b"), entries, 1));
+  TT_ASSERT_INT_EQ(CONFIG_LOOKUP_NOT_FOUND, entries[0].status);
+  TT_ASSERT_INT_EQ(0, ival);
+  entries[0].path = "c";
+  TT_ASSERT_INT_EQ(1, config_setting_lookup_values(
+                     config_lookup(&cfg, "a.b"), entries, 1));
+  TT_ASSERT_INT_EQ(1, ival);
+
+  config_destroy(&cfg);
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(ThreadLocale)
+{
+#if defined(HAVE_THREAD_LOCALE)
+  config_t cfg;
+  FILE *fp;
+  locale_t loc = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+  locale_t prev;
+  double fval = 0.0;
+
+  TT_ASSERT_PTR_NOTNULL(loc);
+  prev = uselocale(loc);
+
+  /* Reading and writing leave the calling thread's own locale in place. */
+  config_init(&cfg);
+  TT_ASSERT_TRUE(config_read_string(&cfg, "f = 1.5;"));
+  TT_ASSERT_PTR_EQ(loc, uselocale((locale_t)0));
+  TT_ASSERT_TRUE(config_lookup_float(&cfg, "f", &fval));
+  TT_ASSERT_TRUE(fval == 1.5);
+
+  fp = tmpfile();
+  TT_ASSERT_PTR_NOTNULL(fp);
+  config_write(&cfg, fp);
+  fclose(fp);
+  TT_ASSERT_PTR_EQ(loc, uselocale((locale_t)0));
+
+  config_destroy(&cfg);
+
+  uselocale(prev);
+  freelocale(loc);
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(WriteString)
+{
+  config_t cfg;
+  config_setting_t *setting;
+  char *text, *streamed, small[8];
+  size_t length, streamed_length;
+  FILE *fp;
+
+  config_init(&cfg);
+  config_set_include_dir(&cfg, "./testdata");
+  TT_ASSERT_TRUE(config_read_file(&cfg, "testdata/input_0.cfg"));
+
+  setting = config_setting_add(config_root_setting(&cfg), "escapes",
+                               CONFIG_TYPE_STRING);
+  config_setting_set_string(setting, "a\"b\\c\n\t\x01z");
+
+  /* The string is exactly what config_write() writes to a stream. */
+  text = config_write_string(&cfg, &length);
+  TT_ASSERT_PTR_NOTNULL(text);
+  TT_ASSERT_INT_EQ((int)strlen(text), (int)length);
+  TT_ASSERT_PTR_NOTNULL(strstr(text, "escapes = \"a\\\"b\\\\c\\n\\t\\x01z\";"));
+
+  fp = tmpfile();
+  TT_ASSERT_PTR_NOTNULL(fp);
+  config_write(&cfg, fp);
+  streamed_length = (size_t)ftell(fp);
+  rewind(fp);
+  streamed = (char *)calloc(1, streamed_length + 1);
+  TT_ASSERT_INT_EQ((int)streamed_length,
+                   (int)fread(streamed, 1, streamed_length, fp));
+  fclose(fp);
+  TT_ASSERT_INT_EQ((int)length, (int)streamed_length);
+  TT_ASSERT_TRUE(memcmp(text, streamed, length) == 0);
+
+  /* A buffer that is too small gets a truncated, terminated copy. */
+  TT_ASSERT_INT_EQ((int)length,
+                   (int)config_write_buffer(&cfg, small, sizeof(small)));
+  TT_ASSERT_INT_EQ((int)sizeof(small) - 1, (int)strlen(small));
+  TT_ASSERT_TRUE(strncmp(text, small, sizeof(small) - 1) == 0);
+  TT_ASSERT_INT_EQ((int)length, (int)config_write_buffer(&cfg, NULL, 0));
+
+  free(streamed);
+  free(text);
+  config_destroy(&cfg);
+
+  /* An empty configuration is an empty string. */
+  config_init(&cfg);
+  text = config_write_string(&cfg, &length);
+  TT_ASSERT_PTR_NOTNULL(text);
+  TT_ASSERT_INT_EQ(0, (int)length);
+  TT_ASSERT_STR_EQ("", text);
+  free(text);
+  config_destroy(&cfg);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static config_setting_t *add_number(config_t *cfg, const char *name,
+                                    int type, int format)
+{
+  config_setting_t *setting = config_setting_add(config_root_setting(cfg),
+                                                 name, type);
+  config_setting_set_format(setting, (short)format);
+  return(setting);
+}
+
+TT_TEST(NumberFormatting)
+{
+  static const double values[] = {
+    0.1, 1.0 / 3.0, 2.5e-7, 6.02214076e23, 1e22, 123456.75,
+    4.9406564584124654e-324, 1.7976931348623157e308, -0.0
+  };
+  config_t cfg, cfg2;
+  config_setting_t *setting;
+  char *text;
+  int i;
+
+  config_init(&cfg);
+
+  config_setting_set_int(add_number(&cfg, "i", CONFIG_TYPE_INT,
+                                    CONFIG_FORMAT_DEFAULT), -2147483647 - 1);
+  config_setting_set_int(add_number(&cfg, "h", CONFIG_TYPE_INT,
+                                    CONFIG_FORMAT_HEX), -1);
+  config_setting_set_int(add_number(&cfg, "b", CONFIG_TYPE_INT,
+                                    CONFIG_FORMAT_BIN), 0);
+  config_setting_set_int64(add_number(&cfg, "l", CONFIG_TYPE_INT64,
+                                      CONFIG_FORMAT_DEFAULT),
+                           -9223372036854775807LL - 1);
+  config_setting_set_int64(add_number(&cfg, "lh", CONFIG_TYPE_INT64,
+                                      CONFIG_FORMAT_HEX), 0xABCDEF012LL);
+  config_setting_set_int64(add_number(&cfg, "lb", CONFIG_TYPE_INT64,
+                                      CONFIG_FORMAT_BIN), 37);
+  setting = add_number(&cfg, "f", CONFIG_TYPE_FLOAT, CONFIG_FORMAT_DEFAULT);
+  config_setting_set_float(setting, 3.14159265358979);
+
+  text = config_write_string(&cfg, NULL);
+  TT_ASSERT_STR_EQ("i = -2147483648;\n"
+                   "h = 0xFFFFFFFF;\n"
+                   "b = 0b0;\n"
+                   "l = -9223372036854775808L;\n"
+                   "lh = 0xABCDEF012L;\n"
+                   "lb = 0b100101L;\n"
+                   "f = 3.141593;\n", text);
+  free(text);
+
+  /* Fixed precision, with and without scientific notation. */
+  config_set_float_precision(&cfg, 3);
+  config_setting_set_float(setting, 1e20);
+  text = config_write_string(&cfg, NULL);
+  TT_ASSERT_PTR_NOTNULL(strstr(text, "f = 100000000000000000000.0;"));
+  free(text);
+
+  config_set_option(&cfg, CONFIG_OPTION_ALLOW_SCIENTIFIC_NOTATION, CONFIG_TRUE);
+  text = config_write_string(&cfg, NULL);
+  TT_ASSERT_PTR_NOTNULL(strstr(text, "f = 1e+20;"));
+  free(text);
+
+  config_setting_set_float(setting, 999.96);
+  text = config_write_string(&cfg, NULL);
+  TT_ASSERT_PTR_NOTNULL(strstr(text, "f = 1e+03;"));
+  free(text);
+
+  config_setting_set_float(setting, -0.00012345);
+  text = config_write_string(&cfg, NULL);
+  TT_ASSERT_PTR_NOTNULL(strstr(text, "f = -0.000123;"));
+  free(text);
+
+  /* The shortest representation reads back exactly. */
+  config_set_option(&cfg, CONFIG_OPTION_SHORTEST_FLOATS, CONFIG_TRUE);
+  config_setting_set_float(setting, 1.0 / 3.0);
+  text = config_write_string(&cfg, NULL);
+  TT_ASSERT_PTR_NOTNULL(strstr(text, "f = 0.3333333333333333;"));
+  free(text);
+
+  for(i = 0; i < (int)(sizeof(values) / sizeof(values[0])); ++i)
+  {
+    int sci;
+
+    config_setting_set_float(setting, values[i]);
+
+    for(sci = 0; sci < 2; ++sci)
+    {
+      double value = 0.0;
+
+      config_set_option(&cfg, CONFIG_OPTION_ALLOW_SCIENTIFIC_NOTATION, sci);
+      text = config_write_string(&cfg, NULL);
+
+      config_init(&cfg2);
+      TT_ASSERT_TRUE(config_read_string(&cfg2, text));
+      TT_ASSERT_TRUE(config_lookup_float(&cfg2, "f", &value));
+      TT_ASSERT_TRUE(memcmp(&value, &values[i], sizeof(value)) == 0);
+      config_destroy(&cfg2);
+      free(text);
+    }
+  }
+
+  config_destroy(&cfg);
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(BinarySnapshots)
+{
+  static const int options[] = {
+    0, CONFIG_OPTION_ARENA,
+    CONFIG_OPTION_INTERN_NAMES | CONFIG_OPTION_INTERN_STRINGS
+  };
+  config_t cfg, cfg2;
+  config_setting_t *setting, *setting2;
+  char input_file[128], *text, *text2;
+  unsigned char header[16];
+  FILE *fp;
+  int i, k;
+
+  /* Each test input reads back from a snapshot exactly as it was. */
+  for(i = 0;; ++i)
+  {
+    sprintf(input_file, "testdata/input_%d.cfg", i);
+    if(! tt_file_exists(input_file))
+      break;
+
+    config_init(&cfg);
+    config_set_include_dir(&cfg, "./testdata");
+    TT_ASSERT_TRUE(config_read_file(&cfg, input_file));
+    text = config_write_string(&cfg, NULL);
+
+    remove("temp.bin");
+    TT_ASSERT_TRUE(config_write_binary(&cfg, "temp.bin",
+                                       CONFIG_BINARY_SOURCE_INFO));
+
+    for(k = 0; k < (int)(sizeof(options) / sizeof(options[0])); ++k)
+    {
+      config_init(&cfg2);
+      config_set_options(&cfg2, config_get_options(&cfg2) | options[k]);
+      TT_ASSERT_TRUE(config_read_binary(&cfg2, "temp.bin"));
+      text2 = config_write_string(&cfg2, NULL);
+      TT_ASSERT_STR_EQ(text, text2);
+      free(text2);
+
+      setting = config_setting_get_elem(config_root_setting(&cfg), 0);
+      setting2 = config_setting_get_elem(config_root_setting(&cfg2), 0);
+      if(setting)
+      {
+        TT_ASSERT_PTR_NOTNULL(setting2);
+        TT_ASSERT_INT_EQ(config_setting_source_line(setting),
+                         config_setting_source_line(setting2));
+        TT_ASSERT_STR_EQ(config_setting_source_file(setting),
+                         config_setting_source_file(setting2));
+      }
+
+      config_destroy(&cfg2);
+    }
+
+    free(text);
+    config_destroy(&cfg);
+  }
+
+  /* A snapshot can be looked up and modified like any other tree. */
+  config_init(&cfg);
+  TT_ASSERT_TRUE(config_read_string(&cfg, "a = { b = [1, 2, 3]; c = \"x\"; };"
+                                    "d = ( 1.5, \"y\", { e = 5L; } );"));
+  TT_ASSERT_TRUE(config_write_binary(&cfg, "temp.bin", 0));
+  config_destroy(&cfg);
+
+  config_init(&cfg);
+  TT_ASSERT_TRUE(config_read_binary(&cfg, "temp.bin"));
+  TT_ASSERT_PTR_NULL(config_setting_source_file(config_root_setting(&cfg)));
+  TT_ASSERT_INT_EQ(3, config_setting_get_int_elem(
+                     config_lookup(&cfg, "a.b"), 2));
+  TT_ASSERT_STR_EQ("y", config_setting_get_string_elem(
+                     config_lookup(&cfg, "d"), 1));
+  TT_ASSERT_TRUE(config_setting_remove(config_lookup(&cfg, "a"), "c"));
+  setting = config_setting_add(config_lookup(&cfg, "a.b"), NULL,
+                               CONFIG_TYPE_INT);
+  config_setting_set_int(setting, 4);
+  config_setting_set_string(config_lookup(&cfg, "d.[1]"), "z");
+  text = config_write_string(&cfg, NULL);
+  TT_ASSERT_STR_EQ("a : \n{\n  b = [ 1, 2, 3, 4 ];\n};\n"
+                   "d = ( 1.5, \"z\", \n  {\n    e = 5L;\n  } );\n", text);
+  free(text);
+
+  /* Damaged snapshots are rejected. */
+  fp = fopen("temp.bin", "r+b");
+  TT_ASSERT_PTR_NOTNULL(fp);
+  TT_ASSERT_INT_EQ(16, (int)fread(header, 1, sizeof(header), fp));
+  header[15] ^= 0x40; /* flags */
+  rewind(fp);
+  TT_ASSERT_INT_EQ(16, (int)fwrite(header, 1, sizeof(header), fp));
+  fclose(fp);
+  TT_ASSERT_FALSE(config_read_binary(&cfg, "temp.bin"));
+  TT_ASSERT_INT_EQ(CONFIG_ERR_PARSE, config_error_type(&cfg));
+  TT_ASSERT_STR_EQ("temp.bin", config_error_file(&cfg));
+  TT_ASSERT_PTR_NULL(config_lookup(&cfg, "a"));
+
+  header[15] ^= 0x40;
+  header[8] = 2; /* version */
+  fp = fopen("temp.bin", "r+b");
+  TT_ASSERT_INT_EQ(16, (int)fwrite(header, 1, sizeof(header), fp));
+  fclose(fp);
+  TT_ASSERT_FALSE(config_read_binary(&cfg, "temp.bin"));
+  TT_ASSERT_STR_EQ("unsupported binary configuration version",
+                   config_error_text(&cfg));
+
+  header[8] = 1; /* truncated */
+  fp = fopen("temp.bin", "wb");
+  TT_ASSERT_INT_EQ(16, (int)fwrite(header, 1, sizeof(header), fp));
+  fclose(fp);
+  TT_ASSERT_FALSE(config_read_binary(&cfg, "temp.bin"));
+  TT_ASSERT_STR_EQ("invalid binary configuration", config_error_text(&cfg));
+
+  TT_ASSERT_FALSE(config_read_binary(&cfg, "testdata/input_0.cfg"));
+  TT_ASSERT_INT_EQ(CONFIG_ERR_PARSE, config_error_type(&cfg));
+
+  TT_ASSERT_FALSE(config_read_binary(&cfg, "testdata/no_such_file.bin"));
+  TT_ASSERT_INT_EQ(CONFIG_ERR_FILE_IO, config_error_type(&cfg));
+
+  remove("temp.bin");
+  config_destroy(&cfg);
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(IncludeCache)
+{
+  static const char *inputs[] = {
+    "testdata/input_5.cfg", "testdata/override_setting.cfg"
+  };
+  config_include_cache_t *cache = config_include_cache_create();
+  config_t cfg, cfg2;
+  config_setting_t *setting;
+  unsigned long hits, misses;
+  char *text, *text2;
+  const char *str;
+  FILE *fp;
+  int i, k, ival;
+
+  /* Cached fragments read back the same as scanned ones, time after time. */
+  for(i = 0; i < (int)(sizeof(inputs) / sizeof(inputs[0])); ++i)
+  {
+    config_init(&cfg);
+    config_set_options(&cfg, config_get_options(&cfg)
+                       | CONFIG_OPTION_ALLOW_OVERRIDES);
+    config_set_include_dir(&cfg, "./testdata");
+    TT_ASSERT_TRUE(config_read_file(&cfg, inputs[i]));
+    text = config_write_string(&cfg, NULL);
+
+    config_init(&cfg2);
+    config_set_options(&cfg2, config_get_options(&cfg));
+    config_set_include_dir(&cfg2, "./testdata");
+    config_set_include_cache(&cfg2, cache);
+    TT_ASSERT_PTR_EQ(cache, config_get_include_cache(&cfg2));
+
+    for(k = 0; k < 3; ++k)
+    {
+      TT_ASSERT_TRUE(config_read_file(&cfg2, inputs[i]));
+      text2 = config_write_string(&cfg2, NULL);
+      TT_ASSERT_STR_EQ(text, text2);
+      free(text2);
+    }
+
+    setting = config_lookup(&cfg2, (i == 0) ? "message" : "group.inner");
+    TT_ASSERT_PTR_NOTNULL(setting);
+    setting = config_setting_get_elem(config_root_setting(&cfg2), 0);
+    TT_ASSERT_STR_EQ(config_setting_source_file(setting),
+                     config_setting_source_file(config_setting_get_elem(
+                       config_root_setting(&cfg), 0)));
+
+    free(text);
+    config_destroy(&cfg2);
+    config_destroy(&cfg);
+  }
+
+  config_include_cache_get_stats(cache, &hits, &misses);
+  TT_ASSERT_INT_EQ(1, (int)misses); /* both include more.cfg */
+  TT_ASSERT_INT_EQ(5, (int)hits);
+  config_include_cache_destroy(cache);
+
+  fp = fopen("temp_fragment.cfg", "wt");
+  TT_ASSERT_PTR_NOTNULL(fp);
+  fprintf(fp, "x = 1;\ny = { z = \"s\"; };\n");
+  fclose(fp);
+
+  fp = fopen("temp_include.cfg", "wt");
+  TT_ASSERT_PTR_NOTNULL(fp);
+  fprintf(fp, "a = 0;\n@include \"temp_fragment.cfg\"\n"
+          "b = {\n  @include \"temp_fragment.cfg\"\n};\n"
+          "c = ( 1,\n@include \"temp_fragment.cfg\"\n);\n");
+  fclose(fp);
+
+  cache = config_include_cache_create();
+  config_init(&cfg);
+  config_set_include_cache(&cfg, cache);
+
+  /* Includes between settings are grafted; the one in the list is not. */
+  TT_ASSERT_FALSE(config_read_file(&cfg, "temp_include.cfg"));
+  config_include_cache_get_stats(cache, &hits, &misses);
+  TT_ASSERT_INT_EQ(1, (int)misses);
+  TT_ASSERT_INT_EQ(1, (int)hits);
+
+  fp = fopen("temp_include.cfg", "wt");
+  fprintf(fp, "a = 0;\n@include \"temp_fragment.cfg\"\n"
+          "b = {\n  @include \"temp_fragment.cfg\"\n};\n");
+  fclose(fp);
+
+  TT_ASSERT_TRUE(config_read_file(&cfg, "temp_include.cfg"));
+  TT_ASSERT_TRUE(config_lookup_int(&cfg, "x", &ival));
+  TT_ASSERT_INT_EQ(1, ival);
+  TT_ASSERT_TRUE(config_lookup_string(&cfg, "b.y.z", &str));
+  TT_ASSERT_STR_EQ("s", str);
+  setting = config_lookup(&cfg, "b.y.z");
+  TT_ASSERT_INT_EQ(2, config_setting_source_line(setting));
+  TT_ASSERT_STR_EQ("temp_fragment.cfg", config_setting_source_file(setting));
+  TT_ASSERT_INT_EQ(3, config_setting_index(config_lookup(&cfg, "b")));
+  config_include_cache_get_stats(cache, &hits, &misses);
+  TT_ASSERT_INT_EQ(1, (int)misses);
+  TT_ASSERT_INT_EQ(3, (int)hits);
+
+  /* A change that keeps the size is still noticed. */
+  fp = fopen("temp_fragment.cfg", "wt");
+  fprintf(fp, "x = 2;\ny = { z = \"t\"; };\n");
+  fclose(fp);
+
+  TT_ASSERT_TRUE(config_read_file(&cfg, "temp_include.cfg"));
+  TT_ASSERT_TRUE(config_lookup_int(&cfg, "b.x", &ival));
+  TT_ASSERT_INT_EQ(2, ival);
+  TT_ASSERT_TRUE(config_lookup_string(&cfg, "y.z", &str));
+  TT_ASSERT_STR_EQ("t", str);
+  config_include_cache_get_stats(cache, &hits, &misses);
+  TT_ASSERT_INT_EQ(2, (int)misses);
+  TT_ASSERT_INT_EQ(4, (int)hits);
+
+  /* A fragment that is not complete on its own is scanned in place. */
+  fp = fopen("temp_fragment.cfg", "wt");
+  fprintf(fp, "x =\n");
+  fclose(fp);
+
+  fp = fopen("temp_include.cfg", "wt");
+  fprintf(fp, "@include \"temp_fragment.cfg\"\n5;\n");
+  fclose(fp);
+
+  TT_ASSERT_TRUE(config_read_file(&cfg, "temp_include.cfg"));
+  TT_ASSERT_TRUE(config_lookup_int(&cfg, "x", &ival));
+  TT_ASSERT_INT_EQ(5, ival);
+
+  /* Settings that clash with the including group are still rejected. */
+  fp = fopen("temp_fragment.cfg", "wt");
+  fprintf(fp, "x = 1;\n");
+  fclose(fp);
+
+  fp = fopen("temp_include.cfg", "wt");
+  fprintf(fp, "x = 0;\n@include \"temp_fragment.cfg\"\n");
+  fclose(fp);
+
+  TT_ASSERT_FALSE(config_read_file(&cfg, "temp_include.cfg"));
+  TT_ASSERT_STR_EQ("duplicate setting name", config_error_text(&cfg));
+
+  /* So are fragments that include themselves. */
+  fp = fopen("temp_fragment.cfg", "wt");
+  fprintf(fp, "@include \"temp_fragment.cfg\"\n");
+  fclose(fp);
+
+  TT_ASSERT_FALSE(config_read_file(&cfg, "temp_include.cfg"));
+  TT_ASSERT_STR_EQ("include file nesting too deep", config_error_text(&cfg));
+
+  remove("temp_fragment.cfg");
+  remove("temp_include.cfg");
+  config_destroy(&cfg);
+  config_include_cache_destroy(cache);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void record_change(config_diff_t change, const char *path,
+                          const config_setting_t *old_setting,
+                          const config_setting_t *new_setting, void *context)
+{
+  static const char marks[] = "+-~";
+  char *log = (char *)context;
+
+  TT_ASSERT_TRUE((change == CONFIG_DIFF_ADDED) == (old_setting == NULL));
+  TT_ASSERT_TRUE((change == CONFIG_DIFF_REMOVED) == (new_setting == NULL));
+
+  sprintf(log + strlen(log), "%c%s ", marks[change], path);
+}
+
+TT_TEST(ConfigDiff)
+{
+  volatile double zero = 0.0;
+  config_t cfg, cfg2;
+  char log[512];
+
+  config_init(&cfg);
+  config_init(&cfg2);
+
+  TT_ASSERT_TRUE(config_read_string(&cfg,
+    "a = 1; b = \"x\"; c = { d = 1.5; e = [1, 2, 3]; f = { g = true; }; };"
+    "h = ( 1, \"y\", { i = 2L; } ); j = 0;"));
+
+  /* Identical trees have no changes. */
+  TT_ASSERT_TRUE(config_read_string(&cfg2,
+    "a = 1; b = \"x\"; c = { d = 1.5; e = [1, 2, 3]; f = { g = true; }; };"
+    "h = ( 1, \"y\", { i = 2L; } ); j = 0;"));
+  config_setting_set_float(config_setting_add(config_root_setting(&cfg), "n",
+                                              CONFIG_TYPE_FLOAT), zero / zero);
+  config_setting_set_float(config_setting_add(config_root_setting(&cfg2), "n",
+                                              CONFIG_TYPE_FLOAT), zero / zero);
+  log[0] = '\0';
+  TT_ASSERT_INT_EQ(0, config_diff(config_root_setting(&cfg),
+                                  config_root_setting(&cfg2),
+                                  record_change, log));
+  TT_ASSERT_STR_EQ("", log);
+
+  /* Members are matched by name, even when they move. */
+  TT_ASSERT_TRUE(config_read_string(&cfg2,
+    "k = 5; b = \"z\"; a = 1; c = { e = [1, 2]; d = 1.5; f = { g = 1; }; };"
+    "h = ( 1, \"y\", { i = 3L; }, 4 ); n = 0.0;"));
+  log[0] = '\0';
+  TT_ASSERT_INT_EQ(8, config_diff(config_root_setting(&cfg),
+                                  config_root_setting(&cfg2),
+                                  record_change, log));
+  TT_ASSERT_STR_EQ("+k ~b -c.e.[2] ~c.f.g ~h.[2].i +h.[3] ~n -j ", log);
+
+  /* The subtrees need not be roots, and a count needs no callback. */
+  TT_ASSERT_INT_EQ(2, config_diff(config_lookup(&cfg, "c"),
+                                  config_lookup(&cfg2, "c"), NULL, NULL));
+  TT_ASSERT_INT_EQ(1, config_diff(config_lookup(&cfg, "c.e"),
+                                  config_lookup(&cfg, "h"), NULL, NULL));
+  TT_ASSERT_INT_EQ(0, config_diff(NULL, NULL, NULL, NULL));
+
+  log[0] = '\0';
+  TT_ASSERT_INT_EQ(1, config_diff(NULL, config_lookup(&cfg2, "k"),
+                                  record_change, log));
+  TT_ASSERT_STR_EQ("+ ", log);
+
+  config_destroy(&cfg2);
+  config_destroy(&cfg);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void setup_reloaded_config(config_t *config, void *context)
+{
+  config_set_include_dir(config, (const char *)context);
+}
+
+TT_TEST(ConfigReloader)
+{
+  config_reloader_t *reloader;
+  const config_t *cfg, *cfg2;
+  FILE *fp;
+  int ival;
+
+  fp = fopen("temp_reload.cfg", "wt");
+  TT_ASSERT_PTR_NOTNULL(fp);
+  fprintf(fp, "a = 1;\n@include \"temp_fragment.cfg\"\n");
+  fclose(fp);
+
+  fp = fopen("temp_fragment.cfg", "wt");
+  TT_ASSERT_PTR_NOTNULL(fp);
+  fprintf(fp, "b = 1;\n");
+  fclose(fp);
+
+  reloader = config_reloader_create("temp_reload.cfg", setup_reloaded_config,
+                                    ".");
+  TT_ASSERT_PTR_NULL(config_reloader_get_failure(reloader));
+
+  cfg = config_reloader_acquire(reloader);
+  TT_ASSERT_PTR_NOTNULL(cfg);
+  TT_ASSERT_STR_EQ(".", config_get_include_dir(cfg));
+  TT_ASSERT_TRUE(config_lookup_int(cfg, "b", &ival));
+  TT_ASSERT_INT_EQ(1, ival);
+
+  /* Nothing changed, so nothing is read. */
+  TT_ASSERT_FALSE(config_reloader_check(reloader));
+  cfg2 = config_reloader_acquire(reloader);
+  TT_ASSERT_PTR_EQ(cfg, cfg2);
+  config_reloader_release(cfg2);
+
+  /* A change to an included file is noticed; the configuration already
+   * acquired stays as it was until it is released.
+   */
+  fp = fopen("temp_fragment.cfg", "wt");
+  fprintf(fp, "b = 2;\n");
+  fclose(fp);
+
+  TT_ASSERT_TRUE(config_reloader_check(reloader));
+  cfg2 = config_reloader_acquire(reloader);
+  TT_ASSERT_PTR_NOTNULL(cfg2);
+  TT_ASSERT_TRUE(config_lookup_int(cfg2, "b", &ival));
+  TT_ASSERT_INT_EQ(2, ival);
+  TT_ASSERT_TRUE(config_lookup_int(cfg, "b", &ival));
+  TT_ASSERT_INT_EQ(1, ival);
+  config_reloader_release(cfg);
+
+  /* A broken file leaves the last good configuration in place. */
+  fp = fopen("temp_reload.cfg", "wt");
+  fprintf(fp, "a = ;\n");
+  fclose(fp);
+
+  TT_ASSERT_FALSE(config_reloader_check(reloader));
+  TT_ASSERT_PTR_NOTNULL(config_reloader_get_failure(reloader));
+  TT_ASSERT_STR_EQ("syntax error",
+                   config_error_text(config_reloader_get_failure(reloader)));
+  TT_ASSERT_INT_EQ(1,
+                   config_error_line(config_reloader_get_failure(reloader)));
+  cfg = config_reloader_acquire(reloader);
+  TT_ASSERT_PTR_EQ(cfg2, cfg);
+  config_reloader_release(cfg);
+  TT_ASSERT_FALSE(config_reloader_check(reloader));
+
+  fp = fopen("temp_reload.cfg", "wt");
+  fprintf(fp, "a = 3;\n");
+  fclose(fp);
+
+  TT_ASSERT_TRUE(config_reloader_check(reloader));
+  TT_ASSERT_PTR_NULL(config_reloader_get_failure(reloader));
+  cfg = config_reloader_acquire(reloader);
+  TT_ASSERT_TRUE(config_lookup_int(cfg, "a", &ival));
+  TT_ASSERT_INT_EQ(3, ival);
+  TT_ASSERT_PTR_NULL(config_lookup(cfg, "b"));
+  config_reloader_release(cfg);
+
+  /* The included file is no longer watched. */
+  remove("temp_fragment.cfg");
+  TT_ASSERT_FALSE(config_reloader_check(reloader));
+  TT_ASSERT_TRUE(config_reloader_reload(reloader));
+
+  /* A configuration may outlive its reloader. */
+  config_reloader_destroy(reloader);
+  TT_ASSERT_TRUE(config_lookup_int(cfg2, "b", &ival));
+  config_reloader_release(cfg2);
+
+  /* A file that cannot be read at first is read once it appears. */
+  remove("temp_reload.cfg");
+  reloader = config_reloader_create("temp_reload.cfg", NULL, NULL);
+  TT_ASSERT_PTR_NULL(config_reloader_acquire(reloader));
+  TT_ASSERT_INT_EQ(CONFIG_ERR_FILE_IO,
+                   config_error_type(config_reloader_get_failure(reloader)));
+  TT_ASSERT_FALSE(config_reloader_check(reloader));
+
+  fp = fopen("temp_reload.cfg", "wt");
+  fprintf(fp, "a = 4;\n");
+  fclose(fp);
+
+  TT_ASSERT_TRUE(config_reloader_check(reloader));
+  cfg = config_reloader_acquire(reloader);
+  TT_ASSERT_TRUE(config_lookup_int(cfg, "a", &ival));
+  TT_ASSERT_INT_EQ(4, ival);
+  config_reloader_release(cfg);
+  config_reloader_destroy(reloader);
+
+  remove("temp_reload.cfg");
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(SettingCopy)
+{
+  config_t cfg, cfg2;
+  config_setting_t *root, *root2, *copy;
+  const char *str = NULL;
+  int ival = 0;
+  double fval = 0.0;
+  char text[1024], *p = text;
+  int i;
+
+  config_init(&cfg);
+  config_init(&cfg2);
+  config_set_options(&cfg2, CONFIG_OPTION_ARENA | CONFIG_OPTION_INTERN_NAMES
+                     | CONFIG_OPTION_INTERN_STRINGS);
+
+  /* A group wide enough to be indexed. */
+  p += sprintf(p, "w = {");
+  for(i = 0; i < 20; ++i)
+    p += sprintf(p, " m%d = %d;", i, i);
+  sprintf(p, " }; c = { d = 1.5; e = [1, 2, 3]; f = { g = true; }; "
+          "h = ( 1, \"y\", { i = 0x2AL; } ); s = \"str\"; };");
+
+  TT_ASSERT_TRUE(config_read_string(&cfg, text));
+  root = config_root_setting(&cfg);
+  root2 = config_root_setting(&cfg2);
+
+  /* Copies into another configuration are equal to their originals. */
+  copy = config_setting_copy(root2, config_lookup(&cfg, "c"), NULL);
+  TT_ASSERT_PTR_NOTNULL(copy);
+  TT_ASSERT_STR_EQ("c", config_setting_name(copy));
+  TT_ASSERT_INT_EQ(0, config_diff(config_lookup(&cfg, "c"), copy, NULL, NULL));
+  copy = config_lookup(&cfg2, "c.h.[2].i");
+  TT_ASSERT_INT_EQ(CONFIG_FORMAT_HEX, config_setting_get_format(copy));
+  TT_ASSERT_TRUE(config_lookup_string(&cfg2, "c.s", &str));
+  TT_ASSERT_STR_EQ("str", str);
+
+  copy = config_setting_copy(root2, config_lookup(&cfg, "w"), "wide");
+  TT_ASSERT_PTR_NOTNULL(copy);
+  TT_ASSERT_INT_EQ(0, config_diff(config_lookup(&cfg, "w"), copy, NULL, NULL));
+  TT_ASSERT_TRUE(config_lookup_int(&cfg2, "wide.m17", &ival));
+  TT_ASSERT_INT_EQ(17, ival);
+
+  /* The copy's own name and place are checked. */
+  TT_ASSERT_PTR_NULL(config_setting_copy(root2, config_lookup(&cfg, "w"),
+                                         "wide"));
+  TT_ASSERT_PTR_NULL(config_setting_copy(root2, config_lookup(&cfg, "w"),
+                                         "1wide"));
+  TT_ASSERT_PTR_NULL(config_setting_copy(root2, config_lookup(&cfg, "c.h.[0]"),
+                                         NULL));
+  TT_ASSERT_PTR_NULL(config_setting_copy(config_lookup(&cfg, "c.e"),
+                                         config_lookup(&cfg, "c.d"), NULL));
+  TT_ASSERT_PTR_NULL(config_setting_copy(config_lookup(&cfg, "c.e"),
+                                         config_lookup(&cfg, "c.f"), NULL));
+  TT_ASSERT_PTR_NOTNULL(config_setting_copy(config_lookup(&cfg, "c.e"),
+                                            config_lookup(&cfg, "w.m4"), NULL));
+  TT_ASSERT_PTR_NOTNULL(config_setting_copy(config_lookup(&cfg, "c.h"),
+                                            config_lookup(&cfg, "c"), NULL));
+  TT_ASSERT_TRUE(config_lookup_int(&cfg, "c.e.[3]", &ival));
+  TT_ASSERT_INT_EQ(4, ival);
+
+  /* A setting copied into itself is copied as it was. */
+  TT_ASSERT_TRUE(config_lookup_float(&cfg, "c.h.[3].d", &fval));
+  TT_ASSERT_DOUBLE_EQ(1.5, fval);
+  TT_ASSERT_INT_EQ(3, config_setting_length(config_lookup(&cfg, "c.h.[3].h")));
+
+  /* An override may replace the setting that holds the original. */
+  config_set_options(&cfg, CONFIG_OPTION_ALLOW_OVERRIDES);
+  copy = config_setting_copy(root, config_lookup(&cfg, "c.f"), "c");
+  TT_ASSERT_PTR_NOTNULL(copy);
+  TT_ASSERT_INT_EQ(1, config_setting_index(copy));
+  TT_ASSERT_TRUE(config_lookup_bool(&cfg, "c.g", &ival));
+  TT_ASSERT_PTR_NULL(config_lookup(&cfg, "c.d"));
+
+  config_destroy(&cfg2);
+  config_destroy(&cfg);
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(SettingMerge)
+{
+  static const char *dst_text =
+    "a = 1; g = { x = 1; y = { z = 1; }; l = ( 1 ); };";
+  static const char *src_text =
+    "a = 2; b = 3; g = { y = { z = 2; w = 1; }; l = ( 2, 3 ); n = 4; };";
+  config_t dst, src;
+  int ival = 0;
+
+  config_init(&dst);
+  config_init(&src);
+  TT_ASSERT_TRUE(config_read_string(&src, src_text));
+
+  /* Without an override, settings already present are kept. */
+  TT_ASSERT_TRUE(config_read_string(&dst, dst_text));
+  TT_ASSERT_TRUE(config_setting_merge(config_root_setting(&dst),
+                                      config_root_setting(&src), 0));
+  TT_ASSERT_TRUE(config_lookup_int(&dst, "a", &ival));
+  TT_ASSERT_INT_EQ(1, ival);
+  TT_ASSERT_TRUE(config_lookup_int(&dst, "b", &ival));
+  TT_ASSERT_INT_EQ(3, ival);
+  TT_ASSERT_TRUE(config_lookup_int(&dst, "g.y.z", &ival));
+  TT_ASSERT_INT_EQ(1, ival);
+  TT_ASSERT_TRUE(config_lookup_int(&dst, "g.y.w", &ival));
+  TT_ASSERT_INT_EQ(1, ival);
+  TT_ASSERT_INT_EQ(1, config_setting_length(config_lookup(&dst, "g.l")));
+  TT_ASSERT_TRUE(config_lookup_int(&dst, "g.n", &ival));
+  TT_ASSERT_INT_EQ(4, ival);
+
+  /* With one, they are replaced in place; groups are still merged. */
+  TT_ASSERT_TRUE(config_read_string(&dst, dst_text));
+  TT_ASSERT_TRUE(config_setting_merge(config_root_setting(&dst),
+                                      config_root_setting(&src),
+                                      CONFIG_MERGE_OVERRIDE));
+  TT_ASSERT_TRUE(config_lookup_int(&dst, "a", &ival));
+  TT_ASSERT_INT_EQ(2, ival);
+  TT_ASSERT_INT_EQ(0, config_setting_index(config_lookup(&dst, "a")));
+  TT_ASSERT_TRUE(config_lookup_int(&dst, "g.x", &ival));
+  TT_ASSERT_INT_EQ(1, ival);
+  TT_ASSERT_TRUE(config_lookup_int(&dst, "g.y.z", &ival));
+  TT_ASSERT_INT_EQ(2, ival);
+  TT_ASSERT_INT_EQ(2, config_setting_length(config_lookup(&dst, "g.l")));
+  TT_ASSERT_INT_EQ(2, config_setting_index(config_lookup(&dst, "g.l")));
+
+  /* A group can be merged into the group that holds it. */
+  TT_ASSERT_TRUE(config_setting_merge(config_root_setting(&dst),
+                                      config_lookup(&dst, "g"),
+                                      CONFIG_MERGE_OVERRIDE));
+  TT_ASSERT_TRUE(config_lookup_int(&dst, "n", &ival));
+  TT_ASSERT_INT_EQ(4, ival);
+  TT_ASSERT_TRUE(config_lookup_int(&dst, "g.n", &ival));
+  TT_ASSERT_INT_EQ(4, ival);
+
+  TT_ASSERT_FALSE(config_setting_merge(config_lookup(&dst, "g.l"),
+                                       config_root_setting(&src), 0));
+
+  config_destroy(&src);
+  config_destroy(&dst);
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(PackedArrays)
+{
+  static const int options[] = {
+    0, CONFIG_OPTION_ARENA,
+    CONFIG_OPTION_INTERN_NAMES | CONFIG_OPTION_INTERN_STRINGS
+  };
+  static const char *text =
+    "i = [ 1, 0x20, 3 ];\n"
+    "l = [ 4L, 5L ];\n"
+    "f = [ 1.5, 2.5 ];\n"
+    "b = [ true, false ];\n"
+    "s = [ \"x\", \"y\", \"z\" ];\n"
+    "e = [ ];\n";
+  config_t cfg, cfg2;
+  config_setting_t *array, *elem;
+  char *out, *out2;
+  int k;
+
+  for(k = 0; k < (int)(sizeof(options) / sizeof(options[0])); ++k)
+  {
+    config_init(&cfg);
+    config_set_options(&cfg, config_get_options(&cfg) | options[k]);
+    TT_ASSERT_TRUE(config_read_string(&cfg, text));
+
+    /* Element values are read without making element settings. */
+    array = config_lookup(&cfg, "i");
+    TT_ASSERT_INT_EQ(3, config_setting_length(array));
+    TT_ASSERT_INT_EQ(32, config_setting_get_int_elem(array, 1));
+    TT_ASSERT_INT_EQ(0, config_setting_get_int_elem(array, 3));
+    TT_ASSERT_TRUE(config_setting_get_int64_elem(
+                     config_lookup(&cfg, "l"), 1) == 5LL);
+    TT_ASSERT_TRUE(config_setting_get_float_elem(
+                     config_lookup(&cfg, "f"), 1) == 2.5);
+    TT_ASSERT_INT_EQ(0, config_setting_get_bool_elem(
+                       config_lookup(&cfg, "b"), 1));
+    TT_ASSERT_STR_EQ("z", config_setting_get_string_elem(
+                       config_lookup(&cfg, "s"), 2));
+
+    /* Formats and values survive a round trip. */
+    out = config_write_string(&cfg, NULL);
+    config_init(&cfg2);
+    TT_ASSERT_TRUE(config_read_string(&cfg2, out));
+    out2 = config_write_string(&cfg2, NULL);
+    TT_ASSERT_STR_EQ(out, out2);
+    TT_ASSERT_INT_EQ(0, config_diff(config_root_setting(&cfg),
+                                    config_root_setting(&cfg2), NULL, NULL));
+    free(out2);
+    free(out);
+
+    /* Removing from a packed array. */
+    TT_ASSERT_TRUE(config_setting_remove_elem(config_lookup(&cfg, "s"), 0));
+    TT_ASSERT_STR_EQ("y", config_setting_get_string_elem(
+                       config_lookup(&cfg, "s"), 0));
+    TT_ASSERT_INT_EQ(2, config_setting_length(config_lookup(&cfg, "s")));
+
+    /* An emptied array takes elements of another type. */
+    array = config_lookup(&cfg, "b");
+    TT_ASSERT_TRUE(config_setting_remove_elem(array, 0));
+    TT_ASSERT_TRUE(config_setting_remove_elem(array, 0));
+    TT_ASSERT_PTR_NOTNULL(config_setting_set_float_elem(array, -1, 0.5));
+    TT_ASSERT_INT_EQ(CONFIG_TYPE_FLOAT,
+                     config_setting_type(config_setting_get_elem(array, 0)));
+
+    /* Element settings, once asked for, stay the same ones. */
+    array = config_lookup(&cfg, "i");
+    elem = config_setting_get_elem(array, 1);
+    TT_ASSERT_PTR_NOTNULL(elem);
+    TT_ASSERT_INT_EQ(32, config_setting_get_int(elem));
+    TT_ASSERT_INT_EQ(CONFIG_FORMAT_HEX, config_setting_get_format(elem));
+    TT_ASSERT_PTR_EQ(array, config_setting_parent(elem));
+    TT_ASSERT_INT_EQ(1, config_setting_source_line(elem));
+    TT_ASSERT_PTR_EQ(elem, config_setting_get_elem(array, 1));
+    TT_ASSERT_PTR_EQ(elem, config_setting_set_int_elem(array, 1, 7));
+    TT_ASSERT_INT_EQ(7, config_setting_get_int_elem(array, 1));
+    TT_ASSERT_PTR_NOTNULL(config_setting_set_int_elem(array, -1, 8));
+    TT_ASSERT_INT_EQ(4, config_setting_length(array));
+    TT_ASSERT_PTR_NULL(config_setting_set_string_elem(array, -1, "no"));
+
+    /* Removing an element setting frees the stale packed values. */
+    array = config_lookup(&cfg, "l");
+    TT_ASSERT_PTR_NOTNULL(config_setting_get_elem(array, 1));
+    TT_ASSERT_PTR_NOTNULL(array->value.list->values);
+    TT_ASSERT_TRUE(config_setting_remove_elem(array, 0));
+    TT_ASSERT_PTR_NULL(array->value.list->values);
+    TT_ASSERT_PTR_NULL(array->value.list->formats);
+    TT_ASSERT_INT_EQ(1, config_setting_length(array));
+    TT_ASSERT_TRUE(config_setting_get_int64_elem(array, 0) == 5LL);
+
+    /* A copy is packed too, and compares equal. */
+    array = config_setting_copy(config_root_setting(&cfg),
+                                config_lookup(&cfg, "f"), "f2");
+    TT_ASSERT_PTR_NOTNULL(array);
+    TT_ASSERT_TRUE(config_setting_get_float_elem(array, 0) == 1.5);
+    TT_ASSERT_INT_EQ(0, config_diff(config_lookup(&cfg, "f"), array,
+                                    NULL, NULL));
+    TT_ASSERT_TRUE(config_setting_set_float_elem(array, 0, 9.0) != NULL);
+    TT_ASSERT_INT_EQ(1, config_diff(config_lookup(&cfg, "f"), array,
+                                    NULL, NULL));
+
+    TT_ASSERT_INT_EQ(0, config_setting_length(config_lookup(&cfg, "e")));
+    TT_ASSERT_PTR_NULL(config_setting_get_elem(config_lookup(&cfg, "e"), 0));
+
+    config_destroy(&cfg2);
+    config_destroy(&cfg);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(BulkArrays)
+{
+  static const int options[] = { 0, CONFIG_OPTION_ARENA };
+  static const int ints[] = { 1, 2, 3, 4, 5 };
+  static const long long int64s[] = { 10000000000LL, -1LL };
+  static const double floats[] = { 0.5, 1.5, 2.5 };
+  static const int bools[] = { 1, 0, 7 };
+  config_t cfg;
+  config_setting_t *array, *root;
+  int ivalues[8], k;
+  long long llvalues[8];
+  double fvalues[8];
+  char *text;
+
+  for(k = 0; k < (int)(sizeof(options) / sizeof(options[0])); ++k)
+  {
+    config_init(&cfg);
+    config_set_options(&cfg, config_get_options(&cfg) | options[k]);
+    TT_ASSERT_TRUE(config_read_string(&cfg,
+                                      "i = [ 1, 2, 3 ]; l = ( 1, 2L, 3.5 );"
+                                      " s = [ \"a\" ]; n = 1;"));
+    root = config_root_setting(&cfg);
+
+    /* Reading copies at most as many values as asked for. */
+    array = config_lookup(&cfg, "i");
+    TT_ASSERT_INT_EQ(3, config_setting_get_int_array(array, ivalues, 8));
+    TT_ASSERT_INT_EQ(3, ivalues[2]);
+    TT_ASSERT_INT_EQ(2, config_setting_get_int_array(array, ivalues, 2));
+    TT_ASSERT_INT_EQ(3, config_setting_get_int64_array(array, llvalues, 8));
+    TT_ASSERT_TRUE(llvalues[1] == 2LL);
+    TT_ASSERT_INT_EQ(-1, config_setting_get_bool_array(array, ivalues, 8));
+    TT_ASSERT_INT_EQ(-1, config_setting_get_int_array(
+                       config_lookup(&cfg, "s"), ivalues, 8));
+    TT_ASSERT_INT_EQ(-1, config_setting_get_int_array(
+                       config_lookup(&cfg, "n"), ivalues, 8));
+
+    /* Elements of lists are converted as the scalar getters would. */
+    array = config_lookup(&cfg, "l");
+    TT_ASSERT_INT_EQ(-1, config_setting_get_float_array(array, fvalues, 8));
+    config_set_auto_convert(&cfg, CONFIG_TRUE);
+    TT_ASSERT_INT_EQ(3, config_setting_get_float_array(array, fvalues, 8));
+    TT_ASSERT_TRUE(fvalues[2] == 3.5);
+    TT_ASSERT_INT_EQ(3, config_setting_get_int_array(array, ivalues, 8));
+    TT_ASSERT_INT_EQ(3, ivalues[2]);
+
+    /* Setting replaces the elements, whatever their type. */
+    array = config_lookup(&cfg, "i");
+    TT_ASSERT_PTR_NOTNULL(config_setting_get_elem(array, 0));
+    TT_ASSERT_TRUE(config_setting_set_float_array(array, floats, 3));
+    TT_ASSERT_INT_EQ(3, config_setting_length(array));
+    TT_ASSERT_TRUE(config_setting_get_float_elem(array, 1) == 1.5);
+    TT_ASSERT_TRUE(config_setting_set_int64_array(array, int64s, 2));
+    TT_ASSERT_TRUE(config_setting_get_int64_elem(array, 0) == 10000000000LL);
+    TT_ASSERT_INT_EQ(-1, config_setting_get_int_array(array, ivalues, 8));
+    TT_ASSERT_TRUE(config_setting_set_int_array(array, NULL, 0));
+    TT_ASSERT_INT_EQ(0, config_setting_length(array));
+    TT_ASSERT_FALSE(config_setting_set_int_array(config_lookup(&cfg, "l"),
+                                                 ints, 5));
+
+    /* Appending keeps the type of the array. */
+    TT_ASSERT_TRUE(config_setting_append_bool_array(array, bools, 3));
+    TT_ASSERT_FALSE(config_setting_append_int_array(array, ints, 5));
+    TT_ASSERT_TRUE(config_setting_append_bool_array(array, bools, 2));
+    TT_ASSERT_INT_EQ(5, config_setting_get_bool_array(array, ivalues, 8));
+    TT_ASSERT_INT_EQ(1, ivalues[2]);
+    TT_ASSERT_INT_EQ(0, ivalues[4]);
+
+    /* Also once the array has element settings. */
+    array = config_setting_add(root, "a", CONFIG_TYPE_ARRAY);
+    TT_ASSERT_PTR_NOTNULL(config_setting_set_int_elem(array, -1, 0));
+    TT_ASSERT_PTR_NOTNULL(config_setting_set_int_elem(array, -1, 16));
+    TT_ASSERT_TRUE(config_setting_append_int_array(array, ints, 5));
+    TT_ASSERT_INT_EQ(7, config_setting_length(array));
+    TT_ASSERT_INT_EQ(5, config_setting_get_int(
+                       config_setting_get_elem(array, 6)));
+    TT_ASSERT_INT_EQ(7, config_setting_get_int_array(array, ivalues, 8));
+    TT_ASSERT_INT_EQ(16, ivalues[1]);
+
+    /* A count that would overflow the length is refused up front. */
+    TT_ASSERT_FALSE(config_setting_append_int_array(array, ints, UINT_MAX));
+    TT_ASSERT_INT_EQ(7, config_setting_length(array));
+
+    text = config_write_string(&cfg, NULL);
+    TT_ASSERT_PTR_NOTNULL(strstr(text, "i = [ true, false, true, true, "
+                                 "false ];"));
+    TT_ASSERT_PTR_NOTNULL(strstr(text, "a = [ 0, 16, 1, 2, 3, 4, 5 ];"));
+    free(text);
+
+    config_destroy(&cfg);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __odd_or_aggregate(const config_setting_t *setting, void *context)
+{
+  (void)context;
+  return(config_setting_is_aggregate(setting)
+         || (config_setting_get_int(setting) & 1));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __named_like(const config_setting_t *setting, void *context)
+{
+  return(setting->name && (setting->name[0] == *(const char *)context));
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct parent_view
+{
+  int length;
+  int calls;
+  int consistent;
+};
+
+/* Removes every other child, checking that the parent is seen unchanged. */
+static int __sees_whole_parent(const config_setting_t *setting, void *context)
+{
+  struct parent_view *view = (struct parent_view *)context;
+  const config_setting_t *parent = config_setting_parent(setting);
+
+  if((config_setting_length(parent) != view->length)
+     || (config_setting_index(setting) != view->calls)
+     || (config_setting_get_int_elem(parent, 0) != 10)
+     || (config_setting_get_int_elem(parent, 1) != 11)
+     || (config_setting_get_int_elem(parent, view->calls)
+         != config_setting_get_int(setting)))
+    view->consistent = 0;
+
+  return((view->calls++ % 2) == 0);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int __string_is(const config_setting_t *setting, void *context)
+{
+  const char *str = config_setting_get_string(setting);
+
+  return(str && ! strcmp(str, (const char *)context));
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(RemoveSettings)
+{
+  static const int options[] = { 0, CONFIG_OPTION_ARENA };
+  config_t cfg;
+  config_setting_t *root, *group, *setting;
+  char name[16], *text;
+  int i, k, ival, list;
+
+  for(k = 0; k < (int)(sizeof(options) / sizeof(options[0])); ++k)
+  {
+    config_init(&cfg);
+    config_set_options(&cfg, config_get_options(&cfg) | options[k]);
+    TT_ASSERT_TRUE(config_read_string(
+                     &cfg, "a = [ 1, 0x2, 3, 4, 5 ]; s = [ \"x\", \"y\" ];"
+                     " l = ( 1, 2, ( 3 ), 4 ); g = { };"));
+    root = config_root_setting(&cfg);
+
+    /* A wide group, with a hash index. */
+    group = config_lookup(&cfg, "g");
+    for(i = 0; i < 40; ++i)
+    {
+      sprintf(name, "%c%d", (i % 2) ? 'o' : 'e', i);
+      config_setting_set_int(config_setting_add(group, name, CONFIG_TYPE_INT),
+                             i);
+    }
+
+    setting = config_lookup(&cfg, "g.o21");
+    TT_ASSERT_INT_EQ(21, config_setting_index(setting));
+    TT_ASSERT_TRUE(config_setting_remove_setting(setting));
+    TT_ASSERT_INT_EQ(21, config_setting_index(config_lookup(&cfg, "g.e22")));
+    TT_ASSERT_FALSE(config_setting_remove_setting(root));
+    TT_ASSERT_FALSE(config_setting_remove(root, "l.[0]"));
+    TT_ASSERT_TRUE(config_setting_remove(root, "g.e0"));
+    TT_ASSERT_PTR_NULL(config_lookup(&cfg, "g.e0"));
+
+    /* Members are removed in one pass; the index and positions follow. */
+    TT_ASSERT_INT_EQ(19, config_setting_remove_if(group, __named_like, "o"));
+    TT_ASSERT_INT_EQ(19, config_setting_length(group));
+    for(i = 2; i < 40; i += 2)
+    {
+      sprintf(name, "e%d", i);
+      setting = config_setting_get_member(group, name);
+      TT_ASSERT_PTR_NOTNULL(setting);
+      TT_ASSERT_INT_EQ((i / 2) - 1, config_setting_index(setting));
+    }
+    TT_ASSERT_PTR_NULL(config_lookup(&cfg, "g.o1"));
+
+    /* Indexes stay exact as members are removed from the front, the back
+     * and the middle, and as new ones are added behind them.
+     */
+    for(i = 0; i < 20; ++i)
+    {
+      int n = config_setting_length(group), j;
+
+      switch(i % 3)
+      {
+        case 0: j = 0; break;
+        case 1: j = n - 1; break;
+        default: j = n / 3; break;
+      }
+
+      TT_ASSERT_TRUE(config_setting_remove_setting(
+                       config_setting_get_elem(group, j)));
+      if((i % 4) == 0)
+      {
+        sprintf(name, "n%d", i);
+        config_setting_add(group, name, CONFIG_TYPE_INT);
+      }
+
+      for(j = 0; j < config_setting_length(group); ++j)
+      {
+        setting = config_setting_get_elem(group, j);
+        TT_ASSERT_INT_EQ(j, config_setting_index(setting));
+        TT_ASSERT_PTR_EQ(setting, config_setting_get_member(
+                           group, config_setting_name(setting)));
+      }
+    }
+    TT_ASSERT_INT_EQ(19 - 20 + 5, config_setting_length(group));
+
+    /* Packed arrays are compacted with their formats. */
+    TT_ASSERT_INT_EQ(3, config_setting_remove_if(config_lookup(&cfg, "a"),
+                                                 __odd_or_aggregate, NULL));
+    TT_ASSERT_INT_EQ(2, config_setting_length(config_lookup(&cfg, "a")));
+    TT_ASSERT_INT_EQ(1, config_setting_remove_if(config_lookup(&cfg, "s"),
+                                                 __string_is, "x"));
+    TT_ASSERT_INT_EQ(2, config_setting_remove_if(config_lookup(&cfg, "l"),
+                                                 __odd_or_aggregate, NULL));
+    setting = config_setting_get_elem(config_lookup(&cfg, "l"), 1);
+    TT_ASSERT_INT_EQ(1, config_setting_index(setting));
+    TT_ASSERT_INT_EQ(CONFIG_TYPE_INT, config_setting_type(setting));
+    TT_ASSERT_TRUE(config_lookup_int(&cfg, "l.[1]", &ival));
+    TT_ASSERT_INT_EQ(4, ival);
+
+    /* Every predicate sees the parent as it was before the call. */
+    for(list = 0; list <= 1; ++list)
+    {
+      struct parent_view view = { 6, 0, 1 };
+      static const int values[] = { 10, 11, 12, 13, 14, 15 };
+
+      setting = config_setting_add(config_root_setting(&cfg), "v",
+                                   list ? CONFIG_TYPE_LIST
+                                   : CONFIG_TYPE_ARRAY);
+      for(i = 0; i < 6; ++i)
+        config_setting_set_int_elem(setting, -1, values[i]);
+
+      TT_ASSERT_INT_EQ(3, config_setting_remove_if(setting,
+                                                   __sees_whole_parent,
+                                                   &view));
+      TT_ASSERT_INT_EQ(6, view.calls);
+      TT_ASSERT_TRUE(view.consistent);
+      TT_ASSERT_INT_EQ(3, config_setting_length(setting));
+      TT_ASSERT_INT_EQ(13, config_setting_get_int_elem(setting, 1));
+      TT_ASSERT_TRUE(config_setting_remove(config_root_setting(&cfg), "v"));
+    }
+
+    text = config_write_string(&cfg, NULL);
+    TT_ASSERT_PTR_NOTNULL(strstr(text, "a = [ 0x2, 4 ];"));
+    TT_ASSERT_PTR_NOTNULL(strstr(text, "s = [ \"y\" ];"));
+    TT_ASSERT_PTR_NOTNULL(strstr(text, "l = ( 2, 4 );"));
+    free(text);
+
+    config_destroy(&cfg);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+TT_TEST(FastScanning)
+{
+  const size_t runlength = 40000;
+  char *text = (char *)malloc(runlength * 3 + 1024);
+  char expected[64];
+  const char *str;
+  config_t cfg;
+  FILE *fp;
+  size_t i, len;
+  int shift, ival;
+
+  config_init(&cfg);
+
+  /* Comments, strings and whitespace that start and end at every offset
+   * within a 32-byte block, with both parser engines. Each input is copied
+   * into a buffer of its own size, so that a checked build catches any read
+   * past its end.
+   */
+  for(shift = 0; shift < 80; ++shift)
+  {
+    char *copy;
+
+    config_set_option(&cfg, CONFIG_OPTION_DIRECT_PARSER, shift >= 40);
+    len = sprintf(text, "%*s// one %*s\n/* two\n * three * / **/ a = \"",
+                  shift % 40, "", (shift % 40) + 1, "x");
+    for(i = 0; i < (size_t)(shift % 40); ++i)
+      text[len++] = 'y';
+    len += sprintf(text + len, "\\\"q\\\\\nr\"; b = 1;\n\r\n  \t \n"
+                   "# four */ \"\n   c = ;\n");
+
+    memset(expected, 'y', shift % 40);
+    strcpy(expected + (shift % 40), "\"q\\\nr");
+
+    copy = (char *)malloc(len + 1);
+    memcpy(copy, text, len + 1);
+    TT_ASSERT_FALSE(config_read_string(&cfg, copy));
+    TT_ASSERT_INT_EQ(8, config_error_line(&cfg));
+    TT_ASSERT_STR_EQ(expected, config_setting_get_string(
+                       config_lookup(&cfg, "a")));
+    TT_ASSERT_INT_EQ(4, config_setting_source_line(
+                       config_lookup(&cfg, "b")));
+
+    copy[len - 3] = '2';
+    TT_ASSERT_TRUE(config_read_string(&cfg, copy));
+    TT_ASSERT_INT_EQ(8, config_setting_source_line(
+                       config_lookup(&cfg, "c")));
+
+    /* Scanned in place, ending in the two NULs. */
+    copy = (char *)realloc(copy, len + 2);
+    copy[len + 1] = '\0';
+    TT_ASSERT_TRUE(config_read_buffer(&cfg, copy, len + 2));
+    TT_ASSERT_INT_EQ(8, config_setting_source_line(
+                       config_lookup(&cfg, "c")));
+    free(copy);
+  }
+
+  /* An @include directive after blank lines must still be recognized. */
+  TT_ASSERT_FALSE(config_read_string(
+                    &cfg, "x = 1;\n\n  \t\n   @include \"no_such_file.cfg\"\n"));
+  TT_ASSERT_STR_EQ("cannot open include file", config_error_text(&cfg));
+  TT_ASSERT_INT_EQ(4, config_error_line(&cfg));
+
+  TT_ASSERT_FALSE(config_read_string(&cfg, "x = 1;\r\n  @include \"\"\n"));
+  TT_ASSERT_STR_EQ("cannot open include file", config_error_text(&cfg));
+
+  /* Runs longer than the scanner's buffer, read from a stream. */
+  fp = fopen("temp_fastscan.cfg", "wt");
+  TT_ASSERT_PTR_NOTNULL(fp);
+  fputs("// ", fp);
+  for(i = 0; i < runlength; ++i)
+    fputc('-', fp);
+  fputs("\n/*", fp);
+  for(i = 0; i < runlength; ++i)
+    fputc(((i % 100) == 99) ? '\n' : '*', fp);
+  fputs("*/\nstr = \"", fp);
+  for(i = 0; i < runlength; ++i)
+    fputc('a' + (i % 26), fp);
+  fputs("\";\nval = 7;\n", fp);
+  fclose(fp);
+
+  fp = fopen("temp_fastscan.cfg", "rt");
+  TT_ASSERT_PTR_NOTNULL(fp);
+  TT_ASSERT_TRUE(config_read(&cfg, fp));
+  fclose(fp);
+
+  TT_ASSERT_TRUE(config_lookup_string(&cfg, "str", &str));
+  TT_ASSERT_INT_EQ((int)runlength, (int)strlen(str));
+  TT_ASSERT_TRUE(config_lookup_int(&cfg, "val", &ival));
+  TT_ASSERT_INT_EQ(7, ival);
+  TT_ASSERT_INT_EQ(4 + (int)(runlength / 100), config_setting_source_line(
+                     config_lookup(&cfg, "val")));
+
+  remove("temp_fastscan.cfg");
+  config_destroy(&cfg);
+  free(text);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Describes the outcome of reading a file or string, including the source
+ * position of every setting, so that two parses can be compared.
+ */
+static void describe_setting(const config_setting_t *setting, char *buf,
+                             size_t size)
+{
+  int i, n = config_setting_length(setting);
+  size_t len = strlen(buf);
+
+  snprintf(buf + len, size - len, "%s@%s:%u ",
+           setting->name ? setting->name : "-",
+           setting->file ? setting->file : "(null)", setting->line);
+
+  if(config_setting_is_aggregate(setting))
+  {
+    for(i = 0; i < n; ++i)
+    {
+      const config_setting_t *elem = config_setting_get_elem(setting, i);
+      if(elem)
+        describe_setting(elem, buf, size);
+    }
+  }
+}
+
+static char *describe_parse(const char *file, const char *text, int options)
+{
+  config_t cfg;
+  char *buf = (char *)malloc(65536);
+  int ok;
+
+  config_init(&cfg);
+  config_set_include_dir(&cfg, "./testdata");
+  config_set_options(&cfg, options);
+
+  ok = file ? config_read_file(&cfg, file) : config_read_string(&cfg, text);
+  if(ok)
+  {
+    char *out = config_write_string(&cfg, NULL);
+    snprintf(buf, 65536, "%s\n", out);
+    free(out);
+  }
+  else
+  {
+    snprintf(buf, 65536, "%s:%d %s\n", config_error_file(&cfg),
+             config_error_line(&cfg), config_error_text(&cfg));
+  }
+
+  /* A failed parse leaves the settings read so far. */
+  describe_setting(config_root_setting(&cfg), buf, 65536);
+
+  config_destroy(&cfg);
+  return(buf);
+}
+
+static void compare_parsers(const char *file, const char *text)
+{
+  char *expected, *actual;
+
+  expected = describe_parse(file, text, CONFIG_OPTION_SEMICOLON_SEPARATORS);
+  actual = describe_parse(file, text, CONFIG_OPTION_SEMICOLON_SEPARATORS
+                          | CONFIG_OPTION_DIRECT_PARSER);
+  TT_ASSERT_STR_EQ(expected, actual);
+  free(expected);
+  free(actual);
+}
+
+TT_TEST(DirectParser)
+{
+  static const char *files[] = {
+    "testdata/input_0.cfg", "testdata/input_1.cfg", "testdata/input_2.cfg",
+    "testdata/input_3.cfg", "testdata/input_4.cfg", "testdata/input_5.cfg",
+    "testdata/input_6.cfg", "testdata/bad_input_0.cfg",
+    "testdata/bad_input_1.cfg", "testdata/binhex.cfg", "testdata/more.cfg",
+    "testdata/nesting.cfg", "testdata/override_setting.cfg",
+    "testdata/strings.cfg", NULL
+  };
+  static const char *strings[] = {
+    "a = \"x\" \"y\"\n  \"z\";\nb = [\"p\", \"q\",];\nc = (1, , 2,);",
+    "i = [0x7FFFFFFF, 0x80000000, 0b101L, -2147483649, 12LL, 5L];",
+    "f = (1., .5, -.e3, 1e5, 1.e-2, +3E+2, .);",
+    "t = [TRUE, fAlSe]; truex = 1; *x-y_z = 2;",
+    "s = \"\\a\\b\\n\\r\\t\\v\\f\\\\\\\"\\x41\\x4g\\q\\\n\";",
+    "a = 1;\na = 2;",
+    "a = [1, \"x\"];",
+    "a = 99999999999999999999;",
+    "a = { b = ( { c = [ ] } ) }\n}",
+    "\n\n  \t@include \"more.cfg\"\nx = 1;\n@include\"more.cfg\"",
+    "# comment\n// comment\n/* comment */ a = 1; /* open",
+    "a = \"open", "a = 1\nb = 2 ; ; c = 3", "a = 1, b = 2,", "{", "a = @",
+    "", NULL
+  };
+  const char **p;
+
+  for(p = files; *p; ++p)
+    compare_parsers(*p, NULL);
+
+  for(p = strings; *p; ++p)
+    compare_parsers(NULL, *p);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void compare_parallel(const char *file, const char *text, int options)
+{
+  char *expected, *actual;
+
+  expected = describe_parse(file, text, options);
+  actual = describe_parse(file, text,
+                          options | CONFIG_OPTION_PARALLEL_INCLUDES);
+  TT_ASSERT_STR_EQ(expected, actual);
+  free(expected);
+  free(actual);
+}
+
+TT_TEST(ParallelIncludes)
+{
+  static const char *fragments[] = {
+    "a = 1;\nb = { c = [1, 2]; };\n",
+    "d = \"x\"",
+    "e = 2; /* trailing comment */",
+    "a = 3;\n",
+    "f = \"open",
+    "",
+    "@include \"temp_parallel_0.cfg\"\n",
+    "g = (1, 2)\n// no terminator\n",
+    NULL
+  };
+  static const char *strings[] = {
+    "@include \"temp_parallel_0.cfg\"\n@include \"temp_parallel_2.cfg\"\n"
+    "@include \"temp_parallel_5.cfg\"\nz = 0;",
+    "@include \"temp_parallel_1.cfg\"\n;\nz = 0;",
+    "@include \"temp_parallel_1.cfg\"\n\"y\";",
+    "@include \"temp_parallel_1.cfg\"\n/* c */ z = 0;",
+    "@include \"temp_parallel_7.cfg\"\n, z = 0;",
+    "@include \"temp_parallel_0.cfg\"\n@include \"temp_parallel_3.cfg\"\n",
+    "a = 0;\n@include \"temp_parallel_2.cfg\"\n",
+    "@include \"temp_parallel_2.cfg\"\n@include \"temp_parallel_4.cfg\"\n",
+    "@include \"temp_parallel_6.cfg\"\n@include \"temp_parallel_2.cfg\"\n",
+    "h = {\n  @include \"temp_parallel_0.cfg\"\n};\n"
+    "@include \"temp_parallel_0.cfg\"\n",
+    "@include \"temp_parallel_9.cfg\"\n",
+    "@include \"temp_parallel_0.cfg\"",
+    NULL
+  };
+  char path[64];
+  const char **p;
+  config_t cfg;
+  FILE *fp;
+  int i, ival;
+
+  for(i = 0; fragments[i]; ++i)
+  {
+    sprintf(path, "testdata/temp_parallel_%d.cfg", i);
+    fp = fopen(path, "wt");
+    TT_ASSERT_PTR_NOTNULL(fp);
+    fputs(fragments[i], fp);
+    fclose(fp);
+  }
+
+  /* Fragments read ahead of time give the same settings, source positions
+   * and errors as fragments scanned in place.
+   */
+  for(p = strings; *p; ++p)
+  {
+    compare_parallel(NULL, *p, CONFIG_OPTION_SEMICOLON_SEPARATORS);
+    compare_parallel(NULL, *p, CONFIG_OPTION_SEMICOLON_SEPARATORS
+                     | CONFIG_OPTION_ALLOW_OVERRIDES);
+    compare_parallel(NULL, *p, CONFIG_OPTION_SEMICOLON_SEPARATORS
+                     | CONFIG_OPTION_DIRECT_PARSER);
+  }
+
+  compare_parallel("testdata/input_5.cfg", NULL,
+                   CONFIG_OPTION_SEMICOLON_SEPARATORS);
+  compare_parallel("testdata/override_setting.cfg", NULL,
+                   CONFIG_OPTION_ALLOW_OVERRIDES);
+
+  config_init(&cfg);
+  config_set_include_dir(&cfg, "./testdata");
+  config_set_options(&cfg, config_get_options(&cfg)
+                     | CONFIG_OPTION_PARALLEL_INCLUDES);
+  TT_ASSERT_TRUE(config_read_string(&cfg, strings[0]));
+  TT_ASSERT_TRUE(config_lookup_int(&cfg, "b.c.[1]", &ival));
+  TT_ASSERT_INT_EQ(2, ival);
+  TT_ASSERT_STR_EQ("./testdata/temp_parallel_2.cfg",
+                   config_setting_source_file(config_lookup(&cfg, "e")));
+  config_destroy(&cfg);
+
+  for(i = 0; fragments[i]; ++i)
+  {
+    sprintf(path, "testdata/temp_parallel_%d.cfg", i);
+    remove(path);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void compare_lazy(const char *file, const char *text, int options)
+{
+  char *expected, *actual;
+
+  expected = describe_parse(file, text, options);
+  actual = describe_parse(file, text, options | CONFIG_OPTION_LAZY_LOAD);
+  TT_ASSERT_STR_EQ(expected, actual);
+  free(expected);
+  free(actual);
+}
+
+TT_TEST(LazyLoad)
+{
+  static const char *files[] = {
+    "testdata/input_0.cfg", "testdata/input_1.cfg", "testdata/input_2.cfg",
+    "testdata/input_3.cfg", "testdata/input_4.cfg", "testdata/input_5.cfg",
+    "testdata/input_6.cfg", "testdata/binhex.cfg", "testdata/more.cfg",
+    "testdata/nesting.cfg", "testdata/override_setting.cfg",
+    "testdata/strings.cfg", NULL
+  };
+  static const char *strings[] = {
+    "a = {\n  b = { c = 1; d = \"}\\\" ) ]\"; /* } */ e = 2; # )\n"
+    "    f = ( 1, \"x\", { g = [ 1, 2, 3 ]; } ); // ]\n"
+    "    /* a long comment, so that this body is worth deferring too */\n"
+    "  };\n  h = [ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17,\n"
+    "    18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,\n"
+    "    35, 36, 37, 38, 39, 40 ];\n"
+    "  i = \"a long string, so that the body is worth deferring\";\n};\n"
+    "j = (\n  \"a long string, so that the body is worth deferring\",\n"
+    "  { k = ( 1, 2 ); l = \"a string with a \\\\\";\n"
+    "    m = 0x10; n = 1.5; o = true; p = 5L; },\n"
+    "  [ \"x\", \"y\" ]\n);\nq = 1;",
+    "a = {\n  @include \"more.cfg\"\n  b = \"a long string, so that the "
+    "body would be worth deferring, but for its directive\";\n};\n",
+    "a = { b = 1; c = \"a long string, so that the body is worth deferring"
+    ", which is never closed\"; d = 2; e = 3; f = 4; g = 5; h = 6; ",
+    "a = ( \"a long string, so that the body is worth deferring, but whose "
+    "brackets do not match\", [ 1, 2 ) ];",
+    NULL
+  };
+  static const char *broken =
+    "a = 1;\nb = {\n  c = 1;\n  d = \"a long string, so that the body is "
+    "worth deferring, even though it does not parse, as the error is "
+    "only found later\";\n  e = ;\n"
+    "  f = 2;\n};\ng = 3;\n";
+  const char **p;
+  config_t cfg;
+  config_setting_t *setting;
+  int ival, arena;
+
+  /* Bodies parsed when they are first accessed give the same settings and
+   * source positions as bodies parsed straight away.
+   */
+  for(p = files; *p; ++p)
+    compare_lazy(*p, NULL, CONFIG_OPTION_SEMICOLON_SEPARATORS);
+
+  for(p = strings; *p; ++p)
+  {
+    compare_lazy(NULL, *p, CONFIG_OPTION_SEMICOLON_SEPARATORS);
+    compare_lazy(NULL, *p, CONFIG_OPTION_SEMICOLON_SEPARATORS
+                 | CONFIG_OPTION_ARENA | CONFIG_OPTION_INTERN_NAMES);
+  }
+
+  config_init(&cfg);
+  config_set_options(&cfg, config_get_options(&cfg)
+                     | CONFIG_OPTION_LAZY_LOAD);
+  TT_ASSERT_TRUE(config_read_string(&cfg, strings[0]));
+  TT_ASSERT_PTR_NOTNULL(cfg.root->value.list->elements[0]->value.list->lazy);
+  TT_ASSERT_TRUE(config_lookup_int(&cfg, "j.[1].k.[1]", &ival));
+  TT_ASSERT_INT_EQ(2, ival);
+  TT_ASSERT_PTR_NOTNULL(cfg.root->value.list->elements[0]->value.list->lazy);
+  setting = config_lookup(&cfg, "a.b.f.[2].g");
+  TT_ASSERT_PTR_NOTNULL(setting);
+  TT_ASSERT_INT_EQ(3, config_setting_get_int_elem(setting, 2));
+  TT_ASSERT_INT_EQ(3, config_setting_source_line(setting));
+  TT_ASSERT_PTR_EQ(config_lookup(&cfg, "a"), setting->parent->parent
+                      ->parent->parent);
+  TT_ASSERT_PTR_NULL(cfg.root->value.list->elements[0]->value.list->lazy);
+
+  /* A syntax error in a body is recorded when the body is accessed, and
+   * leaves the error of the read alone.
+   */
+  TT_ASSERT_TRUE(config_read_string(&cfg, broken));
+  TT_ASSERT_TRUE(config_lookup_int(&cfg, "g", &ival));
+  TT_ASSERT_PTR_NULL(config_lazy_error(&cfg, NULL, NULL));
+  TT_ASSERT_INT_EQ(3, config_setting_length(config_lookup(&cfg, "b")));
+  TT_ASSERT_INT_EQ(CONFIG_ERR_NONE, config_error_type(&cfg));
+  TT_ASSERT_PTR_NULL(config_error_text(&cfg));
+  ival = 0;
+  TT_ASSERT_STR_EQ("syntax error", config_lazy_error(&cfg, NULL, &ival));
+  TT_ASSERT_INT_EQ(5, ival);
+
+  /* Changes to a deferred body parse it first. */
+  TT_ASSERT_TRUE(config_read_string(&cfg, strings[0]));
+  setting = config_setting_add(config_lookup(&cfg, "a"), "r",
+                               CONFIG_TYPE_INT);
+  TT_ASSERT_PTR_NOTNULL(setting);
+  TT_ASSERT_INT_EQ(4, config_setting_length(config_lookup(&cfg, "a")));
+  TT_ASSERT_PTR_NULL(config_setting_add(config_lookup(&cfg, "a"), "h",
+                                        CONFIG_TYPE_INT));
+  config_destroy(&cfg);
+
+  /* Once every body has been parsed, or destroyed unparsed, none is
+   * pending, and interned names are looked up through the pool again.
+   */
+  for(arena = 0; arena <= 1; ++arena)
+  {
+    char *text;
+
+    config_init(&cfg);
+    config_set_options(&cfg, config_get_options(&cfg)
+                       | CONFIG_OPTION_LAZY_LOAD
+                       | CONFIG_OPTION_INTERN_NAMES
+                       | (arena ? CONFIG_OPTION_ARENA : 0));
+    TT_ASSERT_TRUE(config_read_string(&cfg, strings[0]));
+    TT_ASSERT_TRUE(libconfig_lazy_pending(cfg.lazy));
+    TT_ASSERT_TRUE(config_setting_remove(config_root_setting(&cfg), "j"));
+    TT_ASSERT_TRUE(libconfig_lazy_pending(cfg.lazy));
+    text = config_write_string(&cfg, NULL);
+    TT_ASSERT_PTR_NOTNULL(text);
+    free(text);
+    TT_ASSERT_FALSE(libconfig_lazy_pending(cfg.lazy));
+    TT_ASSERT_PTR_NOTNULL(config_lookup(&cfg, "a.b.f.[2].g"));
+    TT_ASSERT_PTR_NULL(config_lookup(&cfg, "a.no_such_name"));
+    config_destroy(&cfg);
+
+    config_init(&cfg);
+    config_set_options(&cfg, config_get_options(&cfg)
+                       | CONFIG_OPTION_LAZY_LOAD
+                       | (arena ? CONFIG_OPTION_ARENA : 0));
+    TT_ASSERT_TRUE(config_read_string(&cfg, strings[0]));
+    TT_ASSERT_TRUE(config_setting_remove(config_root_setting(&cfg), "a"));
+    TT_ASSERT_TRUE(config_setting_remove(config_root_setting(&cfg), "j"));
+    TT_ASSERT_FALSE(libconfig_lazy_pending(cfg.lazy));
+    config_destroy(&cfg);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Expands an include path with config_glob_include_func(), and returns the
+ * resulting file names separated by spaces, or the error.
+ */
+static char *expand_include(config_t *config, const char *path)
+{
+  const char *error = NULL;
+  const char **files = config_glob_include_func(config, "./testdata", path,
+                                                &error);
+  char *buf = (char *)calloc(1, 1024);
+  int i;
+
+  if(! files)
+  {
+    strcpy(buf, error);
+    return(buf);
+  }
+
+  for(i = 0; files[i]; ++i)
+  {
+    strcat(buf, i ? " " : "");
+    strcat(buf, files[i]);
+    free((void *)files[i]);
+  }
+
+  free((void *)files);
+  return(buf);
+}
+
+TT_TEST(GlobIncludes)
+{
+  static const char *expected[][2] = {
+    { "glob/*.cfg", "./testdata/glob/05-base.cfg ./testdata/glob/10-net.cfg "
+      "./testdata/glob/20-db.cfg" },
+    { "glob", "./testdata/glob/05-base.cfg ./testdata/glob/10-net.cfg "
+      "./testdata/glob/20-db.cfg ./testdata/glob/notes.txt" },
+    { "glob/", "./testdata/glob/05-base.cfg ./testdata/glob/10-net.cfg "
+      "./testdata/glob/20-db.cfg ./testdata/glob/notes.txt" },
+    { "glob/.*", "./testdata/glob/.hidden.cfg" },
+    { "glob/[12]?-*.cfg", "./testdata/glob/10-net.cfg "
+      "./testdata/glob/20-db.cfg" },
+    { "glob/[!1]*", "./testdata/glob/05-base.cfg ./testdata/glob/20-db.cfg "
+      "./testdata/glob/notes.txt" },
+    { "glob/*s*", "./testdata/glob/05-base.cfg ./testdata/glob/notes.txt" },
+    { "glob/none*", "" },
+    { "missing/*.cfg", "cannot open include directory" },
+    { "more.cfg", "./testdata/more.cfg" }
+  };
+  config_include_cache_t *cache;
+  config_t cfg;
+  char *text;
+  const char *str;
+  FILE *fp;
+  int i, k, ival;
+
+  config_init(&cfg);
+
+  for(i = 0; i < (int)(sizeof(expected) / sizeof(expected[0])); ++i)
+  {
+    text = expand_include(&cfg, expected[i][0]);
+    TT_ASSERT_STR_EQ(expected[i][1], text);
+    free(text);
+  }
+
+  config_set_include_dir(&cfg, "./testdata");
+  config_set_include_func(&cfg, config_glob_include_func);
+  TT_ASSERT_TRUE(config_read_string(&cfg, "a = 0;\n@include \"glob/*.cfg\"\n"
+                                    "b = {\n  @include \"glob/none*\"\n};\n"));
+  TT_ASSERT_TRUE(config_lookup_int(&cfg, "net.port", &ival));
+  TT_ASSERT_INT_EQ(80, ival);
+  TT_ASSERT_STR_EQ("./testdata/glob/20-db.cfg", config_setting_source_file(
+                     config_lookup(&cfg, "db")));
+  TT_ASSERT_INT_EQ(3, config_setting_index(config_lookup(&cfg, "db")));
+  TT_ASSERT_INT_EQ(0, config_setting_length(config_lookup(&cfg, "b")));
+
+  TT_ASSERT_FALSE(config_read_string(&cfg, "@include \"missing/*.cfg\"\n"));
+  TT_ASSERT_STR_EQ("cannot open include directory", config_error_text(&cfg));
+
+  /* Listings kept in an include cache follow changes to the directory, even
+   * for includes in cached fragments.
+   */
+  fp = fopen("testdata/temp_glob.cfg", "wt");
+  TT_ASSERT_PTR_NOTNULL(fp);
+  fprintf(fp, "@include \"glob/*.cfg\"\n");
+  fclose(fp);
+
+  cache = config_include_cache_create();
+  config_set_include_cache(&cfg, cache);
+
+  for(k = 0; k < 3; ++k)
+  {
+    if(k == 1)
+    {
+      fp = fopen("testdata/glob/30-late.cfg", "wt");
+      TT_ASSERT_PTR_NOTNULL(fp);
+      fprintf(fp, "late = \"yes\";\n");
+      fclose(fp);
+    }
+    else if(k == 2)
+      remove("testdata/glob/30-late.cfg");
+
+    for(i = 0; i < 2; ++i)
+    {
+      TT_ASSERT_TRUE(config_read_string(&cfg, i ? "@include \"temp_glob.cfg\""
+                                        : "@include \"glob/*.cfg\""));
+      TT_ASSERT_TRUE(config_lookup_int(&cfg, "base", &ival));
+      TT_ASSERT_INT_EQ(k == 1, config_lookup_string(&cfg, "late", &str));
+    }
+  }
+
+  remove("testdata/temp_glob.cfg");
+  config_destroy(&cfg);
+  config_include_cache_destroy(cache);
+
+  /* Including a directory by name fails cleanly with either parser. */
+  for(k = 0; k <= 1; ++k)
+  {
+    config_init(&cfg);
+    config_set_include_dir(&cfg, "./testdata");
+    config_set_option(&cfg, CONFIG_OPTION_DIRECT_PARSER, k);
+    TT_ASSERT_FALSE(config_read_string(&cfg, "@include \"glob\"\n"));
+    TT_ASSERT_STR_EQ("cannot open include file", config_error_text(&cfg));
+    config_destroy(&cfg);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
 #if defined(BUILD_MONOLITHIC)
 #define main(cnt, arr)      config_tests_main(cnt, arr)
 #endif
@@ -734,6 +3044,31 @@ int main(int argc, const char** argv)
   TT_SUITE_TEST(LibConfigTests, SettingLookups);
   TT_SUITE_TEST(LibConfigTests, ReadStream);
   TT_SUITE_TEST(LibConfigTests, BinaryAndHex);
+  TT_SUITE_TEST(LibConfigTests, WideGroupLookups);
+  TT_SUITE_TEST(LibConfigTests, ArenaAllocation);
+  TT_SUITE_TEST(LibConfigTests, InternedNames);
+  TT_SUITE_TEST(LibConfigTests, InMemoryFiles);
+  TT_SUITE_TEST(LibConfigTests, ReadBuffer);
+  TT_SUITE_TEST(LibConfigTests, LongStrings);
+  TT_SUITE_TEST(LibConfigTests, CompiledPaths);
+  TT_SUITE_TEST(LibConfigTests, BatchLookups);
+  TT_SUITE_TEST(LibConfigTests, ThreadLocale);
+  TT_SUITE_TEST(LibConfigTests, WriteString);
+  TT_SUITE_TEST(LibConfigTests, NumberFormatting);
+  TT_SUITE_TEST(LibConfigTests, BinarySnapshots);
+  TT_SUITE_TEST(LibConfigTests, IncludeCache);
+  TT_SUITE_TEST(LibConfigTests, ConfigDiff);
+  TT_SUITE_TEST(LibConfigTests, ConfigReloader);
+  TT_SUITE_TEST(LibConfigTests, SettingCopy);
+  TT_SUITE_TEST(LibConfigTests, SettingMerge);
+  TT_SUITE_TEST(LibConfigTests, PackedArrays);
+  TT_SUITE_TEST(LibConfigTests, BulkArrays);
+  TT_SUITE_TEST(LibConfigTests, RemoveSettings);
+  TT_SUITE_TEST(LibConfigTests, FastScanning);
+  TT_SUITE_TEST(LibConfigTests, DirectParser);
+  TT_SUITE_TEST(LibConfigTests, ParallelIncludes);
+  TT_SUITE_TEST(LibConfigTests, GlobIncludes);
+  TT_SUITE_TEST(LibConfigTests, LazyLoad);
   TT_SUITE_RUN(LibConfigTests);
   failures = TT_SUITE_NUM_FAILURES(LibConfigTests);
   TT_SUITE_END(LibConfigTests);
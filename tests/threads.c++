@@ -0,0 +1,285 @@
+/* ----------------------------------------------------------------------------
+   libconfig - A library for processing structured configuration files
+   Copyright (C) 2005-2023  Mark A Lindner
+
+   This file is part of libconfig.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, see
+   <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------------
+*/
+
+// Concurrent read access to loaded configurations, through the C++ and the
+// C interfaces. Many threads walk the same freshly loaded tree at once, so
+// that they race to create the C++ wrappers for the same settings and the
+// element settings of packed arrays, and to parse the same group bodies when
+// those are loaded lazily; and many threads read a configuration
+// that is being reloaded over and over. Build with -fsanitize=thread to have
+// ThreadSanitizer check for data races.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libconfig.h>
+#include <libconfig.h++>
+
+using namespace libconfig;
+
+static const int GROUPS = 50;
+static const int MEMBERS = 20;
+static const int THREADS = 8;
+static const int ROUNDS = 20;
+static const int RELOADS = 200;
+
+static std::atomic<int> failures(0);
+
+// ---------------------------------------------------------------------------
+
+#define CHECK(C)                                                        \
+  do                                                                    \
+  {                                                                     \
+    if(! (C))                                                           \
+    {                                                                   \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+              #C);                                                      \
+      ++failures;                                                       \
+    }                                                                   \
+  } while(0)
+
+// ---------------------------------------------------------------------------
+
+static std::string makeConfig()
+{
+  std::ostringstream text;
+
+  for(int g = 0; g < GROUPS; ++g)
+  {
+    text << "group_" << g << " = {\n";
+    for(int m = 0; m < MEMBERS; ++m)
+    {
+      text << "  int_" << m << " = " << (g * MEMBERS + m) << ";\n"
+           << "  str_" << m << " = \"s" << m << "\";\n";
+    }
+    text << "  array = [";
+    for(int m = 0; m < MEMBERS; ++m)
+      text << (m ? ", " : " ") << (g + m);
+    text << " ];\n";
+    text << "  list = ( " << g << ", { x = " << g << "; } );\n};\n";
+  }
+
+  return(text.str());
+}
+
+// ---------------------------------------------------------------------------
+
+// Each thread records the wrapper it got for every setting it visited, so
+// that the main thread can check that all threads got the same ones.
+
+static void reader(const Config *config, const config_t *cconfig, int id,
+                   std::atomic<int> *ready,
+                   std::vector<const Setting *> *seen)
+{
+  ++*ready;
+  while(ready->load() < THREADS)
+    std::this_thread::yield();
+
+  char path[64];
+
+  for(int i = 0; i < GROUPS * MEMBERS; ++i)
+  {
+    // Start the threads at different places, so that they meet.
+    int k = (i + id * 97) % (GROUPS * MEMBERS);
+    int g = k / MEMBERS, m = k % MEMBERS;
+
+    sprintf(path, "group_%d.int_%d", g, m);
+    const Setting &s = config->lookup(path);
+    CHECK((int)s == k);
+    (*seen)[k] = &s;
+
+    int ival = -1;
+    CHECK(config_lookup_int(cconfig, path, &ival));
+    CHECK(ival == k);
+
+    if(m == 0)
+    {
+      int x = -1, first = -1;
+      std::string str;
+      sprintf(path, "group_%d", g);
+      const Setting &group = config->lookup(path);
+
+      LookupValue lookups[] = {
+        LookupValue("list.[1].x", x),
+        LookupValue("list.[0]", first),
+        LookupValue("str_3", str)
+      };
+      CHECK(group.lookupValues(lookups, 3) == 3);
+      CHECK((x == g) && (first == g) && (str == "s3"));
+
+      int count = 0;
+      for(Setting::const_iterator it = group.begin(); it != group.end(); ++it)
+        ++count;
+      CHECK(count == (MEMBERS * 2) + 2);
+
+      // The C getters read the packed values while the C++ subscripts make
+      // settings for them.
+      const Setting &array = group["array"];
+      const config_setting_t *carray = config_lookup(
+        cconfig, (std::string(path) + ".array").c_str());
+      CHECK(array.getLength() == MEMBERS);
+      std::vector<int> values = array.getArray<int>();
+      CHECK(values.size() == (size_t)MEMBERS);
+      for(int e = 0; e < MEMBERS; ++e)
+      {
+        CHECK(values[e] == g + e);
+        CHECK(config_setting_get_int_elem(carray, e) == g + e);
+        CHECK((int)array[e] == g + e);
+        CHECK(config_setting_get_int(config_setting_get_elem(carray, e))
+              == g + e);
+      }
+
+      CHECK(group[0].getPath() == std::string(path) + ".int_0");
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+static void writeGeneration(const char *filename, int generation)
+{
+  FILE *fp = fopen(filename, "wt");
+  CHECK(fp != NULL);
+  if(! fp)
+    return;
+
+  fprintf(fp, "generation = %d;\n", generation);
+  for(int g = 0; g < GROUPS; ++g)
+    fprintf(fp, "group_%d = { value = %d; };\n", g, generation);
+  fprintf(fp, "mirror = %d;\n", generation);
+  fclose(fp);
+}
+
+// ---------------------------------------------------------------------------
+
+// Each snapshot must be whole: every value in it comes from the same
+// generation, and generations never go backwards.
+
+static void reloadReader(config_reloader_t *reloader, std::atomic<bool> *stop,
+                         std::atomic<long> *reads)
+{
+  int last = 0;
+  char path[64];
+
+  while(! stop->load())
+  {
+    const config_t *cconfig = config_reloader_acquire(reloader);
+    int generation = -1, mirror = -2, value = -3;
+
+    CHECK(config_lookup_int(cconfig, "generation", &generation));
+    CHECK(config_lookup_int(cconfig, "mirror", &mirror));
+    sprintf(path, "group_%d.value", generation % GROUPS);
+    CHECK(config_lookup_int(cconfig, path, &value));
+    CHECK((generation == mirror) && (generation == value));
+    CHECK(generation >= last);
+    last = generation;
+
+    config_reloader_release(cconfig);
+    ++*reads;
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+static void reloadTest()
+{
+  const char *filename = "temp_threads_reload.cfg";
+
+  writeGeneration(filename, 0);
+  config_reloader_t *reloader = config_reloader_create(filename, NULL, NULL);
+
+  std::atomic<bool> stop(false);
+  std::atomic<long> reads(0);
+  std::vector<std::thread> threads;
+
+  for(int t = 0; t < THREADS; ++t)
+    threads.push_back(std::thread(reloadReader, reloader, &stop, &reads));
+
+  for(int generation = 1; generation <= RELOADS; ++generation)
+  {
+    writeGeneration(filename, generation);
+    CHECK(config_reloader_check(reloader));
+  }
+
+  stop = true;
+  for(int t = 0; t < THREADS; ++t)
+    threads[t].join();
+
+  config_reloader_destroy(reloader);
+  remove(filename);
+
+  printf("%d threads x %d reloads; %ld reads\n", THREADS, RELOADS,
+         reads.load());
+}
+
+// ---------------------------------------------------------------------------
+
+int main()
+{
+  std::string text = makeConfig();
+
+  for(int round = 0; round < ROUNDS; ++round)
+  {
+    // Every other pair of rounds, the group bodies are parsed on first
+    // access, and names are interned in half of those.
+    Config config;
+    config.setOption(Config::OptionLazyLoad, (round & 2) != 0);
+    config.readString(text);
+
+    // Every other round, the element settings come out of an arena.
+    config_t cconfig;
+    config_init(&cconfig);
+    config_set_option(&cconfig, CONFIG_OPTION_ARENA, round & 1);
+    config_set_option(&cconfig, CONFIG_OPTION_LAZY_LOAD, round & 2);
+    config_set_option(&cconfig, CONFIG_OPTION_INTERN_NAMES, round & 4);
+    CHECK(config_read_string(&cconfig, text.c_str()));
+
+    std::atomic<int> ready(0);
+    std::vector<std::vector<const Setting *> > seen(
+      THREADS, std::vector<const Setting *>(GROUPS * MEMBERS));
+    std::vector<std::thread> threads;
+
+    for(int t = 0; t < THREADS; ++t)
+      threads.push_back(std::thread(reader, &config, &cconfig, t, &ready,
+                                    &seen[t]));
+
+    for(int t = 0; t < THREADS; ++t)
+      threads[t].join();
+
+    for(int t = 1; t < THREADS; ++t)
+      CHECK(seen[t] == seen[0]);
+
+    config_destroy(&cconfig);
+  }
+
+  reloadTest();
+
+  printf("%d threads x %d rounds; %d failures\n", THREADS, ROUNDS,
+         failures.load());
+
+  return(failures.load() ? EXIT_FAILURE : EXIT_SUCCESS);
+}